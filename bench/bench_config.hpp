@@ -0,0 +1,240 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BENCH_CONFIG_HPP_
+#define BENCH_CONFIG_HPP_
+
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Synthetic configs and matching schemas for the benchmarks
+ *
+ * Every group holds one setting of each atom type. Groups above the
+ * leaf level have fanout child groups g0, g1, ..., leaf groups an
+ * integer array and a list of groups with a string, an integer and an
+ * array of floats each. All settings are required, so that the whole
+ * config is visited by validation. The output only depends on the
+ * shape.
+ */
+namespace bench {
+
+struct config_shape
+{
+	config_shape() :
+		depth(3),
+		fanout(4),
+		list_length(8),
+		array_size(16),
+		string_length(16)
+	{}
+
+	/** Levels of child groups below the root */
+	size_t depth;
+	size_t fanout;
+	/** Entries of the list in every leaf group */
+	size_t list_length;
+	/** Elements of every array */
+	size_t array_size;
+	/** Length of string values */
+	size_t string_length;
+};
+
+/** Command line options for the fields of a shape */
+inline void add_shape_options(boost::program_options::options_description& desc, config_shape& shape)
+{
+	namespace po = boost::program_options;
+	desc.add_options()
+		("depth",
+			po::value<size_t>(&shape.depth)->default_value(shape.depth),
+			"levels of groups below the root")
+		("fanout",
+			po::value<size_t>(&shape.fanout)->default_value(shape.fanout),
+			"child groups per group")
+		("list-length",
+			po::value<size_t>(&shape.list_length)->default_value(shape.list_length),
+			"entries of the list in every leaf group")
+		("array-size",
+			po::value<size_t>(&shape.array_size)->default_value(shape.array_size),
+			"elements of every array")
+		("string-length",
+			po::value<size_t>(&shape.string_length)->default_value(shape.string_length),
+			"length of string values")
+	;
+}
+
+/** Setting of a generated config, as a dotted lookup path */
+struct setting
+{
+	enum type_type { long_type, double_type, bool_type, string_type };
+
+	setting(const std::string& p, type_type t) : path(p), type(t) {}
+
+	std::string path;
+	type_type type;
+};
+
+class config_generator
+{
+public:
+	explicit config_generator(const config_shape& shape) : shape_(shape) {}
+
+	void write_config(std::ostream& out) const
+	{
+		size_t counter = 0;
+		write_group(out, 0, counter);
+	}
+
+	void write_schema(std::ostream& out) const
+	{
+		write_schema_group(out, 0);
+	}
+
+	/** All settings of the config, including list entries and array elements */
+	std::vector<setting> settings() const
+	{
+		std::vector<setting> r;
+		collect(r, "", 0);
+		return r;
+	}
+
+private:
+	static void indent(std::ostream& out, size_t level)
+	{
+		for(size_t i = 0; i < level; i++)
+			out << '\t';
+	}
+
+	std::string make_string(size_t seed) const
+	{
+		std::string s(shape_.string_length, 'a');
+		for(size_t i = 0; i < s.size(); i++)
+			s[i] = static_cast<char>('a' + (seed + i) % 26);
+		return s;
+	}
+
+	void write_group(std::ostream& out, size_t level, size_t& counter) const
+	{
+		const size_t n = counter++;
+		indent(out, level); out << "id = " << n << ";\n";
+		indent(out, level); out << "ratio = " << n << ".5;\n";
+		indent(out, level); out << "enabled = " << (n % 2 == 0 ? "true" : "false") << ";\n";
+		indent(out, level); out << "name = \"" << make_string(n) << "\";\n";
+
+		if(level < shape_.depth)
+		{
+			for(size_t i = 0; i < shape_.fanout; i++)
+			{
+				indent(out, level); out << "g" << i << " {\n";
+				write_group(out, level + 1, counter);
+				indent(out, level); out << "}\n";
+			}
+			return;
+		}
+
+		indent(out, level); out << "values = [";
+		for(size_t i = 0; i < shape_.array_size; i++)
+			out << (i == 0 ? " " : ", ") << n + i;
+		out << " ];\n";
+
+		indent(out, level); out << "entries = (\n";
+		for(size_t j = 0; j < shape_.list_length; j++)
+		{
+			indent(out, level + 1);
+			out << "{ key = \"" << make_string(n + j) << "\"; value = " << j << "; weights = [";
+			for(size_t i = 0; i < shape_.array_size; i++)
+				out << (i == 0 ? " " : ", ") << i << ".25";
+			out << " ]; }" << (j + 1 < shape_.list_length ? "," : "") << "\n";
+		}
+		indent(out, level); out << ");\n";
+	}
+
+	void write_schema_group(std::ostream& out, size_t level) const
+	{
+		indent(out, level); out << "id required (int);\n";
+		indent(out, level); out << "ratio required (float);\n";
+		indent(out, level); out << "enabled required (bool);\n";
+		indent(out, level); out << "name required (string);\n";
+
+		if(level < shape_.depth)
+		{
+			for(size_t i = 0; i < shape_.fanout; i++)
+			{
+				indent(out, level); out << "g" << i << " required (group) {\n";
+				write_schema_group(out, level + 1);
+				indent(out, level); out << "};\n";
+			}
+			return;
+		}
+
+		indent(out, level); out << "values required (array) { (int) };\n";
+		indent(out, level); out << "entries required (list) {\n";
+		indent(out, level + 1); out << "(group) {\n";
+		indent(out, level + 2); out << "key required (string);\n";
+		indent(out, level + 2); out << "value required (int);\n";
+		indent(out, level + 2); out << "weights required (array) { (float) };\n";
+		indent(out, level + 1); out << "}\n";
+		indent(out, level); out << "};\n";
+	}
+
+	void collect(std::vector<setting>& r, const std::string& prefix, size_t depth) const
+	{
+		r.push_back(setting(prefix + "id", setting::long_type));
+		r.push_back(setting(prefix + "ratio", setting::double_type));
+		r.push_back(setting(prefix + "enabled", setting::bool_type));
+		r.push_back(setting(prefix + "name", setting::string_type));
+
+		if(depth < shape_.depth)
+		{
+			for(size_t i = 0; i < shape_.fanout; i++)
+				collect(r, prefix + "g" + boost::lexical_cast<std::string>(i) + ".", depth + 1);
+			return;
+		}
+
+		for(size_t i = 0; i < shape_.array_size; i++)
+			r.push_back(setting(prefix + "values[" + boost::lexical_cast<std::string>(i) + "]", setting::long_type));
+		for(size_t j = 0; j < shape_.list_length; j++)
+		{
+			const std::string entry = prefix + "entries[" + boost::lexical_cast<std::string>(j) + "].";
+			r.push_back(setting(entry + "key", setting::string_type));
+			r.push_back(setting(entry + "value", setting::long_type));
+			for(size_t i = 0; i < shape_.array_size; i++)
+				r.push_back(setting(entry + "weights[" + boost::lexical_cast<std::string>(i) + "]", setting::double_type));
+		}
+	}
+
+	config_shape shape_;
+};
+
+}
+
+#endif
@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Compares lookup and iteration performance of cconfig::group against
+// the boost::ptr_map based storage it used to have.
+
+#include "config_tree.hpp"
+
+#include <boost/ptr_container/ptr_map.hpp>
+#include <boost/chrono.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+namespace {
+
+typedef boost::chrono::steady_clock clock_type;
+typedef boost::ptr_map<std::string, cconfig::atom> reference_map;
+
+// keeps the compiler from optimizing the measured loops away
+volatile size_t sink;
+
+std::vector<std::string> make_keys(size_t n)
+{
+	std::vector<std::string> keys;
+	for(size_t i=0; i<n; i++)
+		keys.push_back("setting_" + boost::lexical_cast<std::string>(std::rand()) + "_" + boost::lexical_cast<std::string>(i));
+	return keys;
+}
+
+double ns_per_op(clock_type::time_point start, size_t ops)
+{
+	boost::chrono::nanoseconds d = clock_type::now() - start;
+	return static_cast<double>(d.count()) / ops;
+}
+
+void run(size_t n)
+{
+	std::vector<std::string> keys = make_keys(n);
+
+	cconfig::arena a;
+	cconfig::symbol_table symbols(a);
+	cconfig::group& g = *new(a) cconfig::group(symbols);
+	reference_map m;
+	for(size_t i=0; i<n; i++)
+	{
+		g.insert(keys[i], new(a) cconfig::atom(static_cast<long>(i)));
+		std::string k(keys[i]);
+		m.insert(k, new cconfig::atom(static_cast<long>(i)));
+	}
+
+	// roughly the same amount of work for every group size
+	const size_t rounds = 2000000 / n + 1;
+	size_t found = 0;
+
+	clock_type::time_point start = clock_type::now();
+	for(size_t r=0; r<rounds; r++)
+		for(size_t i=0; i<n; i++)
+			found += (m.find(keys[i]) != m.end());
+	double map_lookup = ns_per_op(start, rounds * n);
+
+	start = clock_type::now();
+	for(size_t r=0; r<rounds; r++)
+		for(size_t i=0; i<n; i++)
+			found += (g.get_if(keys[i]) != NULL);
+	double group_lookup = ns_per_op(start, rounds * n);
+
+	std::vector<const cconfig::symbol*> resolved;
+	for(size_t i=0; i<n; i++)
+		resolved.push_back(symbols.find(keys[i]));
+
+	start = clock_type::now();
+	for(size_t r=0; r<rounds; r++)
+		for(size_t i=0; i<n; i++)
+			found += (g.get_if(resolved[i]) != NULL);
+	double symbol_lookup = ns_per_op(start, rounds * n);
+
+	start = clock_type::now();
+	for(size_t r=0; r<rounds; r++)
+		for(reference_map::const_iterator it = m.begin(); it != m.end(); ++it)
+			found += it->first.size();
+	double map_iterate = ns_per_op(start, rounds * n);
+
+	start = clock_type::now();
+	for(size_t r=0; r<rounds; r++)
+		for(cconfig::group::iterator it = g.begin(); it != g.end(); ++it)
+			found += it->key->name.size();
+	double group_iterate = ns_per_op(start, rounds * n);
+
+	sink = found;
+
+	std::cout << std::setw(8) << n
+		<< std::setw(16) << map_lookup << std::setw(16) << group_lookup << std::setw(16) << symbol_lookup
+		<< std::setw(16) << map_iterate << std::setw(16) << group_iterate
+		<< std::endl;
+}
+
+}
+
+int main()
+{
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "All times in ns per element" << std::endl;
+	std::cout << std::setw(8) << "keys"
+		<< std::setw(16) << "ptr_map find" << std::setw(16) << "group find" << std::setw(16) << "symbol find"
+		<< std::setw(16) << "ptr_map iter" << std::setw(16) << "group iter"
+		<< std::endl;
+
+	const size_t sizes[] = { 1, 2, 4, 8, 16, 64, 256, 1024, 4096, 16384 };
+	for(size_t i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+		run(sizes[i]);
+
+	return 0;
+}
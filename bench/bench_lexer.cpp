@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Measures the throughput of the hand-written config lexer and of the
+// scanning kernels it uses, compared to their scalar implementations.
+
+#include "config_parser.hpp"
+#include "config_scan.hpp"
+
+#include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+namespace {
+
+typedef boost::chrono::steady_clock clock_type;
+
+// keeps the compiler from optimizing the measured loops away
+volatile size_t sink;
+
+// input dominated by indentation, comments and long string literals as
+// found in generated configs
+std::string make_input(size_t entries)
+{
+	std::string s;
+	for(size_t i=0; i<entries; i++)
+	{
+		std::string n = boost::lexical_cast<std::string>(i);
+		s += "\n\t\t\t\t// generated entry " + n + ", do not edit by hand\n";
+		s += "\t\t\t\tentry_" + n + " = \"a fairly long string literal describing entry " + n
+			+ " of the benchmark input\";\n";
+		s += "\t\t\t\t/* block comment spanning\n\t\t\t\t   more than one line */\n";
+		s += "\n\n                                values_" + n + " = [ 1, 2, 3, 4 ];\n";
+	}
+	return s;
+}
+
+template<typename Function>
+double mb_per_second(const std::string& input, Function f)
+{
+	const size_t rounds = 20;
+	clock_type::time_point start = clock_type::now();
+	for(size_t r=0; r<rounds; r++)
+		sink = f(input.data(), input.data() + input.size());
+	boost::chrono::duration<double> d = clock_type::now() - start;
+	return input.size() * rounds / (1024.0 * 1024.0) / d.count();
+}
+
+size_t lex(const char* begin, const char* end)
+{
+	cconfig::lexer l(begin, end, "<bench>");
+	cconfig::token t;
+	size_t n = 0;
+	for(l.next(t); t.type != cconfig::token::end_of_input; l.next(t))
+		n++;
+	return n;
+}
+
+template<const char* (*Skip)(const char*, const char*)>
+size_t skip_whitespace(const char* p, const char* end)
+{
+	// skip whitespace runs and step over the text in between, as the
+	// lexer does between tokens
+	size_t n = 0;
+	while((p = Skip(p, end)) != end)
+	{
+		while(p != end && !cconfig::scan::is_whitespace(*p))
+			++p;
+		n++;
+	}
+	return n;
+}
+
+template<const char* (*Find)(const char*, const char*, char)>
+size_t find_newlines(const char* p, const char* end)
+{
+	size_t n = 0;
+	while((p = Find(p, end, '\n')) != end)
+		++p, ++n;
+	return n;
+}
+
+template<const char* (*Find)(const char*, const char*)>
+size_t find_quotes(const char* p, const char* end)
+{
+	size_t n = 0;
+	while((p = Find(p, end)) != end)
+		++p, ++n;
+	return n;
+}
+
+}
+
+int main()
+{
+	namespace scan = cconfig::scan;
+
+	std::string input = make_input(100000);
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "Input size " << input.size() / (1024.0 * 1024.0) << " MB, all values in MB/s" << std::endl;
+	std::cout << std::setw(28) << "" << std::setw(12) << "simd" << std::setw(12) << "scalar" << std::endl;
+
+	std::cout << std::setw(28) << "skip_whitespace"
+		<< std::setw(12) << mb_per_second(input, skip_whitespace<scan::skip_whitespace>)
+		<< std::setw(12) << mb_per_second(input, skip_whitespace<scan::scalar::skip_whitespace>) << std::endl;
+	std::cout << std::setw(28) << "find_char"
+		<< std::setw(12) << mb_per_second(input, find_newlines<scan::find_char>)
+		<< std::setw(12) << mb_per_second(input, find_newlines<scan::scalar::find_char>) << std::endl;
+	std::cout << std::setw(28) << "find_quote_or_backslash"
+		<< std::setw(12) << mb_per_second(input, find_quotes<scan::find_quote_or_backslash>)
+		<< std::setw(12) << mb_per_second(input, find_quotes<scan::scalar::find_quote_or_backslash>) << std::endl;
+	std::cout << std::setw(28) << "lexer" << std::setw(12) << mb_per_second(input, lex) << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Compares load times of the hand-written parser (sequential and parallel)
+// and the ANTLR generated parser on a synthetic config made of a list of
+// groups and numeric arrays.
+
+#include "config_file.hpp"
+
+#include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+
+namespace {
+
+typedef boost::chrono::steady_clock clock_type;
+
+std::string make_config(size_t entries)
+{
+	std::string s = "// synthetic benchmark config\nsettings {\n\tlist = (\n";
+	for(size_t i=0; i<entries; i++)
+	{
+		std::string n = boost::lexical_cast<std::string>(i);
+		s += "\t\t{ name = \"entry number " + n + "\"; id = " + n + "; weight = "
+			+ boost::lexical_cast<std::string>(std::rand() / 1000.0) + "; enabled = true;\n"
+			+ "\t\t  values = [ 1, 2, 3, 4, 5, 6, 7, 8 ]; /* trailing comment */ }";
+		s += (i + 1 < entries) ? ",\n" : "\n";
+	}
+	s += "\t);\n}\n";
+	return s;
+}
+
+double seconds_per_load(const std::string& config, const cconfig::load_options& options, size_t rounds)
+{
+	clock_type::time_point start = clock_type::now();
+	for(size_t r=0; r<rounds; r++)
+	{
+		cconfig::file f;
+		f.load_from_buffer(config.data(), config.size(), options);
+	}
+	boost::chrono::duration<double> d = clock_type::now() - start;
+	return d.count() / rounds;
+}
+
+}
+
+int main()
+{
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::setw(10) << "entries" << std::setw(10) << "MB"
+		<< std::setw(16) << "builtin MB/s" << std::setw(16) << "parallel MB/s"
+		<< std::setw(16) << "antlr MB/s" << std::setw(10) << "speedup" << std::endl;
+
+	cconfig::load_options builtin_options;
+	cconfig::load_options parallel_options;
+	parallel_options.mode = cconfig::load_options::parallel;
+	cconfig::load_options antlr_options;
+	antlr_options.parser = cconfig::load_options::antlr_parser;
+
+	const size_t sizes[] = { 100, 1000, 10000, 100000 };
+	for(size_t i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+	{
+		std::string config = make_config(sizes[i]);
+		const double mb = config.size() / (1024.0 * 1024.0);
+		const size_t rounds = static_cast<size_t>(20 / mb) + 1;
+
+		double builtin = seconds_per_load(config, builtin_options, rounds);
+		double parallel = seconds_per_load(config, parallel_options, rounds);
+		double antlr = seconds_per_load(config, antlr_options, rounds);
+
+		std::cout << std::setw(10) << sizes[i] << std::setw(10) << mb
+			<< std::setw(16) << mb / builtin << std::setw(16) << mb / parallel << std::setw(16) << mb / antlr
+			<< std::setw(10) << antlr / builtin << std::endl;
+	}
+
+	return 0;
+}
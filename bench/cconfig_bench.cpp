@@ -0,0 +1,332 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Benchmark suite on synthetic configs (see bench_config.hpp). Every
+// result is written as one JSON object per line with the shape of the
+// config, the latency percentiles of single operations, the throughput
+// and the peak resident set size of the process so far.
+//
+// The generated wrapper is compiled for the default shape, so the
+// load_config and parse_config benchmarks always use that shape.
+
+#include "bench_config.hpp"
+#include "bench_wrapper.hpp"
+#include "bench_wrapper_parser.hpp"
+
+#include "config_file.hpp"
+#include "config_schema.hpp"
+
+#include <boost/chrono.hpp>
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+typedef boost::chrono::steady_clock clock_type;
+
+// keeps the compiler from optimizing the measured operations away
+volatile size_t sink;
+
+size_t peak_rss_kb()
+{
+#ifdef __unix__
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) == 0)
+		return static_cast<size_t>(usage.ru_maxrss);
+#endif
+	return 0;
+}
+
+std::string write_files(const bench::config_shape& shape, const std::string& prefix)
+{
+	const bench::config_generator generator(shape);
+	std::ofstream config((prefix + ".conf").c_str());
+	generator.write_config(config);
+	std::ofstream schema((prefix + ".schema").c_str());
+	generator.write_schema(schema);
+	return prefix;
+}
+
+size_t file_size(const std::string& filename)
+{
+	std::ifstream in(filename.c_str(), std::ios::binary | std::ios::ate);
+	return static_cast<size_t>(in.tellg());
+}
+
+class runner
+{
+public:
+	runner(double min_time, size_t min_iterations, const std::string& filter) :
+		min_time_(min_time),
+		min_iterations_(min_iterations),
+		filter_(filter)
+	{}
+
+	/**
+	 * @brief Measures f and writes the result
+	 *
+	 * @param bytes Input size of one operation, 0 if it has none
+	 * @param items Number of items processed by one operation, 0 if
+	 * only the operations are counted
+	 */
+	template<typename Function>
+	void run(const std::string& name, const bench::config_shape& shape,
+		size_t bytes, size_t items, Function f)
+	{
+		if(name.find(filter_) == std::string::npos)
+			return;
+
+		std::vector<double> latencies;
+		const clock_type::time_point start = clock_type::now();
+		do
+		{
+			const clock_type::time_point begin = clock_type::now();
+			f();
+			const clock_type::time_point end = clock_type::now();
+			latencies.push_back(boost::chrono::duration<double>(end - begin).count());
+		} while(latencies.size() < min_iterations_
+			|| boost::chrono::duration<double>(clock_type::now() - start).count() < min_time_);
+
+		report(name, shape, bytes, items, latencies);
+	}
+
+private:
+	/** Nearest rank percentile of sorted latencies in microseconds */
+	static double percentile(const std::vector<double>& sorted, double p)
+	{
+		size_t rank = static_cast<size_t>(p * sorted.size() + 0.999999);
+		rank = std::max<size_t>(rank, 1);
+		return sorted[std::min(rank, sorted.size()) - 1] * 1e6;
+	}
+
+	static void report(const std::string& name, const bench::config_shape& shape,
+		size_t bytes, size_t items, std::vector<double>& latencies)
+	{
+		std::sort(latencies.begin(), latencies.end());
+		double total = 0;
+		for(size_t i = 0; i < latencies.size(); i++)
+			total += latencies[i];
+		const double mean = total / latencies.size();
+
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(3);
+		out << "{\"benchmark\":\"" << name << "\""
+			<< ",\"depth\":" << shape.depth
+			<< ",\"fanout\":" << shape.fanout
+			<< ",\"list_length\":" << shape.list_length
+			<< ",\"array_size\":" << shape.array_size
+			<< ",\"string_length\":" << shape.string_length
+			<< ",\"iterations\":" << latencies.size();
+		if(bytes != 0)
+			out << ",\"bytes\":" << bytes << ",\"mb_per_s\":" << bytes / mean / (1024.0 * 1024.0);
+		if(items != 0)
+			out << ",\"items\":" << items << ",\"items_per_s\":" << items / mean;
+		out << ",\"mean_us\":" << mean * 1e6
+			<< ",\"p50_us\":" << percentile(latencies, 0.5)
+			<< ",\"p90_us\":" << percentile(latencies, 0.9)
+			<< ",\"p99_us\":" << percentile(latencies, 0.99)
+			<< ",\"max_us\":" << latencies.back() * 1e6
+			<< ",\"peak_rss_kb\":" << peak_rss_kb()
+			<< "}";
+		std::cout << out.str() << std::endl;
+	}
+
+	double min_time_;
+	size_t min_iterations_;
+	std::string filter_;
+};
+
+struct load
+{
+	explicit load(const std::string& f) : filename(f) {}
+	void operator()() const
+	{
+		cconfig::file f;
+		f.load(filename);
+		sink = f.root().size();
+	}
+	std::string filename;
+};
+
+struct lookup
+{
+	lookup(const cconfig::file& c, const std::vector<bench::setting>& s) : config(c), settings(s) {}
+	void operator()() const
+	{
+		size_t n = 0;
+		for(std::vector<bench::setting>::const_iterator it = settings.begin(); it != settings.end(); ++it)
+		{
+			switch(it->type)
+			{
+			case bench::setting::long_type: n += config.lookup<long>(it->path); break;
+			case bench::setting::double_type: n += config.lookup<double>(it->path) > 0; break;
+			case bench::setting::bool_type: n += config.lookup<bool>(it->path); break;
+			case bench::setting::string_type: n += config.lookup<std::string>(it->path).size(); break;
+			}
+		}
+		sink = n;
+	}
+	const cconfig::file& config;
+	const std::vector<bench::setting>& settings;
+};
+
+struct validate
+{
+	validate(const cconfig::schema::schema& s, const cconfig::file& c, bool st) : schema(s), config(c), strict(st) {}
+	void operator()() const
+	{
+		sink = schema.validate(config, strict).valid;
+	}
+	const cconfig::schema::schema& schema;
+	const cconfig::file& config;
+	bool strict;
+};
+
+/** What cconfig_code_gen does with the --parser option */
+struct code_gen
+{
+	code_gen(const std::string& f, const std::string& d) : filename(f), dir(d) {}
+	void operator()() const
+	{
+		cconfig::schema::schema s;
+		s.load(filename);
+		sink = s.generate_wrapper("cconfig_bench_code_gen", dir, "");
+		sink = s.generate_parser("cconfig_bench_code_gen", dir, "");
+	}
+	std::string filename;
+	std::string dir;
+};
+
+struct load_config
+{
+	explicit load_config(const std::string& f) : filename(f) {}
+	void operator()() const
+	{
+		const cconfig::wrapper::Config c = cconfig::wrapper::load_config(filename);
+		sink = c.id;
+	}
+	std::string filename;
+};
+
+struct parse_config
+{
+	explicit parse_config(const std::string& f) : filename(f) {}
+	void operator()() const
+	{
+		const cconfig::wrapper::Config c = cconfig::wrapper::parse_config(filename);
+		sink = c.id;
+	}
+	std::string filename;
+};
+
+}
+
+int main(int argc, char** argv)
+{
+	std::string dir;
+	std::string filter;
+	double min_time;
+	size_t min_iterations;
+	bench::config_shape shape;
+
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help", "show this message")
+		("dir,d",
+			po::value<std::string>(&dir)->default_value("."),
+			"directory for the generated configs and code (default '.')")
+		("filter,b",
+			po::value<std::string>(&filter)->default_value(""),
+			"only run benchmarks whose name contains the given text")
+		("min-time,t",
+			po::value<double>(&min_time)->default_value(1.0),
+			"minimum run time of each benchmark in seconds (default 1)")
+		("min-iterations,n",
+			po::value<size_t>(&min_iterations)->default_value(10),
+			"minimum number of operations of each benchmark (default 10)")
+	;
+	bench::add_shape_options(desc, shape);
+
+	boost::program_options::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+
+	if(vm.count("help"))
+	{
+		std::cout << "Usage: cconfig_bench [options]" << std::endl;
+		std::cout << desc << std::endl;
+		return 0;
+	}
+
+	try
+	{
+		const std::string prefix = write_files(shape, dir + "/cconfig_bench");
+		const std::string conf = prefix + ".conf";
+		const std::string schema_file = prefix + ".schema";
+
+		cconfig::file config(conf);
+		cconfig::schema::schema schema(schema_file);
+		const cconfig::schema::validation_result r = schema.validate(config, true);
+		if(!r.valid)
+			throw cconfig::exception("Generated config is invalid at " + r.error_uri + ": " + r.error_message);
+
+		const std::vector<bench::setting> settings = bench::config_generator(shape).settings();
+		const size_t bytes = file_size(conf);
+
+		runner suite(min_time, min_iterations, filter);
+		suite.run("load", shape, bytes, 0, load(conf));
+		suite.run("lookup", shape, 0, settings.size(), lookup(config, settings));
+		suite.run("validate", shape, bytes, 0, validate(schema, config, false));
+		suite.run("validate_strict", shape, bytes, 0, validate(schema, config, true));
+		suite.run("code_gen", shape, file_size(schema_file), 0, code_gen(schema_file, dir));
+
+		const bench::config_shape wrapper_shape;
+		const std::string wrapper_conf = write_files(wrapper_shape, dir + "/cconfig_bench_wrapper") + ".conf";
+		const size_t wrapper_bytes = file_size(wrapper_conf);
+		suite.run("load_config", wrapper_shape, wrapper_bytes, 0, load_config(wrapper_conf));
+		suite.run("parse_config", wrapper_shape, wrapper_bytes, 0, parse_config(wrapper_conf));
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Writes a synthetic config and its schema as used by cconfig_bench, so
+// that benchmarks can be repeated with other tools or configs of other
+// shapes.
+
+#include "bench_config.hpp"
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+	std::string output;
+	bench::config_shape shape;
+
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help", "show this message")
+		("output,o",
+			po::value<std::string>(&output)->default_value("bench"),
+			"output file name without extension, writes .conf and .schema (default 'bench')")
+	;
+	bench::add_shape_options(desc, shape);
+
+	boost::program_options::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+
+	if(vm.count("help"))
+	{
+		std::cout << "Usage: cconfig_bench_gen [options]" << std::endl;
+		std::cout << desc << std::endl;
+		return 0;
+	}
+
+	const bench::config_generator generator(shape);
+	std::ofstream config((output + ".conf").c_str());
+	generator.write_config(config);
+	std::ofstream schema((output + ".schema").c_str());
+	generator.write_schema(schema);
+
+	config.close();
+	schema.close();
+	if(!config || !schema)
+	{
+		std::cerr << "Unable to write " << output << ".conf and " << output << ".schema" << std::endl;
+		return 1;
+	}
+	return 0;
+}
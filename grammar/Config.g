@@ -32,14 +32,51 @@ options {
     language=Cpp;
 }
 
+@lexer::includes {
+#include "config_antlr_pool.hpp"
+}
+
 @parser::includes {
 #include "ConfigLexer.hpp"
-#include "config_tree.hpp"
+#include "config_builder.hpp"
+}
+
+@parser::members {
+// text of a token as a view into the parser input
+template<typename Token>
+static boost::string_ref token_text(const Token* t)
+{
+    const char* begin = reinterpret_cast<const char*>(t->get_startIndex());
+    const char* end = reinterpret_cast<const char*>(t->get_stopIndex()) + 1;
+    return boost::string_ref(begin, end - begin);
+}
+
+// rethrows a value conversion error at the location of its token
+template<typename Token>
+static void throw_at(const cconfig::parse_error& e, const Token* t)
+{
+    throw cconfig::parse_error(e.what(), t->get_line(), t->get_charPositionInLine() + 1);
+}
 }
 
 @lexer::traits {
 class ConfigLexer; class ConfigParser;
-typedef antlr3::Traits<ConfigLexer, ConfigParser> ConfigLexerTraits;
+
+// Lex tokens in small batches while parsing instead of buffering the
+// whole input up front, every rule discards the tokens it consumed when
+// it returns. The grammar is LL(1), so no rule looks back further than
+// the previous token. The runtime allocates from a pool that is reset
+// after each load (see cconfig::antlr_pool).
+template<class ImplTraits>
+class ConfigUserTraits : public antlr3::CustomTraitsBase<ImplTraits>
+{
+public:
+    typedef cconfig::antlr_pool_policy AllocPolicyType;
+    static const bool TOKENS_ACCESSED_FROM_OWNING_RULE = true;
+    static const int TOKEN_FILL_BUFFER_INCREMENT = 64;
+};
+
+typedef antlr3::Traits<ConfigLexer, ConfigParser, ConfigUserTraits> ConfigLexerTraits;
 typedef ConfigLexerTraits ConfigParserTraits;
 }
 
@@ -47,6 +84,10 @@ BOOLEAN
     :   'true' | 'false'
     ;
 
+INCLUDE
+    :   '@include'
+    ;
+
 ID  :   ('a'..'z'|'A'..'Z'|'_') ('a'..'z'|'A'..'Z'|'0'..'9'|'_')*
     ;
 
@@ -72,7 +113,7 @@ WS  :   ( ' '
     ;
 
 STRING
-    :  '"' ( ESC_SEQ | ~('\\'|'"') )* '"'   { setText(getText().substr(1, getText().length() - 2)); }
+    :  '"' ( ESC_SEQ | ~('\\'|'"') )* '"'
     ;
 
 fragment
@@ -100,109 +141,146 @@ UNICODE_ESC
     :   '\\' 'u' HEX_DIGIT HEX_DIGIT HEX_DIGIT HEX_DIGIT
     ;
 
-file returns [cconfig::group* root]
-@init { $root = new cconfig::group(); }
-    :   definition[$root]* EOF
+file[cconfig::tree_builder* builder] returns [cconfig::group* root]
+@init { $root = $builder->make_group(); }
+    :   definition[$root, $builder]* EOF
     ;
 
-definition[cconfig::group* g]
-    :   groupDefinition[$g]
-    |   variableDefinition[$g]
+definition[cconfig::group* g, cconfig::tree_builder* builder]
+    :   groupDefinition[$g, $builder]
+    |   variableDefinition[$g, $builder]
+    |   includeDirective[$g, $builder]
     ;
 
-groupDefinition[cconfig::group* g]
-    :   i=ID group
-        { $g->insert($i.text, $group.value); }
+// the settings of the included file are added to the enclosing group
+
+includeDirective[cconfig::group* g, cconfig::tree_builder* builder]
+    :   INCLUDE STRING
+        {
+            try { $builder->include(*$g, token_text($STRING)); }
+            catch(const cconfig::parse_error& e) { if(e.line() != 0) throw; throw_at(e, $STRING); }
+        }
     ;
 
-variableDefinition[cconfig::group* g]
+groupDefinition[cconfig::group* g, cconfig::tree_builder* builder]
+    :   i=ID group[$builder]
+        { $g->insert(token_text($i), $group.value); }
+    ;
+
+variableDefinition[cconfig::group* g, cconfig::tree_builder* builder]
     :   i=ID '='
-        (   list    { $g->insert($i.text, $list.value); }
-        |   array   { $g->insert($i.text, $array.value); }
-        |   atom    { $g->insert($i.text, $atom.value); }
+        (   list[$builder]    { $g->insert(token_text($i), $list.value); }
+        |   array[$builder]   { $g->insert(token_text($i), $array.value); }
+        |   atom[$builder]    { $g->insert(token_text($i), $atom.value); }
         ) ';'
     ;
 
-group returns [cconfig::group* value]
-@init { $value = new cconfig::group(); }
+group[cconfig::tree_builder* builder] returns [cconfig::group* value]
+@init { $value = $builder->make_group(); }
     :   '{'
-        definition[$value]*
+        definition[$value, $builder]*
         '}'
     ;
 
-list returns [cconfig::list* value]
-@init { $value = new cconfig::list(); }
+list[cconfig::tree_builder* builder] returns [cconfig::list* value]
+@init { $value = $builder->make_list(); }
     :   '('
-        listBody[$value]?
+        listBody[$value, $builder]?
         ')'
     ;
 
-listBody[cconfig::list* l]
-    :   a=listElement { $l->append($a.value); }
-        (',' b=listElement { $l->append($b.value); } )*
+listBody[cconfig::list* l, cconfig::tree_builder* builder]
+    :   a=listElement[$builder] { $l->append($a.value); }
+        (',' b=listElement[$builder] { $l->append($b.value); } )*
     ;
 
-listElement returns [cconfig::element* value]
-    :   group   { $value = $group.value; }
-    |   list    { $value = $list.value; }   
-    |   array   { $value = $array.value; }
-    |   atom    { $value = $atom.value; }
+listElement[cconfig::tree_builder* builder] returns [cconfig::element* value]
+    :   group[$builder]   { $value = $group.value; }
+    |   list[$builder]    { $value = $list.value; }
+    |   array[$builder]   { $value = $array.value; }
+    |   atom[$builder]    { $value = $atom.value; }
     ;
 
-array returns [cconfig::list* value]
-@init { $value = new cconfig::list(); }
+array[cconfig::tree_builder* builder] returns [cconfig::list* value]
+@init { $value = $builder->make_list(); }
     :   '['
-        (   floatArrayBody[$value]
-        |   intArrayBody[$value]
-        |   boolArrayBody[$value]
-        |   stringArrayBody[$value]
+        (   floatArrayBody[$value, $builder]
+        |   intArrayBody[$value, $builder]
+        |   boolArrayBody[$value, $builder]
+        |   stringArrayBody[$value, $builder]
         )?
         ']'
     ;
     
-floatArrayBody[cconfig::list* l]
-    :   a=float_ { $l->append($a.value); }
-        (',' b=float_ { $l->append($b.value); } )*
+floatArrayBody[cconfig::list* l, cconfig::tree_builder* builder]
+    :   floatElement[$l, $builder] (',' floatElement[$l, $builder])*
     ;
 
-intArrayBody[cconfig::list* l]
-    :   a=int_ { $l->append($a.value); }
-        (',' b=int_ { $l->append($b.value); } )*
+intArrayBody[cconfig::list* l, cconfig::tree_builder* builder]
+    :   intElement[$l, $builder] (',' intElement[$l, $builder])*
     ;
     
-boolArrayBody[cconfig::list* l]
-    :   a=bool_ { $l->append($a.value); }
-        (',' b=bool_ { $l->append($b.value); } )*
+boolArrayBody[cconfig::list* l, cconfig::tree_builder* builder]
+    :   boolElement[$l, $builder] (',' boolElement[$l, $builder])*
+    ;
+
+// numbers and booleans are kept in the typed storage of the array
+
+floatElement[cconfig::list* l, cconfig::tree_builder* builder]
+    :   FLOAT
+        {
+            try { $builder->append_float(*$l, token_text($FLOAT)); }
+            catch(const cconfig::parse_error& e) { throw_at(e, $FLOAT); }
+        }
+    ;
+
+intElement[cconfig::list* l, cconfig::tree_builder* builder]
+    :   INT
+        {
+            try { $builder->append_int(*$l, token_text($INT)); }
+            catch(const cconfig::parse_error& e) { throw_at(e, $INT); }
+        }
+    ;
+
+boolElement[cconfig::list* l, cconfig::tree_builder* builder]
+    :   BOOLEAN
+        { $builder->append_bool(*$l, token_text($BOOLEAN)); }
     ;
 
-stringArrayBody[cconfig::list* l]
-    :   a=string_ { $l->append($a.value); }
-        (',' b=string_ { $l->append($b.value); } )*
+stringArrayBody[cconfig::list* l, cconfig::tree_builder* builder]
+    :   a=string_[$builder] { $l->append($a.value); }
+        (',' b=string_[$builder] { $l->append($b.value); } )*
     ;
 
-atom returns [cconfig::element* value]
-    :   float_  { $value = $float_.value; }
-    |   int_    { $value = $int_.value; }
-    |   bool_   { $value = $bool_.value; }
-    |   string_ { $value = $string_.value; }
+atom[cconfig::tree_builder* builder] returns [cconfig::element* value]
+    :   float_[$builder]  { $value = $float_.value; }
+    |   int_[$builder]    { $value = $int_.value; }
+    |   bool_[$builder]   { $value = $bool_.value; }
+    |   string_[$builder] { $value = $string_.value; }
     ;
 
-float_ returns [cconfig::atom* value]
+float_[cconfig::tree_builder* builder] returns [cconfig::atom* value]
     :   FLOAT
-        { $value = new cconfig::atom(boost::lexical_cast<double>($FLOAT.text)); }
+        {
+            try { $value = $builder->make_float(token_text($FLOAT)); }
+            catch(const cconfig::parse_error& e) { throw_at(e, $FLOAT); }
+        }
     ;
 
-int_ returns [cconfig::atom* value]
+int_[cconfig::tree_builder* builder] returns [cconfig::atom* value]
     :   INT
-        { $value = new cconfig::atom(boost::lexical_cast<long>($INT.text)); }
+        {
+            try { $value = $builder->make_int(token_text($INT)); }
+            catch(const cconfig::parse_error& e) { throw_at(e, $INT); }
+        }
     ;
 
-bool_ returns [cconfig::atom* value]
+bool_[cconfig::tree_builder* builder] returns [cconfig::atom* value]
     :   BOOLEAN
-        { $value = new cconfig::atom(boost::lexical_cast<bool>($BOOLEAN.text)); }
+        { $value = $builder->make_bool(token_text($BOOLEAN)); }
     ;
 
-string_ returns [cconfig::atom* value]
+string_[cconfig::tree_builder* builder] returns [cconfig::atom* value]
     :   STRING
-        { $value = new cconfig::atom($STRING.text); }
+        { $value = $builder->make_string(token_text($STRING)); }
     ;
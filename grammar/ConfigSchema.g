@@ -32,14 +32,27 @@ options {
     language=Cpp;
 }
 
+@lexer::includes {
+#include "config_antlr_pool.hpp"
+}
+
 @parser::includes {
 #include "ConfigSchemaLexer.hpp"
 #include "config_schema.hpp"
+#include <boost/utility/string_ref.hpp>
 }
 
 @lexer::traits {
 class ConfigSchemaLexer; class ConfigSchemaParser;
-typedef antlr3::Traits<ConfigSchemaLexer, ConfigSchemaParser> ConfigSchemaLexerTraits;
+
+template<class ImplTraits>
+class ConfigSchemaUserTraits : public antlr3::CustomTraitsBase<ImplTraits>
+{
+public:
+    typedef cconfig::antlr_pool_policy AllocPolicyType;
+};
+
+typedef antlr3::Traits<ConfigSchemaLexer, ConfigSchemaParser, ConfigSchemaUserTraits> ConfigSchemaLexerTraits;
 typedef ConfigSchemaLexerTraits ConfigSchemaParserTraits;
 }
 
@@ -47,6 +60,15 @@ typedef ConfigSchemaLexerTraits ConfigSchemaParserTraits;
 std::string getUri() {
 
 }
+
+// text of a token as a view into the parser input, tokens never copy it
+template<typename Token>
+static boost::string_ref token_text(const Token* t)
+{
+    const char* begin = reinterpret_cast<const char*>(t->get_startIndex());
+    const char* end = reinterpret_cast<const char*>(t->get_stopIndex()) + 1;
+    return boost::string_ref(begin, end - begin);
+}
 }
 
 BOOLEAN
@@ -116,7 +138,6 @@ WS  :   ( ' '
 
 STRING
     :   '"' ( ESC_SEQ | ~('\\'|'"') )* '"'
-        { setText(getText().substr(1, getText().length() - 2)); }
     ;
 
 fragment
@@ -162,7 +183,7 @@ scope {
         ';'
         {
             $g->add_child(
-                $ID.text,
+                token_text($ID).to_string(),
                 $type.value,
                 $variableDefinition::r
             );
@@ -224,29 +245,39 @@ attributeList[cconfig::schema::node* n]
 attribute[cconfig::schema::node* n]
     :   ID
         '='
-        (   double_     { $n->add_attribute($ID.text, $double_.value); }
-        |   long_       { $n->add_attribute($ID.text, $long_.value); }
-        |   bool_       { $n->add_attribute($ID.text, $bool_.value); }
-        |   string_     { $n->add_attribute($ID.text, $string_.value); }
+        (   double_     { $n->add_attribute(token_text($ID).to_string(), $double_.value); }
+        |   long_       { $n->add_attribute(token_text($ID).to_string(), $long_.value); }
+        |   bool_       { $n->add_attribute(token_text($ID).to_string(), $bool_.value); }
+        |   string_     { $n->add_attribute(token_text($ID).to_string(), $string_.value); }
         )
     ;
     
 double_ returns [double value]
     :   FLOAT
-        { $value = boost::lexical_cast<double>($FLOAT.text); }
+        {
+            const boost::string_ref text = token_text($FLOAT);
+            $value = boost::lexical_cast<double>(text.data(), text.size());
+        }
     ;
 
 long_ returns [long value]
     :   INT
-        { $value = boost::lexical_cast<long>($INT.text); }
+        {
+            const boost::string_ref text = token_text($INT);
+            $value = boost::lexical_cast<long>(text.data(), text.size());
+        }
     ;
 
 bool_ returns [bool value]
     :   BOOLEAN
-        { $value = boost::lexical_cast<bool>($BOOLEAN.text); }
+        { $value = token_text($BOOLEAN) == "true"; }
     ;
 
 string_ returns [std::string value]
     :   STRING
-        { $value = $STRING.text; }
+        {
+            // the only copy, without the quotes
+            const boost::string_ref text = token_text($STRING);
+            $value.assign(text.data() + 1, text.size() - 2);
+        }
     ;
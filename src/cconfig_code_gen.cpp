@@ -27,6 +27,7 @@
  */
 
 #include "config_schema.hpp"
+#include "config_file.hpp"
 
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
@@ -36,6 +37,8 @@ int main(int argc, char** argv)
 	std::string output_dir;
 	std::string output_file;
 	std::string filename;
+	std::string config_file;
+	std::string embed_name;
 
 	po::options_description desc("Allowed options");
 	desc.add_options()
@@ -49,6 +52,13 @@ int main(int argc, char** argv)
 		("schema,s",
 			po::value<std::string>(&filename),
 			"schema file")
+		("config,c",
+			po::value<std::string>(&config_file),
+			"config file to embed into the binary")
+		("embed-name,n",
+			po::value<std::string>(&embed_name)->default_value("embedded_config"),
+			"name of the function returning the embedded config (default 'embedded_config')")
+		("parser,p", "also generate parse_config(), which parses configs directly into the structs")
 	;
 
 	po::positional_options_description pdesc;
@@ -69,9 +79,38 @@ int main(int argc, char** argv)
 
 	cconfig::schema::schema s;
 	s.load(filename);
-	s.generate_wrapper(output_file, output_dir, "");
+	if(!s.generate_wrapper(output_file, output_dir, ""))
+		std::cout << "Wrapper code in " << output_dir << "/" << output_file << ".hpp and " << output_dir << "/" << output_file << ".cpp is up to date" << std::endl;
+	else
+		std::cout << "Wrapper code written to " << output_dir << "/" << output_file << ".hpp and " << output_dir << "/" << output_file << ".cpp" << std::endl;
 
-	std::cout << "Wrapper code written to " << output_dir << "/" << output_file << ".hpp and " << output_dir << "/" << output_file << ".cpp" << std::endl;
+	if(vm.count("parser"))
+	{
+		const std::string parser = output_dir + "/" + output_file + "_parser";
+		if(!s.generate_parser(output_file, output_dir, ""))
+			std::cout << "Parser code in " << parser << ".hpp and " << parser << ".cpp is up to date" << std::endl;
+		else
+			std::cout << "Parser code written to " << parser << ".hpp and " << parser << ".cpp" << std::endl;
+	}
+
+	if(config_file.empty())
+		return 0;
+
+	// an invalid config fails the build instead of the binary
+	const std::string embedded = output_dir + "/" + output_file + "_" + embed_name;
+	try
+	{
+		cconfig::file f(config_file);
+		if(!s.generate_embedded(output_file, embed_name, output_dir, "", f))
+			std::cout << "Embedded config in " << embedded << ".hpp and " << embedded << ".cpp is up to date" << std::endl;
+		else
+			std::cout << "Embedded config " << config_file << " written to " << embedded << ".hpp and " << embedded << ".cpp" << std::endl;
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "Unable to embed " << config_file << ": " << e.what() << std::endl;
+		return 1;
+	}
 	return 0;
 }
 
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <iostream>
+
+#include "config_file.hpp"
+#include "config_schema.hpp"
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+int main(int argc, char** argv)
+{
+	std::string output_file;
+	std::string filename;
+
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help", "show this message")
+		("outputfile,o",
+			po::value<std::string>(&output_file),
+			"output file name (default: input file name with extension '.cconfb',\n"
+			"or '.cconfsb' for schemas)")
+		("schema,s", "compile a schema instead of a config")
+		("config,c",
+			po::value<std::string>(&filename),
+			"config or schema file")
+	;
+
+	po::positional_options_description pdesc;
+	pdesc.add("config", 1);
+
+	boost::program_options::variables_map vm;
+	po::store(po::command_line_parser(argc, argv).options(desc).positional(pdesc).run(), vm);
+	po::notify(vm);
+
+	std::cout << "CConfig compiler v1.0" << std::endl;
+
+	if(vm.count("help") || vm.count("config") == 0)
+	{
+		std::cout << "Usage: cconfig_compile [options] configfile|schemafile" << std::endl;
+		std::cout << desc << std::endl;
+		return 0;
+	}
+
+	const bool schema = vm.count("schema") != 0;
+	if(output_file.empty())
+	{
+		const std::string::size_type dot = filename.find_last_of('.');
+		const std::string::size_type slash = filename.find_last_of("/\\");
+		const bool has_extension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+		output_file = (has_extension ? filename.substr(0, dot) : filename) + (schema ? ".cconfsb" : ".cconfb");
+	}
+
+	// the input is loaded before the output is opened, which may
+	// overwrite it
+	cconfig::file f;
+	cconfig::schema::schema s;
+	if(schema)
+		s.load(filename);
+	else
+		f.load(filename);
+
+	std::ofstream out(output_file.c_str(), std::ios::binary);
+	if(!out)
+	{
+		std::cerr << "Unable to open output file " << output_file << std::endl;
+		return 1;
+	}
+	if(schema)
+		s.save_binary(out);
+	else
+		f.save_binary(out);
+
+	std::cout << "Compiled " << (schema ? "schema" : "config") << " written to " << output_file << std::endl;
+	return 0;
+}
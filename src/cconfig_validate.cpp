@@ -0,0 +1,300 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config_file.hpp"
+#include "config_schema.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+
+#include <glob.h>
+
+#include <boost/atomic.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+namespace {
+
+typedef boost::chrono::steady_clock clock_type;
+
+struct report
+{
+	std::string filename;
+	/** Empty if the file could be loaded */
+	std::string load_error;
+	cconfig::schema::error_list errors;
+	double load_ms;
+	double validate_ms;
+
+	report() : load_ms(0), validate_ms(0) {}
+
+	bool valid() const { return load_error.empty() && errors.empty(); }
+};
+
+double milliseconds(clock_type::duration d)
+{
+	return boost::chrono::duration<double, boost::milli>(d).count();
+}
+
+void validate_file(const cconfig::schema::schema& s, bool strict, report& r)
+{
+	cconfig::file f;
+
+	clock_type::time_point start = clock_type::now();
+	try {
+		f.load(r.filename);
+	} catch(std::exception& e) {
+		r.load_error = e.what();
+		r.load_ms = milliseconds(clock_type::now() - start);
+		return;
+	}
+	clock_type::time_point loaded = clock_type::now();
+
+	s.validate(f, strict, r.errors);
+	r.load_ms = milliseconds(loaded - start);
+	r.validate_ms = milliseconds(clock_type::now() - loaded);
+}
+
+void worker(
+		const cconfig::schema::schema& s,
+		bool strict,
+		std::vector<report>& reports,
+		boost::atomic<size_t>& next)
+{
+	// files are handed out one at a time, so that a few large files
+	// do not leave the other threads idle
+	for(;;)
+	{
+		const size_t i = next.fetch_add(1);
+		if(i >= reports.size())
+			return;
+		validate_file(s, strict, reports[i]);
+	}
+}
+
+void add_files(const std::string& pattern, std::vector<std::string>& files)
+{
+	if(pattern.find_first_of("*?[") == std::string::npos)
+	{
+		files.push_back(pattern);
+		return;
+	}
+
+	// patterns are expanded here as well, for argument lists that are
+	// too long for the shell and for quoted patterns in list files
+	glob_t matches;
+	if(glob(pattern.c_str(), 0, NULL, &matches) == 0)
+	{
+		for(size_t i = 0; i < matches.gl_pathc; ++i)
+			files.push_back(matches.gl_pathv[i]);
+	}
+	else
+	{
+		files.push_back(pattern);
+	}
+	globfree(&matches);
+}
+
+void read_list(std::istream& in, std::vector<std::string>& files)
+{
+	std::string line;
+	while(std::getline(in, line))
+	{
+		if(!line.empty() && line[line.size()-1] == '\r')
+			line.erase(line.size()-1);
+		if(!line.empty())
+			add_files(line, files);
+	}
+}
+
+std::string json_string(const std::string& s)
+{
+	std::string r("\"");
+	for(std::string::const_iterator it = s.begin(); it != s.end(); ++it)
+	{
+		switch(*it)
+		{
+		case '"':  r += "\\\""; break;
+		case '\\': r += "\\\\"; break;
+		case '\n': r += "\\n"; break;
+		case '\r': r += "\\r"; break;
+		case '\t': r += "\\t"; break;
+		default:
+			if(static_cast<unsigned char>(*it) < 0x20)
+			{
+				char buffer[8];
+				std::sprintf(buffer, "\\u%04x", static_cast<unsigned char>(*it));
+				r += buffer;
+			}
+			else
+				r += *it;
+		}
+	}
+	return r + "\"";
+}
+
+void write_error(std::ostream& out, const std::string& uri, const std::string& message)
+{
+	out << "{\"uri\":" << json_string(uri) << ",\"message\":" << json_string(message) << "}";
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	std::string schema_file;
+	std::string list_file;
+	std::vector<std::string> patterns;
+	unsigned int jobs = 0;
+
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help", "show this message")
+		("schema,s",
+			po::value<std::string>(&schema_file),
+			"schema file")
+		("list,l",
+			po::value<std::string>(&list_file),
+			"file with one config file name or pattern per line ('-' for stdin)")
+		("jobs,j",
+			po::value<unsigned int>(&jobs)->default_value(0),
+			"number of worker threads (default: number of cores)")
+		("strict",
+			"report settings that are not defined in the schema")
+		("config,c",
+			po::value<std::vector<std::string> >(&patterns),
+			"config files or patterns")
+	;
+
+	po::positional_options_description pdesc;
+	pdesc.add("config", -1);
+
+	boost::program_options::variables_map vm;
+	po::store(po::command_line_parser(argc, argv).options(desc).positional(pdesc).run(), vm);
+	po::notify(vm);
+
+	if(vm.count("help") || vm.count("schema") == 0)
+	{
+		std::cout << "CConfig batch validator v1.0" << std::endl;
+		std::cout << "Usage: cconfig_validate [options] -s schemafile configfile..." << std::endl;
+		std::cout << desc << std::endl;
+		// a missing schema is a usage error like an unreadable list file
+		return vm.count("help") ? 0 : 2;
+	}
+
+	std::vector<std::string> files;
+	for(std::vector<std::string>::const_iterator it = patterns.begin(); it != patterns.end(); ++it)
+		add_files(*it, files);
+
+	if(list_file == "-")
+	{
+		read_list(std::cin, files);
+	}
+	else if(!list_file.empty())
+	{
+		std::ifstream in(list_file.c_str());
+		if(!in)
+		{
+			std::cerr << "Unable to open list file " << list_file << std::endl;
+			return 2;
+		}
+		read_list(in, files);
+	}
+
+	clock_type::time_point start = clock_type::now();
+
+	cconfig::schema::schema s;
+	try {
+		s.load(schema_file);
+	} catch(std::exception& e) {
+		std::cerr << "Unable to load schema " << schema_file << ": " << e.what() << std::endl;
+		return 2;
+	}
+	const double schema_ms = milliseconds(clock_type::now() - start);
+
+	std::vector<report> reports(files.size());
+	for(size_t i = 0; i < files.size(); ++i)
+		reports[i].filename = files[i];
+
+	if(jobs == 0)
+		jobs = std::max(1u, boost::thread::hardware_concurrency());
+	if(jobs > reports.size())
+		jobs = std::max<size_t>(1, reports.size());
+
+	const bool strict = vm.count("strict") != 0;
+	boost::atomic<size_t> next(0);
+	boost::thread_group threads;
+	for(unsigned int i = 1; i < jobs; ++i)
+	{
+		threads.create_thread(boost::bind(worker,
+			boost::cref(s), strict, boost::ref(reports), boost::ref(next)));
+	}
+	worker(s, strict, reports, next);
+	threads.join_all();
+
+	// the summary is written in input order as a single JSON object
+	size_t invalid = 0;
+	std::cout << "{\"schema\":" << json_string(schema_file)
+		<< ",\"schema_ms\":" << schema_ms
+		<< ",\"files\":[";
+	for(size_t i = 0; i < reports.size(); ++i)
+	{
+		const report& r = reports[i];
+		if(!r.valid())
+			++invalid;
+
+		std::cout << (i ? ",\n" : "\n") << "{\"file\":" << json_string(r.filename)
+			<< ",\"valid\":" << (r.valid() ? "true" : "false")
+			<< ",\"load_ms\":" << r.load_ms
+			<< ",\"validate_ms\":" << r.validate_ms
+			<< ",\"errors\":[";
+		if(!r.load_error.empty())
+			write_error(std::cout, "", r.load_error);
+		for(size_t j = 0; j < r.errors.size(); ++j)
+		{
+			if(j)
+				std::cout << ",";
+			write_error(std::cout, r.errors[j].error_uri, r.errors[j].error_message);
+		}
+		std::cout << "]}";
+	}
+	std::cout << "\n],\"total\":" << reports.size()
+		<< ",\"valid\":" << reports.size() - invalid
+		<< ",\"invalid\":" << invalid
+		<< ",\"jobs\":" << jobs
+		<< ",\"wall_ms\":" << milliseconds(clock_type::now() - start)
+		<< "}" << std::endl;
+
+	return invalid == 0 ? 0 : 1;
+}
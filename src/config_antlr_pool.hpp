@@ -0,0 +1,358 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef CONFIG_ANTLR_POOL_HPP_
+#define CONFIG_ANTLR_POOL_HPP_
+
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <new>
+#include <set>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace cconfig {
+
+///
+/// \brief Per-thread memory pool of the ANTLR runtime.
+///
+/// While a pool_scope is active on a thread, small allocations of the
+/// ANTLR lexers and parsers come from size classes carved out of large
+/// blocks. Freed memory is kept in a free list per class and everything
+/// is released in bulk when the outermost scope ends. The blocks are
+/// kept for the next parse on the same thread, so that repeated parses
+/// do not allocate from the system once the pool has grown.
+///
+/// Memory allocated outside a scope or larger than max_pooled_size comes
+/// from malloc(). Pooled memory that is freed after its scope ended, or
+/// on another thread, is ignored.
+///
+class antlr_pool : boost::noncopyable
+{
+public:
+   /// Allocations up to this size are pooled
+   static const size_t max_pooled_size = 1024;
+
+   ///
+   /// \brief Pools the ANTLR allocations of the current thread for its lifetime.
+   ///
+   class scope : boost::noncopyable
+   {
+   public:
+      scope() : pool_(current())
+      {
+         if(pool_ == NULL)
+         {
+            pool_ = new antlr_pool();
+            slot().reset(pool_);
+         }
+         pool_->depth_++;
+      }
+
+      ~scope()
+      {
+         if(--pool_->depth_ == 0)
+            pool_->reset();
+      }
+
+   private:
+      antlr_pool* pool_;
+   };
+
+   ~antlr_pool()
+   {
+      for(size_t i = 0; i < blocks_.size(); i++)
+         std::free(blocks_[i]);
+   }
+
+   static void* allocate(size_t size)
+   {
+      antlr_pool* p = current();
+      header* h;
+      if(p != NULL && p->depth_ != 0 && size <= max_pooled_size)
+         h = p->allocate_pooled(size);
+      else
+      {
+         h = static_cast<header*>(std::malloc(sizeof(header) + size));
+         if(h == NULL)
+            throw std::bad_alloc();
+         h->size = size;
+         h->generation = 0;
+      }
+      return h + 1;
+   }
+
+   static void free(void* ptr)
+   {
+      if(ptr == NULL)
+         return;
+      header* h = static_cast<header*>(ptr) - 1;
+      if(h->generation == 0)
+      {
+         std::free(h);
+         return;
+      }
+
+      antlr_pool* p = current();
+      if(p != NULL && p->depth_ != 0 && h->generation == p->generation_)
+      {
+         free_node* n = reinterpret_cast<free_node*>(ptr);
+         n->next = p->free_[size_class(h->size)];
+         p->free_[size_class(h->size)] = n;
+      }
+   }
+
+   static void* reallocate(void* ptr, size_t size)
+   {
+      if(ptr == NULL)
+         return allocate(size);
+      header* h = static_cast<header*>(ptr) - 1;
+      if(h->generation == 0)
+      {
+         h = static_cast<header*>(std::realloc(h, sizeof(header) + size));
+         if(h == NULL)
+            return NULL;
+         h->size = size;
+         return h + 1;
+      }
+      if(size <= h->size)
+         return ptr;
+
+      void* p = allocate(size);
+      std::memcpy(p, ptr, h->size);
+      free(ptr);
+      return p;
+   }
+
+private:
+   /// Precedes every allocation, keeps the memory after it aligned
+   struct header
+   {
+      size_t size;
+      /// Generation of the pool at allocation time, 0 for malloc()
+      size_t generation;
+   };
+
+   struct free_node
+   {
+      free_node* next;
+   };
+
+   static const size_t granularity = sizeof(header);
+   static const size_t block_size = 64 * 1024;
+   /// Blocks beyond this many bytes are released by reset()
+   static const size_t max_retained = 1024 * 1024;
+
+   antlr_pool() : depth_(0), generation_(next_generation()), block_(0), pos_(NULL), end_(NULL)
+   {
+      std::memset(free_, 0, sizeof(free_));
+   }
+
+   static boost::thread_specific_ptr<antlr_pool>& slot()
+   {
+      static boost::thread_specific_ptr<antlr_pool> s;
+      return s;
+   }
+
+   static antlr_pool* current() { return slot().get(); }
+
+   /// Generations are unique across threads, so that pools never take memory of each other
+   static size_t next_generation()
+   {
+      static boost::atomic<size_t> counter(0);
+      return counter.fetch_add(1) + 1;
+   }
+
+   static size_t size_class(size_t size) { return (size + granularity - 1) / granularity; }
+
+   header* allocate_pooled(size_t size)
+   {
+      // zero sized allocations still need room for a free list link
+      const size_t c = size != 0 ? size_class(size) : 1;
+      if(free_[c] != NULL)
+      {
+         free_node* n = free_[c];
+         free_[c] = n->next;
+         return reinterpret_cast<header*>(n) - 1;
+      }
+
+      const size_t bytes = sizeof(header) + c * granularity;
+      while(pos_ == NULL || static_cast<size_t>(end_ - pos_) < bytes)
+         next_block();
+      header* h = reinterpret_cast<header*>(pos_);
+      pos_ += bytes;
+      h->size = c * granularity;
+      h->generation = generation_;
+      return h;
+   }
+
+   void next_block()
+   {
+      if(pos_ != NULL)
+         block_++;
+      if(block_ == blocks_.size())
+      {
+         char* b = static_cast<char*>(std::malloc(block_size));
+         if(b == NULL)
+            throw std::bad_alloc();
+         blocks_.push_back(b);
+      }
+      pos_ = blocks_[block_];
+      end_ = pos_ + block_size;
+   }
+
+   void reset()
+   {
+      const size_t keep = max_retained / block_size;
+      for(size_t i = keep; i < blocks_.size(); i++)
+         std::free(blocks_[i]);
+      if(blocks_.size() > keep)
+         blocks_.resize(keep);
+
+      generation_ = next_generation();
+      std::memset(free_, 0, sizeof(free_));
+      block_ = 0;
+      pos_ = NULL;
+      end_ = NULL;
+   }
+
+   unsigned int depth_;
+   size_t generation_;
+   free_node* free_[max_pooled_size / granularity + 1];
+   std::vector<char*> blocks_;
+   size_t block_;
+   char* pos_;
+   char* end_;
+};
+
+///
+/// \brief AllocPolicy of the ANTLR runtime backed by cconfig::antlr_pool.
+///
+/// Used by the traits of the config and schema grammars in place of
+/// antlr3::DefaultAllocPolicy, which it mirrors.
+///
+class antlr_pool_policy
+{
+public:
+   template<class TYPE>
+   class AllocatorType : public std::allocator<TYPE>
+   {
+   public:
+      typedef TYPE value_type;
+      typedef value_type* pointer;
+      typedef const value_type* const_pointer;
+      typedef value_type& reference;
+      typedef const value_type& const_reference;
+      typedef size_t size_type;
+      typedef ptrdiff_t difference_type;
+      template<class U> struct rebind {
+         typedef AllocatorType<U> other;
+      };
+
+      AllocatorType() throw() {}
+      AllocatorType(const AllocatorType&) throw() : std::allocator<TYPE>() {}
+      template<typename U> AllocatorType(const AllocatorType<U>&) throw() {}
+
+      pointer allocate(size_type n, const void* = 0) { return static_cast<pointer>(antlr_pool::allocate(n * sizeof(TYPE))); }
+      void deallocate(pointer p, size_type) { antlr_pool::free(p); }
+   };
+
+   template<class TYPE>
+   class VectorType : public std::vector< TYPE, AllocatorType<TYPE> >
+   {
+   };
+
+   template<class TYPE>
+   class ListType : public std::deque< TYPE, AllocatorType<TYPE> >
+   {
+   };
+
+   template<class TYPE>
+   class StackType : public std::deque< TYPE, AllocatorType<TYPE> >
+   {
+   public:
+      void push(const TYPE& elem) { this->push_back(elem); }
+      void pop() { this->pop_back(); }
+      TYPE& peek() { return this->back(); }
+      TYPE& top() { return this->back(); }
+      const TYPE& peek() const { return this->back(); }
+      const TYPE& top() const { return this->back(); }
+   };
+
+   template<class TYPE>
+   class OrderedSetType : public std::set< TYPE, std::less<TYPE>, AllocatorType<TYPE> >
+   {
+   };
+
+   template<class TYPE>
+   class UnOrderedSetType : public std::set< TYPE, std::less<TYPE>, AllocatorType<TYPE> >
+   {
+   };
+
+   template<class KeyType, class ValueType>
+   class UnOrderedMapType : public std::map< KeyType, ValueType, std::less<KeyType>,
+      AllocatorType<std::pair<KeyType, ValueType> > >
+   {
+   };
+
+   template<class KeyType, class ValueType>
+   class OrderedMapType : public std::map< KeyType, ValueType, std::less<KeyType>,
+      AllocatorType<std::pair<KeyType, ValueType> > >
+   {
+   };
+
+   static void* operator new(std::size_t bytes) { return alloc(bytes); }
+   static void* operator new(std::size_t, void* p) { return p; }
+   static void* operator new[](std::size_t bytes) { return alloc(bytes); }
+   static void operator delete(void* p) { free(p); }
+   static void operator delete(void*, void*) {}
+   static void operator delete[](void* p) { free(p); }
+
+   static void* alloc(std::size_t bytes) { return antlr_pool::allocate(bytes); }
+
+   static void* alloc0(std::size_t bytes)
+   {
+      void* p = alloc(bytes);
+      std::memset(p, 0, bytes);
+      return p;
+   }
+
+   static void free(void* p) { antlr_pool::free(p); }
+   static void* realloc(void* p, size_t size) { return antlr_pool::reallocate(p, size); }
+};
+
+}
+
+#endif
@@ -0,0 +1,327 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_ARENA_HPP_
+#define CONFIG_ARENA_HPP_
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <boost/utility/string_ref.hpp>
+
+namespace cconfig {
+
+///
+/// \brief Monotonic memory arena.
+///
+/// The arena hands out memory from a chain of large blocks and never
+/// frees individual allocations. All memory is released at once when
+/// the arena is destroyed. Config trees are allocated entirely from an
+/// arena owned by their cconfig::file, so that loading a config costs
+/// a few large allocations and tearing it down does not need to visit
+/// the tree.
+///
+/// Objects allocated from an arena are never destructed, so they must
+/// not own any resources besides arena memory.
+///
+class arena : boost::noncopyable
+{
+public:
+   /// Alignment used for untyped allocations
+   static const size_t default_alignment =
+      boost::alignment_of<double>::value > boost::alignment_of<void*>::value
+         ? boost::alignment_of<double>::value
+         : boost::alignment_of<void*>::value;
+
+   explicit arena(size_t initial_block_size = 4096) :
+      head_(NULL),
+      pos_(NULL),
+      end_(NULL),
+      next_block_size_(initial_block_size),
+      bytes_used_(0),
+      bytes_reserved_(0),
+#ifdef CCONFIG_STATS
+      allocations_(0),
+#endif
+      attached_(NULL)
+   {}
+
+   ~arena()
+   {
+      for(detached_block* b = attached_.load(); b != NULL; )
+      {
+         detached_block* next = b->next;
+         std::free(b);
+         b = next;
+      }
+
+      while(head_ != NULL)
+      {
+         block* next = head_->next;
+         std::free(head_);
+         head_ = next;
+      }
+   }
+
+   ///
+   /// \brief Allocates uninitialized memory.
+   ///
+   /// \throws std::bad_alloc if the system is out of memory.
+   ///
+   void* allocate(size_t size, size_t alignment = default_alignment)
+   {
+#ifdef CCONFIG_STATS
+      allocations_++;
+#endif
+      if(pos_ != NULL)
+      {
+         char* p = align(pos_, alignment);
+         if(p <= end_ && size <= static_cast<size_t>(end_ - p))
+         {
+            pos_ = p + size;
+            bytes_used_ += size;
+            return p;
+         }
+      }
+      return allocate_slow(size, alignment);
+   }
+
+   ///
+   /// \brief Allocates an uninitialized array of trivially copyable objects.
+   ///
+   template<typename T>
+   T* allocate_array(size_t n)
+   {
+      return static_cast<T*>(allocate(n * sizeof(T), boost::alignment_of<T>::value));
+   }
+
+   ///
+   /// \brief Copies a string into the arena.
+   ///
+   /// \returns A view of the copy that is valid for the lifetime of the arena.
+   ///
+   boost::string_ref copy_string(boost::string_ref s)
+   {
+      if(s.empty())
+         return boost::string_ref();
+      char* p = static_cast<char*>(allocate(s.size(), 1));
+      std::memcpy(p, s.data(), s.size());
+      return boost::string_ref(p, s.size());
+   }
+
+   ///
+   /// \brief Makes sure that allocations of up to size bytes in total are served from one block.
+   ///
+   /// Allocations are padded to their alignment, which has to be included
+   /// in size.
+   ///
+   /// \throws std::bad_alloc if the system is out of memory.
+   ///
+   void reserve(size_t size)
+   {
+      if(pos_ != NULL && pos_ <= end_ && size <= static_cast<size_t>(end_ - pos_))
+         return;
+
+      const size_t block_size = sizeof(block) + default_alignment + size;
+      block* b = new_block(block_size);
+      b->next = head_;
+      head_ = b;
+      pos_ = reinterpret_cast<char*>(b) + sizeof(block);
+      end_ = reinterpret_cast<char*>(b) + block_size;
+   }
+
+   /// Number of bytes handed out by allocate()
+   size_t bytes_used() const { return bytes_used_; }
+
+   /// Number of bytes allocated from the system
+   size_t bytes_reserved() const { return bytes_reserved_; }
+
+   /// Number of calls to allocate(), only counted with CCONFIG_STATS
+   size_t allocations() const
+   {
+#ifdef CCONFIG_STATS
+      return allocations_;
+#else
+      return 0;
+#endif
+   }
+
+   ///
+   /// \brief Allocates memory that does not belong to an arena yet.
+   ///
+   /// Together with attach() this lets readers of a finished tree create
+   /// data on demand from several threads: the block of the thread that
+   /// wins a race is attached to the arena of the tree, the others are
+   /// released with free_detached(). The memory is aligned like the
+   /// memory returned by allocate().
+   ///
+   /// \throws std::bad_alloc if the system is out of memory.
+   ///
+   static void* allocate_detached(size_t size)
+   {
+      detached_block* b = static_cast<detached_block*>(std::malloc(sizeof(detached_block) + size));
+      if(b == NULL)
+         throw std::bad_alloc();
+      return b + 1;
+   }
+
+   static void free_detached(void* p)
+   {
+      std::free(static_cast<detached_block*>(p) - 1);
+   }
+
+   ///
+   /// \brief Passes a block of allocate_detached() to the arena, which releases it on destruction.
+   ///
+   /// Unlike all other member functions this one may be called concurrently.
+   ///
+   void attach(void* p)
+   {
+      detached_block* b = static_cast<detached_block*>(p) - 1;
+      b->next = attached_.load(boost::memory_order_relaxed);
+      while(!attached_.compare_exchange_weak(b->next, b, boost::memory_order_release, boost::memory_order_relaxed))
+         ;
+   }
+
+   /// Address range [first, second) of a block
+   typedef std::pair<const char*, const char*> block_range;
+
+   ///
+   /// \brief Appends the address ranges of all blocks.
+   ///
+   /// Used to find out which arena an object was allocated from.
+   ///
+   void get_blocks(std::vector<block_range>& result) const
+   {
+      for(const block* b = head_; b != NULL; b = b->next)
+         result.push_back(block_range(reinterpret_cast<const char*>(b), reinterpret_cast<const char*>(b) + b->size));
+   }
+
+private:
+   /// Blocks are never larger than this unless a single allocation needs it
+   static const size_t max_block_size = 1024 * 1024;
+
+   struct block
+   {
+      block* next;
+      size_t size;
+   };
+
+   /// Header of detached blocks, padded to the default alignment
+   union detached_block
+   {
+      detached_block* next;
+      double d;
+      void* p;
+   };
+
+   static char* align(char* p, size_t alignment)
+   {
+      size_t misalignment = reinterpret_cast<size_t>(p) & (alignment - 1);
+      return misalignment ? p + (alignment - misalignment) : p;
+   }
+
+   char* allocate_slow(size_t size, size_t alignment)
+   {
+      size_t needed = sizeof(block) + alignment + size;
+
+      // large allocations get a block of their own so that the rest
+      // of the current block is not wasted
+      if(head_ != NULL && needed > next_block_size_ / 2)
+      {
+         block* b = new_block(needed);
+         b->next = head_->next;
+         head_->next = b;
+         bytes_used_ += size;
+         return align(reinterpret_cast<char*>(b) + sizeof(block), alignment);
+      }
+
+      size_t block_size = next_block_size_;
+      if(block_size < needed)
+         block_size = needed;
+      if(next_block_size_ < max_block_size)
+         next_block_size_ *= 2;
+
+      block* b = new_block(block_size);
+      b->next = head_;
+      head_ = b;
+
+      char* p = align(reinterpret_cast<char*>(b) + sizeof(block), alignment);
+      pos_ = p + size;
+      end_ = reinterpret_cast<char*>(b) + block_size;
+      bytes_used_ += size;
+      return p;
+   }
+
+   block* new_block(size_t size)
+   {
+      block* b = static_cast<block*>(std::malloc(size));
+      if(b == NULL)
+         throw std::bad_alloc();
+      b->size = size;
+      bytes_reserved_ += size;
+      return b;
+   }
+
+   block* head_;
+   char* pos_;
+   char* end_;
+   size_t next_block_size_;
+   size_t bytes_used_;
+   size_t bytes_reserved_;
+#ifdef CCONFIG_STATS
+   size_t allocations_;
+#endif
+   boost::atomic<detached_block*> attached_;
+};
+
+}
+
+///
+/// \brief Placement allocation from a cconfig::arena.
+///
+/// Usage: new(arena) cconfig::list(arena)
+///
+inline void* operator new(std::size_t size, cconfig::arena& a)
+{
+   return a.allocate(size);
+}
+
+inline void operator delete(void*, cconfig::arena&)
+{
+   // memory is reclaimed when the arena is destroyed
+}
+
+#endif
@@ -0,0 +1,253 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_BATCH_HPP_
+#define CONFIG_BATCH_HPP_
+
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "config_tree.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Outcome of lookup_batch::resolve().
+///
+/// Paths are listed in the order their bindings were added.
+///
+struct batch_result
+{
+   /// Paths of required bindings without a setting
+   std::vector<std::string> missing;
+   /// Paths of optional bindings that received their default value
+   std::vector<std::string> defaulted;
+   /// Paths of settings that could not be converted, with the reason
+   std::vector<std::pair<std::string, std::string> > invalid;
+
+   bool ok() const { return missing.empty() && invalid.empty(); }
+};
+
+///
+/// \brief Resolves many lookups in a single walk of the config tree.
+///
+/// Bindings of a path to a destination variable are compiled into a
+/// trie of path components, so that every group and list on the way is
+/// visited once no matter how many settings below it are bound.
+///
+/// \code
+/// long port;
+/// std::string host;
+/// cconfig::lookup_batch batch;
+/// batch.add("server.port", port, 80L).add("server.host", host);
+/// cconfig::batch_result r = batch.resolve(f.root());
+/// \endcode
+///
+class lookup_batch : boost::noncopyable
+{
+public:
+   lookup_batch() : nodes_(1) {}
+
+   ///
+   /// \brief Binds a required setting to a destination.
+   ///
+   /// \throws cconfig::lookup_error if the path is malformed.
+   ///
+   template<typename T>
+   lookup_batch& add(const std::string& path, T& destination)
+   {
+      const cconfig::path tokens(path);
+      insert(tokens, new typed_binding<T>(path, destination, NULL));
+      return *this;
+   }
+
+   ///
+   /// \brief Binds an optional setting, destination receives default_value if it is missing.
+   ///
+   template<typename T>
+   lookup_batch& add(const std::string& path, T& destination, const T& default_value)
+   {
+      const cconfig::path tokens(path);
+      insert(tokens, new typed_binding<T>(path, destination, &default_value));
+      return *this;
+   }
+
+   size_t size() const { return bindings_.size(); }
+
+   ///
+   /// \brief Assigns all bound destinations from the tree below root.
+   ///
+   /// Missing and unconvertible settings are reported in the result,
+   /// the destinations of those are left unchanged.
+   ///
+   batch_result resolve(const element& root) const
+   {
+      std::vector<status> statuses(bindings_.size(), missing);
+      std::vector<std::string> errors(bindings_.size());
+      walk(0, &root, statuses, errors);
+
+      batch_result result;
+      for(size_t i = 0; i < bindings_.size(); i++)
+      {
+         const binding& b = bindings_[i];
+         if(statuses[i] == invalid)
+            result.invalid.push_back(std::make_pair(b.path, errors[i]));
+         else if(statuses[i] == missing)
+         {
+            if(b.assign_default())
+               result.defaulted.push_back(b.path);
+            else
+               result.missing.push_back(b.path);
+         }
+      }
+      return result;
+   }
+
+private:
+   enum status { missing, found, invalid };
+
+   struct binding : boost::noncopyable
+   {
+      explicit binding(const std::string& p) : path(p) {}
+      virtual ~binding() {}
+
+      /// Converts e into the destination, throws if that fails
+      virtual void assign(const element& e) const = 0;
+      /// Assigns the default value, false for required bindings
+      virtual bool assign_default() const = 0;
+
+      std::string path;
+   };
+
+   template<typename T>
+   struct typed_binding : binding
+   {
+      typed_binding(const std::string& p, T& d, const T* default_value) :
+         binding(p), destination(d), has_default(default_value != NULL),
+         default_value(default_value != NULL ? *default_value : T())
+      {}
+
+      void assign(const element& e) const { destination = e.as<T>(); }
+
+      bool assign_default() const
+      {
+         if(has_default)
+            destination = default_value;
+         return has_default;
+      }
+
+      T& destination;
+      bool has_default;
+      T default_value;
+   };
+
+   struct trie_node
+   {
+      trie_node() : component(0u) {}
+
+      cconfig::path::component component;
+      std::vector<size_t> children;
+      std::vector<size_t> bindings;
+   };
+
+   /// Takes ownership of b, paths are tokenized by the caller so that
+   /// a malformed one leaves the batch unchanged
+   void insert(const cconfig::path& tokens, binding* b)
+   {
+      size_t node = 0;
+      for(cconfig::path::iterator it = tokens.begin(); it != tokens.end(); ++it)
+      {
+         size_t child = 0;
+         const std::vector<size_t>& children = nodes_[node].children;
+         for(size_t i = 0; i < children.size() && child == 0; i++)
+         {
+            const cconfig::path::component& c = nodes_[children[i]].component;
+            if(c.is_index == it->is_index && c.index == it->index && c.hash == it->hash && c.key == it->key)
+               child = children[i];
+         }
+         if(child == 0)
+         {
+            child = nodes_.size();
+            nodes_.push_back(trie_node());
+            nodes_.back().component = *it;
+            nodes_[node].children.push_back(child);
+         }
+         node = child;
+      }
+
+      nodes_[node].bindings.push_back(bindings_.size());
+      bindings_.push_back(b);
+   }
+
+   void walk(size_t node, const element* e, std::vector<status>& statuses, std::vector<std::string>& errors) const
+   {
+      // bindings below a missing element stay missing
+      if(e == NULL)
+         return;
+
+      const trie_node& n = nodes_[node];
+      for(size_t i = 0; i < n.bindings.size(); i++)
+      {
+         const size_t b = n.bindings[i];
+         try
+         {
+            bindings_[b].assign(*e);
+            statuses[b] = found;
+         }
+         catch(const std::exception& ex)
+         {
+            statuses[b] = invalid;
+            errors[b] = ex.what();
+         }
+      }
+
+      for(size_t i = 0; i < n.children.size(); i++)
+      {
+         const cconfig::path::component& c = nodes_[n.children[i]].component;
+         const element* child = NULL;
+         if(c.is_index)
+            child = e->is_list() ? e->as_list_unchecked().get_if(c.index) : NULL;
+         else
+            child = e->is_group() ? e->as_group_unchecked().get_if(c.key, c.hash) : NULL;
+         walk(n.children[i], child, statuses, errors);
+      }
+   }
+
+   /// Node 0 is the root of the trie and stands for the whole config
+   std::vector<trie_node> nodes_;
+   boost::ptr_vector<binding> bindings_;
+};
+
+}
+
+#endif
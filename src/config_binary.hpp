@@ -0,0 +1,543 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_BINARY_HPP_
+#define CONFIG_BINARY_HPP_
+
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "config_tree.hpp"
+#include "config_builder.hpp"
+
+///
+/// \file
+/// \brief Compiled (binary) representation of config trees.
+///
+/// A compiled config (.cconfb) consists of four sections, all integers
+/// are stored as little endian 32 bit words:
+///
+/// - header: signature "CCONFB\0\1", format version, number of strings,
+///   number of cell words
+/// - string table: offset and size of every distinct key and string
+///   value within the string data
+/// - cells: the tree in preorder, starting with the root group. Every
+///   cell starts with its type word, followed by
+///   - group: number of children and a (key string, child cell) pair
+///     for each of them in source order
+///   - list: number of elements and the cell of each element
+///   - array: the cell type of its elements (bool, long or double), the
+///     number of elements and their values, 64 bit values take two words
+///     each, booleans are packed 32 per word (lowest bit first)
+///   - bool: the value (0 or 1)
+///   - long: the value as two's complement 64 bit integer (low word first)
+///   - double: the IEEE 754 bit pattern (low word first)
+///   - string: the index into the string table
+///   Cells are referred to by their word offset within the cell section,
+///   every child starts after its parent and previous sibling with all
+///   cells below them.
+/// - string data: the bytes of all strings without terminators
+///
+/// Loading a compiled config neither lexes nor converts anything. String
+/// values refer to the loaded data directly, so it has to outlive the
+/// tree (cconfig::file keeps the mapping of the file).
+///
+namespace cconfig {
+namespace binary {
+
+const boost::uint32_t format_version = 2;
+
+enum cell_type
+{
+   group_cell = 1,
+   list_cell,
+   bool_cell,
+   long_cell,
+   double_cell,
+   string_cell,
+   /// Array with typed storage, added in version 2
+   array_cell
+};
+
+namespace detail {
+
+const char signature[8] = { 'C', 'C', 'O', 'N', 'F', 'B', '\0', '\1' };
+/// Size of the header in bytes
+const size_t header_size = 20;
+
+inline void put_word(std::string& out, boost::uint32_t w)
+{
+   const char bytes[4] = {
+      static_cast<char>(w & 0xff), static_cast<char>((w >> 8) & 0xff),
+      static_cast<char>((w >> 16) & 0xff), static_cast<char>((w >> 24) & 0xff)
+   };
+   out.append(bytes, 4);
+}
+
+inline boost::uint32_t get_word(const char* p)
+{
+   const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+   return static_cast<boost::uint32_t>(b[0]) | (static_cast<boost::uint32_t>(b[1]) << 8)
+      | (static_cast<boost::uint32_t>(b[2]) << 16) | (static_cast<boost::uint32_t>(b[3]) << 24);
+}
+
+///
+/// \brief Serializes a tree into cells and a deduplicated string pool.
+///
+class writer
+{
+public:
+   void write(const element& e)
+   {
+      switch(e.kind())
+      {
+      case element::group_kind: write_group(e.as_group_unchecked()); break;
+      case element::list_kind: write_list(e.as_list_unchecked()); break;
+      default: write_atom(e.as_atom_unchecked()); break;
+      }
+   }
+
+   void finish(std::ostream& out) const
+   {
+      std::string data(signature, sizeof(signature));
+      put_word(data, format_version);
+      put_word(data, static_cast<boost::uint32_t>(strings_.size()));
+      put_word(data, checked_size(cells_.size()));
+      for(std::vector<string_entry>::const_iterator it = strings_.begin(); it != strings_.end(); ++it)
+      {
+         put_word(data, it->offset);
+         put_word(data, it->size);
+      }
+      for(std::vector<boost::uint32_t>::const_iterator it = cells_.begin(); it != cells_.end(); ++it)
+         put_word(data, *it);
+      data += pool_;
+
+      out.write(data.data(), data.size());
+      if(!out)
+         throw cconfig::exception("Unable to write compiled config");
+   }
+
+private:
+   struct string_entry
+   {
+      boost::uint32_t offset;
+      boost::uint32_t size;
+   };
+
+   static boost::uint32_t checked_size(size_t size)
+   {
+      if(size > std::numeric_limits<boost::uint32_t>::max() / 4)
+         throw cconfig::exception("Config too large to be compiled");
+      return static_cast<boost::uint32_t>(size);
+   }
+
+   boost::uint32_t string_index(boost::string_ref s)
+   {
+      std::string key(s.data(), s.size());
+      boost::unordered_map<std::string, boost::uint32_t>::const_iterator it = string_indices_.find(key);
+      if(it != string_indices_.end())
+         return it->second;
+
+      const string_entry entry = { checked_size(pool_.size()), checked_size(s.size()) };
+      pool_.append(s.data(), s.size());
+      checked_size(pool_.size());
+
+      const boost::uint32_t index = static_cast<boost::uint32_t>(strings_.size());
+      strings_.push_back(entry);
+      string_indices_.insert(std::make_pair(key, index));
+      return index;
+   }
+
+   void write_group(const group& g)
+   {
+      cells_.push_back(group_cell);
+      cells_.push_back(static_cast<boost::uint32_t>(g.size()));
+      const size_t entries = cells_.size();
+      cells_.resize(entries + 2 * g.size());
+
+      size_t i = entries;
+      for(group::iterator it = g.begin(); it != g.end(); ++it, i += 2)
+      {
+         // resolve the key first, the child may invalidate references
+         const boost::uint32_t key = string_index(it->key->name);
+         const boost::uint32_t child = checked_size(cells_.size());
+         cells_[i] = key;
+         cells_[i + 1] = child;
+         write(*it->value);
+      }
+   }
+
+   void write_list(const list& l)
+   {
+      if(l.storage() != list::generic_storage)
+         return write_array(l);
+
+      cells_.push_back(list_cell);
+      cells_.push_back(static_cast<boost::uint32_t>(l.size()));
+      const size_t entries = cells_.size();
+      cells_.resize(entries + l.size());
+
+      size_t i = entries;
+      for(list::iterator it = l.begin(); it != l.end(); ++it, ++i)
+      {
+         cells_[i] = checked_size(cells_.size());
+         write(*it);
+      }
+   }
+
+   void write_array(const list& l)
+   {
+      cells_.push_back(array_cell);
+      cells_.push_back(l.storage() == list::long_storage ? long_cell : l.storage() == list::double_storage ? double_cell : bool_cell);
+      cells_.push_back(static_cast<boost::uint32_t>(l.size()));
+      switch(l.storage())
+      {
+      case list::long_storage:
+         for(size_t i = 0; i < l.size(); i++)
+            write_64(static_cast<boost::uint64_t>(static_cast<boost::int64_t>(l.long_values()[i])));
+         break;
+      case list::double_storage:
+         for(size_t i = 0; i < l.size(); i++)
+         {
+            boost::uint64_t bits;
+            std::memcpy(&bits, &l.double_values()[i], sizeof(bits));
+            write_64(bits);
+         }
+         break;
+      default:
+         for(size_t i = 0; i < l.size(); i += 32)
+         {
+            boost::uint32_t bits = 0;
+            for(size_t j = 0; j < 32 && i + j < l.size(); j++)
+               bits |= static_cast<boost::uint32_t>(l.bool_value(i + j)) << j;
+            cells_.push_back(bits);
+         }
+         break;
+      }
+   }
+
+   void write_atom(const atom& a)
+   {
+      if(a.is_bool())
+      {
+         cells_.push_back(bool_cell);
+         cells_.push_back(a.get_bool() ? 1 : 0);
+      }
+      else if(a.is_long())
+      {
+         cells_.push_back(long_cell);
+         write_64(static_cast<boost::uint64_t>(static_cast<boost::int64_t>(a.get_long())));
+      }
+      else if(a.is_double())
+      {
+         const double value = a.get_double();
+         boost::uint64_t bits;
+         std::memcpy(&bits, &value, sizeof(bits));
+         cells_.push_back(double_cell);
+         write_64(bits);
+      }
+      else
+      {
+         cells_.push_back(string_cell);
+         cells_.push_back(string_index(a.get_string_ref()));
+      }
+   }
+
+   void write_64(boost::uint64_t v)
+   {
+      cells_.push_back(static_cast<boost::uint32_t>(v & 0xffffffffu));
+      cells_.push_back(static_cast<boost::uint32_t>(v >> 32));
+   }
+
+   std::vector<boost::uint32_t> cells_;
+   std::vector<string_entry> strings_;
+   std::string pool_;
+   boost::unordered_map<std::string, boost::uint32_t> string_indices_;
+};
+
+///
+/// \brief Rebuilds a tree from its compiled representation.
+///
+/// All offsets are checked against the section sizes. Every child cell
+/// must start at or after the end of its previous sibling (or of the
+/// header of its parent), so cells are never shared or cyclic and the
+/// tree has at most as many nodes as there are cells. Nesting deeper
+/// than max_depth is rejected.
+///
+class reader
+{
+public:
+   reader(const char* data, size_t size, const std::string& name, cconfig::tree_builder& builder) :
+      name_(name),
+      builder_(builder)
+   {
+      if(size < header_size || std::memcmp(data, signature, sizeof(signature)) != 0)
+         fail("not a compiled config");
+      const boost::uint32_t version = get_word(data + 8);
+      if(version == 0 || version > format_version)
+         fail("unsupported format version");
+
+      string_count_ = get_word(data + 12);
+      cell_count_ = get_word(data + 16);
+
+      // compare in words to avoid overflows
+      const size_t words = (size - header_size) / 4;
+      if(string_count_ > words / 2 || cell_count_ > words - 2 * string_count_)
+         fail("truncated data");
+
+      strings_ = data + header_size;
+      cells_ = strings_ + 8 * static_cast<size_t>(string_count_);
+      pool_ = cells_ + 4 * static_cast<size_t>(cell_count_);
+      pool_size_ = size - (pool_ - data);
+
+      symbols_.resize(string_count_, NULL);
+   }
+
+   /// Deepest nesting of groups and lists accepted
+   static const size_t max_depth = 1024;
+
+   group* read()
+   {
+      if(cell_count_ < 2 || word(0) != group_cell)
+         fail("root is not a group");
+      size_t end = 0;
+      return read_group(0, end, 0);
+   }
+
+private:
+   boost::uint32_t word(size_t cell) const
+   {
+      if(cell >= cell_count_)
+         fail("cell offset out of range");
+      return get_word(cells_ + 4 * cell);
+   }
+
+   /// words following a cell header, checked to lie within the cell section
+   size_t payload(size_t cell, boost::uint64_t words) const
+   {
+      if(words > cell_count_ - cell - 1)
+         fail("cell out of range");
+      return cell + 1;
+   }
+
+   boost::string_ref string_at(boost::uint32_t index) const
+   {
+      if(index >= string_count_)
+         fail("string index out of range");
+      const boost::uint32_t offset = get_word(strings_ + 8 * index);
+      const boost::uint32_t size = get_word(strings_ + 8 * index + 4);
+      if(offset > pool_size_ || size > pool_size_ - offset)
+         fail("string out of range");
+      return boost::string_ref(pool_ + offset, size);
+   }
+
+   const symbol* key(boost::uint32_t index)
+   {
+      // every distinct key is interned once
+      const boost::string_ref name = string_at(index);
+      if(symbols_[index] == NULL)
+         symbols_[index] = builder_.symbols().intern(name);
+      return symbols_[index];
+   }
+
+   ///
+   /// \brief Reads the element at cell.
+   ///
+   /// \param end First cell the element may use, receives the first cell
+   ///        after the element and the elements below it
+   ///
+   element* read_element(size_t cell, size_t& end, size_t depth)
+   {
+      if(cell < end)
+         fail("overlapping cells");
+
+      switch(word(cell))
+      {
+      case group_cell: return read_group(cell, end, depth + 1);
+      case list_cell: return read_list(cell, end, depth + 1);
+      case array_cell: return read_array(cell, end);
+      case bool_cell:
+         end = payload(cell, 1) + 1;
+         return new(builder_.get_arena()) atom(word(cell + 1) != 0);
+      case long_cell:
+         {
+            end = payload(cell, 2) + 2;
+            const boost::int64_t value = static_cast<boost::int64_t>(read_64(cell + 1));
+            if(value < std::numeric_limits<long>::min() || value > std::numeric_limits<long>::max())
+               fail("integer out of range");
+            return new(builder_.get_arena()) atom(static_cast<long>(value));
+         }
+      case double_cell:
+         {
+            end = payload(cell, 2) + 2;
+            const boost::uint64_t bits = read_64(cell + 1);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return new(builder_.get_arena()) atom(value);
+         }
+      case string_cell:
+         end = payload(cell, 1) + 1;
+         return new(builder_.get_arena()) atom(string_at(word(cell + 1)));
+      default: fail("unknown cell type");
+      }
+      return NULL;
+   }
+
+   group* read_group(size_t cell, size_t& end, size_t depth)
+   {
+      if(depth > max_depth)
+         fail("nesting too deep");
+      const boost::uint32_t size = word(payload(cell, 1));
+      const size_t entries = payload(cell, 1 + 2 * static_cast<boost::uint64_t>(size)) + 1;
+
+      end = entries + 2 * static_cast<size_t>(size);
+      group* g = builder_.make_group();
+      for(size_t i = 0; i < size; i++)
+      {
+         const symbol* k = key(word(entries + 2 * i));
+         g->insert(k, read_element(word(entries + 2 * i + 1), end, depth));
+      }
+      return g;
+   }
+
+   list* read_list(size_t cell, size_t& end, size_t depth)
+   {
+      if(depth > max_depth)
+         fail("nesting too deep");
+      const boost::uint32_t size = word(payload(cell, 1));
+      const size_t entries = payload(cell, 1 + static_cast<boost::uint64_t>(size)) + 1;
+
+      end = entries + size;
+      list* l = builder_.make_list();
+      for(size_t i = 0; i < size; i++)
+         l->append(read_element(word(entries + i), end, depth));
+      return l;
+   }
+
+   list* read_array(size_t cell, size_t& end)
+   {
+      const size_t header = payload(cell, 2);
+      const boost::uint32_t type = word(header);
+      const boost::uint32_t size = word(header + 1);
+      const boost::uint64_t words = type == bool_cell ? (static_cast<boost::uint64_t>(size) + 31) / 32 : 2 * static_cast<boost::uint64_t>(size);
+      const size_t values = payload(cell, 2 + words) + 2;
+      end = values + static_cast<size_t>(words);
+
+      list* l = builder_.make_list();
+      switch(type)
+      {
+      case long_cell:
+         for(size_t i = 0; i < size; i++)
+         {
+            const boost::int64_t value = static_cast<boost::int64_t>(read_64(values + 2 * i));
+            if(value < std::numeric_limits<long>::min() || value > std::numeric_limits<long>::max())
+               fail("integer out of range");
+            l->append_long(static_cast<long>(value));
+            // the first value selects the storage to reserve
+            if(i == 0)
+               l->reserve(size);
+         }
+         break;
+      case double_cell:
+         for(size_t i = 0; i < size; i++)
+         {
+            const boost::uint64_t bits = read_64(values + 2 * i);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            l->append_double(value);
+            if(i == 0)
+               l->reserve(size);
+         }
+         break;
+      case bool_cell:
+         for(size_t i = 0; i < size; i++)
+            l->append_bool(((word(values + i / 32) >> (i % 32)) & 1) != 0);
+         break;
+      default:
+         fail("unknown array element type");
+      }
+      return l;
+   }
+
+   boost::uint64_t read_64(size_t cell) const
+   {
+      return static_cast<boost::uint64_t>(word(cell)) | (static_cast<boost::uint64_t>(word(cell + 1)) << 32);
+   }
+
+   void fail(const char* message) const
+   {
+      throw cconfig::exception(std::string("Invalid compiled config, ") + message + " (" + name_ + ")");
+   }
+
+   const std::string& name_;
+   cconfig::tree_builder& builder_;
+   boost::uint32_t string_count_;
+   boost::uint32_t cell_count_;
+   const char* strings_;
+   const char* cells_;
+   const char* pool_;
+   size_t pool_size_;
+   std::vector<const symbol*> symbols_;
+};
+
+}
+
+///
+/// \brief Writes the compiled representation of a config tree.
+///
+/// \throws cconfig::exception if the stream fails or the tree exceeds
+///         the 32 bit offsets of the format.
+///
+inline void write(const group& root, std::ostream& out)
+{
+   detail::writer w;
+   w.write(root);
+   w.finish(out);
+}
+
+///
+/// \brief Rebuilds a config tree from its compiled representation.
+///
+/// Nodes are created through the builder, string values refer to data.
+///
+/// \param name Name of the input used in error messages.
+/// \throws cconfig::exception if the data is not a valid compiled config.
+///
+inline group* read(const char* data, size_t size, const std::string& name, cconfig::tree_builder& builder)
+{
+   return detail::reader(data, size, name, builder).read();
+}
+
+}}
+
+#endif
@@ -0,0 +1,319 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_BUILDER_HPP_
+#define CONFIG_BUILDER_HPP_
+
+#include "config_number.hpp"
+#include "config_tree.hpp"
+
+namespace cconfig {
+
+namespace util {
+   inline unsigned int hex_value(char c)
+   {
+      if(c >= '0' && c <= '9') return c - '0';
+      if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+      return c - 'A' + 10;
+   }
+
+   inline size_t encode_utf8(unsigned int code, char* out)
+   {
+      if(code < 0x80)
+      {
+         out[0] = static_cast<char>(code);
+         return 1;
+      }
+      if(code < 0x800)
+      {
+         out[0] = static_cast<char>(0xc0 | (code >> 6));
+         out[1] = static_cast<char>(0x80 | (code & 0x3f));
+         return 2;
+      }
+      out[0] = static_cast<char>(0xe0 | (code >> 12));
+      out[1] = static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+      out[2] = static_cast<char>(0x80 | (code & 0x3f));
+      return 3;
+   }
+
+   ///
+   /// \brief Decodes the escape sequences of the contents of a string literal.
+   ///
+   /// The lexer only accepts valid escape sequences, all of them are at
+   /// least as long as their decoded form, so out needs room for s.size()
+   /// characters.
+   ///
+   /// \returns The length of the decoded string.
+   ///
+   inline size_t unescape(boost::string_ref s, char* out)
+   {
+      size_t n = 0;
+      for(size_t i = 0; i < s.size(); i++)
+      {
+         if(s[i] != '\\')
+         {
+            out[n++] = s[i];
+            continue;
+         }
+
+         char c = s[++i];
+         switch(c)
+         {
+         case 'b': out[n++] = '\b'; break;
+         case 't': out[n++] = '\t'; break;
+         case 'n': out[n++] = '\n'; break;
+         case 'f': out[n++] = '\f'; break;
+         case 'r': out[n++] = '\r'; break;
+         case 'u':
+            {
+               unsigned int code = 0;
+               for(size_t j = 0; j < 4; j++)
+                  code = code * 16 + hex_value(s[++i]);
+               n += encode_utf8(code, out + n);
+               break;
+            }
+         default:
+            if(c >= '0' && c <= '7')
+            {
+               unsigned int code = c - '0';
+               for(size_t j = 0; j < 2 && i + 1 < s.size() && s[i + 1] >= '0' && s[i + 1] <= '7'; j++)
+                  code = code * 8 + (s[++i] - '0');
+               out[n++] = static_cast<char>(code);
+            }
+            else
+               out[n++] = c; // \" \' and \\ (backslash)
+         }
+      }
+      return n;
+   }
+}
+
+///
+/// \brief Provides the settings of files named by include directives.
+///
+class include_resolver
+{
+public:
+   virtual ~include_resolver() {}
+
+   ///
+   /// \brief Returns the root group of an included file.
+   ///
+   /// The group and its children are inserted into the including tree
+   /// without copying, so they must stay valid as long as that tree.
+   ///
+   /// \param path File name as written in the directive
+   ///
+   virtual const group& resolve(const std::string& path) = 0;
+};
+
+///
+/// \brief Creates config tree nodes for the parser.
+///
+/// All nodes are allocated from the arena given on construction. The
+/// builder also owns the symbol table of the tree, which is placed in
+/// the arena as well.
+///
+/// Token text is passed as views into the parser input. If the input
+/// outlives the tree (e.g. a mapped file kept by cconfig::file), string
+/// atoms without escape sequences refer to the input directly instead
+/// of being copied.
+///
+class tree_builder
+{
+public:
+   tree_builder(cconfig::arena& a, bool reference_input, include_resolver* includes = NULL) :
+      arena_(a),
+      symbols_(*new(a) symbol_table(a)),
+      reference_input_(reference_input),
+      includes_(includes)
+#ifdef CCONFIG_STATS
+      , input_bytes_(0),
+      tokens_(0)
+#endif
+   {}
+
+   group* make_group() { return new(arena_) group(symbols_); }
+   list* make_list() { return new(arena_) list(arena_); }
+
+   ///
+   /// \brief Creates an integer atom.
+   ///
+   /// \throws cconfig::parse_error (without location) if the value does
+   ///         not fit into a long.
+   ///
+   atom* make_int(boost::string_ref text) { return new(arena_) atom(to_long(text)); }
+
+   ///
+   /// \brief Creates a floating point atom.
+   ///
+   /// \throws cconfig::parse_error (without location) if the value is
+   ///         not representable as a double.
+   ///
+   atom* make_float(boost::string_ref text) { return new(arena_) atom(to_double(text)); }
+
+   atom* make_bool(boost::string_ref text) { return new(arena_) atom(text == "true"); }
+
+   ///
+   /// \brief Appends array elements to the typed storage of a list.
+   ///
+   /// Same conversions as make_int(), make_float() and make_bool().
+   ///
+   void append_int(list& l, boost::string_ref text) { l.append_long(to_long(text)); }
+   void append_float(list& l, boost::string_ref text) { l.append_double(to_double(text)); }
+   void append_bool(list& l, boost::string_ref text) { l.append_bool(text == "true"); }
+
+   ///
+   /// \brief Creates a string atom from a quoted string literal.
+   ///
+   /// \param text Literal including the surrounding quotes.
+   ///
+   atom* make_string(boost::string_ref text)
+   {
+      boost::string_ref s = text.substr(1, text.size() - 2);
+      if(s.find('\\') != boost::string_ref::npos)
+         return new(arena_) atom(unescape(s));
+      if(reference_input_)
+         return new(arena_) atom(s);
+      return new(arena_) atom(arena_, s);
+   }
+
+   ///
+   /// \brief Adds the settings of an included file to a group.
+   ///
+   /// Settings whose key already exists in the group are ignored, like
+   /// repeated definitions.
+   ///
+   /// \param text File name as string literal including the quotes
+   /// \throws cconfig::parse_error (without location unless the included
+   ///         file is invalid) if the file cannot be included.
+   ///
+   void include(group& g, boost::string_ref text)
+   {
+      if(includes_ == NULL)
+         throw cconfig::parse_error("Include directives are not supported here");
+
+      boost::string_ref s = text.substr(1, text.size() - 2);
+      std::string path(s.size(), '\0');
+      if(!path.empty())
+         path.resize(util::unescape(s, &path[0]));
+
+      const group* fragment = NULL;
+      try
+      {
+         fragment = &includes_->resolve(path);
+      }
+      catch(const cconfig::parse_error&)
+      {
+         throw;
+      }
+      catch(const cconfig::exception& e)
+      {
+         throw cconfig::parse_error(std::string("Unable to include '") + path + "': " + e.what());
+      }
+
+      for(group::iterator it = fragment->begin(); it != fragment->end(); ++it)
+         g.insert(it->key->name, it->value);
+   }
+
+   cconfig::arena& get_arena() const { return arena_; }
+   /// True if strings may refer to the parser input
+   bool reference_input() const { return reference_input_; }
+   /// Resolver of include directives, NULL if they are not supported
+   include_resolver* includes() const { return includes_; }
+   symbol_table& symbols() const { return symbols_; }
+
+   ///
+   /// \brief Counts parsed input for load_stats, does nothing without CCONFIG_STATS.
+   ///
+   void record_input(size_t bytes, size_t tokens)
+   {
+#ifdef CCONFIG_STATS
+      input_bytes_ += bytes;
+      tokens_ += tokens;
+#else
+      (void)bytes;
+      (void)tokens;
+#endif
+   }
+
+#ifdef CCONFIG_STATS
+   size_t input_bytes() const { return input_bytes_; }
+   size_t tokens() const { return tokens_; }
+#else
+   size_t input_bytes() const { return 0; }
+   size_t tokens() const { return 0; }
+#endif
+
+   ///
+   /// \brief Conversions of number tokens.
+   ///
+   /// \throws cconfig::parse_error (without location) if the value is out of range.
+   ///
+   static long to_long(boost::string_ref text)
+   {
+      long value;
+      if(!util::parse_long(text, value))
+         throw cconfig::parse_error("Integer out of range '" + text.to_string() + "'");
+      return value;
+   }
+
+   static double to_double(boost::string_ref text)
+   {
+      double value;
+      if(!util::parse_double(text, value))
+         throw cconfig::parse_error("Floating point value out of range '" + text.to_string() + "'");
+      return value;
+   }
+
+private:
+   tree_builder(const tree_builder&);
+   tree_builder& operator=(const tree_builder&);
+
+   ///
+   /// \brief Decodes the escape sequences of a string literal into the arena.
+   ///
+   boost::string_ref unescape(boost::string_ref s)
+   {
+      char* out = static_cast<char*>(arena_.allocate(s.size(), 1));
+      return boost::string_ref(out, util::unescape(s, out));
+   }
+
+   cconfig::arena& arena_;
+   symbol_table& symbols_;
+   bool reference_input_;
+   include_resolver* includes_;
+#ifdef CCONFIG_STATS
+   size_t input_bytes_;
+   size_t tokens_;
+#endif
+};
+
+}
+
+#endif
@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_CACHE_HPP_
+#define CONFIG_CACHE_HPP_
+
+#include <string>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace cconfig {
+
+class element;
+
+///
+/// \brief Counters of a lookup_cache, see file::cache_stats().
+///
+struct lookup_cache_stats
+{
+   lookup_cache_stats() : hits(0), misses(0), evictions(0), capacity(0) {}
+
+   boost::uint64_t hits;
+   boost::uint64_t misses;
+   /// Entries replaced by newer ones because their set was full
+   boost::uint64_t evictions;
+   /// Maximum number of cached paths, 0 if the cache is disabled
+   size_t capacity;
+};
+
+///
+/// \brief Bounded cache of resolved lookup paths.
+///
+/// Paths are mapped to the elements they resolve to, including paths
+/// that do not exist. The cache is set associative: the hash of a path
+/// selects a set of a few entries, which is searched and updated under
+/// its own mutex, so concurrent readers only contend on the same set.
+/// A full set evicts its least recently used entry.
+///
+/// The cache belongs to one config tree, because the tree never changes
+/// its entries stay valid for the lifetime of the tree.
+///
+class lookup_cache : boost::noncopyable
+{
+public:
+   static const size_t ways = 4;
+
+   ///
+   /// \param capacity Maximum number of entries, rounded up to a power of
+   /// two multiple of the set size.
+   ///
+   explicit lookup_cache(size_t capacity) : mask_(0), hits_(0), misses_(0), evictions_(0)
+   {
+      size_t sets = 1;
+      while(sets * ways < capacity)
+         sets *= 2;
+      sets_.reset(new set[sets]);
+      mask_ = sets - 1;
+   }
+
+   size_t capacity() const { return (mask_ + 1) * ways; }
+
+   ///
+   /// \brief Looks up a path.
+   ///
+   /// \param e Receives the cached element, which is NULL for paths that
+   /// do not exist.
+   /// \returns false if the path is not cached.
+   ///
+   bool get(const std::string& path, boost::uint32_t hash, const element*& e) const
+   {
+      set& s = sets_[hash & mask_];
+      boost::lock_guard<boost::mutex> lock(s.mutex);
+      for(size_t i = 0; i < ways; i++)
+      {
+         entry& en = s.entries[i];
+         if(en.used != 0 && en.hash == hash && en.path == path)
+         {
+            en.used = ++s.clock;
+            e = en.value;
+            hits_.fetch_add(1, boost::memory_order_relaxed);
+            return true;
+         }
+      }
+      misses_.fetch_add(1, boost::memory_order_relaxed);
+      return false;
+   }
+
+   ///
+   /// \brief Adds a resolved path, replacing the least recently used entry of its set.
+   ///
+   void put(const std::string& path, boost::uint32_t hash, const element* e) const
+   {
+      set& s = sets_[hash & mask_];
+      boost::lock_guard<boost::mutex> lock(s.mutex);
+      entry* victim = &s.entries[0];
+      for(size_t i = 0; i < ways; i++)
+      {
+         entry& en = s.entries[i];
+         // another reader may have resolved the same path meanwhile
+         if(en.used != 0 && en.hash == hash && en.path == path)
+            return;
+         if(en.used < victim->used)
+            victim = &en;
+      }
+
+      if(victim->used != 0)
+         evictions_.fetch_add(1, boost::memory_order_relaxed);
+      victim->hash = hash;
+      victim->path = path;
+      victim->value = e;
+      victim->used = ++s.clock;
+   }
+
+   lookup_cache_stats stats() const
+   {
+      lookup_cache_stats result;
+      result.hits = hits_.load(boost::memory_order_relaxed);
+      result.misses = misses_.load(boost::memory_order_relaxed);
+      result.evictions = evictions_.load(boost::memory_order_relaxed);
+      result.capacity = capacity();
+      return result;
+   }
+
+private:
+   struct entry
+   {
+      entry() : hash(0), used(0), value(NULL) {}
+
+      boost::uint32_t hash;
+      /// Value of the set clock at the last access, 0 for empty entries
+      boost::uint64_t used;
+      std::string path;
+      const element* value;
+   };
+
+   struct set
+   {
+      set() : clock(0) {}
+
+      boost::mutex mutex;
+      boost::uint64_t clock;
+      entry entries[ways];
+   };
+
+   boost::scoped_array<set> sets_;
+   size_t mask_;
+   mutable boost::atomic<boost::uint64_t> hits_;
+   mutable boost::atomic<boost::uint64_t> misses_;
+   mutable boost::atomic<boost::uint64_t> evictions_;
+};
+
+}
+
+#endif
@@ -0,0 +1,403 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_COLUMN_HPP_
+#define CONFIG_COLUMN_HPP_
+
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include <boost/bind/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "config_tree.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Lookup path that may contain wildcards.
+///
+/// "[*]" stands for every element of a list and "*" in place of a group
+/// name for every child of a group, e.g. "settings.list[*].a" or
+/// "servers.*.port". Paths without wildcards match a single setting.
+///
+class wildcard_path
+{
+public:
+   struct component
+   {
+      enum component_type { fixed, any_index, any_key };
+
+      component(component_type t, const cconfig::path::component& c) : type(t), value(c) {}
+
+      component_type type;
+      /// Key or index of fixed components
+      cconfig::path::component value;
+   };
+
+   typedef std::vector<component> component_list;
+   typedef component_list::const_iterator iterator;
+
+   ///
+   /// \param s Lookup path, see util::path_tokenizer for the syntax.
+   /// \throws cconfig::lookup_error if the path is malformed.
+   ///
+   explicit wildcard_path(const std::string& s) : str_(s) { compile(); }
+   explicit wildcard_path(const char* s) : str_(s) { compile(); }
+
+   const std::string& str() const { return str_; }
+
+   size_t size() const { return components_.size(); }
+   iterator begin() const { return components_.begin(); }
+   iterator end() const { return components_.end(); }
+
+   const component& operator[](size_t i) const { return components_[i]; }
+
+   /// Position of the first wildcard, size() if there is none
+   size_t first_wildcard() const { return first_wildcard_; }
+
+private:
+   void compile()
+   {
+      util::path_tokenizer tokenizer(str_, true);
+      util::path_token t;
+      while(tokenizer.next(t))
+      {
+         switch(t.type)
+         {
+         case util::path_token::index:
+            components_.push_back(component(component::fixed, cconfig::path::component(t.value)));
+            break;
+         case util::path_token::any_index:
+            components_.push_back(component(component::any_index, cconfig::path::component(0u)));
+            break;
+         case util::path_token::any_key:
+            components_.push_back(component(component::any_key, cconfig::path::component(0u)));
+            break;
+         default:
+            components_.push_back(component(component::fixed,
+               cconfig::path::component(std::string(t.text.data(), t.text.size()))));
+            break;
+         }
+      }
+
+      first_wildcard_ = components_.size();
+      for(size_t i = 0; i < components_.size() && first_wildcard_ == components_.size(); i++)
+         if(components_[i].type != component::fixed)
+            first_wildcard_ = i;
+   }
+
+   std::string str_;
+   component_list components_;
+   size_t first_wildcard_;
+};
+
+namespace column_detail {
+
+///
+/// \brief Keys and indices chosen for the wildcards on the way to an element.
+///
+/// Only needed to name the setting in error messages.
+///
+struct trail
+{
+   std::vector<const symbol*> keys;
+   std::vector<size_t> indices;
+};
+
+inline std::string concrete_path(const wildcard_path& p, const trail& t, size_t length)
+{
+   std::string result;
+   size_t key = 0;
+   size_t index = 0;
+   for(size_t i = 0; i < length; i++)
+   {
+      const wildcard_path::component& c = p[i];
+      if(c.type == wildcard_path::component::any_index || (c.type == wildcard_path::component::fixed && c.value.is_index))
+      {
+         const size_t value = c.type == wildcard_path::component::fixed ? c.value.index : t.indices[index++];
+         result += "[" + boost::lexical_cast<std::string>(value) + "]";
+      }
+      else
+      {
+         if(!result.empty())
+            result += ".";
+         if(c.type == wildcard_path::component::fixed)
+            result += c.value.key;
+         else
+            result += t.keys[key++]->name.to_string();
+      }
+   }
+   return result;
+}
+
+inline const element* step(const element& e, const cconfig::path::component& c)
+{
+   if(c.is_index)
+      return e.is_list() ? e.as_list_unchecked().get_if(c.index) : NULL;
+   return e.is_group() ? e.as_group_unchecked().get_if(c.key, c.hash) : NULL;
+}
+
+///
+/// \brief Walks the fixed components from pos to the next wildcard.
+///
+/// \returns The element reached, pos is advanced to the wildcard.
+/// \throws cconfig::lookup_error if a setting is missing.
+///
+inline const element& follow(const element& e, const wildcard_path& p, size_t& pos, const trail& t)
+{
+   const element* current = &e;
+   for(; pos < p.size() && p[pos].type == wildcard_path::component::fixed; ++pos)
+   {
+      current = step(*current, p[pos].value);
+      if(current == NULL)
+         throw cconfig::lookup_error("Config setting not found (" + concrete_path(p, t, pos + 1) + ")");
+   }
+   return *current;
+}
+
+template<typename T>
+void collect(const element& e, const wildcard_path& p, size_t pos, trail& t, std::vector<T>& out);
+
+///
+/// \brief Collects the column below the children [begin, end) of e.
+///
+/// e is the element matched by the wildcard at pos.
+///
+template<typename T>
+void collect_children(const element& e, const wildcard_path& p, size_t pos, size_t begin, size_t end,
+   trail& t, std::vector<T>& out)
+{
+   if(p[pos].type == wildcard_path::component::any_index)
+   {
+      const list& l = e.as_list_unchecked();
+      if(pos + 1 == p.size() && begin == 0 && end == l.size())
+      {
+         // an array at the end of the path is converted as a whole,
+         // which doesn't need atoms for typed storage
+         const std::vector<T> values = l.as_vector<T>();
+         out.insert(out.end(), values.begin(), values.end());
+         return;
+      }
+
+      // every element yields one value unless there are more wildcards
+      out.reserve(out.size() + (end - begin));
+      list::iterator it = l.begin() + begin;
+      for(size_t i = begin; i < end; ++i, ++it)
+      {
+         t.indices.push_back(i);
+         collect(*it, p, pos + 1, t, out);
+         t.indices.pop_back();
+      }
+   }
+   else
+   {
+      const group& g = e.as_group_unchecked();
+      out.reserve(out.size() + (end - begin));
+      for(group::iterator it = g.begin() + begin; it != g.begin() + end; ++it)
+      {
+         t.keys.push_back(it->key);
+         collect(*it->value, p, pos + 1, t, out);
+         t.keys.pop_back();
+      }
+   }
+}
+
+///
+/// \brief Resolves the wildcard at pos (after the fixed components) and checks its kind.
+///
+/// \returns The number of children matched by the wildcard.
+///
+inline size_t children(const element& e, const wildcard_path& p, size_t pos, const trail& t)
+{
+   if(p[pos].type == wildcard_path::component::any_index)
+   {
+      if(!e.is_list())
+         throw cconfig::lookup_error("Config setting is not a list (" + concrete_path(p, t, pos) + ")");
+      return e.as_list_unchecked().size();
+   }
+
+   if(!e.is_group())
+      throw cconfig::lookup_error("Config setting is not a group (" + concrete_path(p, t, pos) + ")");
+   return e.as_group_unchecked().size();
+}
+
+template<typename T>
+void collect(const element& e, const wildcard_path& p, size_t pos, trail& t, std::vector<T>& out)
+{
+   const element& current = follow(e, p, pos, t);
+   if(pos == p.size())
+   {
+      out.push_back(current.as<T>());
+      return;
+   }
+
+   collect_children(current, p, pos, 0, children(current, p, pos, t), t, out);
+}
+
+///
+/// \brief Range of children of the first wildcard collected by one thread.
+///
+template<typename T>
+struct chunk
+{
+   chunk(size_t b, size_t e) : begin(b), end(e), failed(false) {}
+
+   size_t begin;
+   size_t end;
+   std::vector<T> values;
+   bool failed;
+};
+
+template<typename T>
+void collect_chunks(const element* e, const wildcard_path* p, boost::ptr_vector<chunk<T> >* chunks, boost::atomic<size_t>* next)
+{
+   for(size_t i = next->fetch_add(1); i < chunks->size(); i = next->fetch_add(1))
+   {
+      chunk<T>& c = (*chunks)[i];
+      try
+      {
+         trail t;
+         collect_children(*e, *p, p->first_wildcard(), c.begin, c.end, t, c.values);
+      }
+      catch(const std::exception&)
+      {
+         // the error is reported by the calling thread, see extract_column_parallel()
+         c.failed = true;
+      }
+   }
+}
+
+}
+
+///
+/// \brief Collects the values of all settings matched by a wildcard path.
+///
+/// The values are appended to out in the order of the config, lists and
+/// groups are resolved once for all of their elements.
+///
+/// \code
+/// std::vector<std::string> a;
+/// cconfig::extract_column(f.root(), cconfig::wildcard_path("settings.list[*].a"), a);
+/// \endcode
+///
+/// \throws cconfig::lookup_error naming the concrete path if a setting is
+///         missing or a wildcard doesn't match a list or group, the
+///         exceptions of element::as<T>() for values that can't be
+///         converted. out is left in an unspecified state then.
+///
+template<typename T>
+void extract_column(const element& root, const wildcard_path& p, std::vector<T>& out)
+{
+   column_detail::trail t;
+   column_detail::collect(root, p, 0, t, out);
+}
+
+template<typename T>
+std::vector<T> extract_column(const element& root, const wildcard_path& p)
+{
+   std::vector<T> result;
+   extract_column(root, p, result);
+   return result;
+}
+
+///
+/// \brief Variant of extract_column() which splits the children of the
+/// first wildcard among a pool of threads.
+///
+/// Falls back to extract_column() for fewer than min_parallel_size
+/// children. The result and the reported errors are the same as those
+/// of extract_column().
+///
+/// \param threads Number of threads, 0 for one per core
+///
+template<typename T>
+void extract_column_parallel(const element& root, const wildcard_path& p, std::vector<T>& out, unsigned int threads = 0)
+{
+   static const size_t min_parallel_size = 16 * 1024;
+
+   if(threads == 0)
+      threads = std::max(1u, boost::thread::hardware_concurrency());
+
+   column_detail::trail t;
+   size_t pos = 0;
+   const element& e = column_detail::follow(root, p, pos, t);
+   const size_t n = pos == p.size() ? 0 : column_detail::children(e, p, pos, t);
+   if(threads < 2 || n < min_parallel_size)
+   {
+      extract_column(root, p, out);
+      return;
+   }
+
+   // a few chunks per thread to balance uneven subtrees
+   const size_t chunk_size = std::max<size_t>(n / (4 * threads), 1024);
+   boost::ptr_vector<column_detail::chunk<T> > chunks;
+   for(size_t begin = 0; begin < n; begin += chunk_size)
+      chunks.push_back(new column_detail::chunk<T>(begin, std::min(begin + chunk_size, n)));
+
+   boost::atomic<size_t> next(0);
+   boost::thread_group pool;
+   const unsigned int workers = static_cast<unsigned int>(std::min<size_t>(threads, chunks.size()));
+   for(unsigned int i = 1; i < workers; i++)
+      pool.create_thread(boost::bind(&column_detail::collect_chunks<T>, &e, &p, &chunks, &next));
+   column_detail::collect_chunks<T>(&e, &p, &chunks, &next);
+   pool.join_all();
+
+   size_t total = 0;
+   for(size_t i = 0; i < chunks.size(); i++)
+   {
+      if(chunks[i].failed)
+      {
+         // collect the failed chunk again to throw the original exception
+         column_detail::trail retry;
+         std::vector<T> ignored;
+         column_detail::collect_children(e, p, pos, chunks[i].begin, chunks[i].end, retry, ignored);
+      }
+      total += chunks[i].values.size();
+   }
+
+   out.reserve(out.size() + total);
+   for(size_t i = 0; i < chunks.size(); i++)
+      out.insert(out.end(), chunks[i].values.begin(), chunks[i].values.end());
+}
+
+template<typename T>
+std::vector<T> extract_column_parallel(const element& root, const wildcard_path& p, unsigned int threads = 0)
+{
+   std::vector<T> result;
+   extract_column_parallel(root, p, result, threads);
+   return result;
+}
+
+}
+
+#endif
@@ -0,0 +1,214 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_COMPACT_HPP_
+#define CONFIG_COMPACT_HPP_
+
+#include <algorithm>
+#include <vector>
+
+#include "config_tree.hpp"
+
+namespace cconfig {
+
+namespace compact_detail {
+
+///
+/// \brief Copies a tree into an arena with all containers fitted to their size.
+///
+/// The copy is laid out depth first, each node followed by its child
+/// array and index, so that a lookup walks forward through memory.
+/// Strings are always copied, the copy refers to nothing but the arena.
+/// Typed arrays keep their typed storage, their element views are
+/// created again on first access.
+///
+class copier
+{
+public:
+   explicit copier(cconfig::arena& a) :
+      arena_(a),
+      symbols_(NULL)
+   {}
+
+   group* copy(const group& root)
+   {
+      std::vector<const symbol*> keys;
+      size_t size = measure(root, keys);
+      std::sort(keys.begin(), keys.end());
+      keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+      size += padded(sizeof(symbol_table)) + padded(symbol_table::table_capacity(keys.size()) * sizeof(const symbol*));
+      for(std::vector<const symbol*>::const_iterator it = keys.begin(); it != keys.end(); ++it)
+         size += padded(sizeof(symbol)) + padded((*it)->name.size());
+      arena_.reserve(size);
+
+      symbols_ = new(arena_) symbol_table(arena_);
+      symbols_->reserve(keys.size());
+      return copy_group(root);
+   }
+
+private:
+   static size_t padded(size_t n)
+   {
+      const size_t a = cconfig::arena::default_alignment;
+      return (n + a - 1) / a * a;
+   }
+
+   static size_t index_capacity(size_t n)
+   {
+      // see group::rebuild_index
+      size_t capacity = 16;
+      while(capacity < n * 2)
+         capacity *= 2;
+      return capacity;
+   }
+
+   /// Upper bound of the arena memory the copy of e takes, without the symbols
+   static size_t measure(const element& e, std::vector<const symbol*>& keys)
+   {
+      if(e.is_atom())
+      {
+         const atom& a = e.as_atom_unchecked();
+         const size_t n = a.is_string() ? a.get_string_ref().size() : 0;
+         return padded(sizeof(atom)) + (n > sizeof(a.payload_.small) ? padded(n) : 0);
+      }
+
+      if(e.is_group())
+      {
+         const group& g = e.as_group_unchecked();
+         size_t size = padded(sizeof(group));
+         if(g.size() > group::inline_capacity)
+            size += padded(g.size() * sizeof(group::value_type));
+         if(g.size() > group::linear_search_limit)
+            size += padded(index_capacity(g.size()) * sizeof(group::slot));
+         for(group::iterator it = g.begin(); it != g.end(); ++it)
+         {
+            keys.push_back(it->key);
+            size += measure(*it->value, keys);
+         }
+         return size;
+      }
+
+      const list& l = e.as_list_unchecked();
+      size_t size = padded(sizeof(list));
+      if(l.storage() != list::generic_storage)
+         return size + padded(l.value_bytes(l.size()));
+      size += padded(l.size() * sizeof(element*));
+      for(list::iterator it = l.begin(); it != l.end(); ++it)
+         size += measure(*it, keys);
+      return size;
+   }
+
+   element* copy_element(const element& e)
+   {
+      if(e.is_group())
+         return copy_group(e.as_group_unchecked());
+      if(e.is_list())
+         return copy_list(e.as_list_unchecked());
+
+      const atom& a = e.as_atom_unchecked();
+      return a.is_string() ? new(arena_) atom(arena_, a.get_string_ref()) : new(arena_) atom(a);
+   }
+
+   group* copy_group(const group& source)
+   {
+      group* g = new(arena_) group(*symbols_);
+      const boost::uint32_t n = source.size_;
+      if(n > group::inline_capacity)
+      {
+         g->settings_ = arena_.allocate_array<group::value_type>(n);
+         g->capacity_ = n;
+      }
+      if(n > group::linear_search_limit)
+      {
+         g->index_capacity_ = static_cast<boost::uint32_t>(index_capacity(n));
+         g->index_ = arena_.allocate_array<group::slot>(g->index_capacity_);
+         std::memset(g->index_, 0, g->index_capacity_ * sizeof(group::slot));
+      }
+
+      for(group::iterator it = source.begin(); it != source.end(); ++it)
+      {
+         group::value_type& v = g->settings_[g->size_];
+         v.key = symbols_->intern(it->key->name);
+         v.value = copy_element(*it->value);
+         if(g->index_ != NULL)
+            g->index_insert(v.key->hash, g->size_);
+         g->size_++;
+      }
+      return g;
+   }
+
+   list* copy_list(const list& source)
+   {
+      list* l = new(arena_) list(arena_);
+      const boost::uint32_t n = source.size_;
+      if(n == 0)
+         return l;
+
+      l->capacity_ = n;
+      if(source.storage_ != list::generic_storage)
+      {
+         l->storage_ = source.storage_;
+         l->values_ = arena_.allocate(source.value_bytes(n));
+         std::memcpy(l->values_, source.values_, source.value_bytes(n));
+         l->size_ = n;
+         return l;
+      }
+
+      l->settings_ = arena_.allocate_array<element*>(n);
+      for(boost::uint32_t i = 0; i < n; i++)
+      {
+         l->settings_[i] = copy_element(*source.settings_[i]);
+         l->size_ = i + 1;
+      }
+      return l;
+   }
+
+   cconfig::arena& arena_;
+   symbol_table* symbols_;
+};
+
+}
+
+///
+/// \brief Copies a tree into a single block of an arena.
+///
+/// All child arrays and indexes of the copy are allocated with exactly
+/// the size they need, keys are interned in a new symbol table and
+/// strings are copied, so that the copy depends on nothing but the arena.
+///
+/// \throws std::bad_alloc if the system is out of memory.
+///
+inline group* compact(const group& root, cconfig::arena& a)
+{
+   return compact_detail::copier(a).copy(root);
+}
+
+}
+
+#endif
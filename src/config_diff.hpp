@@ -0,0 +1,282 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_DIFF_HPP_
+#define CONFIG_DIFF_HPP_
+
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include "config_tree.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Difference between two versions of a config tree.
+///
+struct change
+{
+   enum kind_type { added, removed, modified };
+
+   change(kind_type k, const std::string& p) : kind(k), path(p) {}
+
+   ///
+   /// \brief Checks whether the change concerns the settings below prefix.
+   ///
+   /// This is the case if the changed element is inside the prefix or if
+   /// it contains the prefix, e.g. "a.b" affects "a", "a.b" and "a.b[1]",
+   /// but not "a.bc". The empty prefix is affected by every change.
+   ///
+   bool affects(const std::string& prefix) const
+   {
+      const std::string& shorter = prefix.size() < path.size() ? prefix : path;
+      const std::string& longer = prefix.size() < path.size() ? path : prefix;
+      if(longer.compare(0, shorter.size(), shorter) != 0)
+         return false;
+      return shorter.empty() || longer.size() == shorter.size()
+         || longer[shorter.size()] == '.' || longer[shorter.size()] == '[';
+   }
+
+   kind_type kind;
+   /// Path of the element, e.g. "settings.list[2].a"
+   std::string path;
+};
+
+typedef std::vector<change> change_list;
+
+namespace diff_detail {
+
+///
+/// \brief Recursive comparison of two trees.
+///
+/// Only the topmost differing elements are reported: an added group is
+/// one change, not one per setting inside it. A group whose settings are
+/// equal but in a different order is reported as modified.
+///
+/// If sharing is enabled, equal children of the new tree are replaced by
+/// the ones of the old tree.
+///
+class differ
+{
+public:
+   differ(change_list& changes, bool share) : changes_(changes), share_(share) {}
+
+   /// Returns true if both elements are equal, path is the path of both
+   bool compare(const element& before, const element& after, std::string& path)
+   {
+      if(&before == &after)
+         return true;
+
+      if(before.kind() != after.kind())
+      {
+         report(change::modified, path);
+         return false;
+      }
+
+      const size_t reported = changes_.size();
+      bool equal;
+      switch(after.kind())
+      {
+      case element::group_kind:
+         equal = compare_groups(before.as_group_unchecked(), const_cast<group&>(after.as_group_unchecked()), path);
+         break;
+      case element::list_kind:
+         equal = compare_lists(before.as_list_unchecked(), const_cast<list&>(after.as_list_unchecked()), path);
+         break;
+      default:
+         equal = before.as_atom_unchecked() == after.as_atom_unchecked();
+         break;
+      }
+
+      // reordered groups do not have a differing child
+      if(!equal && changes_.size() == reported)
+         report(change::modified, path);
+      return equal;
+   }
+
+private:
+   bool compare_groups(const group& before, group& after, std::string& path)
+   {
+      bool equal = before.size() == after.size();
+      size_t matched = 0;
+      size_t position = 0;
+      for(group::iterator it = after.begin(); it != after.end(); ++it, ++position)
+      {
+         const size_t length = path.size();
+         append_key(path, it->key->name);
+
+         const element* old = before.get_if(it->key->name, it->key->hash);
+         if(old == NULL)
+         {
+            report(change::added, path);
+            equal = false;
+         }
+         else
+         {
+            ++matched;
+            if(compare(*old, *it->value, path))
+            {
+               if(share_)
+                  after.replace(position, const_cast<element*>(old));
+               if(equal && before.begin()[position].key->name != it->key->name)
+                  equal = false;
+            }
+            else
+               equal = false;
+         }
+         path.resize(length);
+      }
+
+      if(matched != before.size())
+      {
+         for(group::iterator it = before.begin(); it != before.end(); ++it)
+            if(after.get_if(it->key->name, it->key->hash) == NULL)
+            {
+               const size_t length = path.size();
+               append_key(path, it->key->name);
+               report(change::removed, path);
+               path.resize(length);
+            }
+      }
+      return equal;
+   }
+
+   bool compare_lists(const list& before, list& after, std::string& path)
+   {
+      if(before.storage() != list::generic_storage && before.storage() == after.storage())
+         return compare_arrays(before, after, path);
+
+      bool equal = before.size() == after.size();
+      const size_t common = before.size() < after.size() ? before.size() : after.size();
+      for(size_t i = 0; i < before.size() || i < after.size(); i++)
+      {
+         const size_t length = path.size();
+         path += '[';
+         path += boost::lexical_cast<std::string>(i);
+         path += ']';
+
+         if(i >= common)
+            report(i < after.size() ? change::added : change::removed, path);
+         else if(compare(*before.get_if(i), *after.get_if(i), path))
+         {
+            // elements of typed arrays are views in detached memory
+            // that is not found among the arena blocks, they are kept
+            if(share_ && after.storage() == list::generic_storage && before.storage() == list::generic_storage)
+               after.replace(i, const_cast<element*>(before.get_if(i)));
+         }
+         else
+            equal = false;
+         path.resize(length);
+      }
+      return equal;
+   }
+
+   /// Compares arrays of the same typed storage without creating elements
+   bool compare_arrays(const list& before, const list& after, std::string& path)
+   {
+      bool equal = before.size() == after.size();
+      for(size_t i = 0; i < before.size() || i < after.size(); i++)
+      {
+         if(i < before.size() && i < after.size() && same_value(before, after, i))
+            continue;
+
+         const size_t length = path.size();
+         path += '[';
+         path += boost::lexical_cast<std::string>(i);
+         path += ']';
+         report(i >= after.size() ? change::removed : i >= before.size() ? change::added : change::modified, path);
+         path.resize(length);
+         equal = false;
+      }
+      return equal;
+   }
+
+   static bool same_value(const list& a, const list& b, size_t i)
+   {
+      switch(a.storage())
+      {
+      case list::long_storage: return a.long_values()[i] == b.long_values()[i];
+      case list::double_storage: return a.double_values()[i] == b.double_values()[i];
+      default: return a.bool_value(i) == b.bool_value(i);
+      }
+   }
+
+   static void append_key(std::string& path, boost::string_ref key)
+   {
+      if(!path.empty())
+         path += '.';
+      path.append(key.data(), key.size());
+   }
+
+   void report(change::kind_type kind, const std::string& path)
+   {
+      changes_.push_back(change(kind, path));
+   }
+
+   change_list& changes_;
+   bool share_;
+};
+
+}
+
+///
+/// \brief Compares two config trees.
+///
+/// Appends the differences to changes, see diff_detail::differ for how
+/// they are reported.
+///
+/// \returns true if both trees are equal.
+///
+inline bool diff(const element& before, const element& after, change_list& changes)
+{
+   std::string path;
+   return diff_detail::differ(changes, false).compare(before, after, path);
+}
+
+///
+/// \brief Compares two config trees and makes the new one share unchanged subtrees.
+///
+/// Every subtree of after that is equal to the corresponding subtree of
+/// before is replaced by the latter, so that the nodes of unchanged
+/// settings stay the same across reloads. The memory of before must then
+/// live as long as after.
+///
+/// \returns true if both trees are equal, before can then be kept instead
+/// of after.
+///
+inline bool share_unchanged(const element& before, element& after, change_list& changes)
+{
+   std::string path;
+   return diff_detail::differ(changes, true).compare(before, after, path);
+}
+
+}
+
+#endif
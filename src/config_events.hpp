@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_EVENTS_HPP_
+#define CONFIG_EVENTS_HPP_
+
+#include <string>
+#include <vector>
+
+#include "config_tree.hpp"
+#include "config_builder.hpp"
+#include "config_input.hpp"
+#include "config_parser.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Receives the structure of a config while it is parsed.
+///
+/// Events are reported in the order of the input and no tree is built.
+/// Keys and atoms are only valid during the call, the key of elements
+/// of lists and arrays is empty. All functions do nothing by default.
+///
+/// Exceptions thrown by a handler abort parsing and are passed on to the
+/// caller of parse_events.
+///
+class event_handler
+{
+public:
+   virtual ~event_handler() {}
+
+   virtual void on_group_begin(boost::string_ref /*key*/) {}
+   virtual void on_group_end() {}
+   virtual void on_list_begin(boost::string_ref /*key*/) {}
+   virtual void on_list_end() {}
+   /// Arrays are lists whose elements are atoms of the same type
+   virtual void on_array_begin(boost::string_ref /*key*/) {}
+   virtual void on_array_end() {}
+   virtual void on_atom(boost::string_ref /*key*/, const cconfig::atom& /*value*/) {}
+   /// Include directive inside a group, the file is not read
+   virtual void on_include(boost::string_ref /*path*/) {}
+};
+
+namespace events_detail {
+
+///
+/// \brief Adapts the events of cconfig::parser to an event_handler.
+///
+/// Numbers are converted and strings are decoded like tree_builder does.
+/// Decoded strings share a single buffer, so memory use only depends on
+/// the nesting depth and the longest string literal.
+///
+class handler_adapter
+{
+public:
+   explicit handler_adapter(event_handler& h) : handler_(h) {}
+
+   void key(boost::string_ref k) { key_ = k; }
+
+   void begin_group() { handler_.on_group_begin(take_key()); }
+   void end_group() { handler_.on_group_end(); }
+   void begin_list() { handler_.on_list_begin(take_key()); }
+   void end_list() { handler_.on_list_end(); }
+   void begin_array() { handler_.on_array_begin(take_key()); }
+   void end_array() { handler_.on_array_end(); }
+
+   void integer(boost::string_ref text) { handler_.on_atom(take_key(), atom(tree_builder::to_long(text))); }
+   void floating_point(boost::string_ref text) { handler_.on_atom(take_key(), atom(tree_builder::to_double(text))); }
+   void boolean(boost::string_ref text) { handler_.on_atom(take_key(), atom(text == "true")); }
+
+   void string(boost::string_ref text) { handler_.on_atom(take_key(), atom(decode(text))); }
+   void include(boost::string_ref text) { handler_.on_include(decode(text)); }
+
+private:
+   boost::string_ref decode(boost::string_ref text)
+   {
+      boost::string_ref s = text.substr(1, text.size() - 2);
+      if(s.find('\\') != boost::string_ref::npos)
+      {
+         buffer_.resize(s.size());
+         s = boost::string_ref(&buffer_[0], util::unescape(s, &buffer_[0]));
+      }
+      return s;
+   }
+
+   /// Only definitions inside groups have a key, it applies to one value
+   boost::string_ref take_key()
+   {
+      const boost::string_ref k = key_;
+      key_.clear();
+      return k;
+   }
+
+   event_handler& handler_;
+   boost::string_ref key_;
+   std::vector<char> buffer_;
+};
+
+}
+
+///
+/// \brief Parses a config held in memory and reports it to a handler.
+///
+/// The contents of the root group are reported without a surrounding
+/// on_group_begin() and on_group_end().
+///
+/// \param name Name of the input, used in error messages
+/// \throws cconfig::parse_error on syntax errors, after the events of
+///         the input before the error have been reported.
+///
+inline void parse_events(const char* data, size_t size, event_handler& h, const std::string& name = "<buffer>")
+{
+   cconfig::lexer l(data, data + size, name);
+   events_detail::handler_adapter adapter(h);
+   parser<events_detail::handler_adapter> p(l, adapter);
+   p.parse();
+}
+
+///
+/// \brief Parses a config file and reports it to a handler.
+///
+/// The file is mapped instead of read, so large files are streamed
+/// through the page cache.
+///
+/// \throws cconfig::exception if the file cannot be opened,
+///         cconfig::parse_error on syntax errors.
+///
+inline void parse_events(const std::string& filename, event_handler& h)
+{
+   const mapped_file input(filename);
+   parse_events(input.data(), input.size(), h, filename);
+}
+
+}
+
+#endif
@@ -29,47 +29,780 @@
 #ifndef CONFIG_FILE_HPP_
 #define CONFIG_FILE_HPP_
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include "config_tree.hpp"
+#include "config_antlr_pool.hpp"
+#include "config_binary.hpp"
+#include "config_builder.hpp"
+#include "config_cache.hpp"
+#include "config_compact.hpp"
+#include "config_diff.hpp"
+#include "config_include.hpp"
+#include "config_index.hpp"
+#include "config_input.hpp"
+#include "config_lazy.hpp"
+#include "config_parallel.hpp"
+#include "config_parser.hpp"
+#include "config_stats.hpp"
+#include "config_stream.hpp"
 
 #include "ConfigLexer.hpp"
 #include "ConfigParser.hpp"
 
 namespace cconfig {
 
+namespace schema { class schema; }
+
+///
+/// \brief Options for loading config files.
+///
+struct load_options
+{
+   enum input_mode
+   {
+      /// Read the file into a temporary buffer
+      read_file,
+      /// Map the file into memory, strings without escape sequences refer
+      /// to the mapping instead of being copied. The mapping is kept open
+      /// as long as the tree exists, so the file must not be truncated
+      /// in the meantime.
+      map_file
+   };
+
+   enum parser_type
+   {
+      /// Hand-written parser (see config_parser.hpp)
+      builtin_parser,
+      /// Parser generated by ANTLR from grammar/Config.g, kept as the
+      /// reference implementation
+      antlr_parser
+   };
+
+   enum parse_mode
+   {
+      /// Parse the whole config while loading
+      eager,
+      /// Only index the top-level definitions while loading and parse each
+      /// of them on first access (see cconfig::lazy_tree). The input is
+      /// kept in memory for the lifetime of the tree. Only supported by
+      /// the builtin parser, the ANTLR parser always parses eagerly, as
+      /// do configs containing include directives.
+      lazy,
+      /// Parse the whole config on multiple threads (see
+      /// cconfig::parse_config_parallel). Only supported by the builtin
+      /// parser, small configs and configs containing include
+      /// directives are parsed on the calling thread.
+      parallel
+   };
+
+   load_options() : input(read_file), parser(builtin_parser), mode(eager), threads(0), lookup_cache(0), path_index(false) {}
+
+   input_mode input;
+   parser_type parser;
+   parse_mode mode;
+   /// Number of threads used by parallel parsing, 0 for one per core
+   unsigned int threads;
+   /// Maximum number of string paths whose lookup results are cached
+   /// (see cconfig::lookup_cache), 0 disables the cache
+   size_t lookup_cache;
+   /// Resolve string paths through the full path index (see
+   /// file::index()), which is built on the first lookup
+   bool path_index;
+   /// Receives the stats of the file when it is loaded and validated,
+   /// only called with CCONFIG_STATS (see file::stats())
+   cconfig::stats_callback stats_callback;
+};
+
+///
+/// \brief A loaded config file.
+///
+/// The config tree is allocated from an arena owned by the file, group
+/// keys are interned in a symbol table that lives in the same arena. Copies
+/// of a file share the same tree, it is released when the last copy or
+/// handle (see shared_root()) is destroyed or reloaded. Copying is cheap
+/// and the tree is not modified after loading, so each thread may work
+/// with a copy of its own.
+///
+/// A file may be read by several threads, but not while it is reloaded.
+/// Use cconfig::live_file for configs that are replaced at run time.
+///
 class file
 {
 public:
-   file() {}
-   explicit file(const std::string& filename) { load(filename); }
+   file() : root_(NULL), lazy_(NULL) {}
+   explicit file(const std::string& filename, const load_options& options = load_options()) : root_(NULL), lazy_(NULL) { load(filename, options); }
 
-   void load(const std::string& filename)
+   void load(const std::string& filename, const load_options& options = load_options())
    {
-	ConfigLexer::InputStreamType input(reinterpret_cast<const ANTLR_UINT8*>(filename.c_str()), ANTLR_ENC_8BIT);
-	ConfigLexer lexer(&input);
-	ConfigParser::TokenStreamType tokens(ANTLR_SIZE_HINT, lexer.get_tokSource());
-	ConfigParser parser(&tokens);
+	boost::shared_ptr<storage> s = new_storage(options);
+
+#ifdef __unix__
+	// pipes and devices can neither be mapped nor sized in advance
+	if(!cconfig::is_regular_file(filename))
+	{
+		if(options.parser == load_options::builtin_parser && options.mode == load_options::eager)
+		{
+			cconfig::file_source source(filename);
+			load_source(s, source, filename);
+		}
+		else
+		{
+			cconfig::stats_detail::stopwatch watch;
+			cconfig::read_file(filename, s->buffer);
+			s->stats.read_time = watch.elapsed();
+			load_memory(s, s->buffer.data(), s->buffer.size(), filename, true, options);
+		}
+		return;
+	}
+#endif
+
+	cconfig::stats_detail::stopwatch watch;
+	if(options.input == load_options::map_file)
+	{
+		s->input.reset(new cconfig::mapped_file(filename));
+		s->stats.read_time = watch.elapsed();
+		load_memory(s, s->input->data(), s->input->size(), filename, true, options);
+	}
+	else if(options.parser == load_options::builtin_parser)
+	{
+		// lazily parsed trees keep the input
+		const bool keep = options.mode == load_options::lazy;
+		std::string buffer;
+		cconfig::read_file(filename, keep ? s->buffer : buffer);
+		s->stats.read_time = watch.elapsed();
+		const std::string& input = keep ? s->buffer : buffer;
+		load_memory(s, input.data(), input.size(), filename, keep, options);
+	}
+	else
+	{
+		cconfig::antlr_pool::scope pool;
+		ConfigLexer::InputStreamType input(reinterpret_cast<const ANTLR_UINT8*>(filename.c_str()), ANTLR_ENC_8BIT);
+		group* root = parse_antlr(input, *s, filename, false);
+		// the ANTLR input stream reads the file itself
+		record_parse(*s, filename, input.size(), s->stats.tokens, watch);
+		set(s, root, NULL);
+	}
+   }
+
+   ///
+   /// \brief Loads a config from a memory buffer.
+   ///
+   /// The buffer is parsed in place without copying it and is not
+   /// referenced after this function returns. Lazily parsed configs
+   /// copy the buffer.
+   ///
+   void load_from_buffer(const char* data, size_t size, const load_options& options = load_options())
+   {
+	load_memory(new_storage(options), data, size, "<buffer>", false, options);
+   }
+
+   ///
+   /// \brief Loads a config from a memory buffer holding the contents of a file.
+   ///
+   /// \param name File name used in errors and for resolving relative
+   ///        include directives
+   ///
+   void load_from_buffer(const char* data, size_t size, const std::string& name, const load_options& options = load_options())
+   {
+	load_memory(new_storage(options), data, size, name, false, options);
+   }
+
+   ///
+   /// \brief Loads a config from a stream, reading it until end of file.
+   ///
+   /// Configs loaded eagerly by the builtin parser are parsed while the
+   /// stream is read (see cconfig::parse_stream).
+   ///
+   void load_from_stream(std::istream& in, const load_options& options = load_options())
+   {
+	boost::shared_ptr<storage> s = new_storage(options);
+	if(options.parser == load_options::builtin_parser && options.mode == load_options::eager)
+	{
+		cconfig::stream_source source(in);
+		load_source(s, source, "<stream>");
+		return;
+	}
+
+	const bool keep = options.mode == load_options::lazy && options.parser == load_options::builtin_parser;
+	std::string buffer;
+	cconfig::stats_detail::stopwatch watch;
+	cconfig::read_stream(in, keep ? s->buffer : buffer);
+	s->stats.read_time = watch.elapsed();
+	const std::string& input = keep ? s->buffer : buffer;
+	load_memory(s, input.data(), input.size(), "<stream>", keep, options);
+   }
+
+   ///
+   /// \brief Loads a compiled config as written by cconfig_compile.
+   ///
+   /// The file is mapped into memory and the tree is rebuilt from it
+   /// without parsing, string values refer to the mapping.
+   ///
+   /// \throws cconfig::exception if the file is not a valid compiled config.
+   ///
+   void load_binary(const std::string& filename)
+   {
+	boost::shared_ptr<storage> s = boost::make_shared<storage>();
+	cconfig::stats_detail::stopwatch watch;
+	s->input.reset(new cconfig::mapped_file(filename));
+	s->stats.read_time = watch.elapsed();
 
-	root_ = parser.file();
+	cconfig::stats_detail::stopwatch parse_watch;
+	cconfig::tree_builder builder(s->arena, true);
+	group* root = cconfig::binary::read(s->input->data(), s->input->size(), filename, builder);
+	record_parse(*s, filename, s->input->size(), 0, parse_watch);
+	set(s, root, NULL);
+   }
+
+   ///
+   /// \brief Writes the loaded config in compiled form (see load_binary).
+   ///
+   void save_binary(std::ostream& out) const
+   {
+	cconfig::binary::write(*root_, out);
+   }
+
+   ///
+   /// \brief Moves the tree into a single block of memory with all containers fitted to their size.
+   ///
+   /// Meant to be called once after loading a config that is kept for a
+   /// long time: lookups touch fewer cache lines, and the arenas, input
+   /// and included files of the previous tree are released as soon as no
+   /// other copy of the file or handle refers to them. Lazily parsed
+   /// configs are parsed completely. Other copies of the file keep the
+   /// previous tree, the lookup cache and path index start out empty.
+   /// The stats of the file are kept, with the allocations of the new
+   /// arena.
+   ///
+   void compact()
+   {
+	if(!storage_)
+		return;
+
+	boost::shared_ptr<storage> s = boost::make_shared<storage>();
+	if(storage_->cache)
+		s->cache.reset(new cconfig::lookup_cache(storage_->cache->capacity()));
+	s->use_index = storage_->use_index;
+	s->stats = stats();
+	s->stats_callback = storage_->stats_callback;
+
+	root_ = cconfig::compact(root(), s->arena);
+	lazy_ = NULL;
+	storage_.swap(s);
+#ifdef CCONFIG_STATS
+	count_arenas(storage_->stats);
+#endif
    }
 
    ///////////////////////////////////////////////////
    // Forwarding functions for contained root element
 
-   const element& operator[](const std::string& key) const { return root_->operator[](key); }
+   const element& operator[](const std::string& key) const
+   {
+	const element* e = fast_find(key);
+	return e != NULL ? *e : lazy_ ? lazy_get(key) : root_->operator[](key);
+   }
+   const element& operator[](const cconfig::path& p) const { return lazy_ ? lazy_get(p) : root_->operator[](p); }
+
+   template<typename T>
+   const T lookup(const std::string& path) const
+   {
+	const element* e = fast_find(path);
+	return e != NULL ? e->as<T>() : lazy_ ? lazy_get(path).as<T>() : root_->lookup<T>(path);
+   }
 
    template<typename T>
-   const T lookup(const std::string& path) const { return root_->lookup<T>(path); }
+   const T lookup(const std::string& path, const T& default_value) const { return try_lookup<T>(path).get_value_or(default_value); }
 
    template<typename T>
-   const T lookup(const std::string& path, const T& default_value) const { return root_->lookup<T>(path, default_value); }
+   const T lookup(const cconfig::path& p) const { return lazy_ ? lazy_get(p).as<T>() : root_->lookup<T>(p); }
+
+   template<typename T>
+   const T lookup(const cconfig::path& p, const T& default_value) const { return try_lookup<T>(p).get_value_or(default_value); }
+
+   const element* find(const std::string& path) const
+   {
+	const element* e = storage_->use_index ? index().find(path) : NULL;
+	return e != NULL ? e : storage_->cache ? cached_find(path) : uncached_find(path);
+   }
+   const element* find(const cconfig::path& p) const { return lazy_ ? lazy_->find(p) : root_->find(p); }
+
+   bool contains(const std::string& path) const { return find(path) != NULL; }
+   bool contains(const cconfig::path& p) const { return find(p) != NULL; }
+
+   template<typename T>
+   boost::optional<T> try_lookup(const std::string& path) const { return lazy_try<T>(find(path)); }
+
+   template<typename T>
+   boost::optional<T> try_lookup(const cconfig::path& p) const { return lazy_ ? lazy_try<T>(lazy_->find(p)) : root_->try_lookup<T>(p); }
+
+#ifdef CCONFIG_HAS_PATH_LITERALS
+   // lazy files resolve static paths like runtime ones
+
+   template<size_t N>
+   const element& operator[](const static_path<N>& p) const { return lazy_ ? lazy_get(cconfig::path(p.str())) : root_->operator[](p); }
+
+   template<typename T, size_t N>
+   const T lookup(const static_path<N>& p) const { return operator[](p).template as<T>(); }
+
+   template<typename T, size_t N>
+   const T lookup(const static_path<N>& p, const T& default_value) const { return try_lookup<T>(p).get_value_or(default_value); }
+
+   template<size_t N>
+   const element* find(const static_path<N>& p) const { return lazy_ ? lazy_->find(cconfig::path(p.str())) : root_->find(p); }
+
+   template<size_t N>
+   bool contains(const static_path<N>& p) const { return find(p) != NULL; }
+
+   template<typename T, size_t N>
+   boost::optional<T> try_lookup(const static_path<N>& p) const { return lazy_ ? lazy_try<T>(find(p)) : root_->try_lookup<T>(p); }
+#endif
 
    ///////////////////////////////////////////////////
    // Other functions
 
-   const group& root() const { return *root_; }
+   ///
+   /// \brief Returns the root group of the config.
+   ///
+   /// Lazily parsed configs are parsed completely by the first call.
+   ///
+   const group& root() const { return lazy_ ? lazy_->root() : *root_; }
+
+   ///
+   /// \brief Returns the root group as a handle that keeps the tree alive.
+   ///
+   /// The handle shares ownership of the tree with the copies of the
+   /// file, it stays valid when the file is destroyed or reloaded.
+   ///
+   boost::shared_ptr<const group> shared_root() const { return boost::shared_ptr<const group>(storage_, &root()); }
+
+   ///
+   /// \brief Returns a setting as a handle that keeps the tree alive, see shared_root().
+   ///
+   /// \throws cconfig::lookup_error if the setting does not exist.
+   ///
+   boost::shared_ptr<const element> shared_element(const std::string& path) const
+   {
+	return boost::shared_ptr<const element>(storage_, &operator[](path));
+   }
+
+   boost::shared_ptr<const element> shared_element(const cconfig::path& p) const
+   {
+	return boost::shared_ptr<const element>(storage_, &operator[](p));
+   }
+
+   ///
+   /// \brief Returns the full path index of the config, building it on first use.
+   ///
+   /// The index is shared by all copies of the file. Lazily parsed configs
+   /// are parsed completely when it is built.
+   ///
+   const path_index& index() const
+   {
+	const path_index* i = storage_->index.load(boost::memory_order_acquire);
+	if(i != NULL)
+		return *i;
+
+	boost::lock_guard<boost::mutex> lock(storage_->index_mutex);
+	if(!storage_->index_owner)
+	{
+		// passed as element, the template conversion operator would
+		// otherwise be considered for the copy constructor in C++17
+		const element& r = root();
+		storage_->index_owner.reset(new cconfig::path_index(r));
+		storage_->index.store(storage_->index_owner.get(), boost::memory_order_release);
+	}
+	return *storage_->index_owner;
+   }
+
+   ///
+   /// \brief Returns the counters of the lookup cache shared by all copies of the file.
+   ///
+   cconfig::lookup_cache_stats cache_stats() const
+   {
+	return storage_ && storage_->cache ? storage_->cache->stats() : cconfig::lookup_cache_stats();
+   }
+
+   ///
+   /// \brief Returns the measurements of loading and validating the config.
+   ///
+   /// Shared by all copies of the file. All members are zero unless
+   /// compiled with CCONFIG_STATS, see cconfig::load_stats.
+   ///
+   cconfig::load_stats stats() const
+   {
+	if(!storage_)
+		return cconfig::load_stats();
+#ifdef CCONFIG_STATS
+	boost::lock_guard<boost::mutex> lock(storage_->stats_mutex);
+#endif
+	return storage_->stats;
+   }
 
 private:
+   friend class live_file;
+   friend class overlay;
+   friend class cconfig::schema::schema;
+
+   ///
+   /// \brief Memory shared by all copies of a file.
+   ///
+   struct storage
+   {
+      cconfig::arena arena;
+      /// Mapped input, strings of the tree may refer to it
+      boost::scoped_ptr<cconfig::mapped_file> input;
+      /// Input of lazily parsed configs that are not mapped
+      std::string buffer;
+      boost::scoped_ptr<cconfig::lazy_tree> lazy;
+      /// Arenas of the threads of parallel parsing
+      boost::ptr_vector<cconfig::arena> arenas;
+      /// Storage of earlier trees that share subtrees with this one
+      std::vector<boost::shared_ptr<storage> > retained;
+      /// Files included by the config, the tree holds their nodes
+      std::vector<boost::shared_ptr<const cconfig::fragment> > includes;
+      /// Results of string lookups, replaced together with the tree
+      boost::scoped_ptr<cconfig::lookup_cache> cache;
+
+      cconfig::load_stats stats;
+      cconfig::stats_callback stats_callback;
+#ifdef CCONFIG_STATS
+      /// Guards the stats once the file is shared, validations update them
+      boost::mutex stats_mutex;
+#endif
+
+      storage() : shares_nodes(false), use_index(false), index(NULL) {}
+
+      /// The tree holds nodes of other configs, see overlay::flatten
+      bool shares_nodes;
+
+      /// String lookups try the index first
+      bool use_index;
+      /// Published index once built, guarded by index_mutex until then
+      boost::atomic<const cconfig::path_index*> index;
+      boost::mutex index_mutex;
+      boost::scoped_ptr<cconfig::path_index> index_owner;
+   };
+
+   ///
+   /// \brief Diffs against a previously loaded config and shares its unchanged subtrees.
+   ///
+   /// The tree must not be shared by other copies yet. Lazily parsed
+   /// configs, configs with include directives and flattened overlays
+   /// are only compared, as are configs following one with include
+   /// directives or a flattened overlay. The storage of previous and of
+   /// the trees it shares is kept as long as it holds any node of the
+   /// new tree.
+   ///
+   /// \returns true if both configs are equal.
+   ///
+   bool share_unchanged(const file& previous, cconfig::change_list& changes)
+   {
+	// included fragments and overlay layers are shared with other
+	// configs and must not be modified, and nodes of previous that
+	// belong to them are not found in its arenas by retain_owners
+	if(lazy_ != NULL || storage_->shares_nodes || !storage_->includes.empty()
+		|| previous.storage_->shares_nodes || !previous.storage_->includes.empty())
+		return cconfig::diff(previous.root(), root(), changes);
+	if(cconfig::share_unchanged(previous.root(), *root_, changes))
+		return true;
+
+	std::vector<boost::shared_ptr<storage> > candidates(previous.storage_->retained);
+	candidates.push_back(previous.storage_);
+	retain_owners(candidates);
+	return false;
+   }
+
+   /// Block of a candidate storage in retain_owners()
+   struct owner_block
+   {
+      cconfig::arena::block_range range;
+      size_t owner;
+
+      bool operator<(const owner_block& other) const { return range.first < other.range.first; }
+   };
+
+   void retain_owners(const std::vector<boost::shared_ptr<storage> >& candidates)
+   {
+	std::vector<owner_block> blocks;
+	std::vector<cconfig::arena::block_range> ranges;
+	for(size_t i = 0; i < candidates.size(); i++)
+	{
+		ranges.clear();
+		candidates[i]->arena.get_blocks(ranges);
+		for(boost::ptr_vector<cconfig::arena>::const_iterator it = candidates[i]->arenas.begin(); it != candidates[i]->arenas.end(); ++it)
+			it->get_blocks(ranges);
+		for(size_t j = 0; j < ranges.size(); j++)
+		{
+			owner_block b = { ranges[j], i };
+			blocks.push_back(b);
+		}
+	}
+	std::sort(blocks.begin(), blocks.end());
+
+	std::vector<bool> used(candidates.size(), false);
+	size_t remaining = candidates.size();
+	mark_owners(*root_, blocks, used, remaining);
+
+	for(size_t i = 0; i < candidates.size(); i++)
+		if(used[i])
+			storage_->retained.push_back(candidates[i]);
+   }
+
+   static void mark_owners(const element& e, const std::vector<owner_block>& blocks, std::vector<bool>& used, size_t& remaining)
+   {
+	if(remaining == 0)
+		return;
+
+	// strings live in the arena or input of the storage holding their
+	// atom, so looking at the nodes is enough
+	owner_block key = { cconfig::arena::block_range(reinterpret_cast<const char*>(&e), NULL), 0 };
+	std::vector<owner_block>::const_iterator it = std::upper_bound(blocks.begin(), blocks.end(), key);
+	if(it != blocks.begin() && key.range.first < (--it)->range.second && !used[it->owner])
+	{
+		used[it->owner] = true;
+		--remaining;
+	}
+
+	if(e.is_group())
+	{
+		const group& g = e.as_group_unchecked();
+		for(group::iterator child = g.begin(); child != g.end(); ++child)
+			mark_owners(*child->value, blocks, used, remaining);
+	}
+	else if(e.is_list() && e.as_list_unchecked().storage() == list::generic_storage)
+	{
+		// typed arrays have no child nodes
+		const list& l = e.as_list_unchecked();
+		for(list::iterator child = l.begin(); child != l.end(); ++child)
+			mark_owners(*child, blocks, used, remaining);
+	}
+   }
+
+   static boost::shared_ptr<storage> new_storage(const load_options& options)
+   {
+	boost::shared_ptr<storage> s = boost::make_shared<storage>();
+	if(options.lookup_cache != 0)
+		s->cache.reset(new cconfig::lookup_cache(options.lookup_cache));
+	s->use_index = options.path_index;
+	s->stats_callback = options.stats_callback;
+	return s;
+   }
+
+   void set(boost::shared_ptr<storage>& s, group* root, cconfig::lazy_tree* lazy)
+   {
+	root_ = root;
+	lazy_ = lazy;
+	storage_.swap(s);
+#ifdef CCONFIG_STATS
+	finish_stats();
+#endif
+   }
+
+   /// Records the input and the time since watch was started as parse phase
+   static void record_parse(storage& s, const std::string& name, size_t bytes, size_t tokens,
+	const cconfig::stats_detail::stopwatch& watch)
+   {
+#ifdef CCONFIG_STATS
+	s.stats.parse_time = watch.elapsed();
+	s.stats.name = name;
+	s.stats.bytes_read = bytes;
+	s.stats.tokens = tokens;
+#else
+	(void)s;
+	(void)name;
+	(void)bytes;
+	(void)tokens;
+	(void)watch;
+#endif
+   }
+
+#ifdef CCONFIG_STATS
+   /// Counts the tree of a loaded config and reports the stats
+   void finish_stats()
+   {
+	cconfig::load_stats& stats = storage_->stats;
+	if(root_ != NULL)
+		cconfig::stats_detail::count_elements(*root_, stats, 1);
+	count_arenas(stats);
+
+	if(storage_->stats_callback)
+		storage_->stats_callback(stats);
+   }
+
+   void count_arenas(cconfig::load_stats& stats) const
+   {
+	stats.allocations = storage_->arena.allocations();
+	stats.allocated_bytes = storage_->arena.bytes_used();
+	stats.reserved_bytes = storage_->arena.bytes_reserved();
+	for(boost::ptr_vector<cconfig::arena>::const_iterator it = storage_->arenas.begin(); it != storage_->arenas.end(); ++it)
+	{
+		stats.allocations += it->allocations();
+		stats.allocated_bytes += it->bytes_used();
+		stats.reserved_bytes += it->bytes_reserved();
+	}
+   }
+#endif
+
+   /// Adds a validation that started with watch to the stats, see schema::validate
+   void record_validation(const cconfig::stats_detail::stopwatch& watch) const
+   {
+#ifdef CCONFIG_STATS
+	cconfig::load_stats stats;
+	{
+		boost::lock_guard<boost::mutex> lock(storage_->stats_mutex);
+		storage_->stats.validate_time += watch.elapsed();
+		storage_->stats.validations++;
+		stats = storage_->stats;
+	}
+	if(storage_->stats_callback)
+		storage_->stats_callback(stats);
+#else
+	(void)watch;
+#endif
+   }
+
+   const element* uncached_find(const std::string& path) const
+   {
+	return lazy_ ? lazy_->find(path) : root_->find(path);
+   }
+
+   const element* cached_find(const std::string& path) const
+   {
+	const boost::uint32_t hash = util::hash_key(path);
+	const element* e = NULL;
+	if(!storage_->cache->get(path, hash, e))
+	{
+		// malformed paths throw and are never cached
+		e = uncached_find(path);
+		storage_->cache->put(path, hash, e);
+	}
+	return e;
+   }
+
+   /// Element found through the index or cache, NULL if neither has it
+   const element* fast_find(const std::string& path) const
+   {
+	if(storage_->use_index)
+	{
+		// the index only knows canonical paths, others are walked
+		const element* e = index().find(path);
+		if(e != NULL)
+			return e;
+	}
+	return storage_->cache ? cached_find(path) : NULL;
+   }
+
+   const element& lazy_get(const std::string& path) const
+   {
+	const element* e = lazy_->find(path);
+	if(e == NULL)
+		throw cconfig::lookup_error("Config setting not found (" + path + ")");
+	return *e;
+   }
+
+   const element& lazy_get(const cconfig::path& p) const
+   {
+	const element* e = lazy_->find(p);
+	if(e == NULL)
+		throw cconfig::lookup_error("Config setting not found (" + p.str() + ")");
+	return *e;
+   }
+
+   template<typename T>
+   static boost::optional<T> lazy_try(const element* e)
+   {
+	if(e == NULL || !e->is_atom())
+		return boost::none;
+	return e->as_atom_unchecked().as<T>();
+   }
+
+   void load_memory(boost::shared_ptr<storage> s, const char* data, size_t size,
+	const std::string& name, bool reference_input, const load_options& options)
+   {
+	if(options.parser == load_options::builtin_parser)
+	{
+		// include directives need a tree builder, configs that may contain
+		// them are parsed eagerly
+		if(options.mode == load_options::lazy && std::memchr(data, '@', size) == NULL)
+		{
+			if(!reference_input)
+			{
+				s->buffer.assign(data, size);
+				data = s->buffer.data();
+			}
+			cconfig::stats_detail::stopwatch watch;
+			s->lazy.reset(new cconfig::lazy_tree(s->arena, data, size, name, true));
+			record_parse(*s, name, size, 0, watch);
+			set(s, NULL, s->lazy.get());
+			return;
+		}
+
+		cconfig::stats_detail::stopwatch watch;
+		cconfig::include_loader includes(name, s->includes);
+		cconfig::tree_builder builder(s->arena, reference_input, &includes);
+		group* root = options.mode == load_options::parallel
+			? cconfig::parse_config_parallel(data, size, name, builder, s->arenas, options.threads)
+			: cconfig::parse_config(data, size, name, builder);
+		record_parse(*s, name, size, builder.tokens(), watch);
+		set(s, root, NULL);
+		return;
+	}
+
+	if(size > std::numeric_limits<ANTLR_UINT32>::max())
+		throw cconfig::exception("Config input too large (" + name + ")");
+
+	// the runtime objects, the input stream included, must not outlive the pool scope
+	cconfig::stats_detail::stopwatch watch;
+	cconfig::antlr_pool::scope pool;
+	ConfigLexer::InputStreamType input(reinterpret_cast<const ANTLR_UINT8*>(data), ANTLR_ENC_8BIT,
+		static_cast<ANTLR_UINT32>(size), reinterpret_cast<ANTLR_UINT8*>(const_cast<char*>(name.c_str())));
+	group* root = parse_antlr(input, *s, name, reference_input);
+	record_parse(*s, name, size, s->stats.tokens, watch);
+	set(s, root, NULL);
+   }
+
+   void load_source(boost::shared_ptr<storage>& s, cconfig::input_source& source, const std::string& name)
+   {
+	cconfig::stats_detail::stopwatch watch;
+	cconfig::include_loader includes(name, s->includes);
+	cconfig::tree_builder builder(s->arena, false, &includes);
+	group* root = cconfig::parse_stream(source, name, builder);
+	record_parse(*s, name, builder.input_bytes(), builder.tokens(), watch);
+	set(s, root, NULL);
+   }
+
+   static group* parse_antlr(ConfigLexer::InputStreamType& input, storage& s, const std::string& name, bool reference_input)
+   {
+	ConfigLexer lexer(&input);
+	ConfigParser::TokenStreamType tokens(ANTLR_SIZE_HINT, lexer.get_tokSource());
+	ConfigParser parser(&tokens);
+
+	cconfig::include_loader includes(name, s.includes);
+	cconfig::tree_builder builder(s.arena, reference_input, &includes);
+	group* root = parser.file(&builder);
+#ifdef CCONFIG_STATS
+	s.stats.tokens = tokens.get_tokens().size();
+#endif
+	return root;
+   }
+
+   boost::shared_ptr<storage> storage_;
    group* root_;
+   /// Lazily parsed tree owned by the storage, root_ is NULL if set
+   cconfig::lazy_tree* lazy_;
 };
 
 }
@@ -0,0 +1,185 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef CONFIG_FILE_SET_HPP_
+#define CONFIG_FILE_SET_HPP_
+
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "config_file.hpp"
+#include "config_input.hpp"
+#include "config_schema.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Options of file_set::load().
+///
+struct file_set_options
+{
+   file_set_options() : threads(0), schema(NULL), strict(false) {}
+
+   /// Options each file is loaded with
+   load_options load;
+   /// Number of threads, 0 for one per core
+   unsigned int threads;
+   /// Schema the loaded files are validated against, NULL for none. It
+   /// is shared by all threads.
+   const cconfig::schema::schema* schema;
+   /// Strict validation, see cconfig::schema::node::validate()
+   bool strict;
+};
+
+///
+/// \brief Loads many config files concurrently.
+///
+/// Files are handed out to the threads one at a time, so that a few large
+/// files do not leave the others idle. Each thread reuses its input
+/// buffer for all files it reads. Failures are collected per file and
+/// do not stop the others from loading.
+///
+/// \code
+/// cconfig::file_set tenants;
+/// tenants.add("tenants/a.conf").add("tenants/b.conf");
+/// cconfig::file_set_options options;
+/// options.schema = &tenant_schema;
+/// if(tenants.load(options) != 0)
+///    ...
+/// \endcode
+///
+class file_set : boost::noncopyable
+{
+public:
+   ///
+   /// \brief Outcome of loading one file.
+   ///
+   struct entry
+   {
+      explicit entry(const std::string& f) : filename(f) {}
+
+      std::string filename;
+      /// Loaded config, empty if loading failed
+      cconfig::file config;
+      /// Reason loading failed, empty if the file was loaded
+      std::string error;
+      /// Validation errors of the loaded config
+      cconfig::schema::error_list errors;
+
+      bool loaded() const { return error.empty(); }
+      bool valid() const { return error.empty() && errors.empty(); }
+   };
+
+   file_set& add(const std::string& filename)
+   {
+      entries_.push_back(entry(filename));
+      return *this;
+   }
+
+   size_t size() const { return entries_.size(); }
+   const entry& operator[](size_t i) const { return entries_[i]; }
+
+   ///
+   /// \brief Loads and validates all files that were added.
+   ///
+   /// Files loaded by an earlier call are loaded again.
+   ///
+   /// \returns the number of files that failed to load or to validate.
+   ///
+   size_t load(const file_set_options& options = file_set_options())
+   {
+      unsigned int threads = options.threads != 0 ? options.threads : boost::thread::hardware_concurrency();
+      threads = static_cast<unsigned int>(std::min<size_t>(std::max(threads, 1u), entries_.size()));
+
+      boost::atomic<size_t> next(0);
+      boost::thread_group group;
+      for(unsigned int i = 1; i < threads; i++)
+         group.create_thread(boost::bind(&file_set::work, this, boost::cref(options), boost::ref(next)));
+      // the calling thread takes part
+      work(options, next);
+      group.join_all();
+
+      size_t failed = 0;
+      for(size_t i = 0; i < entries_.size(); i++)
+         failed += !entries_[i].valid();
+      return failed;
+   }
+
+private:
+   void work(const file_set_options& options, boost::atomic<size_t>& next)
+   {
+      std::string buffer;
+      for(;;)
+      {
+         const size_t i = next.fetch_add(1);
+         if(i >= entries_.size())
+            return;
+         load(entries_[i], options, buffer);
+      }
+   }
+
+   static void load(entry& e, const file_set_options& options, std::string& buffer)
+   {
+      e.config = cconfig::file();
+      e.error.clear();
+      e.errors.clear();
+      try
+      {
+         // mapped and ANTLR input is read by the file itself
+         if(options.load.input == load_options::read_file && options.load.parser == load_options::builtin_parser)
+         {
+            cconfig::read_file(e.filename, buffer);
+            e.config.load_from_buffer(buffer.data(), buffer.size(), e.filename, options.load);
+         }
+         else
+            e.config.load(e.filename, options.load);
+
+         if(options.schema != NULL)
+            options.schema->validate(e.config, options.strict, e.errors);
+      }
+      catch(const std::exception& ex)
+      {
+         e.config = cconfig::file();
+         e.error = ex.what();
+      }
+   }
+
+   std::vector<entry> entries_;
+};
+
+}
+
+#endif
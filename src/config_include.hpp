@@ -0,0 +1,260 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef CONFIG_INCLUDE_HPP_
+#define CONFIG_INCLUDE_HPP_
+
+#include <climits>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "config_arena.hpp"
+#include "config_builder.hpp"
+#include "config_input.hpp"
+#include "config_parser.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Parsed included file.
+///
+/// Fragments are immutable once parsed and shared by all configs that
+/// include the same file, their nodes are part of the including trees.
+///
+struct fragment : boost::noncopyable
+{
+   fragment() : root(NULL) {}
+
+   /// Canonical file name
+   std::string path;
+   file_stamp stamp;
+   cconfig::arena arena;
+   const group* root;
+   /// Fragments included by this one, root holds their nodes
+   std::vector<boost::shared_ptr<const fragment> > includes;
+
+   /// Returns true if neither this file nor one it includes has changed
+   bool current() const
+   {
+      file_stamp s;
+      if(!file_stamp::of(path, s) || s != stamp)
+         return false;
+      for(size_t i = 0; i < includes.size(); i++)
+         if(!includes[i]->current())
+            return false;
+      return true;
+   }
+};
+
+///
+/// \brief Process-wide cache of included files.
+///
+/// The cache only holds weak references, a fragment lives as long as a
+/// loaded config includes it. Reloading a config while the previous
+/// version is still alive reuses the fragments of unchanged files.
+///
+class fragment_cache : boost::noncopyable
+{
+public:
+   static fragment_cache& instance()
+   {
+      static fragment_cache cache;
+      return cache;
+   }
+
+   /// Returns the fragment of a file if it is cached and still alive
+   boost::shared_ptr<const fragment> find(const std::string& path) const
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      std::map<std::string, boost::weak_ptr<const fragment> >::const_iterator it = fragments_.find(path);
+      return it != fragments_.end() ? it->second.lock() : boost::shared_ptr<const fragment>();
+   }
+
+   ///
+   /// \brief Adds a newly parsed fragment.
+   ///
+   /// \returns the fragment to use, which is an equal one if the file was
+   ///          parsed by another thread in the meantime. Outdated
+   ///          fragments are replaced.
+   ///
+   boost::shared_ptr<const fragment> insert(const boost::shared_ptr<const fragment>& f)
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      boost::weak_ptr<const fragment>& entry = fragments_[f->path];
+      boost::shared_ptr<const fragment> existing = entry.lock();
+      if(existing && existing->stamp == f->stamp && existing->current())
+         return existing;
+      entry = f;
+
+      for(std::map<std::string, boost::weak_ptr<const fragment> >::iterator it = fragments_.begin(); it != fragments_.end(); )
+      {
+         if(it->second.expired())
+            fragments_.erase(it++);
+         else
+            ++it;
+      }
+      return f;
+   }
+
+   /// Number of cached files that are still alive
+   size_t size() const
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      size_t n = 0;
+      for(std::map<std::string, boost::weak_ptr<const fragment> >::const_iterator it = fragments_.begin(); it != fragments_.end(); ++it)
+         n += !it->second.expired();
+      return n;
+   }
+
+private:
+   fragment_cache() {}
+
+   mutable boost::mutex mutex_;
+   std::map<std::string, boost::weak_ptr<const fragment> > fragments_;
+};
+
+///
+/// \brief Resolves include directives by loading files through the fragment cache.
+///
+/// Relative file names are taken relative to the directory of the
+/// including file. The loader keeps the fragments it returns alive in a
+/// vector owned by the including config.
+///
+class include_loader : public include_resolver
+{
+public:
+   ///
+   /// \param including Name of the including file, used for the directory
+   ///        of relative includes and to detect recursion
+   /// \param keep Receives the included fragments
+   ///
+   include_loader(const std::string& including, std::vector<boost::shared_ptr<const fragment> >& keep,
+      fragment_cache& cache = fragment_cache::instance()) :
+      parent_(NULL),
+      path_(canonical_name(including)),
+      directory_(directory_of(including)),
+      keep_(keep),
+      cache_(cache)
+   {}
+
+   const group& resolve(const std::string& name)
+   {
+      const std::string filename = name.empty() || name[0] == '/' || directory_.empty() ? name : directory_ + name;
+      file_stamp stamp;
+      if(!file_stamp::of(filename, stamp))
+         throw cconfig::exception("Unable to open file (" + filename + ")");
+
+      const std::string path = canonical_name(filename);
+      check_recursion(path);
+
+      boost::shared_ptr<const fragment> f = cache_.find(path);
+      if(f && f->current())
+         check_includes(*f);
+      else
+         f = cache_.insert(load(filename, path, stamp));
+
+      keep_.push_back(f);
+      return *f->root;
+   }
+
+private:
+   include_loader(const include_loader& parent, const std::string& filename, const std::string& path,
+      std::vector<boost::shared_ptr<const fragment> >& keep) :
+      parent_(&parent),
+      path_(path),
+      directory_(directory_of(filename)),
+      keep_(keep),
+      cache_(parent.cache_)
+   {}
+
+   boost::shared_ptr<const fragment> load(const std::string& filename, const std::string& path, const file_stamp& stamp)
+   {
+      // the stamp is taken before reading, a change in between makes the
+      // fragment outdated instead of wrongly current
+      boost::shared_ptr<fragment> f = boost::make_shared<fragment>();
+      f->path = path;
+      f->stamp = stamp;
+
+      std::string buffer;
+      cconfig::read_file(filename, buffer);
+      include_loader nested(*this, filename, path, f->includes);
+      cconfig::tree_builder builder(f->arena, false, &nested);
+      f->root = cconfig::parse_config(buffer.data(), buffer.size(), filename, builder);
+      return f;
+   }
+
+   void check_recursion(const std::string& path) const
+   {
+      for(const include_loader* l = this; l != NULL; l = l->parent_)
+         if(l->path_ == path)
+            throw cconfig::exception("Recursive include");
+   }
+
+   /// Checks the files a cached fragment includes, they may include the current file by now
+   void check_includes(const fragment& f) const
+   {
+      for(size_t i = 0; i < f.includes.size(); i++)
+      {
+         check_recursion(f.includes[i]->path);
+         check_includes(*f.includes[i]);
+      }
+   }
+
+   static std::string canonical_name(const std::string& filename)
+   {
+      char buffer[PATH_MAX];
+      return ::realpath(filename.c_str(), buffer) != NULL ? std::string(buffer) : filename;
+   }
+
+   /// Directory including the trailing separator, empty for the current directory
+   static std::string directory_of(const std::string& filename)
+   {
+      const std::string::size_type separator = filename.rfind('/');
+      return separator == std::string::npos ? std::string() : filename.substr(0, separator + 1);
+   }
+
+   const include_loader* parent_;
+   const std::string path_;
+   const std::string directory_;
+   std::vector<boost::shared_ptr<const fragment> >& keep_;
+   fragment_cache& cache_;
+};
+
+}
+
+#endif
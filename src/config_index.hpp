@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_INDEX_HPP_
+#define CONFIG_INDEX_HPP_
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include "config_tree.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Flat index from the full path of every setting to its element.
+///
+/// Paths are canonical, i.e. group names are separated by dots and list
+/// indices are enclosed in brackets (settings.list[1].a). A lookup is a
+/// single probe of an open addressing hash table, independent of the
+/// depth of the setting. The entries are also kept sorted by path, so
+/// that all settings below a prefix form a contiguous range.
+///
+/// The index refers to the tree it was built from and must not outlive
+/// it. It is immutable once built and can be read by several threads.
+///
+class path_index : boost::noncopyable
+{
+public:
+   struct entry
+   {
+      boost::string_ref path;
+      const element* value;
+
+      bool operator<(const entry& other) const { return path < other.path; }
+   };
+
+   typedef std::vector<entry>::const_iterator iterator;
+   typedef std::pair<iterator, iterator> range;
+
+   ///
+   /// \brief Indexes all elements below root in one depth first pass.
+   ///
+   explicit path_index(const element& root)
+   {
+      // paths are collected as offsets first, the buffer may still grow
+      std::vector<pending> collected;
+      std::string path;
+      collect(root, path, collected);
+
+      entries_.resize(collected.size());
+      for(size_t i = 0; i < collected.size(); i++)
+      {
+         entries_[i].path = boost::string_ref(buffer_.data() + collected[i].offset, collected[i].length);
+         entries_[i].value = collected[i].value;
+      }
+      std::sort(entries_.begin(), entries_.end());
+
+      // at most half of the slots are used, so probe sequences stay short
+      size_t slots = 16;
+      while(slots < 2 * entries_.size())
+         slots *= 2;
+      slots_.resize(slots);
+      mask_ = slots - 1;
+      for(size_t i = 0; i < entries_.size(); i++)
+      {
+         const boost::uint32_t hash = util::hash_key(entries_[i].path);
+         size_t s = hash & mask_;
+         while(slots_[s].index != 0)
+            s = (s + 1) & mask_;
+         slots_[s].hash = hash;
+         slots_[s].index = static_cast<boost::uint32_t>(i + 1);
+      }
+   }
+
+   size_t size() const { return entries_.size(); }
+   bool empty() const { return entries_.empty(); }
+
+   /// Entries sorted by path
+   iterator begin() const { return entries_.begin(); }
+   iterator end() const { return entries_.end(); }
+
+   ///
+   /// \brief Looks up a canonical path.
+   ///
+   /// \returns The element or NULL if no setting has this path. Paths in
+   /// other notations (e.g. settings.array.2) are not found.
+   ///
+   const element* find(boost::string_ref path) const
+   {
+      const boost::uint32_t hash = util::hash_key(path);
+      for(size_t s = hash & mask_; slots_[s].index != 0; s = (s + 1) & mask_)
+      {
+         if(slots_[s].hash != hash)
+            continue;
+         const entry& e = entries_[slots_[s].index - 1];
+         if(e.path == path)
+            return e.value;
+      }
+      return NULL;
+   }
+
+   ///
+   /// \brief Returns all entries whose path starts with prefix, in sorted order.
+   ///
+   /// Use "settings." for the settings below the group settings and
+   /// "settings.list[" for the elements of a list.
+   ///
+   range with_prefix(boost::string_ref prefix) const
+   {
+      entry key = { prefix, NULL };
+      iterator first = std::lower_bound(entries_.begin(), entries_.end(), key);
+      iterator last = first;
+      while(last != entries_.end() && last->path.starts_with(prefix))
+         ++last;
+      return range(first, last);
+   }
+
+private:
+   struct pending
+   {
+      size_t offset;
+      size_t length;
+      const element* value;
+   };
+
+   struct slot
+   {
+      slot() : hash(0), index(0) {}
+
+      boost::uint32_t hash;
+      /// Position in entries_ plus one, 0 for empty slots
+      boost::uint32_t index;
+   };
+
+   void collect(const element& e, std::string& path, std::vector<pending>& collected)
+   {
+      if(!path.empty())
+      {
+         pending p = { buffer_.size(), path.size(), &e };
+         collected.push_back(p);
+         buffer_.append(path);
+      }
+
+      const size_t length = path.size();
+      if(e.is_group())
+      {
+         const group& g = e.as_group_unchecked();
+         for(group::iterator it = g.begin(); it != g.end(); ++it)
+         {
+            if(length != 0)
+               path += '.';
+            path.append(it->key->name.data(), it->key->name.size());
+            collect(*it->value, path, collected);
+            path.resize(length);
+         }
+      }
+      else if(e.is_list())
+      {
+         const list& l = e.as_list_unchecked();
+         list::iterator it = l.begin();
+         for(size_t i = 0; it != l.end(); ++it, ++i)
+         {
+            char index[32];
+            std::sprintf(index, "[%lu]", static_cast<unsigned long>(i));
+            path += index;
+            collect(*it, path, collected);
+            path.resize(length);
+         }
+      }
+   }
+
+   std::string buffer_;
+   std::vector<entry> entries_;
+   std::vector<slot> slots_;
+   size_t mask_;
+};
+
+}
+
+#endif
@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_INPUT_HPP_
+#define CONFIG_INPUT_HPP_
+
+#include <string>
+#include <fstream>
+#include <istream>
+#include <iterator>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "config_tree.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Read only memory mapping of an input file.
+///
+/// Empty files cannot be mapped, they are represented by an empty range.
+///
+class mapped_file : boost::noncopyable
+{
+public:
+   ///
+   /// \throws cconfig::exception if the file cannot be opened or mapped.
+   ///
+   explicit mapped_file(const std::string& filename)
+   {
+      std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+      if(!in)
+         throw cconfig::exception("Unable to open file (" + filename + ")");
+      if(!in.seekg(0, std::ios::end) || in.tellg() == std::streampos(0))
+         return;
+      in.close();
+
+      try
+      {
+         file_.open(filename);
+      }
+      catch(const std::exception& e)
+      {
+         throw cconfig::exception("Unable to map file (" + filename + "): " + e.what());
+      }
+   }
+
+   const char* data() const { return file_.is_open() ? file_.data() : ""; }
+   size_t size() const { return file_.is_open() ? file_.size() : 0; }
+
+private:
+   boost::iostreams::mapped_file_source file_;
+};
+
+///
+/// \brief Reads a stream until end of file.
+///
+/// \throws cconfig::exception on read errors.
+///
+inline void read_stream(std::istream& in, std::string& buffer)
+{
+   buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+   if(in.bad())
+      throw cconfig::exception("Unable to read input stream");
+}
+
+///
+/// \brief Reads a whole file into a buffer.
+///
+/// \throws cconfig::exception if the file cannot be opened or read.
+///
+inline void read_file(const std::string& filename, std::string& buffer)
+{
+   std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+   if(!in)
+      throw cconfig::exception("Unable to open file (" + filename + ")");
+   read_stream(in, buffer);
+}
+
+///
+/// \brief Identity of a file as far as stat() can tell.
+///
+/// Modification and status change times are compared to the nanosecond,
+/// so rewriting a file with the same size changes its stamp even within
+/// the same second.
+///
+struct file_stamp
+{
+   file_stamp() : mtime(0), mtime_nsec(0), ctime(0), ctime_nsec(0), size(0), inode(0) {}
+
+   bool operator==(const file_stamp& other) const
+   {
+      return mtime == other.mtime && mtime_nsec == other.mtime_nsec
+         && ctime == other.ctime && ctime_nsec == other.ctime_nsec
+         && size == other.size && inode == other.inode;
+   }
+
+   bool operator!=(const file_stamp& other) const { return !(*this == other); }
+
+   /// Reads the stamp of a file, returns false if it does not exist
+   static bool of(const std::string& filename, file_stamp& s)
+   {
+      struct stat st;
+      if(::stat(filename.c_str(), &st) != 0)
+         return false;
+      s.mtime = st.st_mtime;
+      s.ctime = st.st_ctime;
+#if defined(__APPLE__)
+      s.mtime_nsec = st.st_mtimespec.tv_nsec;
+      s.ctime_nsec = st.st_ctimespec.tv_nsec;
+#else
+      s.mtime_nsec = st.st_mtim.tv_nsec;
+      s.ctime_nsec = st.st_ctim.tv_nsec;
+#endif
+      s.size = st.st_size;
+      s.inode = st.st_ino;
+      return true;
+   }
+
+   time_t mtime;
+   long mtime_nsec;
+   time_t ctime;
+   long ctime_nsec;
+   off_t size;
+   ino_t inode;
+};
+
+}
+
+#endif
@@ -0,0 +1,221 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_LAZY_HPP_
+#define CONFIG_LAZY_HPP_
+
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "config_tree.hpp"
+#include "config_builder.hpp"
+#include "config_parser.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Config tree whose top-level definitions are parsed on first access.
+///
+/// Loading only finds the byte range of every top-level definition (see
+/// index_definitions). A definition is parsed the first time a path
+/// below its key is looked up. Syntax errors inside a definition are
+/// therefore reported by the first lookup that needs it, and by every
+/// later one.
+///
+/// Lookups are thread-safe. Parsing is serialized by a mutex because
+/// all definitions share the arena, but lookups of definitions that are
+/// already parsed take no lock. Every definition gets its own symbol
+/// table, so parsing one never touches data read by lookups in another.
+///
+/// The input must stay valid for the lifetime of the tree.
+///
+class lazy_tree : boost::noncopyable
+{
+public:
+   ///
+   /// \param reference_input Let strings refer to the input instead of
+   ///        copying them (see tree_builder)
+   /// \throws cconfig::parse_error if the brackets of the input don't match.
+   ///
+   lazy_tree(cconfig::arena& a, const char* data, size_t size, const std::string& name, bool reference_input) :
+      arena_(a),
+      data_(data),
+      name_(name),
+      reference_input_(reference_input),
+      keys_(*new(a) symbol_table(a)),
+      root_(NULL)
+   {
+      std::vector<definition_range> ranges;
+      index_definitions(data, size, name, ranges);
+
+      definitions_.reserve(ranges.size());
+      for(std::vector<definition_range>::const_iterator it = ranges.begin(); it != ranges.end(); ++it)
+      {
+         // like group::insert, later definitions of a key are ignored
+         if(keys_.intern(it->key)->id == definitions_.size())
+            definitions_.push_back(new definition(*it));
+      }
+   }
+
+   ///
+   /// \brief Finds a setting, parsing its top-level definition if necessary.
+   ///
+   /// \returns The element or NULL if there is no such setting.
+   /// \throws cconfig::lookup_error if the path is malformed.
+   /// \throws cconfig::parse_error if the definition is invalid.
+   ///
+   const element* find(const std::string& path) const
+   {
+      util::path_tokenizer tokenizer(path);
+      util::path_token t;
+      tokenizer.next(t);
+
+      const group* g = t.type == util::path_token::name ? definition_group(util::hash_key(t.text), t.text) : NULL;
+      if(g != NULL)
+         return g->find(path);
+
+      // report malformed paths regardless of the contents
+      while(tokenizer.next(t))
+         ;
+      return NULL;
+   }
+
+   const element* find(const cconfig::path& p) const
+   {
+      if(p.empty())
+         return &root();
+
+      const cconfig::path::component& c = *p.begin();
+      const group* g = c.is_index ? NULL : definition_group(c.hash, c.key);
+      return g != NULL ? g->find(p) : NULL;
+   }
+
+   ///
+   /// \brief Returns the complete tree, parsing all remaining definitions.
+   ///
+   const group& root() const
+   {
+      const group* r = root_.load(boost::memory_order_acquire);
+      if(r != NULL)
+         return *r;
+
+      boost::mutex::scoped_lock lock(mutex_);
+      r = root_.load(boost::memory_order_relaxed);
+      if(r == NULL)
+      {
+         cconfig::tree_builder builder(arena_, reference_input_);
+         group* g = builder.make_group();
+         for(boost::ptr_vector<definition>::iterator it = definitions_.begin(); it != definitions_.end(); ++it)
+         {
+            const group::value_type& v = *parse(*it)->begin();
+            g->insert(v.key->name, v.value);
+         }
+         root_.store(g, boost::memory_order_release);
+         r = g;
+      }
+      return *r;
+   }
+
+private:
+   struct definition
+   {
+      explicit definition(const definition_range& r) : range(r), parsed(NULL) {}
+
+      definition_range range;
+      /// Group holding only this definition once it has been parsed
+      boost::atomic<const group*> parsed;
+      /// Error of the first parse attempt, guarded by the mutex
+      boost::scoped_ptr<cconfig::parse_error> failure;
+   };
+
+   const group* definition_group(boost::uint32_t hash, boost::string_ref key) const
+   {
+      const symbol* s = keys_.find(key, hash);
+      if(s == NULL)
+         return NULL;
+
+      definition& d = definitions_[s->id];
+      const group* g = d.parsed.load(boost::memory_order_acquire);
+      if(g != NULL)
+         return g;
+
+      boost::mutex::scoped_lock lock(mutex_);
+      return parse(d);
+   }
+
+   /// parses a definition unless done before, the mutex must be held
+   const group* parse(definition& d) const
+   {
+      const group* g = d.parsed.load(boost::memory_order_relaxed);
+      if(g != NULL)
+         return g;
+      if(d.failure)
+         throw *d.failure;
+
+      try
+      {
+         cconfig::tree_builder builder(arena_, reference_input_);
+         g = parse_config(data_, d.range.begin, d.range.end, name_, builder);
+      }
+      catch(const cconfig::parse_error& e)
+      {
+         d.failure.reset(new cconfig::parse_error(e));
+         throw;
+      }
+
+      if(g->size() != 1)
+      {
+         // not reachable with ranges found by index_definitions
+         d.failure.reset(new cconfig::parse_error("Invalid definition of '" + d.range.key.to_string() + "' (" + name_ + ")"));
+         throw *d.failure;
+      }
+
+      d.parsed.store(g, boost::memory_order_release);
+      return g;
+   }
+
+   cconfig::arena& arena_;
+   const char* data_;
+   const std::string name_;
+   const bool reference_input_;
+   /// Top-level keys, the id of a key is the index of its definition
+   symbol_table& keys_;
+   /// Parse state of the definitions changes on first access
+   mutable boost::ptr_vector<definition> definitions_;
+   mutable boost::atomic<const group*> root_;
+   mutable boost::mutex mutex_;
+};
+
+}
+
+#endif
@@ -0,0 +1,414 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_LIVE_HPP_
+#define CONFIG_LIVE_HPP_
+
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "config_file.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Config file that can be reloaded while other threads read it.
+///
+/// Every load publishes a new immutable snapshot of the config. Readers
+/// either take a snapshot (a shared pointer that keeps the tree alive as
+/// long as they need it) or call one of the lookup functions, which
+/// return values and don't keep anything.
+///
+/// Readers never lock or wait. They announce themselves in one of two
+/// counters for the duration of a read, like the read-side critical sections of
+/// RCU. A reload parses the new config first, swaps the current snapshot
+/// and then waits until all readers that might still see the old one
+/// have left before releasing its reference. Only concurrent reloads are
+/// serialized by a mutex.
+///
+/// Reloads are incremental: the new tree is compared with the current
+/// one and reuses its unchanged subtrees, so that elements of unchanged
+/// settings stay valid. Subscribers are notified of the changes below the
+/// path prefixes they have registered for.
+///
+/// In contrast to live_file, a cconfig::file must not be reloaded while
+/// it is read by other threads.
+///
+class live_file : boost::noncopyable
+{
+public:
+   typedef boost::shared_ptr<const cconfig::file> snapshot_type;
+   /// Called with the new snapshot and the changes below the subscribed prefix
+   typedef boost::function<void (const snapshot_type&, const cconfig::change_list&)> callback_type;
+
+   explicit live_file(const std::string& filename, const load_options& options = load_options()) :
+      epoch_(0),
+      generation_(0),
+      current_(NULL)
+   {
+      readers_[0].value = 0;
+      readers_[1].value = 0;
+      load(filename, options);
+   }
+
+   /// Publishes a loaded config, reload() is not possible
+   explicit live_file(const cconfig::file& f) :
+      epoch_(0),
+      generation_(0),
+      current_(NULL)
+   {
+      readers_[0].value = 0;
+      readers_[1].value = 0;
+      publish(f);
+   }
+
+   ~live_file()
+   {
+      delete current_.load();
+   }
+
+   ///
+   /// \brief Loads a config and publishes it if it differs from the current one.
+   ///
+   /// Readers keep seeing the previous config until the new one has been
+   /// parsed completely. If loading fails the previous config stays
+   /// current.
+   ///
+   void load(const std::string& filename, const load_options& options = load_options())
+   {
+      cconfig::file f(filename, options);
+
+      boost::mutex::scoped_lock lock(writer_mutex_);
+      filename_ = filename;
+      options_ = options;
+
+      cconfig::change_list changes;
+      const holder* h = current_.load();
+      if(h != NULL && f.share_unchanged(*h->snapshot, changes))
+         return;
+      update(f, changes);
+   }
+
+   ///
+   /// \brief Loads the file of the last call to load() again.
+   ///
+   void reload()
+   {
+      std::string filename;
+      load_options options;
+      {
+         boost::mutex::scoped_lock lock(writer_mutex_);
+         filename = filename_;
+         options = options_;
+      }
+      load(filename, options);
+   }
+
+   /// Returns the file of the last call to load()
+   std::string filename() const
+   {
+      boost::mutex::scoped_lock lock(writer_mutex_);
+      return filename_;
+   }
+
+   ///
+   /// \brief Publishes a loaded config (the tree is shared, not copied).
+   ///
+   /// The config is compared with the current one, but does not share
+   /// its subtrees since its tree may already be used by other copies.
+   ///
+   void publish(const cconfig::file& f)
+   {
+      boost::mutex::scoped_lock lock(writer_mutex_);
+
+      cconfig::change_list changes;
+      const holder* h = current_.load();
+      if(h != NULL && cconfig::diff(h->snapshot->root(), f.root(), changes))
+         return;
+      update(f, changes);
+   }
+
+   ///
+   /// \brief Registers a callback for changes below a path prefix.
+   ///
+   /// Callbacks are called after each reload that changed the settings
+   /// below prefix, on the reloading thread and with only the matching
+   /// changes. They must not load configs into this live_file.
+   ///
+   void subscribe(const std::string& prefix, const callback_type& callback)
+   {
+      boost::mutex::scoped_lock lock(subscribers_mutex_);
+      subscribers_.push_back(subscriber(prefix, callback));
+   }
+
+   ///
+   /// \brief Returns the current snapshot, which stays valid after reloads.
+   ///
+   snapshot_type snapshot() const
+   {
+      read_guard g(*this);
+      return g.current();
+   }
+
+   ///
+   /// \brief Returns the number of configs published so far.
+   ///
+   /// The counter is increased after a new snapshot has become current,
+   /// a snapshot taken after reading the counter is at least as new.
+   ///
+   unsigned long generation() const { return generation_.load(boost::memory_order_acquire); }
+
+   ///////////////////////////////////////////////////
+   // Lookups in the current snapshot
+
+   template<typename T>
+   const T lookup(const std::string& path) const { read_guard g(*this); return g.current()->lookup<T>(path); }
+
+   template<typename T>
+   const T lookup(const std::string& path, const T& default_value) const { read_guard g(*this); return g.current()->lookup<T>(path, default_value); }
+
+   template<typename T>
+   const T lookup(const cconfig::path& p) const { read_guard g(*this); return g.current()->lookup<T>(p); }
+
+   template<typename T>
+   const T lookup(const cconfig::path& p, const T& default_value) const { read_guard g(*this); return g.current()->lookup<T>(p, default_value); }
+
+   bool contains(const std::string& path) const { read_guard g(*this); return g.current()->contains(path); }
+   bool contains(const cconfig::path& p) const { read_guard g(*this); return g.current()->contains(p); }
+
+   template<typename T>
+   boost::optional<T> try_lookup(const std::string& path) const { read_guard g(*this); return g.current()->try_lookup<T>(path); }
+
+   template<typename T>
+   boost::optional<T> try_lookup(const cconfig::path& p) const { read_guard g(*this); return g.current()->try_lookup<T>(p); }
+
+private:
+   struct subscriber
+   {
+      subscriber(const std::string& p, const callback_type& c) : prefix(p), callback(c) {}
+
+      std::string prefix;
+      callback_type callback;
+   };
+
+   /// Publishes a config while holding the writer mutex and notifies
+   void update(const cconfig::file& f, const cconfig::change_list& changes)
+   {
+      holder* h = new holder(boost::make_shared<const cconfig::file>(f));
+      holder* old = current_.exchange(h);
+      generation_.fetch_add(1, boost::memory_order_release);
+      if(old == NULL)
+         return;
+
+      // readers of either epoch may have loaded the old snapshot, each
+      // flip sends new readers to the other counter so that the one
+      // waited for drains
+      for(int phase = 0; phase < 2; phase++)
+      {
+         const unsigned int e = epoch_.fetch_add(1) & 1;
+         while(readers_[e].value.load() != 0)
+            boost::this_thread::yield();
+      }
+      delete old;
+
+      std::vector<subscriber> subscribers;
+      {
+         boost::mutex::scoped_lock lock(subscribers_mutex_);
+         subscribers = subscribers_;
+      }
+      cconfig::change_list matching;
+      for(std::vector<subscriber>::const_iterator it = subscribers.begin(); it != subscribers.end(); ++it)
+      {
+         matching.clear();
+         for(cconfig::change_list::const_iterator c = changes.begin(); c != changes.end(); ++c)
+            if(c->affects(it->prefix))
+               matching.push_back(*c);
+         if(!matching.empty())
+            it->callback(h->snapshot, matching);
+      }
+   }
+
+   struct holder
+   {
+      explicit holder(const snapshot_type& s) : snapshot(s) {}
+      snapshot_type snapshot;
+   };
+
+   /// Reader counter on its own cache line
+   struct counter
+   {
+      boost::atomic<long> value;
+      char padding[64];
+   };
+
+   ///
+   /// \brief Read-side critical section.
+   ///
+   /// The snapshot is loaded after announcing the reader, and a reload
+   /// waits for the counters of both epochs, so the snapshot of a reader
+   /// is released only after the reader has left. Readers announce
+   /// themselves again if the epoch changed in between, so that they don't
+   /// keep a counter busy that a reload waits for.
+   ///
+   class read_guard
+   {
+   public:
+      explicit read_guard(const live_file& f) :
+         counter_(&announce(f))
+      {
+         current_ = f.current_.load();
+      }
+
+      ~read_guard() { counter_->fetch_sub(1); }
+
+      const snapshot_type& current() const { return current_->snapshot; }
+
+   private:
+      static boost::atomic<long>& announce(const live_file& f)
+      {
+         for(;;)
+         {
+            const unsigned int e = f.epoch_.load();
+            boost::atomic<long>& c = f.readers_[e & 1].value;
+            c.fetch_add(1);
+            if(f.epoch_.load() == e)
+               return c;
+            c.fetch_sub(1);
+         }
+      }
+
+      boost::atomic<long>* counter_;
+      const holder* current_;
+   };
+
+   mutable counter readers_[2];
+   boost::atomic<unsigned int> epoch_;
+   boost::atomic<unsigned long> generation_;
+   boost::atomic<holder*> current_;
+   mutable boost::mutex writer_mutex_;
+   /// Source of the last load, guarded by writer_mutex_
+   std::string filename_;
+   load_options options_;
+
+   std::vector<subscriber> subscribers_;
+   boost::mutex subscribers_mutex_;
+};
+
+///
+/// \brief Typed value of a setting of a live_file, updated on reloads.
+///
+/// The value is looked up and converted on first access after each
+/// reload, other accesses only compare the generation of the live file
+/// with the one the value was taken from.
+///
+/// \code
+/// cconfig::setting<long> timeout(live, "server.timeout", 30L);
+/// ...
+/// wait(*timeout);
+/// \endcode
+///
+/// A setting caches its value without synchronization, it may either be
+/// used by a single thread or must be guarded by the caller. Settings are
+/// cheap, each thread can bind its own.
+///
+template<typename T>
+class setting
+{
+public:
+   ///
+   /// \brief Binds a required setting.
+   ///
+   /// \throws cconfig::lookup_error if the path is malformed.
+   ///
+   setting(const live_file& f, const std::string& path) :
+      file_(f),
+      path_(path),
+      generation_(0),
+      valid_(false)
+   {}
+
+   ///
+   /// \brief Binds a setting that takes default_value while it is missing.
+   ///
+   setting(const live_file& f, const std::string& path, const T& default_value) :
+      file_(f),
+      path_(path),
+      default_(default_value),
+      generation_(0),
+      valid_(false)
+   {}
+
+   ///
+   /// \brief Returns the value in the current config.
+   ///
+   /// \throws cconfig::lookup_error if a required setting is missing,
+   ///         cconfig::exception if it cannot be converted. Failed
+   ///         lookups are repeated by the next access.
+   ///
+   const T& get() const
+   {
+      const unsigned long g = file_.generation();
+      if(!valid_ || g != generation_)
+         refresh(g);
+      return value_;
+   }
+
+   const T& operator*() const { return get(); }
+   const T* operator->() const { return &get(); }
+
+   const cconfig::path& path() const { return path_; }
+
+private:
+   void refresh(unsigned long g) const
+   {
+      valid_ = false;
+      value_ = default_ ? file_.lookup<T>(path_, *default_) : file_.lookup<T>(path_);
+      generation_ = g;
+      valid_ = true;
+   }
+
+   const live_file& file_;
+   const cconfig::path path_;
+   const boost::optional<T> default_;
+   mutable T value_;
+   mutable unsigned long generation_;
+   mutable bool valid_;
+};
+
+}
+
+#endif
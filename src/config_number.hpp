@@ -0,0 +1,280 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_NUMBER_HPP_
+#define CONFIG_NUMBER_HPP_
+
+#include <cstdio>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+#include <boost/cstdint.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#if defined(__has_include)
+#  if __cplusplus >= 201703L && __has_include(<charconv>)
+#     include <charconv>
+#  endif
+#endif
+
+namespace cconfig {
+namespace util {
+
+///
+/// \brief Converts an integer literal (optional sign followed by digits).
+///
+/// The conversion is locale independent and does not allocate.
+///
+/// \returns false if the text is not a valid integer or out of range.
+///
+inline bool parse_long(boost::string_ref text, long& value)
+{
+   const char* p = text.data();
+   const char* end = p + text.size();
+
+   bool negative = false;
+   if(p != end && (*p == '+' || *p == '-'))
+      negative = *p++ == '-';
+   if(p == end)
+      return false;
+
+   // accumulate as unsigned, the magnitude of the minimum is one larger
+   // than the maximum
+   const unsigned long limit = negative
+      ? static_cast<unsigned long>(std::numeric_limits<long>::max()) + 1
+      : static_cast<unsigned long>(std::numeric_limits<long>::max());
+   unsigned long v = 0;
+   for(; p != end; ++p)
+   {
+      unsigned int digit = static_cast<unsigned char>(*p) - '0';
+      if(digit > 9)
+         return false;
+      if(v > (limit - digit) / 10)
+         return false;
+      v = v * 10 + digit;
+   }
+
+   value = negative ? static_cast<long>(0 - v) : static_cast<long>(v);
+   return true;
+}
+
+namespace number_detail {
+
+///
+/// \brief Correctly rounded conversion of an unsigned decimal literal.
+///
+inline bool parse_double_slow(const char* p, const char* end, double& value)
+{
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+   std::from_chars_result r = std::from_chars(p, end, value);
+   return r.ec == std::errc() && r.ptr == end;
+#else
+   std::istringstream in(std::string(p, end));
+   in.imbue(std::locale::classic());
+   in >> value;
+   return !in.fail() && in.peek() == std::char_traits<char>::eof();
+#endif
+}
+
+}
+
+///
+/// \brief Converts a floating point literal.
+///
+/// Accepts the FLOAT syntax of the config grammar: an optional sign,
+/// digits with an optional fraction and an optional exponent. The result
+/// is correctly rounded and does not depend on the locale. Literals with
+/// up to 15 significant digits and small exponents are converted exactly
+/// with a single floating point operation, all others are delegated to
+/// std::from_chars (or a stream imbued with the classic locale before
+/// C++17).
+///
+/// \returns false if the text is not valid or the value overflows.
+///
+inline bool parse_double(boost::string_ref text, double& value)
+{
+   const char* p = text.data();
+   const char* end = p + text.size();
+
+   bool negative = false;
+   if(p != end && (*p == '+' || *p == '-'))
+      negative = *p++ == '-';
+   const char* start = p;
+
+   boost::uint64_t mantissa = 0;
+   int digits = 0;
+   int exponent = 0;
+   bool any_digits = false;
+
+   for(; p != end && *p >= '0' && *p <= '9'; ++p, any_digits = true)
+   {
+      if(digits < 19)
+      {
+         mantissa = mantissa * 10 + (*p - '0');
+         if(mantissa != 0)
+            digits++;
+      }
+      else
+         exponent++;
+   }
+   if(p != end && *p == '.')
+   {
+      for(++p; p != end && *p >= '0' && *p <= '9'; ++p, any_digits = true)
+      {
+         if(digits < 19)
+         {
+            mantissa = mantissa * 10 + (*p - '0');
+            if(mantissa != 0)
+               digits++;
+            exponent--;
+         }
+      }
+   }
+   if(!any_digits)
+      return false;
+
+   if(p != end && (*p == 'e' || *p == 'E'))
+   {
+      ++p;
+      bool negative_exponent = false;
+      if(p != end && (*p == '+' || *p == '-'))
+         negative_exponent = *p++ == '-';
+      if(p == end)
+         return false;
+
+      int e = 0;
+      for(; p != end && *p >= '0' && *p <= '9'; ++p)
+         if(e < 100000)
+            e = e * 10 + (*p - '0');
+      exponent += negative_exponent ? -e : e;
+   }
+   if(p != end)
+      return false;
+
+   // both the mantissa and the power of ten are exact doubles, so the
+   // single multiplication or division is correctly rounded
+   static const double powers[] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+   };
+   double v;
+   if(mantissa == 0)
+      v = 0.0;
+   else if(digits <= 15 && exponent >= -22 && exponent <= 22)
+   {
+      v = static_cast<double>(mantissa);
+      v = exponent < 0 ? v / powers[-exponent] : v * powers[exponent];
+   }
+   else if(!number_detail::parse_double_slow(start, end, v))
+   {
+      // the syntax is valid at this point, so the value is out of range:
+      // values too small for a denormal round to zero, overflow fails
+      if(digits + exponent > 0)
+         return false;
+      v = 0.0;
+   }
+
+   value = negative ? -v : v;
+   return true;
+}
+
+///
+/// \brief Writes a long in decimal notation.
+///
+/// \param buffer Room for at least 24 characters
+/// \returns The number of characters written.
+///
+inline size_t format_long(long value, char* buffer)
+{
+   // digits are produced backwards from the unsigned magnitude
+   unsigned long v = value < 0 ? 0 - static_cast<unsigned long>(value) : static_cast<unsigned long>(value);
+   char digits[24];
+   size_t n = 0;
+   do
+   {
+      digits[n++] = static_cast<char>('0' + v % 10);
+      v /= 10;
+   } while(v != 0);
+
+   size_t length = 0;
+   if(value < 0)
+      buffer[length++] = '-';
+   while(n != 0)
+      buffer[length++] = digits[--n];
+   return length;
+}
+
+///
+/// \brief Writes the shortest representation of a double that converts back
+/// to the same value and is a FLOAT literal of the config grammar.
+///
+/// Integral values get a ".0" appended. The result does not depend on the
+/// locale.
+///
+/// \param buffer Room for at least 32 characters
+/// \returns The number of characters written, 0 for infinity and NaN,
+///          which cannot be written as literals.
+///
+inline size_t format_double(double value, char* buffer)
+{
+   if(value != value || value - value != 0.0)
+      return 0;
+
+   size_t length = 0;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+   length = std::to_chars(buffer, buffer + 32, value).ptr - buffer;
+#else
+   for(int precision = std::numeric_limits<double>::digits10; precision <= 17; ++precision)
+   {
+      length = std::sprintf(buffer, "%.*g", precision, value);
+      // the decimal point of the C locale may differ
+      for(size_t i = 0; i < length; i++)
+         if(buffer[i] != '-' && buffer[i] != '+' && buffer[i] != 'e' && (buffer[i] < '0' || buffer[i] > '9'))
+            buffer[i] = '.';
+
+      double check;
+      if(parse_double(boost::string_ref(buffer, length), check) && check == value)
+         break;
+   }
+#endif
+
+   bool is_float = false;
+   for(size_t i = 0; i < length; i++)
+      is_float = is_float || buffer[i] == '.' || buffer[i] == 'e';
+   if(!is_float)
+   {
+      buffer[length++] = '.';
+      buffer[length++] = '0';
+   }
+   return length;
+}
+
+}}
+
+#endif
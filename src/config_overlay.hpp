@@ -0,0 +1,221 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef CONFIG_OVERLAY_HPP_
+#define CONFIG_OVERLAY_HPP_
+
+#include <string>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "config_tree.hpp"
+#include "config_builder.hpp"
+#include "config_file.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Stack of configs where upper layers override lower ones.
+///
+/// Groups are merged by key across layers, every other element replaces
+/// whatever lower layers define at its path, lists included. Lookups
+/// walk the layers from the top without copying anything. Groups
+/// returned by lookups are those of the topmost layer defining them, see
+/// flatten() for merged groups.
+///
+/// \code
+/// cconfig::overlay o;
+/// o.push(cconfig::file("base.conf"));
+/// o.push(cconfig::file("production.conf"));
+/// long port = o.lookup<long>("server.port");
+/// \endcode
+///
+/// The layers are copies of the files and share their trees. Lazily
+/// parsed layers are parsed completely by the first lookup, default
+/// constructed files that hold no config are skipped.
+///
+class overlay
+{
+public:
+   /// Adds a layer on top of the existing ones
+   void push(const file& f) { layers_.push_back(f); }
+
+   size_t size() const { return layers_.size(); }
+   bool empty() const { return layers_.empty(); }
+
+   /// Returns a layer, 0 is the bottom one
+   const file& layer(size_t i) const { return layers_[i]; }
+
+   ///
+   /// \brief Returns the setting at a path or NULL if no layer defines it.
+   ///
+   /// \throws cconfig::lookup_error if the path is malformed.
+   ///
+   const element* find(const std::string& path) const { return find(cconfig::path(path)); }
+
+   const element* find(const cconfig::path& p) const
+   {
+      for(size_t i = layers_.size(); i-- > 0; )
+      {
+         if(!layers_[i].storage_)
+            continue;
+         const element* e = &layers_[i].root();
+         cconfig::path::iterator it = p.begin();
+         for(; it != p.end() && e->is_group() && !it->is_index; ++it)
+         {
+            const element* child = e->as_group_unchecked().get_if(it->key, it->hash);
+            if(child == NULL)
+               break;
+            e = child;
+         }
+         // keys missing from a group fall through to the layer below, once
+         // the walk leaves the groups this layer alone defines the result
+         if(it != p.end() && e->is_group() && !it->is_index)
+            continue;
+
+         for(; it != p.end() && e != NULL; ++it)
+            e = it->is_index && e->is_list() ? e->as_list_unchecked().get_if(it->index) : NULL;
+         return e;
+      }
+      return NULL;
+   }
+
+   bool contains(const std::string& path) const { return find(path) != NULL; }
+
+   ///
+   /// \throws cconfig::lookup_error if no layer defines the path.
+   ///
+   const element& operator[](const std::string& path) const { return get(cconfig::path(path), path); }
+   const element& operator[](const cconfig::path& p) const { return get(p, p.str()); }
+
+   template<typename T>
+   const T lookup(const std::string& path) const { return operator[](path).as<T>(); }
+
+   template<typename T>
+   const T lookup(const std::string& path, const T& default_value) const { return try_lookup<T>(path).get_value_or(default_value); }
+
+   template<typename T>
+   boost::optional<T> try_lookup(const std::string& path) const
+   {
+      const element* e = find(path);
+      if(e == NULL || !e->is_atom())
+         return boost::none;
+      return e->as_atom_unchecked().as<T>();
+   }
+
+   ///
+   /// \brief Merges all layers into a single config.
+   ///
+   /// Only groups defined by several layers are created anew, all other
+   /// subtrees are shared with the layers, whose storage the result keeps
+   /// alive. Calling file::share_unchanged on the result only compares it.
+   ///
+   file flatten() const
+   {
+      boost::shared_ptr<file::storage> s = boost::make_shared<file::storage>();
+      s->shares_nodes = true;
+      for(size_t i = 0; i < layers_.size(); i++)
+      {
+         const boost::shared_ptr<file::storage>& layer = layers_[i].storage_;
+         if(!layer)
+            continue;
+         s->retained.push_back(layer);
+         s->retained.insert(s->retained.end(), layer->retained.begin(), layer->retained.end());
+      }
+
+      cconfig::tree_builder builder(s->arena, false);
+      std::vector<const group*> groups;
+      for(size_t i = layers_.size(); i-- > 0; )
+      {
+         if(layers_[i].storage_)
+            groups.push_back(&layers_[i].root());
+      }
+
+      file result;
+      group* root = groups.empty() ? builder.make_group() : merge(groups, builder);
+      result.set(s, root, NULL);
+      return result;
+   }
+
+private:
+   const element& get(const cconfig::path& p, const std::string& path) const
+   {
+      const element* e = find(p);
+      if(e == NULL)
+         throw cconfig::lookup_error("Config setting not found (" + path + ")");
+      return *e;
+   }
+
+   ///
+   /// \brief Merges groups that are defined at the same path.
+   ///
+   /// \param groups Groups ordered from the top layer down
+   ///
+   static group* merge(const std::vector<const group*>& groups, cconfig::tree_builder& builder)
+   {
+      if(groups.size() == 1)
+         return const_cast<group*>(groups[0]);
+
+      // keys keep the order of the lowest layer defining them
+      group* g = builder.make_group();
+      for(size_t i = groups.size(); i-- > 0; )
+      {
+         for(group::iterator it = groups[i]->begin(); it != groups[i]->end(); ++it)
+         {
+            if(g->get_if(it->key->name, it->key->hash) != NULL)
+               continue;
+
+            element* top = NULL;
+            std::vector<const group*> children;
+            for(size_t j = 0; j < groups.size(); j++)
+            {
+               const element* e = groups[j]->get_if(it->key->name, it->key->hash);
+               if(e == NULL)
+                  continue;
+               if(top == NULL)
+                  top = const_cast<element*>(e);
+               if(!e->is_group())
+                  break;
+               children.push_back(&e->as_group_unchecked());
+            }
+            g->insert(it->key->name, children.empty() ? top : merge(children, builder));
+         }
+      }
+      return g;
+   }
+
+   std::vector<file> layers_;
+};
+
+}
+
+#endif
@@ -0,0 +1,412 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_PARALLEL_HPP_
+#define CONFIG_PARALLEL_HPP_
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "config_tree.hpp"
+#include "config_builder.hpp"
+#include "config_parser.hpp"
+
+namespace cconfig {
+
+namespace parallel_detail {
+
+///
+/// \brief Parses a config held in memory on a pool of threads.
+///
+/// The input is split at top-level definition boundaries (see
+/// index_definitions) into slices of roughly equal size. Definitions
+/// that are larger than a slice are split further: group definitions
+/// into their inner definitions, list and array definitions at the
+/// commas between their elements. Every slice is parsed by the builtin
+/// parser into a separate part of the tree, which are stitched together
+/// in source order afterwards.
+///
+/// Each slice is parsed with the lexer positioned within the whole input,
+/// so errors are reported at the same location and with the same message
+/// as by the sequential parser. If several slices fail, the error of the
+/// first one in the input is reported. If the input can't be split at all
+/// (e.g. because of unbalanced brackets), it is parsed sequentially to
+/// find the first error.
+///
+class parallel_parser : boost::noncopyable
+{
+public:
+   /// Inputs smaller than this are not split
+   static const size_t min_slice_size = 64 * 1024;
+
+   parallel_parser(const char* data, size_t size, const std::string& name, bool reference_input, unsigned int threads) :
+      data_(data),
+      size_(size),
+      name_(name),
+      reference_input_(reference_input),
+      threads_(threads != 0 ? threads : std::max(1u, boost::thread::hardware_concurrency())),
+      slice_size_(size / (8 * threads_) > min_slice_size ? size / (8 * threads_) : min_slice_size),
+      next_(0)
+   {}
+
+   ///
+   /// \brief Parses the input.
+   ///
+   /// \param builder Builder for the root group and the stitched parts
+   /// \param arenas Receives the arenas of the worker threads, which have
+   ///        to be kept alive as long as the tree
+   /// \throws cconfig::parse_error on syntax errors.
+   ///
+   group* parse(cconfig::tree_builder& builder, boost::ptr_vector<cconfig::arena>& arenas)
+   {
+      if(threads_ < 2 || size_ < 2 * slice_size_)
+         return parse_config(data_, size_, name_, builder);
+
+      std::vector<node> nodes;
+      try
+      {
+         plan_definitions(data_, data_ + size_, nodes);
+      }
+      catch(const cconfig::parse_error&)
+      {
+         // the first error may be located before the structural one
+         parse_config(data_, size_, name_, builder);
+         throw;
+      }
+
+      const unsigned int workers = static_cast<unsigned int>(std::min<size_t>(threads_, slices_.size()));
+      for(unsigned int i = 0; i < workers; i++)
+         arenas.push_back(new cconfig::arena(64 * 1024));
+
+      boost::thread_group pool;
+      for(unsigned int i = 1; i < workers; i++)
+         pool.create_thread(boost::bind(&parallel_parser::run, this, boost::ref(arenas[i])));
+      run(arenas[0]);
+      pool.join_all();
+
+      size_t tokens = 0;
+      for(boost::ptr_vector<slice>::const_iterator it = slices_.begin(); it != slices_.end(); ++it)
+      {
+         if(it->error)
+            throw *it->error;
+         if(it->result == NULL)
+            throw cconfig::exception("Parallel parsing failed: " + it->failure + " (" + name_ + ")");
+         tokens += it->tokens;
+      }
+      builder.record_input(size_, tokens);
+
+      group* root = builder.make_group();
+      stitch(nodes, *root, builder);
+      return root;
+   }
+
+private:
+   ///
+   /// \brief Part of the input parsed by a single task.
+   ///
+   struct slice
+   {
+      slice(const char* b, const char* e, const char* s, token::token_type t, bool elements) :
+         begin(b), end(e), stop(s), array_type(t), elements(elements), result(NULL), tokens(0)
+      {}
+
+      const char* begin;
+      /// End of the range given to the lexer
+      const char* end;
+      /// Comma or closing bracket ending a slice of elements
+      const char* stop;
+      /// Type of array elements, token::end_of_input for lists
+      token::token_type array_type;
+      /// True for a slice of list elements, false for definitions
+      bool elements;
+
+      /// Group of the parsed definitions or list of the parsed elements
+      element* result;
+      /// Tokens read by the lexer of the slice, see load_stats
+      size_t tokens;
+      boost::scoped_ptr<cconfig::parse_error> error;
+      std::string failure;
+   };
+
+   ///
+   /// \brief Part of the tree that is stitched together from slices.
+   ///
+   struct node
+   {
+      enum node_type
+      {
+         /// Definitions of a single slice
+         definitions,
+         /// List or array whose elements are spread over slices
+         split_list,
+         /// Group definition whose body has been split
+         split_group
+      };
+
+      node_type type;
+      boost::string_ref key;
+      /// Slices [first, last) of definitions and split lists
+      size_t first;
+      size_t last;
+      /// Parts of the group body of split groups
+      std::vector<node> children;
+   };
+
+   void plan_definitions(const char* begin, const char* end, std::vector<node>& nodes)
+   {
+      std::vector<definition_range> ranges;
+      index_definitions(data_, begin, end, name_, ranges);
+
+      const char* batch = NULL;
+      for(std::vector<definition_range>::const_iterator it = ranges.begin(); it != ranges.end(); ++it)
+      {
+         const size_t size = it->end - it->begin;
+         if(size > slice_size_ && it->complete)
+         {
+            // slices are kept in source order, the first failed one is
+            // reported, so the pending batch goes before those of the split
+            if(batch != NULL)
+               add_definitions(batch, it->begin, nodes);
+            batch = NULL;
+
+            std::vector<node> split;
+            if(plan_split(*it, split))
+            {
+               nodes.insert(nodes.end(), split.begin(), split.end());
+               continue;
+            }
+         }
+
+         if(batch == NULL)
+            batch = it->begin;
+         if(static_cast<size_t>(it->end - batch) >= slice_size_)
+         {
+            add_definitions(batch, it->end, nodes);
+            batch = NULL;
+         }
+      }
+      if(batch != NULL)
+         add_definitions(batch, ranges.back().end, nodes);
+   }
+
+   /// splits a large definition, returns false if it has to be parsed as a whole
+   bool plan_split(const definition_range& r, std::vector<node>& nodes)
+   {
+      cconfig::lexer l(data_, r.begin, r.end, name_);
+      token key, t;
+      l.next(key);
+      l.next(t);
+
+      node n;
+      n.key = key.text;
+      n.first = n.last = 0;
+
+      if(t.type == token::left_brace)
+      {
+         // the range of a complete group definition ends with its brace
+         n.type = node::split_group;
+         plan_definitions(t.text.end(), r.end - 1, n.children);
+         nodes.push_back(n);
+         return true;
+      }
+
+      if(t.type != token::equals)
+         return false;
+      l.next(t);
+      if(t.type != token::left_paren && t.type != token::left_bracket)
+         return false;
+      const char* body = t.text.end();
+
+      token first;
+      l.next(first);
+      token::token_type array_type = token::end_of_input;
+      if(t.type == token::left_bracket)
+      {
+         if(first.type != token::integer && first.type != token::floating_point
+            && first.type != token::boolean && first.type != token::string)
+            return false;
+         array_type = first.type;
+      }
+
+      std::vector<const char*> cuts;
+      const char* close = parser_detail::split_elements(l, body, r.end, slice_size_, cuts);
+      if(close == NULL || cuts.empty())
+         return false;
+
+      // nothing but the semicolon may follow the list
+      cconfig::lexer tail(data_, close + 1, r.end, name_);
+      tail.next(t);
+      if(t.type != token::semicolon)
+         return false;
+      tail.next(t);
+      if(t.type != token::end_of_input)
+         return false;
+
+      n.type = node::split_list;
+      n.first = slices_.size();
+      for(std::vector<const char*>::const_iterator it = cuts.begin(); it != cuts.end(); ++it)
+      {
+         slices_.push_back(new slice(body, data_ + size_, *it, array_type, true));
+         body = *it + 1;
+      }
+      slices_.push_back(new slice(body, data_ + size_, close, array_type, true));
+      n.last = slices_.size();
+      nodes.push_back(n);
+      return true;
+   }
+
+   void add_definitions(const char* begin, const char* end, std::vector<node>& nodes)
+   {
+      node n;
+      n.type = node::definitions;
+      n.first = slices_.size();
+      slices_.push_back(new slice(begin, end, NULL, token::end_of_input, false));
+      n.last = slices_.size();
+      nodes.push_back(n);
+   }
+
+   void run(cconfig::arena& a)
+   {
+      for(;;)
+      {
+         const size_t i = next_.fetch_add(1, boost::memory_order_relaxed);
+         if(i >= slices_.size())
+            return;
+
+         slice& s = slices_[i];
+         try
+         {
+            cconfig::tree_builder builder(a, reference_input_);
+            if(s.elements)
+            {
+               list* l = builder.make_list();
+               cconfig::lexer lex(data_, s.begin, s.end, name_);
+               tree_handler h(builder, l, s.array_type != token::end_of_input);
+               parser<tree_handler> p(lex, h);
+               p.parse_elements(s.array_type, s.stop);
+               s.result = l;
+               s.tokens = lex.token_count();
+            }
+            else
+            {
+               s.result = parse_config(data_, s.begin, s.end, name_, builder);
+               s.tokens = builder.tokens();
+            }
+         }
+         catch(const cconfig::parse_error& e)
+         {
+            s.error.reset(new cconfig::parse_error(e));
+         }
+         catch(const std::exception& e)
+         {
+            s.failure = e.what();
+         }
+      }
+   }
+
+   void stitch(const std::vector<node>& nodes, group& g, cconfig::tree_builder& builder) const
+   {
+      for(std::vector<node>::const_iterator n = nodes.begin(); n != nodes.end(); ++n)
+      {
+         switch(n->type)
+         {
+         case node::definitions:
+            {
+               const group& part = slices_[n->first].result->as_group_unchecked();
+               for(group::iterator it = part.begin(); it != part.end(); ++it)
+                  g.insert(it->key->name, it->value);
+            }
+            break;
+         case node::split_list:
+            {
+               size_t size = 0;
+               for(size_t i = n->first; i != n->last; i++)
+                  size += slices_[i].result->as_list_unchecked().size();
+
+               // the first part selects the storage of arrays
+               list* l = builder.make_list();
+               l->append(slices_[n->first].result->as_list_unchecked());
+               l->reserve(size);
+               for(size_t i = n->first + 1; i != n->last; i++)
+                  l->append(slices_[i].result->as_list_unchecked());
+               g.insert(n->key, l);
+            }
+            break;
+         case node::split_group:
+            {
+               group* child = builder.make_group();
+               stitch(n->children, *child, builder);
+               g.insert(n->key, child);
+            }
+            break;
+         }
+      }
+   }
+
+   const char* data_;
+   const size_t size_;
+   const std::string& name_;
+   const bool reference_input_;
+   const unsigned int threads_;
+   const size_t slice_size_;
+   boost::ptr_vector<slice> slices_;
+   boost::atomic<size_t> next_;
+};
+
+}
+
+///
+/// \brief Parses a config held in memory on multiple threads.
+///
+/// See parallel_detail::parallel_parser, the result is the same tree as
+/// parse_config would produce.
+///
+/// \param threads Number of threads, 0 for one per core
+/// \param arenas Receives arenas that have to be kept alive with the tree
+///
+inline group* parse_config_parallel(const char* data, size_t size, const std::string& name,
+   cconfig::tree_builder& builder, boost::ptr_vector<cconfig::arena>& arenas, unsigned int threads = 0)
+{
+   // slices are built by builders of their own, include directives are
+   // resolved on the calling thread
+   if(std::memchr(data, '@', size) != NULL)
+      return parse_config(data, size, name, builder);
+   return parallel_detail::parallel_parser(data, size, name, builder.reference_input(), threads).parse(builder, arenas);
+}
+
+}
+
+#endif
@@ -0,0 +1,941 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_PARSER_HPP_
+#define CONFIG_PARSER_HPP_
+
+#include <string>
+#include <vector>
+
+#include "config_tree.hpp"
+#include "config_builder.hpp"
+#include "config_scan.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Token of the config language.
+///
+struct token
+{
+   enum token_type
+   {
+      end_of_input,
+      identifier,
+      boolean,
+      integer,
+      floating_point,
+      string,
+      left_brace,
+      right_brace,
+      left_paren,
+      right_paren,
+      left_bracket,
+      right_bracket,
+      equals,
+      semicolon,
+      comma,
+      /// The include keyword "@include"
+      include
+   };
+
+   token_type type;
+   /// Token text as a view into the input, string literals include their quotes
+   boost::string_ref text;
+};
+
+///
+/// \brief Hand-written lexer for the config language.
+///
+/// Recognizes the same tokens as the lexer generated from grammar/Config.g
+/// and works directly on a memory range that must stay valid while the
+/// lexer is in use. Whitespace and comments are skipped.
+///
+class lexer
+{
+public:
+   ///
+   /// \param name Name of the input, used in error messages
+   ///
+   lexer(const char* begin, const char* end, const std::string& name) :
+      begin_(begin),
+      pos_(begin),
+      end_(end),
+      name_(name),
+      first_line_(1),
+      first_column_(1)
+#ifdef CCONFIG_STATS
+      , tokens_(0)
+#endif
+   {}
+
+   ///
+   /// \brief Constructs a lexer for a part of a larger input.
+   ///
+   /// \param input Start of the whole input, error locations are reported
+   ///        relative to it
+   ///
+   lexer(const char* input, const char* begin, const char* end, const std::string& name) :
+      begin_(input),
+      pos_(begin),
+      end_(end),
+      name_(name),
+      first_line_(1),
+      first_column_(1)
+#ifdef CCONFIG_STATS
+      , tokens_(0)
+#endif
+   {}
+
+   ///
+   /// \brief Sets the location of the start of the input in error messages.
+   ///
+   /// Used when the input is a part of a stream whose beginning is gone.
+   ///
+   void set_location(size_t line, size_t column)
+   {
+      first_line_ = line;
+      first_column_ = column;
+   }
+
+   ///
+   /// \brief Reads the next token.
+   ///
+   /// \throws cconfig::parse_error on invalid input.
+   ///
+   void next(token& t)
+   {
+      skip();
+      const char* start = pos_;
+      if(pos_ == end_)
+      {
+         t.type = token::end_of_input;
+         t.text = boost::string_ref(pos_, 0);
+         return;
+      }
+#ifdef CCONFIG_STATS
+      tokens_++;
+#endif
+
+      char c = *pos_;
+      switch(c)
+      {
+      case '{': t.type = token::left_brace; ++pos_; break;
+      case '}': t.type = token::right_brace; ++pos_; break;
+      case '(': t.type = token::left_paren; ++pos_; break;
+      case ')': t.type = token::right_paren; ++pos_; break;
+      case '[': t.type = token::left_bracket; ++pos_; break;
+      case ']': t.type = token::right_bracket; ++pos_; break;
+      case '=': t.type = token::equals; ++pos_; break;
+      case ';': t.type = token::semicolon; ++pos_; break;
+      case ',': t.type = token::comma; ++pos_; break;
+      case '"': t.type = token::string; lex_string(); break;
+      case '@':
+         {
+            const char* keyword = ++pos_;
+            while(pos_ != end_ && is_alpha(*pos_))
+               ++pos_;
+            if(boost::string_ref(keyword, pos_ - keyword) != "include")
+               error(start, "Unknown directive '" + std::string(start, pos_) + "'");
+            t.type = token::include;
+         }
+         break;
+      default:
+         if(is_alpha(c))
+         {
+            while(pos_ != end_ && (is_alpha(*pos_) || is_digit(*pos_)))
+               ++pos_;
+            boost::string_ref text(start, pos_ - start);
+            t.type = (text == "true" || text == "false") ? token::boolean : token::identifier;
+         }
+         else if(is_digit(c) || c == '+' || c == '-' || c == '.')
+            t.type = lex_number();
+         else
+            error(start, "Unexpected character '" + std::string(1, c) + "'");
+      }
+      t.text = boost::string_ref(start, pos_ - start);
+   }
+
+   /// Number of tokens read so far, only counted with CCONFIG_STATS
+   size_t token_count() const
+   {
+#ifdef CCONFIG_STATS
+      return tokens_;
+#else
+      return 0;
+#endif
+   }
+
+   ///
+   /// \brief Throws a parse_error for the given input position.
+   ///
+   void error(const char* where, const std::string& message) const
+   {
+      size_t line = first_line_;
+      const char* line_start = begin_;
+      for(const char* p = begin_; p != where; ++p)
+      {
+         if(*p == '\n')
+         {
+            line++;
+            line_start = p + 1;
+         }
+      }
+      const size_t column = (line_start == begin_ ? first_column_ : 1) + (where - line_start);
+      throw cconfig::parse_error(message + " (" + name_ + ")", line, column);
+   }
+
+private:
+   static bool is_alpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+   static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+   static bool is_hex_digit(char c) { return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); }
+   static bool is_octal_digit(char c) { return c >= '0' && c <= '7'; }
+
+   void skip()
+   {
+      for(;;)
+      {
+         pos_ = scan::skip_whitespace(pos_, end_);
+         if(end_ - pos_ < 2 || *pos_ != '/')
+            return;
+
+         if(pos_[1] == '/')
+            pos_ = scan::find_char(pos_ + 2, end_, '\n');
+         else if(pos_[1] == '*')
+         {
+            const char* start = pos_;
+            pos_ += 2;
+            for(;;)
+            {
+               pos_ = scan::find_char(pos_, end_, '*');
+               if(pos_ == end_)
+                  error(start, "Unterminated comment");
+               if(++pos_ != end_ && *pos_ == '/')
+                  break;
+            }
+            ++pos_;
+         }
+         else
+            return;
+      }
+   }
+
+   void lex_string()
+   {
+      const char* start = pos_++;
+      for(;;)
+      {
+         pos_ = scan::find_quote_or_backslash(pos_, end_);
+         if(pos_ == end_)
+            error(start, "Unterminated string");
+         if(*pos_ == '"')
+            break;
+
+         const char* escape = pos_++;
+         if(pos_ == end_)
+            error(start, "Unterminated string");
+         char c = *pos_++;
+         switch(c)
+         {
+         case 'b': case 't': case 'n': case 'f': case 'r': case '"': case '\'': case '\\':
+            break;
+         case 'u':
+            for(int i = 0; i < 4; i++, ++pos_)
+               if(pos_ == end_ || !is_hex_digit(*pos_))
+                  error(escape, "Invalid unicode escape sequence");
+            break;
+         default:
+            if(!is_octal_digit(c))
+               error(escape, "Invalid escape sequence");
+            // up to three octal digits, the value must fit into a byte
+            if(pos_ != end_ && is_octal_digit(*pos_))
+            {
+               ++pos_;
+               if(c <= '3' && pos_ != end_ && is_octal_digit(*pos_))
+                  ++pos_;
+            }
+         }
+      }
+      ++pos_;
+   }
+
+   token::token_type lex_number()
+   {
+      const char* start = pos_;
+      if(*pos_ == '+' || *pos_ == '-')
+         ++pos_;
+
+      const char* digits = pos_;
+      while(pos_ != end_ && is_digit(*pos_))
+         ++pos_;
+      bool integral_digits = pos_ != digits;
+      bool is_float = false;
+
+      if(pos_ != end_ && *pos_ == '.')
+      {
+         ++pos_;
+         const char* fraction = pos_;
+         while(pos_ != end_ && is_digit(*pos_))
+            ++pos_;
+         if(!integral_digits && pos_ == fraction)
+            error(start, "Invalid number");
+         is_float = true;
+      }
+      else if(!integral_digits)
+         error(start, "Invalid number");
+
+      if(pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E'))
+      {
+         ++pos_;
+         if(pos_ != end_ && (*pos_ == '+' || *pos_ == '-'))
+            ++pos_;
+         const char* exponent = pos_;
+         while(pos_ != end_ && is_digit(*pos_))
+            ++pos_;
+         if(pos_ == exponent)
+            error(start, "Invalid number");
+         is_float = true;
+      }
+
+      return is_float ? token::floating_point : token::integer;
+   }
+
+   const char* begin_;
+   const char* pos_;
+   const char* end_;
+   std::string name_;
+   /// Location of begin_ for error messages
+   size_t first_line_;
+   size_t first_column_;
+#ifdef CCONFIG_STATS
+   size_t tokens_;
+#endif
+};
+
+///
+/// \brief Hand-written recursive descent parser for the config language.
+///
+/// The parser accepts the language of grammar/Config.g and reports its
+/// structure to a handler, which must provide the following functions:
+///
+/// - key(text): sets the key of the next value inside a group
+/// - begin_group(), end_group(), begin_list(), end_list(),
+///   begin_array(), end_array()
+/// - integer(text), floating_point(text), boolean(text), string(text):
+///   atom values, string literals are passed including their quotes
+/// - include(text): an include directive inside a group, text is the
+///   string literal of the file name
+///
+/// All text is passed as views into the input. Tokens are lexed on demand
+/// with a single token of lookahead, so the parser needs no token buffer.
+///
+template<typename Handler>
+class parser
+{
+public:
+   parser(cconfig::lexer& l, Handler& h) :
+      lexer_(l),
+      handler_(h)
+   {
+      lexer_.next(token_);
+   }
+
+   ///
+   /// \brief Parses the input up to its end as the contents of the root group.
+   ///
+   /// \throws cconfig::parse_error on syntax errors.
+   ///
+   void parse()
+   {
+      while(is_definition(token_.type))
+         definition();
+      if(token_.type != token::end_of_input)
+         unexpected("setting name");
+   }
+
+   ///
+   /// \brief Parses a slice of the elements of a list or array.
+   ///
+   /// Used to parse long lists in parallel. The slice starts with the
+   /// current token and ends at stop, which is either a comma between two
+   /// elements or the closing bracket. Elements are reported without a
+   /// begin_list() or begin_array() event.
+   ///
+   /// \param array_type Token type of the first array element, or
+   ///        token::end_of_input for lists
+   /// \throws cconfig::parse_error on syntax errors.
+   ///
+   void parse_elements(token::token_type array_type, const char* stop)
+   {
+      slice_element(array_type);
+      while(token_.type == token::comma && token_.text.data() != stop)
+      {
+         advance();
+         slice_element(array_type);
+      }
+
+      const token::token_type closer = array_type == token::end_of_input ? token::right_paren : token::right_bracket;
+      if(token_.text.data() != stop || (token_.type != token::comma && token_.type != closer))
+         unexpected(closer == token::right_paren ? "')'" : "']'");
+   }
+
+private:
+   void advance() { lexer_.next(token_); }
+
+   void expect(token::token_type type, const char* what)
+   {
+      if(token_.type != type)
+         unexpected(what);
+      advance();
+   }
+
+   void unexpected(const std::string& expected)
+   {
+      std::string found = token_.type == token::end_of_input
+         ? std::string("end of input")
+         : "'" + token_.text.to_string() + "'";
+      lexer_.error(token_.text.data(), "Expected " + expected + " but found " + found);
+   }
+
+   static bool is_definition(token::token_type type)
+   {
+      return type == token::identifier || type == token::include;
+   }
+
+   static bool is_atom(token::token_type type)
+   {
+      return type == token::integer || type == token::floating_point
+         || type == token::boolean || type == token::string;
+   }
+
+   void definition()
+   {
+      if(token_.type == token::include)
+      {
+         include();
+         return;
+      }
+
+      handler_.key(token_.text);
+      advance();
+      if(token_.type == token::left_brace)
+         group();
+      else if(token_.type == token::equals)
+      {
+         advance();
+         if(token_.type == token::left_paren)
+            list();
+         else if(token_.type == token::left_bracket)
+            array();
+         else if(is_atom(token_.type))
+            atom();
+         else
+            unexpected("value");
+         expect(token::semicolon, "';'");
+      }
+      else
+         unexpected("'{' or '='");
+   }
+
+   void group()
+   {
+      advance();
+      handler_.begin_group();
+      while(is_definition(token_.type))
+         definition();
+      expect(token::right_brace, "'}'");
+      handler_.end_group();
+   }
+
+   void list()
+   {
+      advance();
+      handler_.begin_list();
+      if(token_.type != token::right_paren)
+      {
+         list_element();
+         while(token_.type == token::comma)
+         {
+            advance();
+            list_element();
+         }
+      }
+      expect(token::right_paren, "')'");
+      handler_.end_list();
+   }
+
+   void list_element()
+   {
+      switch(token_.type)
+      {
+      case token::left_brace: group(); break;
+      case token::left_paren: list(); break;
+      case token::left_bracket: array(); break;
+      default:
+         if(!is_atom(token_.type))
+            unexpected("value");
+         atom();
+      }
+   }
+
+   void array()
+   {
+      advance();
+      handler_.begin_array();
+      if(token_.type != token::right_bracket)
+      {
+         // all elements of an array share the type of the first one
+         const token::token_type type = token_.type;
+         if(!is_atom(type))
+            unexpected("value");
+         atom();
+         while(token_.type == token::comma)
+         {
+            advance();
+            if(token_.type != type)
+               unexpected("value of the same type as the first array element");
+            atom();
+         }
+      }
+      expect(token::right_bracket, "']'");
+      handler_.end_array();
+   }
+
+   void slice_element(token::token_type array_type)
+   {
+      if(array_type == token::end_of_input)
+         list_element();
+      else
+      {
+         if(token_.type != array_type)
+            unexpected("value of the same type as the first array element");
+         atom();
+      }
+   }
+
+   void include()
+   {
+      advance();
+      if(token_.type != token::string)
+         unexpected("file name");
+      try
+      {
+         handler_.include(token_.text);
+      }
+      catch(const cconfig::parse_error& e)
+      {
+         // errors inside the included file carry their own location
+         if(e.line() != 0)
+            throw;
+         lexer_.error(token_.text.data(), e.what());
+      }
+      advance();
+   }
+
+   void atom()
+   {
+      try
+      {
+         switch(token_.type)
+         {
+         case token::integer: handler_.integer(token_.text); break;
+         case token::floating_point: handler_.floating_point(token_.text); break;
+         case token::boolean: handler_.boolean(token_.text); break;
+         default: handler_.string(token_.text); break;
+         }
+      }
+      catch(const cconfig::parse_error& e)
+      {
+         // conversion errors of the handler don't know the location
+         if(e.line() != 0)
+            throw;
+         lexer_.error(token_.text.data(), e.what());
+      }
+      advance();
+   }
+
+   cconfig::lexer& lexer_;
+   Handler& handler_;
+   token token_;
+};
+
+///
+/// \brief Parser handler that builds a config tree.
+///
+class tree_handler
+{
+public:
+   explicit tree_handler(cconfig::tree_builder& b) :
+      builder_(b),
+      root_(b.make_group()),
+      array_(NULL)
+   {
+      stack_.push_back(root_);
+   }
+
+   ///
+   /// \brief Constructs a handler that adds all values to container.
+   ///
+   /// Used with parser::parse_elements, root() returns NULL. If array is
+   /// true, the container is a list that receives array elements.
+   ///
+   tree_handler(cconfig::tree_builder& b, element* container, bool array = false) :
+      builder_(b),
+      root_(NULL),
+      array_(array ? static_cast<list*>(container) : NULL)
+   {
+      stack_.push_back(container);
+   }
+
+   void key(boost::string_ref k) { key_ = k; }
+
+   void begin_group() { push(builder_.make_group()); }
+   void end_group() { stack_.pop_back(); }
+   void begin_list() { push(builder_.make_list()); }
+   void end_list() { stack_.pop_back(); }
+   void begin_array()
+   {
+      array_ = builder_.make_list();
+      push(array_);
+   }
+
+   // arrays contain atoms only
+   void end_array()
+   {
+      stack_.pop_back();
+      array_ = NULL;
+   }
+
+   void integer(boost::string_ref text)
+   {
+      if(array_ != NULL)
+         builder_.append_int(*array_, text);
+      else
+         add(builder_.make_int(text));
+   }
+
+   void floating_point(boost::string_ref text)
+   {
+      if(array_ != NULL)
+         builder_.append_float(*array_, text);
+      else
+         add(builder_.make_float(text));
+   }
+
+   void boolean(boost::string_ref text)
+   {
+      if(array_ != NULL)
+         builder_.append_bool(*array_, text);
+      else
+         add(builder_.make_bool(text));
+   }
+
+   void string(boost::string_ref text) { add(builder_.make_string(text)); }
+
+   // include directives only occur inside groups
+   void include(boost::string_ref text) { builder_.include(*static_cast<group*>(stack_.back()), text); }
+
+   group* root() const { return root_; }
+
+private:
+   void add(element* e)
+   {
+      element* parent = stack_.back();
+      if(parent->is_group())
+         static_cast<group*>(parent)->insert(key_, e);
+      else
+         static_cast<list*>(parent)->append(e);
+   }
+
+   void push(element* e)
+   {
+      add(e);
+      stack_.push_back(e);
+   }
+
+   cconfig::tree_builder& builder_;
+   group* root_;
+   /// Array being parsed, its numbers and booleans are stored typed
+   list* array_;
+   std::vector<element*> stack_;
+   boost::string_ref key_;
+};
+
+///
+/// \brief Parses a config held in memory with the hand-written parser.
+///
+inline group* parse_config(const char* data, size_t size, const std::string& name, cconfig::tree_builder& builder)
+{
+   cconfig::lexer l(data, data + size, name);
+   tree_handler h(builder);
+   parser<tree_handler> p(l, h);
+   p.parse();
+   builder.record_input(size, l.token_count());
+   return h.root();
+}
+
+///
+/// \brief Parses a part of a config, e.g. a range found by index_definitions.
+///
+/// \param input Start of the whole config, used for error locations
+///
+inline group* parse_config(const char* input, const char* begin, const char* end,
+   const std::string& name, cconfig::tree_builder& builder)
+{
+   cconfig::lexer l(input, begin, end, name);
+   tree_handler h(builder);
+   parser<tree_handler> p(l, h);
+   p.parse();
+   builder.record_input(end - begin, l.token_count());
+   return h.root();
+}
+
+///
+/// \brief Byte range of a top-level definition.
+///
+struct definition_range
+{
+   /// Setting name of the definition
+   boost::string_ref key;
+   /// Range of the definition including its name
+   const char* begin;
+   const char* end;
+   /// False if the input ended before the definition did
+   bool complete;
+};
+
+namespace parser_detail {
+
+///
+/// \brief Skips a string literal or comment like the lexer does.
+///
+/// \returns Position of the last character of the string or comment, or
+///          NULL if there is none at p.
+///
+inline const char* skip_literal(const cconfig::lexer& l, const char* p, const char* end)
+{
+   if(*p == '"')
+   {
+      const char* start = p++;
+      for(;;)
+      {
+         p = scan::find_quote_or_backslash(p, end);
+         if(p == end)
+            l.error(start, "Unterminated string");
+         if(*p == '"')
+            return p;
+         // skip the escaped character
+         if(++p == end)
+            l.error(start, "Unterminated string");
+         ++p;
+      }
+   }
+
+   if(*p != '/' || end - p < 2)
+      return NULL;
+   if(p[1] == '/')
+   {
+      p = scan::find_char(p + 2, end, '\n');
+      return p == end ? p - 1 : p;
+   }
+   if(p[1] == '*')
+   {
+      const char* start = p;
+      for(p += 2; ; ++p)
+      {
+         p = scan::find_char(p, end, '*');
+         if(p == end)
+            l.error(start, "Unterminated comment");
+         if(p + 1 != end && p[1] == '/')
+            return p + 1;
+      }
+   }
+   return NULL;
+}
+
+///
+/// \brief Finds the end of a definition by matching brackets.
+///
+/// A group definition ends with the bracket closing its first opening
+/// bracket, a variable definition with a semicolon outside of brackets.
+///
+/// \returns Position behind the definition or NULL if the input ends first.
+///
+inline const char* skip_definition(const cconfig::lexer& l, const char* p, const char* end)
+{
+   std::string expected;
+   bool variable = false;
+   for(; ; ++p)
+   {
+      p = scan::find_structural(p, end, '=', ';');
+      if(p == end)
+         return NULL;
+
+      switch(*p)
+      {
+      case '"': case '/':
+         {
+            const char* literal = skip_literal(l, p, end);
+            if(literal != NULL)
+               p = literal;
+         }
+         break;
+      case '{': expected.push_back('}'); break;
+      case '(': expected.push_back(')'); break;
+      case '[': expected.push_back(']'); break;
+      case '}': case ')': case ']':
+         if(expected.empty() || expected[expected.size() - 1] != *p)
+            l.error(p, "Unbalanced '" + std::string(1, *p) + "'");
+         expected.erase(expected.size() - 1);
+         if(expected.empty() && !variable)
+            return p + 1;
+         break;
+      case '=':
+         if(expected.empty())
+            variable = true;
+         break;
+      case ';':
+         if(expected.empty())
+            return p + 1;
+         break;
+      }
+   }
+}
+
+///
+/// \brief Finds the closing bracket of a list or array body.
+///
+/// The body starts at p, behind the opening bracket. Commas separating
+/// two elements are added to cuts whenever at least slice_size bytes
+/// passed since the previous cut.
+///
+/// \returns Position of the closing bracket or NULL if the input ends first.
+///
+inline const char* split_elements(const cconfig::lexer& l, const char* p, const char* end,
+   size_t slice_size, std::vector<const char*>& cuts)
+{
+   std::string expected;
+   const char* last = p;
+   for(; ; ++p)
+   {
+      // commas are only of interest once the next cut is due, until then
+      // the search stops where it becomes due
+      const bool due = static_cast<size_t>(p - last) >= slice_size;
+      const char* limit = due || static_cast<size_t>(end - last) <= slice_size ? end : last + slice_size;
+      const char separator = due ? ',' : '"';
+      p = scan::find_structural(p, limit, separator, separator);
+      if(p == end)
+         return NULL;
+      if(p == limit)
+      {
+         // the loop moves on to the character at the limit
+         --p;
+         continue;
+      }
+
+      switch(*p)
+      {
+      case '"': case '/':
+         {
+            const char* literal = skip_literal(l, p, end);
+            if(literal != NULL)
+               p = literal;
+         }
+         break;
+      case '{': expected.push_back('}'); break;
+      case '(': expected.push_back(')'); break;
+      case '[': expected.push_back(']'); break;
+      case '}': case ')': case ']':
+         // the parser checks that the body is closed with the right bracket
+         if(expected.empty())
+            return p;
+         if(expected[expected.size() - 1] != *p)
+            l.error(p, "Unbalanced '" + std::string(1, *p) + "'");
+         expected.erase(expected.size() - 1);
+         break;
+      case ',':
+         if(expected.empty() && static_cast<size_t>(p - last) >= slice_size)
+         {
+            cuts.push_back(p);
+            last = p;
+         }
+         break;
+      }
+   }
+}
+
+}
+
+///
+/// \brief Splits a part of a config into definitions without parsing them.
+///
+/// Only setting names, brackets, strings and comments are recognized.
+/// Unbalanced brackets are reported right away, all other syntax errors
+/// are only detected when the definitions are parsed.
+///
+/// \param input Start of the whole config, used for error locations
+/// \throws cconfig::parse_error if the structure of the input is invalid.
+///
+inline void index_definitions(const char* input, const char* begin, const char* end,
+   const std::string& name, std::vector<definition_range>& result)
+{
+   const char* p = begin;
+   for(;;)
+   {
+      cconfig::lexer l(input, p, end, name);
+      token t;
+      l.next(t);
+      if(t.type == token::end_of_input)
+         return;
+      if(t.type != token::identifier)
+         l.error(t.text.data(), "Expected setting name but found '" + t.text.to_string() + "'");
+
+      definition_range range;
+      range.key = t.text;
+      range.begin = t.text.data();
+      range.end = parser_detail::skip_definition(l, t.text.end(), end);
+      range.complete = range.end != NULL;
+      if(!range.complete)
+         range.end = end;
+      result.push_back(range);
+      p = range.end;
+   }
+}
+
+///
+/// \brief Splits a config into its top-level definitions without parsing them.
+///
+inline void index_definitions(const char* data, size_t size, const std::string& name,
+   std::vector<definition_range>& result)
+{
+   index_definitions(data, data, data + size, name, result);
+}
+
+}
+
+#endif
@@ -0,0 +1,355 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_SCAN_HPP_
+#define CONFIG_SCAN_HPP_
+
+///
+/// \file
+/// \brief Scanning kernels used by the config lexer and the pre-scans of
+/// lazy and parallel parsing.
+///
+/// The kernels process 16 or 32 bytes at a time with SSE2, AVX2 or NEON
+/// depending on the target. Define CCONFIG_NO_SIMD to always use the
+/// scalar implementation.
+///
+
+#if !defined(CCONFIG_NO_SIMD)
+#  if defined(__AVX2__)
+#     define CCONFIG_SCAN_AVX2
+#     include <immintrin.h>
+#  elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#     define CCONFIG_SCAN_SSE2
+#     include <emmintrin.h>
+#  elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#     define CCONFIG_SCAN_NEON
+#     include <arm_neon.h>
+#  endif
+#endif
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+#include <boost/cstdint.hpp>
+
+namespace cconfig {
+namespace scan {
+
+inline bool is_whitespace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+///
+/// \brief Portable implementations, also used for the tail of the input.
+///
+namespace scalar {
+
+/// Returns the first character in [p, end) that is not whitespace or end
+inline const char* skip_whitespace(const char* p, const char* end)
+{
+   while(p != end && is_whitespace(*p))
+      ++p;
+   return p;
+}
+
+/// Returns the first occurrence of c in [p, end) or end
+inline const char* find_char(const char* p, const char* end, char c)
+{
+   while(p != end && *p != c)
+      ++p;
+   return p;
+}
+
+/// Returns the first '"' or '\\' in [p, end) or end
+inline const char* find_quote_or_backslash(const char* p, const char* end)
+{
+   while(p != end && *p != '"' && *p != '\\')
+      ++p;
+   return p;
+}
+
+/// Returns the first bracket, '"', '/', a or b in [p, end) or end
+inline const char* find_structural(const char* p, const char* end, char a, char b)
+{
+   for(; p != end; ++p)
+   {
+      const char c = *p;
+      // classify the brackets like the vector kernels: '(' and ')' differ in
+      // the lowest bit, '[' and '{' as well as ']' and '}' in bit 5
+      if((c & 0xfe) == '(' || (c & 0xdf) == '[' || (c & 0xdf) == ']'
+         || c == '"' || c == '/' || c == a || c == b)
+         break;
+   }
+   return p;
+}
+
+}
+
+namespace detail {
+
+inline unsigned int count_trailing_zeros(boost::uint32_t mask)
+{
+#if defined(_MSC_VER)
+   unsigned long index;
+   _BitScanForward(&index, mask);
+   return index;
+#else
+   return __builtin_ctz(mask);
+#endif
+}
+
+#if defined(CCONFIG_SCAN_AVX2)
+
+typedef __m256i vector;
+static const size_t width = 32;
+
+inline vector load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline vector splat(char c) { return _mm256_set1_epi8(c); }
+inline vector eq(vector a, vector b) { return _mm256_cmpeq_epi8(a, b); }
+inline vector either(vector a, vector b) { return _mm256_or_si256(a, b); }
+inline vector both(vector a, vector b) { return _mm256_and_si256(a, b); }
+inline boost::uint32_t mask(vector v) { return static_cast<boost::uint32_t>(_mm256_movemask_epi8(v)); }
+inline const char* first(const char* p, boost::uint32_t m) { return p + count_trailing_zeros(m); }
+
+#elif defined(CCONFIG_SCAN_SSE2)
+
+typedef __m128i vector;
+static const size_t width = 16;
+
+inline vector load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline vector splat(char c) { return _mm_set1_epi8(c); }
+inline vector eq(vector a, vector b) { return _mm_cmpeq_epi8(a, b); }
+inline vector either(vector a, vector b) { return _mm_or_si128(a, b); }
+inline vector both(vector a, vector b) { return _mm_and_si128(a, b); }
+inline boost::uint32_t mask(vector v) { return static_cast<boost::uint32_t>(_mm_movemask_epi8(v)); }
+inline const char* first(const char* p, boost::uint32_t m) { return p + count_trailing_zeros(m); }
+
+#elif defined(CCONFIG_SCAN_NEON)
+
+typedef uint8x16_t vector;
+static const size_t width = 16;
+
+inline vector load(const char* p) { return vld1q_u8(reinterpret_cast<const uint8_t*>(p)); }
+inline vector splat(char c) { return vdupq_n_u8(static_cast<uint8_t>(c)); }
+inline vector eq(vector a, vector b) { return vceqq_u8(a, b); }
+inline vector either(vector a, vector b) { return vorrq_u8(a, b); }
+inline vector both(vector a, vector b) { return vandq_u8(a, b); }
+
+// NEON has no movemask, the narrowing shift yields four bits per byte
+inline boost::uint64_t mask64(vector v)
+{
+   return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+}
+
+#endif
+
+}
+
+#if defined(CCONFIG_SCAN_AVX2) || defined(CCONFIG_SCAN_SSE2) || defined(CCONFIG_SCAN_NEON)
+
+namespace detail {
+
+///
+/// \brief Byte mask of the characters found by find_structural.
+///
+struct structural_matcher
+{
+   structural_matcher(char a, char b) :
+      not_bit0(splat(static_cast<char>(0xfe))), not_bit5(splat(static_cast<char>(0xdf))),
+      parens(splat('(')), opening(splat('[')), closing(splat(']')),
+      quote(splat('"')), slash(splat('/')), a(splat(a)), b(splat(b))
+   {}
+
+   vector match(vector v) const
+   {
+      const vector brackets = either(eq(both(v, not_bit0), parens),
+         either(eq(both(v, not_bit5), opening), eq(both(v, not_bit5), closing)));
+      return either(either(brackets, either(eq(v, quote), eq(v, slash))), either(eq(v, a), eq(v, b)));
+   }
+
+   vector not_bit0, not_bit5, parens, opening, closing, quote, slash, a, b;
+};
+
+}
+
+#endif
+
+#if defined(CCONFIG_SCAN_AVX2) || defined(CCONFIG_SCAN_SSE2)
+
+namespace detail {
+
+inline const char* skip_whitespace_vector(const char* p, const char* end)
+{
+   const vector space = splat(' '), tab = splat('\t'), cr = splat('\r'), lf = splat('\n');
+   const boost::uint32_t all = static_cast<boost::uint32_t>((boost::uint64_t(1) << width) - 1);
+   for(; static_cast<size_t>(end - p) >= width; p += width)
+   {
+      vector v = load(p);
+      boost::uint32_t m = mask(either(either(eq(v, space), eq(v, tab)), either(eq(v, cr), eq(v, lf))));
+      if(m != all)
+         return first(p, ~m & all);
+   }
+   return scalar::skip_whitespace(p, end);
+}
+
+}
+
+inline const char* skip_whitespace(const char* p, const char* end)
+{
+   // most whitespace runs are short (a separating space or a line break
+   // and some indentation), vectors only pay off for longer runs
+   const char* start = p;
+   while(p != end && is_whitespace(*p))
+   {
+      if(++p - start == 16)
+         return detail::skip_whitespace_vector(p, end);
+   }
+   return p;
+}
+
+inline const char* find_char(const char* p, const char* end, char c)
+{
+   using namespace detail;
+   const vector needle = splat(c);
+   for(; static_cast<size_t>(end - p) >= width; p += width)
+   {
+      boost::uint32_t m = mask(eq(load(p), needle));
+      if(m != 0)
+         return first(p, m);
+   }
+   return scalar::find_char(p, end, c);
+}
+
+inline const char* find_quote_or_backslash(const char* p, const char* end)
+{
+   using namespace detail;
+   const vector quote = splat('"'), backslash = splat('\\');
+   for(; static_cast<size_t>(end - p) >= width; p += width)
+   {
+      vector v = load(p);
+      boost::uint32_t m = mask(either(eq(v, quote), eq(v, backslash)));
+      if(m != 0)
+         return first(p, m);
+   }
+   return scalar::find_quote_or_backslash(p, end);
+}
+
+inline const char* find_structural(const char* p, const char* end, char a, char b)
+{
+   using namespace detail;
+   const structural_matcher matcher(a, b);
+   for(; static_cast<size_t>(end - p) >= width; p += width)
+   {
+      boost::uint32_t m = mask(matcher.match(load(p)));
+      if(m != 0)
+         return first(p, m);
+   }
+   return scalar::find_structural(p, end, a, b);
+}
+
+#elif defined(CCONFIG_SCAN_NEON)
+
+namespace detail {
+
+inline const char* skip_whitespace_vector(const char* p, const char* end)
+{
+   const vector space = splat(' '), tab = splat('\t'), cr = splat('\r'), lf = splat('\n');
+   for(; static_cast<size_t>(end - p) >= width; p += width)
+   {
+      vector v = load(p);
+      boost::uint64_t m = ~mask64(either(either(eq(v, space), eq(v, tab)), either(eq(v, cr), eq(v, lf))));
+      if(m != 0)
+         return p + __builtin_ctzll(m) / 4;
+   }
+   return scalar::skip_whitespace(p, end);
+}
+
+}
+
+inline const char* skip_whitespace(const char* p, const char* end)
+{
+   const char* start = p;
+   while(p != end && is_whitespace(*p))
+   {
+      if(++p - start == 16)
+         return detail::skip_whitespace_vector(p, end);
+   }
+   return p;
+}
+
+inline const char* find_char(const char* p, const char* end, char c)
+{
+   using namespace detail;
+   const vector needle = splat(c);
+   for(; static_cast<size_t>(end - p) >= width; p += width)
+   {
+      boost::uint64_t m = mask64(eq(load(p), needle));
+      if(m != 0)
+         return p + __builtin_ctzll(m) / 4;
+   }
+   return scalar::find_char(p, end, c);
+}
+
+inline const char* find_quote_or_backslash(const char* p, const char* end)
+{
+   using namespace detail;
+   const vector quote = splat('"'), backslash = splat('\\');
+   for(; static_cast<size_t>(end - p) >= width; p += width)
+   {
+      vector v = load(p);
+      boost::uint64_t m = mask64(either(eq(v, quote), eq(v, backslash)));
+      if(m != 0)
+         return p + __builtin_ctzll(m) / 4;
+   }
+   return scalar::find_quote_or_backslash(p, end);
+}
+
+inline const char* find_structural(const char* p, const char* end, char a, char b)
+{
+   using namespace detail;
+   const structural_matcher matcher(a, b);
+   for(; static_cast<size_t>(end - p) >= width; p += width)
+   {
+      boost::uint64_t m = mask64(matcher.match(load(p)));
+      if(m != 0)
+         return p + __builtin_ctzll(m) / 4;
+   }
+   return scalar::find_structural(p, end, a, b);
+}
+
+#else
+
+using scalar::skip_whitespace;
+using scalar::find_char;
+using scalar::find_quote_or_backslash;
+using scalar::find_structural;
+
+#endif
+
+}}
+
+#endif
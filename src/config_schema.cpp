@@ -27,21 +27,37 @@
  */
 
 #include "config_schema.hpp"
+#include "config_binary.hpp"
 #include "config_file.hpp"
+#include "config_input.hpp"
+#include "config_writer.hpp"
 
 #include "ConfigSchemaLexer.hpp"
 #include "ConfigSchemaParser.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <iterator>
+#include <sstream>
+#include <limits>
 
+#include <boost/atomic.hpp>
+#include <boost/bind/bind.hpp>
 #include <boost/foreach.hpp>
+#include <boost/thread/thread.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/erase.hpp>
 #include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
 
 std::string
 cconfig::schema::node::uri() const
 {
+	if(!uri_.empty())
+		return uri_;
 	if(parent_ == NULL)
 		return "/";
 
@@ -57,8 +73,7 @@ cconfig::schema::node::uri() const
 		else
 			element = n->name_;
 
-		const list* l = dynamic_cast<const list*>(n);
-		if(l)
+		if(n->is_list())
 		{
 			element += "[]";
 		}
@@ -73,11 +88,55 @@ cconfig::schema::node::uri() const
 std::string
 cconfig::schema::node::uri_safe() const
 {
+	if(!uri_safe_.empty())
+		return uri_safe_;
 	std::string u = boost::algorithm::replace_all_copy(uri(), "/", "_");
 	boost::algorithm::erase_all(u, "[]");
 	return u;
 }
 
+void
+cconfig::schema::node::finalize()
+{
+	// each URI extends the one of the parent, which has already
+	// been computed on the way down
+	if(parent_ == NULL)
+	{
+		uri_ = "/";
+		uri_safe_ = "_";
+	}
+	else
+	{
+		const std::string element = name_.empty() ? "unnamed" : name_;
+		const bool top_level = parent_->parent_ == NULL;
+		uri_ = (top_level ? "/" : parent_->uri_ + "/") + element + (is_list() ? "[]" : "");
+		uri_safe_ = (top_level ? "" : parent_->uri_safe_) + "_" + element;
+	}
+
+	if(is_group())
+	{
+		const group& g = as_group_unchecked();
+		for(group::node_map_type::const_iterator it = g.children_.begin(); it != g.children_.end(); ++it)
+			it->second->finalize();
+	}
+	else if(is_list())
+	{
+		const list& l = as_list_unchecked();
+		for(list::node_list_type::const_iterator it = l.children_.begin(); it != l.children_.end(); ++it)
+			(*it)->finalize();
+	}
+}
+
+std::string
+cconfig::schema::node::generate_type_name() const
+{
+	if(is_group())
+		return parent_ == NULL ? "Config" : "group" + uri_safe_;
+	if(is_list())
+		return "list" + uri_safe_;
+	return as_atom_unchecked().c_type_string();
+}
+
 bool
 cconfig::schema::node::has_attribute(const std::string& name) const
 {
@@ -85,23 +144,65 @@ cconfig::schema::node::has_attribute(const std::string& name) const
 	return it != attributes_.end();
 }
 
-std::string
-cconfig::schema::node::generate_common_tree_initialization(int unique_id, int indent) const
+void
+cconfig::schema::node::generate_literal(std::ostream& out, const cconfig::atom& a)
 {
-	// visitors are your friend
-	attribute_visitor visitor;
-
-	std::string s;
-	std::string varname = "var" + boost::lexical_cast<std::string>(unique_id);
-
-	for(attribute_map_type::const_iterator ita = attributes_.begin();
-		ita != attributes_.end(); ++ita)
+	if(a.is_long())
+	{
+		// the negated maximum is the only way to spell the minimum
+		const long v = a.get_long();
+		if(v == std::numeric_limits<long>::min())
+			out << "(-" << std::numeric_limits<long>::max() << "L - 1)";
+		else
+			out << v << 'L';
+	}
+	else if(a.is_double())
 	{
-		indent_string(s, indent); s += varname + "->add_attribute(\"" + ita->first + "\", "
-			+ boost::apply_visitor(visitor, ita->second) + ");\n";
+		// shortest representation that reads back as the same value
+		const double d = a.get_double();
+		std::string v;
+		for(int precision = std::numeric_limits<double>::digits10; precision <= 17; ++precision)
+		{
+			std::ostringstream s;
+			s.precision(precision);
+			s << d;
+			v = s.str();
+			if(boost::lexical_cast<double>(v) == d)
+				break;
+		}
+		out << v;
+		if(v.find_first_of(".en") == std::string::npos)
+			out << ".0";
+	}
+	else if(a.is_bool())
+		out << (a.get_bool() ? "true" : "false");
+	else
+	{
+		const boost::string_ref v = a.get_string_ref();
+		out << '"';
+		for(size_t i = 0; i < v.size(); ++i)
+		{
+			const unsigned char c = v[i];
+			switch(c)
+			{
+			case '"':  out << "\\\""; break;
+			case '\\': out << "\\\\"; break;
+			case '?':  out << "\\?"; break;	// no trigraphs
+			case '\n': out << "\\n"; break;
+			case '\t': out << "\\t"; break;
+			default:
+				if(c < 0x20 || c == 0x7f)
+				{
+					char octal[8];
+					std::sprintf(octal, "\\%03o", static_cast<unsigned int>(c));
+					out << octal;
+				}
+				else
+					out << c;
+			}
+		}
+		out << '"';
 	}
-
-	return s;
 }
 
 cconfig::schema::group::~group()
@@ -146,259 +247,270 @@ cconfig::schema::group::add_child(
 cconfig::schema::validation_result
 cconfig::schema::group::validate(const cconfig::element& e, bool strict) const
 {
-	try {
-		// loop child nodes in schema and validate the config
-		// nodes against them
-		const cconfig::group& g = e.as_group();
-		node_map_type::const_iterator it = children_.begin();
-		for(; it != children_.end(); ++it)
-		{
-			try {
-				const cconfig::element& c = e[it->first];
-				// validate child node
-				validation_result r = it->second->validate(c, strict);
-				// mark as invalid if result was invalid
-				if(!r.valid)
-					return r;
-			} catch(cconfig::lookup_error&) {
-				// mark as invalid if config setting was not found though
-				// it is required
-				if(it->second->required_)
-					return validation_result(false, this->uri(),
-						"Missing required attribute '" + it->first + "'");
-			}
+	if(!e.is_group())
+		return validation_result(false, this->uri(), "Group required");
+	const cconfig::group* g = &e.as_group_unchecked();
+
+	// loop child nodes in schema and validate the config
+	// nodes against them
+	node_map_type::const_iterator it = children_.begin();
+	for(; it != children_.end(); ++it)
+	{
+		const cconfig::element* c = g->get_if(it->first);
+		if(c == NULL)
+		{
+			// mark as invalid if config setting was not found though
+			// it is required
+			if(it->second->required_)
+				return validation_result(false, this->uri(),
+					"Missing required attribute '" + it->first + "'");
+			continue;
 		}
 
-		// check the other way round (all config settings must be defined
-		// in schema) if strict flag is set
-		if(strict)
+		// validate child node
+		validation_result r = it->second->validate(*c, strict);
+		// mark as invalid if result was invalid
+		if(!r.valid)
+			return r;
+	}
+
+	// check the other way round (all config settings must be defined
+	// in schema) if strict flag is set
+	if(strict)
+	{
+		cconfig::group::iterator git = g->begin();
+		for(; git != g->end(); ++git)
 		{
-			cconfig::group::iterator git = g.begin();
-			for(; git != g.end(); ++git)
-			{
-				node_map_type::const_iterator it = children_.find(git->first);
-				if(it == children_.end())
-					return validation_result(false, this->uri(),
-						"Attribute '" + git->first + "' not found in schema "
-						+ "(strict validation). This might possibly be a typo.");
-			}
+			const std::string key = git->key->name.to_string();
+			node_map_type::const_iterator it = children_.find(key);
+			if(it == children_.end())
+				return validation_result(false, this->uri(),
+					"Attribute '" + key + "' not found in schema "
+					+ "(strict validation). This might possibly be a typo.");
 		}
-	} catch(cconfig::lookup_error&) {
-		return validation_result(false, this->uri(), "Group required");
 	}
 
 	return true;
 }
 
-std::string
-cconfig::schema::group::generate_declaration() const
+void
+cconfig::schema::group::generate_declaration(std::ostream& out) const
 {
 	if(children_.empty())
-		return "";
-
-	std::string code;
+		return;
 
 	// generate declarations for children first
 	node_map_type::const_iterator it = children_.begin();
 	for(; it != children_.end(); ++it)
 	{
-		code += it->second->generate_declaration();
+		it->second->generate_declaration(out);
 	}
 
 	// then generate own declaration
 	if(parent_ == NULL)	// root node
-		code += "struct Config {\n";
+		out << "struct Config {\n";
 	else
 	{
-		code += "struct group" + uri_safe() + " {\n";
+		out << "struct group" << uri_safe_ << " {\n";
 	}
 
 	for(it = children_.begin(); it != children_.end(); ++it)
 	{
-		code += "\t" + it->second->generate_definition();
+		out << '\t';
+		it->second->generate_definition(out);
 	}
 
 	// generate initializations
-	std::vector<std::string> initializations;
+	bool first = true;
 	for(it = children_.begin(); it != children_.end(); ++it)
 	{
-		if(cconfig::schema::atom* a = dynamic_cast<cconfig::schema::atom*>(it->second))
+		if(!it->second->is_atom())
+			continue;
+
+		const cconfig::schema::atom* a = &it->second->as_atom_unchecked();
+		if(first)
 		{
-			std::string s(it->first + "(");
-			
-			if(a->has_attribute("default"))
-			{
-				// we have a default value, so put it into initializer
-				if(a->type_ == typeid(long))
-					s += boost::lexical_cast<std::string>(a->get_attribute<long>("default")) + "L";
-				else if(a->type_ == typeid(bool))
-					s += (a->get_attribute<bool>("default")?"true":"false");
-				else if(a->type_ == typeid(double))
-					s += boost::lexical_cast<std::string>(a->get_attribute<double>("default"));
-				else if(a->type_ == typeid(std::string))
-					s += "\"" + a->get_attribute<std::string>("default") + "\"";
-			}
+			if(parent_ == NULL) // root node
+				out << "\n\tConfig() :\n\t\t";
 			else
-			{
-				// initialize with a sensible default to avoid accidental usage
-				// of undefined variables
-				if(a->type_ == typeid(long))
-					s += "0L";
-				else if(a->type_ == typeid(bool))
-					s += "false";
-				else if(a->type_ == typeid(double))
-					s += "0.0";
-			}
-			
-			s += ")";
-
-			initializations.push_back(s);
+				out << "\n\tgroup" << uri_safe_ << "() :\n\t\t";
+			first = false;
 		}
-	}
+		else
+			out << ",\n\t\t";
 
-	if(!initializations.empty())
-	{
-		if(parent_ == NULL) // root node
-			code += "\n\tConfig() :\n\t\t";
+		out << it->first << '(';
+		if(a->has_default_)
+		{
+			// we have a default value, so put it into initializer
+			if(a->type_ == typeid(long))
+				out << boost::lexical_cast<std::string>(a->default_long_) << 'L';
+			else if(a->type_ == typeid(bool))
+				out << (a->default_bool_?"true":"false");
+			else if(a->type_ == typeid(double))
+				out << boost::lexical_cast<std::string>(a->default_double_);
+			else if(a->type_ == typeid(std::string))
+				out << '"' << a->default_string_ << '"';
+		}
 		else
 		{
-			code += "\n\tgroup" + uri_safe() + "() :\n\t\t";
+			// initialize with a sensible default to avoid accidental usage
+			// of undefined variables
+			if(a->type_ == typeid(long))
+				out << "0L";
+			else if(a->type_ == typeid(bool))
+				out << "false";
+			else if(a->type_ == typeid(double))
+				out << "0.0";
 		}
-
-		code += boost::algorithm::join(initializations, ",\n\t\t");
-		code += "\n\t{}\n";
+		out << ')';
 	}
 
+	if(!first)
+		out << "\n\t{}\n";
+
 	if(parent_ == NULL) // root node
 	{
-		code += "\n\tcconfig::file& file() { return *file_; }\n";
-		code += "\tcconfig::file* file_;\n";
+		out << "\n\tcconfig::file& file() { return *file_; }\n";
+		out << "\tboost::shared_ptr<cconfig::file> file_;\n";
 	}
 
-	code += "};\n\n";
-	return code;
+	out << "};\n\n";
 }
 
-std::string
-cconfig::schema::group::generate_definition() const
+void
+cconfig::schema::group::generate_definition(std::ostream& out) const
 {
-	return "group" + uri_safe() + " " + name_ + ";\n";
+	out << "group" << uri_safe_ << " " << name_ << ";\n";
 }
 
-std::string
-cconfig::schema::group::generate_initialization() const
+void
+cconfig::schema::group::generate_initialization(std::ostream& out, const std::string& target) const
 {
-	return "generate_group" + uri_safe() + "(child_element, child_node)";
+	out << "generate_group" << uri_safe_ << "(child_element, " << target << ");\n";
 }
 
-std::string
-cconfig::schema::group::generate_function() const
+void
+cconfig::schema::group::generate_function(std::ostream& out) const
 {
-	std::string code;
-
-	std::string return_type;
+	std::string struct_type;
 	std::string function_name;
 
 	if(parent_ == NULL) // root node
 	{
-		return_type = "Config";
+		struct_type = "Config";
 		function_name = "generate_Config";
 	}
 	else
 	{
-		std::string u = uri_safe();
-		return_type = "group" + u;
-		function_name = "generate_group" + u;
+		struct_type = "group" + uri_safe_;
+		function_name = "generate_group" + uri_safe_;
+		// elements of struct-of-arrays lists are filled through a row
+		if(parent_->is_list() && parent_->as_list_unchecked().soa_)
+			struct_type = "list" + parent_->uri_safe_ + "::row";
 	}
 
 	node_map_type::const_iterator it = children_.begin();
 	for(; it != children_.end(); ++it)
-		code += it->second->generate_function();
-
-	code += return_type + " " + function_name +
-		"(const cconfig::element& e, cconfig::schema::node* n)\n";
-	code += "{\n";
-	code += "\t" + return_type + " r;\n";
-	code += "\tcconfig::schema::group* g = dynamic_cast<cconfig::schema::group*>(n);\n";
+		it->second->generate_function(out);
+
+	// the settings of the config group are visited once and dispatched
+	// on the hashes their keys were interned with; hashes colliding
+	// within the group share a case label
+	typedef std::map<boost::uint32_t, std::vector<node_map_type::const_iterator> > case_map_type;
+	case_map_type cases;
+	size_t required = 0;
 	for(it = children_.begin(); it != children_.end(); ++it)
 	{
-		code += "\t{\n";
-		code += "\t\tcconfig::schema::node* child_node = g->children_.find(\""
-			+ it->first + "\")->second;\n";
-		code += "\t\t{\n";
-		if(!it->second->required_)
-		{
-			code += "\t\t\ttry {\n";
-			code += "\t\t\t\tconst cconfig::element& child_element = e[\"" + it->first + "\"];\n";
-			code += "\t\t\t\tr." + it->first + " = ";
-			code += it->second->generate_initialization() + ";\n";
-			code += "\t\t\t} catch(cconfig::lookup_error&) {}\n";
-			// this is an optional setting and possible defaults are already
-			// defined in the struct declaration so we may (and should)
-			// safely ignore this error
-		}
-		else
+		cases[cconfig::util::hash_key(it->first)].push_back(it);
+		if(it->second->required_)
+			++required;
+	}
+
+	// validation is done on the way, with the checks and messages of
+	// the strict schema validator; the members of r are filled in place
+	out << "void " << function_name << "(const cconfig::element& e, " << struct_type << "& r)\n";
+	out << "{\n";
+	out << "\tif(!e.is_group())\n";
+	out << "\t\tfail(\"" << uri_ << "\", \"Group required\");\n";
+	out << "\tconst cconfig::group& g = e.as_group_unchecked();\n\n";
+	if(required != 0)
+		out << "\tsize_t required = 0;\n";
+	out << "\tconst cconfig::symbol* unknown = NULL;\n";
+	out << "\tfor(cconfig::group::iterator it = g.begin(); it != g.end(); ++it)\n";
+	out << "\t{\n";
+	if(!children_.empty())
+	{
+		out << "\t\tconst cconfig::element& child_element = *it->value;\n";
+		out << "\t\tswitch(it->key->hash)\n";
+		out << "\t\t{\n";
+		for(case_map_type::const_iterator cit = cases.begin(); cit != cases.end(); ++cit)
 		{
-			code += "\t\t\tconst cconfig::element& child_element = e[\"" + it->first + "\"];\n";
-			code += "\t\t\tr." + it->first + " = ";
-			code += it->second->generate_initialization() + ";\n";
+			char label[16];
+			std::sprintf(label, "0x%08xu", static_cast<unsigned int>(cit->first));
+			out << "\t\tcase " << label << ":\n";
+			for(size_t i = 0; i < cit->second.size(); ++i)
+			{
+				const node_map_type::const_iterator& child = cit->second[i];
+				out << "\t\t\tif(it->key->name == \"" << child->first << "\")\n";
+				out << "\t\t\t{\n";
+				out << "\t\t\t\t";
+				child->second->generate_initialization(out, "r." + child->first);
+				if(child->second->required_)
+					out << "\t\t\t\t++required;\n";
+				out << "\t\t\t\tcontinue;\n";
+				out << "\t\t\t}\n";
+			}
+			out << "\t\t\tbreak;\n";
 		}
-		code += "\t\t}\n";
-		code += "\t}\n";
+		out << "\t\t}\n";
 	}
-	code += "\n\treturn r;\n";
-	code += "}\n\n";
+	out << "\t\tif(unknown == NULL)\n";
+	out << "\t\t\tunknown = it->key;\n";
+	out << "\t}\n\n";
 
-	return code;
+	if(required != 0)
+	{
+		// keys are unique, so only the count needs to be checked
+		out << "\tif(required != " << required << ")\n";
+		out << "\t{\n";
+		for(it = children_.begin(); it != children_.end(); ++it)
+		{
+			if(!it->second->required_)
+				continue;
+			out << "\t\tif(g.get_if(\"" << it->first << "\") == NULL)\n";
+			out << "\t\t\tfail(\"" << uri_ << "\", \"Missing required attribute '" << it->first << "'\");\n";
+		}
+		out << "\t}\n";
+	}
+	out << "\tif(unknown != NULL)\n";
+	out << "\t\tfail(\"" << uri_ << "\", \"Attribute '\" + unknown->name.to_string() + \"' not found in schema \"\n";
+	out << "\t\t\t\"(strict validation). This might possibly be a typo.\");\n";
+	out << "}\n\n";
 }
 
-std::string
-cconfig::schema::group::generate_tree_builder(int& unique_id, int indent) const
+void
+cconfig::schema::group::generate_config_stub(cconfig::writer& w, const std::string& key) const
 {
-	std::string s;
-	std::string varname = "var" + boost::lexical_cast<std::string>(unique_id);
-
-	indent_string(s, indent); s += "cconfig::schema::group* " + varname
-		+ " = new cconfig::schema::group();\n";
-	s += generate_common_tree_initialization(unique_id, indent);
-	
+	w.on_group_begin(key);
 	for(node_map_type::const_iterator it = children_.begin();
 		it != children_.end(); ++it)
-	{
-		indent_string(s, indent); s += "{\n";
-		// we need a unique variable name here so we construct one using
-		// the incrementing variable unique_id
-		std::string childvarname = "var" + boost::lexical_cast<std::string>(++unique_id);
-		s += it->second->generate_tree_builder(unique_id, indent+1);
-
-		indent_string(s, indent+1); s += varname + "->add_child(\"" + it->first + "\", "
-			+ childvarname + ", " + (it->second->required_?"true":"false") + ");\n";
-		
-		indent_string(s, indent); s += "}\n";
-	}
-
-	return s;
+		it->second->generate_config_stub(w, it->first);
+	w.on_group_end();
 }
 
-std::string
-cconfig::schema::group::generate_config_stub(int indent) const
+void
+cconfig::schema::group::generate_embedded(std::ostream& out, const cconfig::element& e,
+	const std::string& target, int indent) const
 {
-	std::string s;
-	
-	s += "{\n";
-
-	for(node_map_type::const_iterator it = children_.begin();
-		it != children_.end(); ++it)
+	// absent settings keep the defaults of the struct
+	const cconfig::group& g = e.as_group_unchecked();
+	for(node_map_type::const_iterator it = children_.begin(); it != children_.end(); ++it)
 	{
-		indent_string(s, indent+1);
-		s += it->first
-			+ " = "
-			+ it->second->generate_config_stub(indent+1)
-			+ ";\n";
+		const cconfig::element* child = g.get_if(it->first);
+		if(child != NULL)
+			it->second->generate_embedded(out, *child, target + "." + it->first, indent);
 	}
-
-	indent_string(s, indent); s += "}";
-	return s;
 }
 
 cconfig::schema::list::~list()
@@ -415,157 +527,300 @@ cconfig::schema::list::add_child(node* n)
 	n->parent_ = this;
 }
 
+void
+cconfig::schema::list::resolve_attribute(const std::string& name)
+{
+	if(name == "min")
+	{
+		// stored unsigned for comparing with list sizes
+		const long min = get_attribute<long>(name);
+		if(min < 0)
+			throw cconfig::schema::exception("Negative list minimum " +
+				boost::lexical_cast<std::string>(min));
+		has_min_ = true;
+		min_ = min;
+	}
+	else if(name == "layout")
+	{
+		const std::string layout = get_attribute<std::string>(name);
+		if(layout != "aos" && layout != "soa")
+			throw cconfig::schema::exception("Unknown list layout '" + layout +
+				"', expected \"aos\" or \"soa\"");
+		soa_ = layout == "soa";
+	}
+}
+
 cconfig::schema::validation_result
 cconfig::schema::list::validate(
 		const cconfig::element& e,
 		bool strict) const
 {
-	try {
-		const cconfig::list& l = e.as_list();
-		node_list_type::const_iterator it = children_.begin();
-		// only one child allowed! TODO: allow more childs after thinking
-		// about how to handle this properly (this might be brainfuck though)
-
-		cconfig::list::iterator lit = l.begin();
-		for(; lit != l.end(); ++lit)
-		{
-			validation_result r = (*it)->validate(*lit, strict);
-			if(!r.valid)
-				return r;
-		}
+	if(!e.is_list())
+		return validation_result(false, this->uri(), "List required");
 
-		// check min attribute
-		if(has_attribute("min"))
-		{
-			unsigned int min = get_attribute<int>("min");
-			if(l.size() < min)
-				return validation_result(false, this->uri(),
-					"List has not enough entries, need at least " +
-					boost::lexical_cast<std::string>(min)
-				);
-		}
+	const cconfig::list& l = e.as_list_unchecked();
+	node_list_type::const_iterator it = children_.begin();
+	// only one child allowed! TODO: allow more childs after thinking
+	// about how to handle this properly (this might be brainfuck though)
 
-		return validation_result(true);
-	} catch(cconfig::lookup_error&) {
-		return validation_result(false, this->uri(), "List required");
+	cconfig::list::iterator lit = l.begin();
+	for(; lit != l.end(); ++lit)
+	{
+		validation_result r = (*it)->validate(*lit, strict);
+		if(!r.valid)
+			return r;
 	}
+
+	// check min attribute
+	if(has_min_ && l.size() < min_)
+		return validation_result(false, this->uri(),
+			"List has not enough entries, need at least " +
+			boost::lexical_cast<std::string>(min_)
+		);
+
+	return validation_result(true);
 }
 
-std::string
-cconfig::schema::list::generate_declaration() const
+void
+cconfig::schema::list::generate_declaration(std::ostream& out) const
 {
 	if(children_.empty())
-		return "";
-
-	std::string code;
+		return;
 
 	// generate declarations for child first
 	node_list_type::const_iterator it = children_.begin();
-	code += (*it)->generate_declaration();
+	(*it)->generate_declaration(out);
 
 	// then generate own declaration
-	code += "typedef std::vector<";
-	if(dynamic_cast<cconfig::schema::group*>(*it))
-		code += "group" + (*it)->uri_safe();
-	else if(dynamic_cast<cconfig::schema::group*>(*it))
-		code += "list" + (*it)->uri_safe();
-	else if(cconfig::schema::atom* a = dynamic_cast<cconfig::schema::atom*>(*it))
-		code += a->c_type_string();
-	
-	code += "> list" + uri_safe() + ";\n";
-	return code;
-}
+	if(!soa_)
+	{
+		out << "typedef std::vector<" << (*it)->generate_type_name()
+			<< "> list" << uri_safe_ << ";\n";
+		return;
+	}
 
-std::string
-cconfig::schema::list::generate_definition() const
-{
-	return "list" + uri_safe() + " " + name_ + ";\n";
+	if(!(*it)->is_group())
+		throw cconfig::schema::exception("Layout \"soa\" requires a list of groups (" + uri_ + ")");
+
+	// one column per group member; the group struct still provides the
+	// default values for new rows
+	const cconfig::schema::group& g = (*it)->as_group_unchecked();
+	const std::string element_type = g.generate_type_name();
+	const char* reserved[] = { "size", "empty", "resize", "push_back", "row", "const_row" };
+	cconfig::schema::group::node_map_type::const_iterator cit = g.children_.begin();
+	for(; cit != g.children_.end(); ++cit)
+	{
+		if(std::find(reserved, reserved + 6, cit->first) != reserved + 6)
+			throw cconfig::schema::exception("Member '" + cit->first +
+				"' clashes with the list interface of layout \"soa\" (" + uri_ + ")");
+	}
+	const std::string& front = g.children_.begin()->first;
+
+	out << "struct list" << uri_safe_ << " {\n";
+	for(cit = g.children_.begin(); cit != g.children_.end(); ++cit)
+		out << "\tstd::vector<" << cit->second->generate_type_name() << "> " << cit->first << ";\n";
+
+	const char* proxies[] = { "row", "const_row" };
+	const char* references[] = { "reference", "const_reference" };
+	for(int p = 0; p < 2; ++p)
+	{
+		out << "\n\tstruct " << proxies[p] << " {\n";
+		for(cit = g.children_.begin(); cit != g.children_.end(); ++cit)
+			out << "\t\tstd::vector<" << cit->second->generate_type_name() << ">::"
+				<< references[p] << " " << cit->first << ";\n";
+		out << "\t};\n";
+	}
+
+	// members are qualified with this-> as locals may shadow them
+	out << "\n\tsize_t size() const { return this->" << front << ".size(); }\n";
+	out << "\tbool empty() const { return this->" << front << ".empty(); }\n\n";
+	out << "\tvoid resize(size_t n)\n";
+	out << "\t{\n";
+	out << "\t\tconst " << element_type << " d;\n";
+	for(cit = g.children_.begin(); cit != g.children_.end(); ++cit)
+		out << "\t\tthis->" << cit->first << ".resize(n, d." << cit->first << ");\n";
+	out << "\t}\n\n";
+	out << "\tvoid push_back(const " << element_type << "& value)\n";
+	out << "\t{\n";
+	for(cit = g.children_.begin(); cit != g.children_.end(); ++cit)
+		out << "\t\tthis->" << cit->first << ".push_back(value." << cit->first << ");\n";
+	out << "\t}\n";
+	for(int p = 0; p < 2; ++p)
+	{
+		out << "\n\t" << proxies[p] << " operator[](size_t i)" << (p == 1 ? " const" : "") << "\n";
+		out << "\t{\n";
+		out << "\t\t" << proxies[p] << " r = { ";
+		for(cit = g.children_.begin(); cit != g.children_.end(); ++cit)
+			out << (cit == g.children_.begin() ? "" : ", ") << "this->" << cit->first << "[i]";
+		out << " };\n";
+		out << "\t\treturn r;\n";
+		out << "\t}\n";
+	}
+	out << "};\n\n";
 }
 
-std::string
-cconfig::schema::list::generate_initialization() const
+void
+cconfig::schema::list::generate_definition(std::ostream& out) const
 {
-	return "generate_list" + uri_safe() + "(child_element, child_node)";
+	out << "list" << uri_safe_ << " " << name_ << ";\n";
 }
 
-std::string
-cconfig::schema::list::generate_function() const
+void
+cconfig::schema::list::generate_initialization(std::ostream& out, const std::string& target) const
 {
-	std::string code;
-
-	std::string u = uri_safe();
-	std::string return_type = "list" + u;
-
-	cconfig::schema::node* spec = children_.front();
-	code += spec->generate_function();
-
-	code += return_type + " generate_list" + u +
-			"(const cconfig::element& e, cconfig::schema::node* n)\n";
-	code += "{\n";
-	code += "\t" + return_type + " r;\n";
-	code += "\tcconfig::schema::list* ln = dynamic_cast<cconfig::schema::list*>(n);\n";
-	code += "\tcconfig::schema::node* child_node = *(ln->children_.begin());\n";
-	code += "\tconst cconfig::list& l = e.as_list();\n";
-	code += "\tcconfig::list::iterator it = l.begin();\n";
-	code += "\tfor(; it != l.end(); ++it)\n";
-	code += "\t{\n";
-	code += "\t\tconst cconfig::element& child_element = *it;\n";
-	code += "\t\tr.push_back(" + spec->generate_initialization() + ");\n";
-	code += "\t}\n";
-	code += "\n\treturn r;\n";
-	code += "}\n\n";
-
-	return code;
+	out << "generate_list" << uri_safe_ << "(child_element, " << target << ");\n";
 }
 
-std::string
-cconfig::schema::list::generate_tree_builder(int& unique_id, int indent) const
+void
+cconfig::schema::list::generate_function(std::ostream& out) const
 {
-	std::string s;
-	std::string varname = "var" + boost::lexical_cast<std::string>(unique_id);
+	const std::string& u = uri_safe_;
 
-	indent_string(s, indent); s += "cconfig::schema::list* " + varname
-		+ " = new cconfig::schema::list();\n";
-	s += generate_common_tree_initialization(unique_id, indent);
-	
-	for(node_list_type::const_iterator it = children_.begin();
-		it != children_.end(); ++it)
+	cconfig::schema::node* spec = children_.front();
+	spec->generate_function(out);
+
+	out << "void generate_list" << u << "(const cconfig::element& e, list" << u << "& r)\n";
+	out << "{\n";
+	out << "\tif(!e.is_list())\n";
+	out << "\t\tfail(\"" << uri_ << "\", \"List required\");\n";
+	out << "\tconst cconfig::list& l = e.as_list_unchecked();\n\n";
+	if(spec->is_atom() && spec->as_atom_unchecked().type_ != typeid(std::string))
 	{
-		std::string childvarname = "var" + boost::lexical_cast<std::string>(++unique_id);
-		s += (*it)->generate_tree_builder(unique_id, indent);
-
-		indent_string(s, indent); s += varname + "->add_child(" + childvarname + ");\n";
+		// arrays with the matching storage are converted in bulk
+		const cconfig::schema::atom& a = spec->as_atom_unchecked();
+		out << "\tget_array(l, \"" << a.uri_ << "\", cconfig::list::";
+		if(a.type_ == typeid(long))
+			out << "long_storage";
+		else if(a.type_ == typeid(double))
+			out << "double_storage";
+		else if(a.type_ == typeid(bool))
+			out << "bool_storage";
+		else
+			out << "generic_storage";
+		out << ", ";
+		a.generate_getter(out);
+		out << ", r);\n";
 	}
-
-	return s;
+	else
+	{
+		// every entry is default constructed once and then filled
+		out << "\tr.resize(l.size());\n";
+		out << "\tcconfig::list::iterator it = l.begin();\n";
+		out << "\tfor(size_t i = 0; it != l.end(); ++it, ++i)\n";
+		out << "\t{\n";
+		out << "\t\tconst cconfig::element& child_element = *it;\n";
+		if(soa_)
+		{
+			out << "\t\tlist" << u << "::row row = r[i];\n";
+			out << "\t\t";
+			spec->generate_initialization(out, "row");
+		}
+		else
+		{
+			out << "\t\t";
+			spec->generate_initialization(out, "r[i]");
+		}
+		out << "\t}\n";
+	}
+	if(has_min_)
+	{
+		out << "\tif(l.size() < " << min_ << "UL)\n";
+		out << "\t\tfail(\"" << uri_ << "\", \"List has not enough entries, need at least " << min_ << "\");\n";
+	}
+	out << "}\n\n";
 }
 
-std::string
-cconfig::schema::list::generate_config_stub(int indent) const
+void
+cconfig::schema::list::generate_config_stub(cconfig::writer& w, const std::string& key) const
 {
-	std::string s;
-
 	// we defined that there may be only one child in the schema
-	node_list_type::const_iterator it = children_.begin();
+	const node* child = children_.front();
 
 	// this may be an array or a list, so we need to make a sensible
 	// guess based on the constraints
-	if(dynamic_cast<cconfig::schema::atom*>(*it))
+	if(child->is_atom())
 	{
 		// this should be an array so we generate a dummy parameter
-		s += "[" + (*it)->generate_config_stub(indent+1) + "]";
+		w.on_array_begin(key);
+		child->generate_config_stub(w, "");
+		w.on_array_end();
 	}
 	else
 	{
 		// this must be a list and, as the child must be a group
 		// or list, we should generate a (single) stub for that as well
-		s += "(\n";
-		indent_string(s, indent+1);
-		(*it)->generate_config_stub(indent+1);
-		indent_string(s, indent); s += ")";
+		w.on_list_begin(key);
+		child->generate_config_stub(w, "");
+		w.on_list_end();
+	}
+}
+
+void
+cconfig::schema::list::generate_embedded(std::ostream& out, const cconfig::element& e,
+	const std::string& target, int indent) const
+{
+	const cconfig::list& l = e.as_list_unchecked();
+	if(l.empty())
+		return;
+
+	const cconfig::schema::node* spec = children_.front();
+	if(!spec->is_atom())
+	{
+		indent_string(out, indent);
+		out << target << ".resize(" << l.size() << ");\n";
+		cconfig::list::iterator it = l.begin();
+		for(size_t i = 0; it != l.end(); ++it, ++i)
+			spec->generate_embedded(out, *it, target + "[" + boost::lexical_cast<std::string>(i) + "]", indent);
+		return;
+	}
+
+	// arrays are copied from constant tables, which need no code to
+	// be initialized
+	const cconfig::schema::atom& a = spec->as_atom_unchecked();
+	indent_string(out, indent); out << "{\n";
+	indent_string(out, indent+1);
+	out << "static const " << (a.type_ == typeid(std::string) ? "char* const" : a.c_type_string()) << " values[] = {";
+	cconfig::list::iterator it = l.begin();
+	for(size_t i = 0; it != l.end(); ++it, ++i)
+	{
+		if(i % 8 == 0)
+		{
+			out << '\n';
+			indent_string(out, indent+2);
+		}
+		else
+			out << ' ';
+		generate_literal(out, it->as_atom_unchecked());
+		out << ',';
 	}
+	out << '\n';
+	indent_string(out, indent+1); out << "};\n";
+	indent_string(out, indent+1);
+	out << target << ".assign(values, values + " << l.size() << ");\n";
+	indent_string(out, indent); out << "}\n";
+}
 
-	return s;
+void
+cconfig::schema::atom::resolve_attribute(const std::string& name)
+{
+	if(name != "default")
+		return;
+
+	if(type_ == typeid(long))
+		default_long_ = get_attribute<long>(name);
+	else if(type_ == typeid(bool))
+		default_bool_ = get_attribute<bool>(name);
+	else if(type_ == typeid(double))
+	{
+		// integer literals are fine for floating point settings
+		if(boost::get<long>(&attributes_.find(name)->second) != NULL)
+			default_double_ = get_attribute<long>(name);
+		else
+			default_double_ = get_attribute<double>(name);
+	}
+	else if(type_ == typeid(std::string))
+		default_string_ = get_attribute<std::string>(name);
+	has_default_ = true;
 }
 
 cconfig::schema::validation_result
@@ -573,27 +828,26 @@ cconfig::schema::atom::validate(
 		const cconfig::element& e,
 		bool strict) const
 {
-	try {
-		const cconfig::atom& a = e.as_atom();
-		if(a.type() != type_)
-		{
-			std::string type_name;
-			// TODO: would be nice to have some generalized way of doing
-			// this stuff (visitor...?)
-			if(type_ == typeid(std::string))
-				type_name = "string";
-			else if(type_ == typeid(long))
-				type_name = "integer";
-			else if(type_ == typeid(bool))
-				type_name = "bool";
-			else if(type_ == typeid(double))
-				type_name = "float";
-
-			return validation_result(false, this->uri(),
-				"Type mismatch, " + type_name + " required");
-		}
-	} catch(cconfig::lookup_error&) {
+	if(!e.is_atom())
 		return validation_result(false, this->uri(), "Atom required");
+
+	const cconfig::atom& a = e.as_atom_unchecked();
+	if(a.type() != type_)
+	{
+		std::string type_name;
+		// TODO: would be nice to have some generalized way of doing
+		// this stuff (visitor...?)
+		if(type_ == typeid(std::string))
+			type_name = "string";
+		else if(type_ == typeid(long))
+			type_name = "integer";
+		else if(type_ == typeid(bool))
+			type_name = "bool";
+		else if(type_ == typeid(double))
+			type_name = "float";
+
+		return validation_result(false, this->uri(),
+			"Type mismatch, " + type_name + " required");
 	}
 
 	return validation_result(true);
@@ -615,206 +869,1710 @@ cconfig::schema::atom::c_type_string() const
 		throw std::runtime_error("Unknown error in config schema");
 }
 
-std::string
-cconfig::schema::atom::generate_declaration() const
+void
+cconfig::schema::atom::generate_declaration(std::ostream&) const
 {
-	return "";
 }
 
-std::string
-cconfig::schema::atom::generate_definition() const
+void
+cconfig::schema::atom::generate_definition(std::ostream& out) const
 {
-	// TODO: duh..., use static_visitor
-	std::string code;
-	if(type_ == typeid(std::string))
-		code += "std::string";
-	else if(type_ == typeid(long))
-		code += "long";
-	else if(type_ == typeid(bool))
-		code += "bool";
-	else if(type_ == typeid(double))
-		code += "double";
+	out << c_type_string() << " " << name_ << ";\n";
+}
 
-	code += " " + name_ + ";\n";
-	return code;
+void
+cconfig::schema::atom::generate_initialization(std::ostream& out, const std::string& target) const
+{
+	// strings are assigned into the existing member
+	if(type_ == typeid(std::string))
+	{
+		out << "get_string(child_element, \"" << uri_ << "\", " << target << ");\n";
+		return;
+	}
+	out << target << " = ";
+	generate_getter(out);
+	out << "(child_element, \"" << uri_ << "\");\n";
 }
 
-std::string
-cconfig::schema::atom::generate_initialization() const
+void
+cconfig::schema::atom::generate_getter(std::ostream& out) const
 {
 	// TODO: use static_visitor again
 	if(type_ == typeid(std::string))
-		return "generate_string(child_element, child_node)";
+		out << "get_string";
 	else if(type_ == typeid(long))
-		return "generate_long(child_element, child_node)";
+		out << "get_long";
 	else if(type_ == typeid(bool))
-		return "generate_bool(child_element, child_node)";
+		out << "get_bool";
 	else if(type_ == typeid(double))
-		return "generate_double(child_element, child_node)";
+		out << "get_double";
 	else
 		throw std::runtime_error("Unknown error in config schema");
 }
 
-std::string
-cconfig::schema::atom::generate_function() const
-{
-	return "";
-}
-
-std::string
-cconfig::schema::atom::generate_tree_builder(int& unique_id, int indent) const
+void
+cconfig::schema::atom::generate_function(std::ostream&) const
 {
-	// TODO: use static_visitor once more
-	std::string s;
-	std::string varname = "var" + boost::lexical_cast<std::string>(unique_id);
-
-	indent_string(s, indent); s += "cconfig::schema::atom* " + varname
-		+ " = new cconfig::schema::atom(";
-	if(type_ == typeid(long))
-		s += "typeid(long)";
-	else if(type_ == typeid(bool))
-		s += "typeid(bool)";
-	else if(type_ == typeid(double))
-		s += "typeid(double)";
-	else if(type_ == typeid(std::string))
-		s += "typeid(std::string)";
-	s += ");\n";
-
-	s += generate_common_tree_initialization(unique_id, indent);
-	
-	return s;
 }
 
-std::string
-cconfig::schema::atom::generate_config_stub(int indent) const
+void
+cconfig::schema::atom::generate_config_stub(cconfig::writer& w, const std::string& key) const
 {
 	// TODO: use static_visitor for god's sake
-	std::string s;
-	
 	if(type_ == typeid(long))
-		s += "0";
+		w.on_atom(key, cconfig::atom(0L));
 	else if(type_ == typeid(bool))
-		s += "false";
+		w.on_atom(key, cconfig::atom(false));
 	else if(type_ == typeid(double))
-		s += "0.0";
+		w.on_atom(key, cconfig::atom(0.0));
 	else if(type_ == typeid(std::string))
-		s += "\"\"";
-	
-	return s;
+		w.on_atom(key, cconfig::atom(boost::string_ref()));
 }
 
 void
-cconfig::schema::schema::load(const std::string& filename)
-{
-	ConfigSchemaLexer::InputStreamType input(reinterpret_cast<const ANTLR_UINT8*>(filename.c_str()), ANTLR_ENC_8BIT);
-	ConfigSchemaLexer lexer(&input);
-	ConfigSchemaParser::TokenStreamType tokens(ANTLR_SIZE_HINT, lexer.get_tokSource());
-	ConfigSchemaParser parser(&tokens);
-
-	root_ = parser.file();
-}
-
-cconfig::schema::validation_result
-cconfig::schema::schema::validate(
-		cconfig::file& config,
-		bool strict)
+cconfig::schema::atom::generate_embedded(std::ostream& out, const cconfig::element& e,
+	const std::string& target, int indent) const
 {
-	return root_->validate(config.root(), strict);
+	indent_string(out, indent);
+	out << target << " = ";
+	generate_literal(out, e.as_atom_unchecked());
+	out << ";\n";
 }
 
 void
-cconfig::schema::schema::generate_wrapper(
-	const std::string& basename,
-	const std::string& targetdir,
-	const std::string& includepath) const
+cconfig::schema::validator::compile(const group& root)
 {
-	// YUCK!!!
-	std::string header;
-	header += "// THIS FILE HAS BEEN GENERATED FROM THE SCHEMA FILE\n";
-	header += "// DO NOT CHANGE THIS FILE IN ANY CASE!!\n\n";
-	header += "#ifndef CONFIG_WRAPPER_H_\n";
-	header += "#define CONFIG_WRAPPER_H_\n\n";
-	header += "#include \"" + includepath + "config_file.hpp\"\n";
-	header += "#include \"" + includepath + "config_schema.hpp\"\n\n";
-	header += "#include <stdexcept>\n";
-	header += "#include <string>\n";
-	header += "#include <vector>\n\n";
-	header += "namespace cconfig { namespace wrapper {\n\n";
-	header += "class validation_error : public std::runtime_error\n";
-	header += "{\n";
-	header += "public:\n";
-	header += "\tvalidation_error(const std::string& what) :\n";
-	header += "\t\tstd::runtime_error(what) {}\n";
-	header += "};\n\n";
-	header += root_->generate_declaration();
-	header += "Config load_config(const std::string& config_filename);\n";
-	header += "cconfig::schema::schema* generate_schema();\n\n";
-	header += "}}\n\n";
-	header += "#endif\n";
-
-	std::ofstream header_file((targetdir + "/" + basename + ".hpp").c_str());
-	header_file << header;
-	header_file.close();
-
-	std::string cpp;
-	cpp += "// THIS FILE HAS BEEN GENERATED FROM THE SCHEMA FILE\n";
-	cpp += "// DO NOT CHANGE THIS FILE IN ANY CASE!!\n\n";
-	cpp += "#include \"" + basename + ".hpp\"\n\n";
-	cpp += "namespace {\n\n";
-	cpp += "using namespace cconfig::wrapper;\n\n";
-	cpp += "std::string generate_string(const cconfig::element& e, cconfig::schema::node*) { return e.as<std::string>(); }\n";
-	cpp += "std::string generate_string(const cconfig::element& e, cconfig::schema::node*, const std::string& d) { try { return e.as<std::string>(); } catch(...) { return d; } }\n";
-	cpp += "long generate_long(const cconfig::element& e, cconfig::schema::node*) { return e.as<long>(); }\n";
-	cpp += "long generate_long(const cconfig::element& e, cconfig::schema::node*, long d) { try { return e.as<long>(); } catch(...) { return d; } }\n";
-	cpp += "bool generate_bool(const cconfig::element& e, cconfig::schema::node*) { return e.as<bool>(); }\n";
-	cpp += "bool generate_bool(const cconfig::element& e, cconfig::schema::node*, bool d) { try { return e.as<bool>(); } catch(...) { return d; } }\n";
-	cpp += "double generate_double(const cconfig::element& e, cconfig::schema::node*) { return e.as<double>(); }\n";
-	cpp += "double generate_double(const cconfig::element& e, cconfig::schema::node*, double d) { try { return e.as<double>(); } catch(...) { return d; } }\n\n";
-	cpp += root_->generate_function();
-	cpp += "\n}\n\n";
-	cpp += "\ncconfig::wrapper::Config cconfig::wrapper::load_config(const std::string& config_filename)\n";
-	cpp += "{\n";
-	cpp += "\tcconfig::file* f = new cconfig::file;\n";
-	cpp += "\tf->load(config_filename);\n\n";
-	cpp += "\tcconfig::schema::schema* s = generate_schema();\n";
-	cpp += "\tcconfig::schema::validation_result r = s->validate(*f, true);\n\n";
-	cpp += "\tif(!r.valid)\n";
-	cpp += "\t\tthrow validation_error(\"Validation failed at \" + ((r.error_uri == \"/\")?\"root level\":r.error_uri) + \": \" + r.error_message);\n\n";
-	cpp += "\tcconfig::wrapper::Config c = generate_Config(f->root(), s->root());\n";
-	cpp += "\tc.file_ = f;\n";
-	cpp += "\tdelete s;\n";
-	cpp += "\treturn c;\n";
-	cpp += "}\n\n";
-	cpp += "cconfig::schema::schema* cconfig::wrapper::generate_schema()\n";
-	cpp += "{\n";
-	int unique_id = 0;
-	cpp += root_->generate_tree_builder(unique_id, 1);
-	cpp += "\n\tcconfig::schema::schema* s = new cconfig::schema::schema;\n";
-	cpp += "\ts->set(var0);\n";
-	cpp += "\treturn s;\n";
-	cpp += "}\n\n";
-
-	std::ofstream cpp_file((targetdir + "/" + basename + ".cpp").c_str());
-	cpp_file << cpp;
-	cpp_file.close();
+	program_.clear();
+	program_.resize(1);
+	compile_node(root, 0);
 }
 
 void
-cconfig::schema::schema::generate_config_stub(const std::string& outputfile) const
+cconfig::schema::validator::compile_node(const node& n, size_t index)
 {
-	std::ofstream stub_file(outputfile.c_str());
-	std::string s;
-
-	for(cconfig::schema::group::node_map_type::const_iterator it = root_->children_.begin();
-		it != root_->children_.end(); ++it)
+	// the children of a node are appended as one block before
+	// descending into them, which keeps them adjacent
+	instruction ins;
+	ins.kind = n.kind();
+	ins.type = no_value;
+	ins.required = n.required_;
+	ins.has_min = false;
+	ins.min = 0;
+	ins.name = n.name_;
+	ins.hash = cconfig::util::hash_key(n.name_);
+	ins.uri = n.uri();
+	ins.first = program_.size();
+	ins.count = 0;
+
+	if(n.is_group())
 	{
-		s += it->first
-			+ " = "
-			+ it->second->generate_config_stub(0)
-			+ ";\n";
+		const group& g = n.as_group_unchecked();
+		ins.count = g.children_.size();
+		program_.resize(ins.first + ins.count);
+
+		size_t i = ins.first;
+		for(group::node_map_type::const_iterator it = g.children_.begin();
+			it != g.children_.end(); ++it, ++i)
+		{
+			compile_node(*it->second, i);
+		}
 	}
+	else if(n.is_list())
+	{
+		const list& l = n.as_list_unchecked();
+		ins.has_min = l.has_min_;
+		ins.min = l.min_;
 
-	stub_file << s;
-	stub_file.close();
+		// only the first child is used, see list::validate()
+		if(!l.children_.empty())
+		{
+			ins.count = 1;
+			program_.resize(ins.first + 1);
+			compile_node(*l.children_.front(), ins.first);
+		}
+	}
+	else
+	{
+		const std::type_info& type = n.as_atom_unchecked().type_;
+		if(type == typeid(long))
+			ins.type = long_value;
+		else if(type == typeid(double))
+			ins.type = double_value;
+		else if(type == typeid(bool))
+			ins.type = bool_value;
+		else if(type == typeid(std::string))
+			ins.type = string_value;
+	}
+
+	program_[index] = ins;
+}
+
+cconfig::schema::validation_result
+cconfig::schema::validator::validate(
+		const cconfig::element& e,
+		bool strict) const
+{
+	validation_options options;
+	options.strict = strict;
+	return execute(e, options, NULL);
+}
+
+cconfig::schema::validation_result
+cconfig::schema::validator::validate(
+		const cconfig::element& e,
+		bool strict,
+		error_list& errors) const
+{
+	validation_options options;
+	options.strict = strict;
+	return execute(e, options, &errors);
+}
+
+cconfig::schema::validation_result
+cconfig::schema::validator::validate(
+		const cconfig::element& e,
+		const validation_options& options) const
+{
+	return execute(e, options, NULL);
+}
+
+cconfig::schema::validation_result
+cconfig::schema::validator::validate(
+		const cconfig::element& e,
+		const validation_options& options,
+		error_list& errors) const
+{
+	return execute(e, options, &errors);
+}
+
+cconfig::schema::validation_result
+cconfig::schema::validator::execute(
+		const cconfig::element& e,
+		const validation_options& options,
+		error_list* errors) const
+{
+	const unsigned int threads = options.threads != 0
+		? options.threads : std::max(1u, boost::thread::hardware_concurrency());
+
+	context c(options, threads, errors);
+	if(program_.empty())
+		fail(c, "/", "No schema loaded");
+	else
+		run(0, e, c);
+	return c.result;
+}
+
+bool
+cconfig::schema::validator::fail(
+		context& c,
+		const std::string& uri,
+		const std::string& message)
+{
+	if(c.result.valid)
+		c.result = validation_result(false, uri, message);
+	if(c.errors == NULL)
+		return false;
+
+	c.errors->push_back(validation_result(false, uri, message));
+	return true;
+}
+
+bool
+cconfig::schema::validator::run(
+		size_t index,
+		const cconfig::element& e,
+		context& c) const
+{
+	const instruction& ins = program_[index];
+	switch(ins.kind)
+	{
+	case node::group_kind:
+		return run_group(ins, e, c);
+	case node::list_kind:
+		return run_list(ins, e, c);
+	default:
+		break;
+	}
+
+	if(!e.is_atom())
+		return fail(c, ins.uri, "Atom required");
+
+	const cconfig::atom& a = e.as_atom_unchecked();
+	value_type type = no_value;
+	if(a.is_long())
+		type = long_value;
+	else if(a.is_double())
+		type = double_value;
+	else if(a.is_bool())
+		type = bool_value;
+	else if(a.is_string())
+		type = string_value;
+
+	return check_value(ins, type, c);
+}
+
+bool
+cconfig::schema::validator::run_group(
+		const instruction& ins,
+		const cconfig::element& e,
+		context& c) const
+{
+	if(!e.is_group())
+		return fail(c, ins.uri, "Group required");
+	const cconfig::group& g = e.as_group_unchecked();
+
+	size_t matched = 0;
+	const size_t end = ins.first + ins.count;
+	cconfig::group::iterator next = g.begin();
+	for(size_t i = ins.first; i < end; ++i)
+	{
+		const instruction& child = program_[i];
+		// settings written in schema order are matched by walking both
+		// sequences in step, anything else is found through the index
+		const cconfig::element* setting;
+		if(next != g.end() && next->key->hash == child.hash && next->key->name == child.name)
+		{
+			setting = (next++)->value;
+		}
+		else
+		{
+			setting = g.get_if(child.name, child.hash);
+			// resynchronize after a single setting unknown to the schema
+			if(setting != NULL && next != g.end() && next + 1 != g.end() && (next + 1)->value == setting)
+				next += 2;
+		}
+		if(setting == NULL)
+		{
+			if(child.required && !fail(c, ins.uri,
+					"Missing required attribute '" + child.name + "'"))
+				return false;
+			continue;
+		}
+
+		++matched;
+		if(!run(i, *setting, c))
+			return false;
+	}
+
+	// keys are unique within a group, so every setting has been
+	// matched unless the counts differ; only then the offending
+	// key needs to be searched for
+	if(c.strict && matched != g.size())
+	{
+		for(cconfig::group::iterator git = g.begin(); git != g.end(); ++git)
+		{
+			size_t i = ins.first;
+			while(i < end && program_[i].name != git->key->name)
+				++i;
+			if(i == end && !fail(c, ins.uri,
+					"Attribute '" + git->key->name.to_string() + "' not found in schema "
+					+ "(strict validation). This might possibly be a typo."))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool
+cconfig::schema::validator::run_list(
+		const instruction& ins,
+		const cconfig::element& e,
+		context& c) const
+{
+	if(!e.is_list())
+		return fail(c, ins.uri, "List required");
+	const cconfig::list& l = e.as_list_unchecked();
+
+	if(ins.count != 0 && !l.empty())
+	{
+		const instruction& child = program_[ins.first];
+		switch(l.storage())
+		{
+		// typed arrays are checked as a whole by their storage type,
+		// which avoids creating atoms for their values
+		case cconfig::list::long_storage:
+			if(!check_value(child, long_value, c))
+				return false;
+			break;
+		case cconfig::list::double_storage:
+			if(!check_value(child, double_value, c))
+				return false;
+			break;
+		case cconfig::list::bool_storage:
+			if(!check_value(child, bool_value, c))
+				return false;
+			break;
+		default:
+			if(c.threads > 1 && l.size() >= c.parallel_threshold)
+			{
+				if(!run_parallel(ins.first, l, c))
+					return false;
+				break;
+			}
+
+			for(cconfig::list::iterator it = l.begin(); it != l.end(); ++it)
+			{
+				if(!run(ins.first, *it, c))
+					return false;
+			}
+			break;
+		}
+	}
+
+	if(ins.has_min && l.size() < ins.min)
+		return fail(c, ins.uri,
+			"List has not enough entries, need at least " +
+			boost::lexical_cast<std::string>(ins.min)
+		);
+
+	return true;
+}
+
+struct cconfig::schema::validator::list_job
+{
+	/** Chunks smaller than this are not worth a thread switch */
+	static size_t min_chunk_size() { return 256; }
+
+	list_job(size_t _index, const cconfig::list& l, const context& c) :
+		index(_index),
+		begin(l.begin()),
+		size(l.size()),
+		chunk_size(std::max(size / (8 * c.threads), min_chunk_size())),
+		count((size + chunk_size - 1) / chunk_size),
+		errors(c.errors != NULL ? count : 0),
+		next(0),
+		failed(count)
+	{
+		// nested lists are validated sequentially by the thread
+		// owning the chunk
+		validation_options options;
+		options.strict = c.strict;
+		options.parallel_threshold = c.parallel_threshold;
+
+		parts.reserve(count);
+		for(size_t i = 0; i < count; ++i)
+			parts.push_back(context(options, 1, c.errors != NULL ? &errors[i] : NULL));
+	}
+
+	size_t index;
+	cconfig::list::iterator begin;
+	size_t size;
+	size_t chunk_size;
+	size_t count;
+
+	std::vector<context> parts;
+	std::vector<error_list> errors;
+
+	/** Next chunk to be validated */
+	boost::atomic<size_t> next;
+	/** Earliest chunk that failed in first error mode */
+	boost::atomic<size_t> failed;
+};
+
+bool
+cconfig::schema::validator::run_parallel(
+		size_t index,
+		const cconfig::list& l,
+		context& c) const
+{
+	list_job job(index, l, c);
+
+	const unsigned int workers = static_cast<unsigned int>(std::min<size_t>(c.threads, job.count));
+	boost::thread_group pool;
+	for(unsigned int i = 1; i < workers; ++i)
+		pool.create_thread(boost::bind(&validator::run_chunks, this, boost::ref(job)));
+	run_chunks(job);
+	pool.join_all();
+
+	// merging in chunk order yields the result of sequential
+	// validation, chunks after the first failed one have been
+	// cancelled unless all errors are collected
+	for(size_t i = 0; i < job.count; ++i)
+	{
+		const context& part = job.parts[i];
+		if(c.errors != NULL)
+			c.errors->insert(c.errors->end(), job.errors[i].begin(), job.errors[i].end());
+		if(!part.result.valid)
+		{
+			if(c.result.valid)
+				c.result = part.result;
+			if(c.errors == NULL)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void
+cconfig::schema::validator::run_chunks(list_job& job) const
+{
+	// chunks are taken in ascending order, so all chunks before a
+	// failed one are validated even if later ones are skipped
+	for(;;)
+	{
+		const size_t chunk = job.next.fetch_add(1);
+		if(chunk >= job.count || chunk > job.failed.load(boost::memory_order_relaxed))
+			return;
+
+		context& part = job.parts[chunk];
+		const size_t end = std::min(job.size, (chunk + 1) * job.chunk_size);
+		for(size_t i = chunk * job.chunk_size; i < end; ++i)
+		{
+			if(job.failed.load(boost::memory_order_relaxed) < chunk)
+				break;
+			if(!run(job.index, *(job.begin + i), part))
+			{
+				size_t failed = job.failed.load(boost::memory_order_relaxed);
+				while(chunk < failed && !job.failed.compare_exchange_weak(failed, chunk, boost::memory_order_relaxed))
+					;
+				break;
+			}
+		}
+	}
+}
+
+bool
+cconfig::schema::validator::check_value(
+		const instruction& ins,
+		value_type type,
+		context& c) const
+{
+	if(ins.kind == node::group_kind)
+		return fail(c, ins.uri, "Group required");
+	if(ins.kind == node::list_kind)
+		return fail(c, ins.uri, "List required");
+	if(type == ins.type)
+		return true;
+
+	const char* type_name = "";
+	switch(ins.type)
+	{
+	case long_value:   type_name = "integer"; break;
+	case double_value: type_name = "float"; break;
+	case bool_value:   type_name = "bool"; break;
+	case string_value: type_name = "string"; break;
+	default: break;
+	}
+
+	return fail(c, ins.uri,
+		std::string("Type mismatch, ") + type_name + " required");
+}
+
+namespace {
+
+/**
+ * @brief Writes binary data as a string literal split across lines
+ *
+ * Printable characters are kept so that keys remain readable, all
+ * other bytes become octal escapes of fixed width.
+ */
+void
+generate_string_literal(std::ostream& out, const std::string& data)
+{
+	std::string line;
+	for(size_t i = 0; i < data.size(); ++i)
+	{
+		const unsigned char c = data[i];
+		if(c == '"' || c == '\\' || c == '?' || c < 0x20 || c >= 0x7f)
+		{
+			char octal[8];
+			std::sprintf(octal, "\\%03o", static_cast<unsigned int>(c));
+			line += octal;
+		}
+		else
+			line += static_cast<char>(c);
+
+		if(line.size() >= 80 || i + 1 == data.size())
+		{
+			out << "\t\"" << line << "\"\n";
+			line.clear();
+		}
+	}
+}
+
+/**
+ * @brief Writes a file unless it already has the given content
+ *
+ * @return True if the file has been written
+ */
+bool
+write_if_changed(const std::string& filename, const std::string& content)
+{
+	{
+		std::ifstream in(filename.c_str(), std::ios::binary);
+		if(in)
+		{
+			// a different size means different content, so the old file
+			// is only read when it could match
+			in.seekg(0, std::ios::end);
+			if(in.tellg() == static_cast<std::streamoff>(content.size()))
+			{
+				in.seekg(0, std::ios::beg);
+				std::string existing;
+				existing.resize(content.size());
+				if(!existing.empty())
+					in.read(&existing[0], existing.size());
+				if(in && existing == content)
+					return false;
+			}
+		}
+	}
+
+	std::ofstream out(filename.c_str(), std::ios::binary);
+	out << content;
+	out.close();
+	if(!out)
+		throw cconfig::schema::exception("Unable to write " + filename);
+	return true;
+}
+
+cconfig::schema::group*
+parse_schema(ConfigSchemaLexer::InputStreamType& input)
+{
+	ConfigSchemaLexer lexer(&input);
+	ConfigSchemaParser::TokenStreamType tokens(ANTLR_SIZE_HINT, lexer.get_tokSource());
+	ConfigSchemaParser parser(&tokens);
+
+	return parser.file();
+}
+
+/*
+ * Compiled schemas use the little endian words of compiled configs
+ * (see config_binary.hpp). The header holds the signature "CCONFS\0\1",
+ * the format version and the size of the node data in bytes, which is
+ * followed by the tree in preorder. Every node consists of
+ * - its kind, atoms have their value type in the second byte
+ * - the required flag as given in the schema
+ * - the number of attributes and a (name, value type, value) triple
+ *   for each of them; 64 bit values take two words (low word first),
+ *   doubles are stored as their bit pattern to read back exactly
+ * - groups: the number of children and a (key, node) pair for each
+ * - lists: the number of children and their nodes
+ * Strings are written as their size followed by the bytes.
+ */
+const char schema_signature[8] = { 'C', 'C', 'O', 'N', 'F', 'S', '\0', '\1' };
+const boost::uint32_t schema_format_version = 1;
+const size_t schema_header_size = 16;
+
+enum schema_value_type { long_type = 1, bool_type, double_type, string_type };
+
+boost::uint32_t
+checked_size(size_t size)
+{
+	if(size > std::numeric_limits<boost::uint32_t>::max())
+		throw cconfig::schema::exception("Schema too large to be compiled");
+	return static_cast<boost::uint32_t>(size);
+}
+
+class schema_writer :
+	public boost::static_visitor<void>
+{
+public:
+	void write(const cconfig::schema::node& n)
+	{
+		boost::uint32_t kind = n.kind();
+		if(n.is_atom())
+			kind |= value_type_of(n.as_atom_unchecked().type_) << 8;
+		put_word(kind);
+		put_word(n.required_ ? 1 : 0);
+
+		put_word(checked_size(n.attributes_.size()));
+		for(cconfig::schema::node::attribute_map_type::const_iterator it = n.attributes_.begin();
+			it != n.attributes_.end(); ++it)
+		{
+			put_string(it->first);
+			boost::apply_visitor(*this, it->second);
+		}
+
+		if(n.is_group())
+		{
+			const cconfig::schema::group& g = n.as_group_unchecked();
+			put_word(checked_size(g.children_.size()));
+			for(cconfig::schema::group::node_map_type::const_iterator it = g.children_.begin();
+				it != g.children_.end(); ++it)
+			{
+				put_string(it->first);
+				write(*it->second);
+			}
+		}
+		else if(n.is_list())
+		{
+			const cconfig::schema::list& l = n.as_list_unchecked();
+			put_word(checked_size(l.children_.size()));
+			for(cconfig::schema::list::node_list_type::const_iterator it = l.children_.begin();
+				it != l.children_.end(); ++it)
+				write(**it);
+		}
+	}
+
+	void finish(std::ostream& out) const
+	{
+		std::string header(schema_signature, sizeof(schema_signature));
+		cconfig::binary::detail::put_word(header, schema_format_version);
+		cconfig::binary::detail::put_word(header, checked_size(data_.size()));
+		out.write(header.data(), header.size());
+		out.write(data_.data(), data_.size());
+		if(!out)
+			throw cconfig::schema::exception("Unable to write compiled schema");
+	}
+
+	void operator()(long x)
+	{
+		put_word(long_type);
+		put_64(static_cast<boost::uint64_t>(static_cast<boost::int64_t>(x)));
+	}
+
+	void operator()(bool x)
+	{
+		put_word(bool_type);
+		put_word(x ? 1 : 0);
+	}
+
+	void operator()(double x)
+	{
+		boost::uint64_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+		put_word(double_type);
+		put_64(bits);
+	}
+
+	void operator()(const std::string& x)
+	{
+		put_word(string_type);
+		put_string(x);
+	}
+
+private:
+	static boost::uint32_t value_type_of(const std::type_info& type)
+	{
+		if(type == typeid(long))
+			return long_type;
+		if(type == typeid(bool))
+			return bool_type;
+		if(type == typeid(double))
+			return double_type;
+		return string_type;
+	}
+
+	void put_word(boost::uint32_t w) { cconfig::binary::detail::put_word(data_, w); }
+
+	void put_64(boost::uint64_t v)
+	{
+		put_word(static_cast<boost::uint32_t>(v));
+		put_word(static_cast<boost::uint32_t>(v >> 32));
+	}
+
+	void put_string(const std::string& s)
+	{
+		put_word(checked_size(s.size()));
+		data_.append(s);
+	}
+
+	std::string data_;
+};
+
+class schema_reader
+{
+public:
+	schema_reader(const char* data, size_t size, const std::string& name) :
+		pos_(data), end_(data + size), name_(name)
+	{}
+
+	cconfig::schema::group* read()
+	{
+		if(static_cast<size_t>(end_ - pos_) < schema_header_size
+			|| std::memcmp(pos_, schema_signature, sizeof(schema_signature)) != 0)
+			fail("not a compiled schema");
+		pos_ += sizeof(schema_signature);
+		if(get_word() != schema_format_version)
+			fail("unsupported format version");
+		if(get_word() != static_cast<size_t>(end_ - pos_))
+			fail("truncated data");
+
+		cconfig::schema::node* root = read_node();
+		if(!root->is_group())
+		{
+			delete root;
+			fail("root is not a group");
+		}
+		if(pos_ != end_)
+		{
+			delete root;
+			fail("trailing data");
+		}
+		return &root->as_group_unchecked();
+	}
+
+private:
+	/** Children are attached once they are complete, like in the parser */
+	cconfig::schema::node* read_node()
+	{
+		const boost::uint32_t kind = get_word();
+		const bool required = get_word() != 0;
+
+		cconfig::schema::node* n = NULL;
+		switch(kind & 0xff)
+		{
+		case cconfig::schema::node::group_kind: n = new cconfig::schema::group(); break;
+		case cconfig::schema::node::list_kind: n = new cconfig::schema::list(); break;
+		case cconfig::schema::node::atom_kind:
+			switch(kind >> 8)
+			{
+			case long_type: n = new cconfig::schema::atom(typeid(long)); break;
+			case bool_type: n = new cconfig::schema::atom(typeid(bool)); break;
+			case double_type: n = new cconfig::schema::atom(typeid(double)); break;
+			case string_type: n = new cconfig::schema::atom(typeid(std::string)); break;
+			default: fail("unknown value type");
+			}
+			break;
+		default: fail("unknown node kind");
+		}
+
+		try {
+			n->required_ = required;
+			read_attributes(*n);
+			if(n->is_group())
+				read_children(n->as_group_unchecked());
+			else if(n->is_list())
+				read_children(n->as_list_unchecked());
+		} catch(...) {
+			delete n;
+			throw;
+		}
+		return n;
+	}
+
+	void read_attributes(cconfig::schema::node& n)
+	{
+		for(boost::uint32_t count = get_word(); count > 0; --count)
+		{
+			const std::string name = get_string();
+			switch(get_word())
+			{
+			case long_type:
+			{
+				const boost::int64_t v = static_cast<boost::int64_t>(get_64());
+				if(v < std::numeric_limits<long>::min() || v > std::numeric_limits<long>::max())
+					fail("integer out of range");
+				n.add_attribute(name, static_cast<long>(v));
+				break;
+			}
+			case bool_type: n.add_attribute(name, get_word() != 0); break;
+			case double_type:
+			{
+				const boost::uint64_t bits = get_64();
+				double v;
+				std::memcpy(&v, &bits, sizeof(v));
+				n.add_attribute(name, v);
+				break;
+			}
+			case string_type: n.add_attribute(name, get_string()); break;
+			default: fail("unknown attribute type");
+			}
+		}
+	}
+
+	void read_children(cconfig::schema::group& g)
+	{
+		for(boost::uint32_t count = get_word(); count > 0; --count)
+		{
+			const std::string key = get_string();
+			cconfig::schema::node* child = read_node();
+			if(g.children_.find(key) != g.children_.end())
+			{
+				delete child;
+				fail("duplicate key");
+			}
+			// the flag of the child is passed on to the group
+			g.add_child(key, child, false);
+		}
+	}
+
+	void read_children(cconfig::schema::list& l)
+	{
+		for(boost::uint32_t count = get_word(); count > 0; --count)
+			l.add_child(read_node());
+	}
+
+	boost::uint32_t get_word()
+	{
+		if(end_ - pos_ < 4)
+			fail("truncated data");
+		const boost::uint32_t w = cconfig::binary::detail::get_word(pos_);
+		pos_ += 4;
+		return w;
+	}
+
+	boost::uint64_t get_64()
+	{
+		const boost::uint64_t low = get_word();
+		return low | (static_cast<boost::uint64_t>(get_word()) << 32);
+	}
+
+	std::string get_string()
+	{
+		const boost::uint32_t size = get_word();
+		if(static_cast<size_t>(end_ - pos_) < size)
+			fail("truncated data");
+		const char* begin = pos_;
+		pos_ += size;
+		return std::string(begin, size);
+	}
+
+	void fail(const char* message) const
+	{
+		throw cconfig::schema::exception(std::string("Invalid compiled schema, ") + message + " (" + name_ + ")");
+	}
+
+	const char* pos_;
+	const char* end_;
+	std::string name_;
+};
+
+
+/**
+ * @brief Generates the direct parser of a schema, see schema::generate_parser()
+ *
+ * The nodes are numbered in preorder starting with 1 for the root,
+ * the number of a group or list is the state of its parser frame and
+ * 0 stands for values that are skipped.
+ */
+class parser_generator
+{
+public:
+	explicit parser_generator(const cconfig::schema::group& root) :
+		seen_words_(1),
+		depth_(0)
+	{
+		nodes_.push_back(NULL);
+		number(root, 1);
+	}
+
+	void generate(std::ostream& out) const
+	{
+		out << "// nodes by number, 0 stands for skipped values\n";
+		out << "const node_info nodes[] = {\n";
+		out << "\t{ \"\", \"\", NULL },\n";
+		for(size_t i = 1; i < nodes_.size(); ++i)
+		{
+			const cconfig::schema::node& n = *nodes_[i];
+			out << "\t{ \"" << n.uri_ << "\", ";
+			if(n.is_group())
+				out << "\"Group required\", NULL";
+			else if(n.is_list())
+				out << "\"List required\", NULL";
+			else
+				out << "\"Atom required\", \"Type mismatch, " << type_name(n.as_atom_unchecked()) << " required\"";
+			out << " },\n";
+		}
+		out << "};\n\n";
+
+		out << "/**\n";
+		out << " * Parser handler writing the settings into a Config, with one frame\n";
+		out << " * for every open group or list\n";
+		out << " */\n";
+		out << "class config_handler\n";
+		out << "{\n";
+		out << "public:\n";
+		out << "\texplicit config_handler(Config& config) :\n";
+		out << "\t\tnext_(0)\n";
+		out << "\t{\n";
+		out << "\t\tstack_.reserve(" << depth_ + 1 << ");\n";
+		out << "\t\tpush(1, -1, &config);\n";
+		out << "\t}\n\n";
+
+		generate_key(out);
+
+		out << "\tvoid begin_group()\n";
+		out << "\t{\n";
+		generate_dispatch_begin(out);
+		for(size_t i = 1; i < nodes_.size(); ++i)
+		{
+			if(!nodes_[i]->is_group() || nodes_[i]->parent_ == NULL)
+				continue;
+			const cconfig::schema::node& n = *nodes_[i];
+			const cconfig::schema::node& p = *n.parent_;
+			out << "\t\tcase " << i << ": // " << n.uri_ << "\n";
+			if(p.is_list() && p.as_list_unchecked().soa_)
+			{
+				// the frame of a row refers to the list, members are the
+				// last entries of its columns
+				out << "\t\t\tappend_row(*static_cast<list" << p.uri_safe_ << "*>(t));\n";
+				out << "\t\t\tpush(" << i << ", -1, t);\n";
+			}
+			else
+				out << "\t\t\tpush(" << i << ", -1, &" << lvalue(n) << ");\n";
+			out << "\t\t\tbreak;\n";
+		}
+		generate_dispatch_end(out, "wrong_kind");
+
+		out << "\tvoid begin_list()\n";
+		out << "\t{\n";
+		generate_dispatch_begin(out);
+		for(size_t i = 1; i < nodes_.size(); ++i)
+		{
+			if(!nodes_[i]->is_list())
+				continue;
+			const cconfig::schema::list& l = nodes_[i]->as_list_unchecked();
+			out << "\t\tcase " << i << ": // " << l.uri_ << "\n";
+			out << "\t\t\tpush(" << i << ", " << id(l.children_.front()) << ", &" << lvalue(l) << ");\n";
+			out << "\t\t\tbreak;\n";
+		}
+		generate_dispatch_end(out, "wrong_kind");
+
+		out << "\t// arrays are lists with elements of the same type\n";
+		out << "\tvoid begin_array() { begin_list(); }\n\n";
+		out << "\tvoid end_group() { close(); }\n";
+		out << "\tvoid end_list() { close(); }\n";
+		out << "\tvoid end_array() { close(); }\n\n";
+
+		generate_atom(out, "integer", typeid(long), "const long v = cconfig::tree_builder::to_long(text);");
+		generate_atom(out, "floating_point", typeid(double), "const double v = cconfig::tree_builder::to_double(text);");
+		generate_atom(out, "boolean", typeid(bool), "const bool v = text == \"true\";");
+		generate_atom(out, "string", typeid(std::string), "");
+
+		out << "\tvoid include(boost::string_ref)\n";
+		out << "\t{\n";
+		out << "\t\tthrow cconfig::parse_error(\"Include directives are not supported here\");\n";
+		out << "\t}\n\n";
+
+		out << "\t/** Checks the root group at the end of the input */\n";
+		out << "\tvoid finish() { check(stack_.front()); }\n\n";
+
+		out << "private:\n";
+		out << "\tstruct frame\n";
+		out << "\t{\n";
+		out << "\t\tint node;\n";
+		out << "\t\t/** Node of the elements of lists, -1 for groups */\n";
+		out << "\t\tint element;\n";
+		out << "\t\tvoid* target;\n";
+		out << "\t\tsize_t count;\n";
+		out << "\t\t/** First key that is not in the schema */\n";
+		out << "\t\tboost::string_ref unknown;\n";
+		out << "\t\t/** Bit set of the members defined so far */\n";
+		out << "\t\tboost::uint64_t seen[" << seen_words_ << "];\n";
+		out << "\t};\n\n";
+
+		out << "\tvoid push(int node, int element, void* target)\n";
+		out << "\t{\n";
+		out << "\t\tframe f;\n";
+		out << "\t\tf.node = node;\n";
+		out << "\t\tf.element = element;\n";
+		out << "\t\tf.target = target;\n";
+		out << "\t\tf.count = 0;\n";
+		out << "\t\tstd::fill(f.seen, f.seen + " << seen_words_ << ", 0);\n";
+		out << "\t\tstack_.push_back(f);\n";
+		out << "\t}\n\n";
+
+		out << "\tvoid close()\n";
+		out << "\t{\n";
+		out << "\t\tcheck(stack_.back());\n";
+		out << "\t\tstack_.pop_back();\n";
+		out << "\t}\n\n";
+
+		out << "\t/** Values in lists belong to the element node, in groups to the last key */\n";
+		out << "\tint take_node()\n";
+		out << "\t{\n";
+		out << "\t\tframe& f = stack_.back();\n";
+		out << "\t\tif(f.element < 0)\n";
+		out << "\t\t\treturn next_;\n";
+		out << "\t\t++f.count;\n";
+		out << "\t\treturn f.element;\n";
+		out << "\t}\n\n";
+
+		out << "\t/** Repeated definitions are ignored like by the tree builder */\n";
+		out << "\tvoid define(frame& f, size_t member, int node)\n";
+		out << "\t{\n";
+		out << "\t\tboost::uint64_t& word = f.seen[member / 64];\n";
+		out << "\t\tconst boost::uint64_t bit = static_cast<boost::uint64_t>(1) << (member % 64);\n";
+		out << "\t\tif((word & bit) != 0)\n";
+		out << "\t\t\treturn;\n";
+		out << "\t\tword |= bit;\n";
+		out << "\t\tnext_ = node;\n";
+		out << "\t}\n\n";
+
+		out << "\tstatic bool defined(const frame& f, size_t member)\n";
+		out << "\t{\n";
+		out << "\t\treturn (f.seen[member / 64] & (static_cast<boost::uint64_t>(1) << (member % 64))) != 0;\n";
+		out << "\t}\n\n";
+
+		generate_check(out);
+
+		out << "\tstd::vector<frame> stack_;\n";
+		out << "\t/** Node of the value following the last key */\n";
+		out << "\tint next_;\n";
+		out << "};\n\n";
+	}
+
+private:
+	void number(const cconfig::schema::node& n, size_t depth)
+	{
+		ids_[&n] = static_cast<int>(nodes_.size());
+		nodes_.push_back(&n);
+		depth_ = std::max(depth_, depth);
+
+		if(n.is_group())
+		{
+			const cconfig::schema::group& g = n.as_group_unchecked();
+			seen_words_ = std::max(seen_words_, (g.children_.size() + 63) / 64);
+			for(cconfig::schema::group::node_map_type::const_iterator it = g.children_.begin(); it != g.children_.end(); ++it)
+				number(*it->second, depth + 1);
+		}
+		else if(n.is_list())
+		{
+			const cconfig::schema::list& l = n.as_list_unchecked();
+			if(l.children_.empty())
+				throw cconfig::schema::exception("List without element type (" + l.uri_ + ")");
+			number(*l.children_.front(), depth + 1);
+		}
+	}
+
+	int id(const cconfig::schema::node* n) const { return ids_.find(n)->second; }
+
+	static const char* type_name(const cconfig::schema::atom& a)
+	{
+		if(a.type_ == typeid(long))
+			return "integer";
+		if(a.type_ == typeid(double))
+			return "float";
+		if(a.type_ == typeid(bool))
+			return "bool";
+		return "string";
+	}
+
+	/**
+	 * @brief Expression for the storage of a node from the frame target t of its parent
+	 *
+	 * Elements of lists are appended to the list.
+	 */
+	static std::string lvalue(const cconfig::schema::node& n)
+	{
+		const cconfig::schema::node& p = *n.parent_;
+		if(p.is_list())
+			return "append(*static_cast<list" + p.uri_safe_ + "*>(t))";
+		if(p.parent_ != NULL && p.parent_->is_list() && p.parent_->as_list_unchecked().soa_)
+			return "static_cast<list" + p.parent_->uri_safe_ + "*>(t)->" + n.name_ + ".back()";
+		return "static_cast<" + p.generate_type_name() + "*>(t)->" + n.name_;
+	}
+
+	void generate_key(std::ostream& out) const
+	{
+		out << "\tvoid key(boost::string_ref k)\n";
+		out << "\t{\n";
+		out << "\t\tframe& f = stack_.back();\n";
+		out << "\t\tnext_ = 0;\n";
+		out << "\t\tswitch(f.node)\n";
+		out << "\t\t{\n";
+		for(size_t i = 1; i < nodes_.size(); ++i)
+		{
+			if(!nodes_[i]->is_group())
+				continue;
+			const cconfig::schema::group& g = nodes_[i]->as_group_unchecked();
+
+			// keys are dispatched on their hash like in the wrapper,
+			// colliding keys share a case label
+			typedef std::map<boost::uint32_t, std::vector<size_t> > case_map_type;
+			case_map_type cases;
+			std::vector<cconfig::schema::group::node_map_type::const_iterator> members;
+			for(cconfig::schema::group::node_map_type::const_iterator it = g.children_.begin(); it != g.children_.end(); ++it)
+			{
+				cases[cconfig::util::hash_key(it->first)].push_back(members.size());
+				members.push_back(it);
+			}
+
+			out << "\t\tcase " << i << ": // " << g.uri_ << "\n";
+			if(!cases.empty())
+			{
+				out << "\t\t\tswitch(cconfig::util::hash_key(k))\n";
+				out << "\t\t\t{\n";
+				for(case_map_type::const_iterator cit = cases.begin(); cit != cases.end(); ++cit)
+				{
+					char label[16];
+					std::sprintf(label, "0x%08xu", static_cast<unsigned int>(cit->first));
+					out << "\t\t\tcase " << label << ":\n";
+					for(size_t j = 0; j < cit->second.size(); ++j)
+					{
+						const size_t member = cit->second[j];
+						out << "\t\t\t\tif(k == \"" << members[member]->first << "\")\n";
+						out << "\t\t\t\t{\n";
+						out << "\t\t\t\t\tdefine(f, " << member << ", " << id(members[member]->second) << ");\n";
+						out << "\t\t\t\t\treturn;\n";
+						out << "\t\t\t\t}\n";
+					}
+					out << "\t\t\t\tbreak;\n";
+				}
+				out << "\t\t\t}\n";
+			}
+			out << "\t\t\tbreak;\n";
+		}
+		out << "\t\tdefault:\n";
+		out << "\t\t\t// contents of skipped groups\n";
+		out << "\t\t\treturn;\n";
+		out << "\t\t}\n";
+		out << "\t\tif(f.unknown.empty())\n";
+		out << "\t\t\tf.unknown = k;\n";
+		out << "\t}\n\n";
+	}
+
+	static void generate_dispatch_begin(std::ostream& out)
+	{
+		out << "\t\tvoid* t = stack_.back().target;\n";
+		out << "\t\tconst int n = take_node();\n";
+		out << "\t\tswitch(n)\n";
+		out << "\t\t{\n";
+		out << "\t\tcase 0:\n";
+		out << "\t\t\tpush(0, 0, NULL);\n";
+		out << "\t\t\tbreak;\n";
+	}
+
+	static void generate_dispatch_end(std::ostream& out, const char* error)
+	{
+		out << "\t\tdefault:\n";
+		out << "\t\t\t" << error << "(n);\n";
+		out << "\t\t}\n";
+		out << "\t}\n\n";
+	}
+
+	void generate_atom(std::ostream& out, const char* event, const std::type_info& type, const char* conversion) const
+	{
+		const bool is_string = type == typeid(std::string);
+		out << "\tvoid " << event << "(boost::string_ref text)\n";
+		out << "\t{\n";
+		if(!is_string)
+		{
+			// numbers out of range are errors even in skipped values
+			out << "\t\t" << conversion << "\n";
+		}
+		out << "\t\tvoid* t = stack_.back().target;\n";
+		out << "\t\tconst int n = take_node();\n";
+		out << "\t\tswitch(n)\n";
+		out << "\t\t{\n";
+		out << "\t\tcase 0:\n";
+		out << "\t\t\tbreak;\n";
+		for(size_t i = 1; i < nodes_.size(); ++i)
+		{
+			if(!nodes_[i]->is_atom() || nodes_[i]->as_atom_unchecked().type_ != type)
+				continue;
+			const cconfig::schema::node& n = *nodes_[i];
+			out << "\t\tcase " << i << ": // " << n.uri_ << "\n";
+			if(is_string)
+				out << "\t\t\tassign(" << lvalue(n) << ", text);\n";
+			else if(n.parent_->is_list())
+				out << "\t\t\tstatic_cast<list" << n.parent_->uri_safe_ << "*>(t)->push_back(v);\n";
+			else
+				out << "\t\t\t" << lvalue(n) << " = v;\n";
+			out << "\t\t\tbreak;\n";
+		}
+		out << "\t\tdefault:\n";
+		out << "\t\t\twrong_type(n);\n";
+		out << "\t\t}\n";
+		out << "\t}\n\n";
+	}
+
+	/** Checks of a frame when it is closed, with the order and messages of the wrapper */
+	void generate_check(std::ostream& out) const
+	{
+		out << "\tvoid check(const frame& f)\n";
+		out << "\t{\n";
+		out << "\t\tswitch(f.node)\n";
+		out << "\t\t{\n";
+		for(size_t i = 1; i < nodes_.size(); ++i)
+		{
+			const cconfig::schema::node& n = *nodes_[i];
+			if(n.is_group())
+			{
+				const cconfig::schema::group& g = n.as_group_unchecked();
+				bool required = false;
+				size_t member = 0;
+				for(cconfig::schema::group::node_map_type::const_iterator it = g.children_.begin(); it != g.children_.end(); ++it, ++member)
+				{
+					if(!it->second->required_)
+						continue;
+					if(!required)
+						out << "\t\tcase " << i << ": // " << g.uri_ << "\n";
+					required = true;
+					out << "\t\t\tif(!defined(f, " << member << "))\n";
+					out << "\t\t\t\tfail(\"" << g.uri_ << "\", \"Missing required attribute '" << it->first << "'\");\n";
+				}
+				if(required)
+					out << "\t\t\tbreak;\n";
+			}
+			else if(n.is_list() && n.as_list_unchecked().has_min_)
+			{
+				const cconfig::schema::list& l = n.as_list_unchecked();
+				out << "\t\tcase " << i << ": // " << l.uri_ << "\n";
+				out << "\t\t\tif(f.count < " << l.min_ << "UL)\n";
+				out << "\t\t\t\tfail(\"" << l.uri_ << "\", \"List has not enough entries, need at least " << l.min_ << "\");\n";
+				out << "\t\t\tbreak;\n";
+			}
+		}
+		out << "\t\tdefault:\n";
+		out << "\t\t\tbreak;\n";
+		out << "\t\t}\n";
+		out << "\t\tif(!f.unknown.empty())\n";
+		out << "\t\t\tfail(nodes[f.node].uri, \"Attribute '\" + f.unknown.to_string() + \"' not found in schema \"\n";
+		out << "\t\t\t\t\"(strict validation). This might possibly be a typo.\");\n";
+		out << "\t}\n\n";
+	}
+
+	std::vector<const cconfig::schema::node*> nodes_;
+	std::map<const cconfig::schema::node*, int> ids_;
+	/** Words of the largest bit set of group members */
+	size_t seen_words_;
+	size_t depth_;
+};
+
+}
+
+void
+cconfig::schema::schema::load(const std::string& filename)
+{
+	{
+		char signature[sizeof(schema_signature)];
+		std::ifstream in(filename.c_str(), std::ios::binary);
+		if(in.read(signature, sizeof(signature))
+			&& std::memcmp(signature, schema_signature, sizeof(signature)) == 0)
+		{
+			cconfig::mapped_file data(filename);
+			load_binary(data.data(), data.size(), filename);
+			return;
+		}
+	}
+
+	cconfig::antlr_pool::scope pool;
+	ConfigSchemaLexer::InputStreamType input(reinterpret_cast<const ANTLR_UINT8*>(filename.c_str()), ANTLR_ENC_8BIT);
+	set(parse_schema(input));
+}
+
+void
+cconfig::schema::schema::load_from_buffer(const char* data, size_t size)
+{
+	if(size > std::numeric_limits<ANTLR_UINT32>::max())
+		throw cconfig::schema::exception("Schema input too large");
+
+	cconfig::antlr_pool::scope pool;
+	ConfigSchemaLexer::InputStreamType input(reinterpret_cast<const ANTLR_UINT8*>(data), ANTLR_ENC_8BIT,
+		static_cast<ANTLR_UINT32>(size), reinterpret_cast<ANTLR_UINT8*>(const_cast<char*>("<buffer>")));
+	set(parse_schema(input));
+}
+
+void
+cconfig::schema::schema::load_from_stream(std::istream& in)
+{
+	std::string buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	if(in.bad())
+		throw cconfig::schema::exception("Unable to read schema stream");
+	load_from_buffer(buffer.data(), buffer.size());
+}
+
+void
+cconfig::schema::schema::load_binary(const char* data, size_t size, const std::string& name)
+{
+	set(schema_reader(data, size, name).read());
+}
+
+void
+cconfig::schema::schema::save_binary(std::ostream& out) const
+{
+	if(root_ == NULL)
+		throw cconfig::schema::exception("No schema loaded");
+
+	schema_writer w;
+	w.write(*root_);
+	w.finish(out);
+}
+
+cconfig::schema::validation_result
+cconfig::schema::schema::validate(
+		const cconfig::file& config,
+		bool strict) const
+{
+	cconfig::stats_detail::stopwatch watch;
+	validation_result result = validator_.validate(config.root(), strict);
+	config.record_validation(watch);
+	return result;
+}
+
+cconfig::schema::validation_result
+cconfig::schema::schema::validate(
+		const cconfig::file& config,
+		bool strict,
+		error_list& errors) const
+{
+	cconfig::stats_detail::stopwatch watch;
+	validation_result result = validator_.validate(config.root(), strict, errors);
+	config.record_validation(watch);
+	return result;
+}
+
+cconfig::schema::validation_result
+cconfig::schema::schema::validate(
+		const cconfig::file& config,
+		const validation_options& options) const
+{
+	cconfig::stats_detail::stopwatch watch;
+	validation_result result = validator_.validate(config.root(), options);
+	config.record_validation(watch);
+	return result;
+}
+
+cconfig::schema::validation_result
+cconfig::schema::schema::validate(
+		const cconfig::file& config,
+		const validation_options& options,
+		error_list& errors) const
+{
+	cconfig::stats_detail::stopwatch watch;
+	validation_result result = validator_.validate(config.root(), options, errors);
+	config.record_validation(watch);
+	return result;
+}
+
+void
+cconfig::schema::schema::compile()
+{
+	if(root_ == NULL)
+	{
+		validator_ = validator();
+		return;
+	}
+
+	root_->finalize();
+	validator_.compile(*root_);
+}
+
+bool
+cconfig::schema::schema::generate_wrapper(
+	const std::string& basename,
+	const std::string& targetdir,
+	const std::string& includepath) const
+{
+	// YUCK!!!
+	std::ostringstream header;
+	header << "// THIS FILE HAS BEEN GENERATED FROM THE SCHEMA FILE\n";
+	header << "// DO NOT CHANGE THIS FILE IN ANY CASE!!\n\n";
+	header << "#ifndef CONFIG_WRAPPER_H_\n";
+	header << "#define CONFIG_WRAPPER_H_\n\n";
+	header << "#include \"" << includepath << "config_file.hpp\"\n";
+	header << "#include \"" << includepath << "config_schema.hpp\"\n\n";
+	header << "#include <boost/shared_ptr.hpp>\n\n";
+	header << "#include <stdexcept>\n";
+	header << "#include <string>\n";
+	header << "#include <vector>\n\n";
+	header << "namespace cconfig { namespace wrapper {\n\n";
+	header << "class validation_error : public std::runtime_error\n";
+	header << "{\n";
+	header << "public:\n";
+	header << "\tvalidation_error(const std::string& what) :\n";
+	header << "\t\tstd::runtime_error(what) {}\n";
+	header << "};\n\n";
+	root_->generate_declaration(header);
+	header << "Config load_config(const std::string& config_filename);\n";
+	header << "// fills a default constructed config in place\n";
+	header << "void load_config(const std::string& config_filename, Config& config);\n";
+	header << "cconfig::schema::schema* generate_schema();\n";
+	header << "// schema built by generate_schema() on first use\n";
+	header << "const cconfig::schema::schema& get_schema();\n\n";
+	header << "}}\n\n";
+	header << "#endif\n";
+
+	std::ostringstream cpp;
+	cpp << "// THIS FILE HAS BEEN GENERATED FROM THE SCHEMA FILE\n";
+	cpp << "// DO NOT CHANGE THIS FILE IN ANY CASE!!\n\n";
+	cpp << "#include \"" << basename << ".hpp\"\n\n";
+	cpp << "#include <boost/scoped_ptr.hpp>\n\n";
+	cpp << "namespace {\n\n";
+	cpp << "using namespace cconfig::wrapper;\n\n";
+	cpp << "void fail(const char* uri, const std::string& message)\n";
+	cpp << "{\n";
+	cpp << "\tconst bool root = uri[0] == '/' && uri[1] == '\\0';\n";
+	cpp << "\tthrow validation_error(std::string(\"Validation failed at \") + (root ? \"root level\" : uri) + \": \" + message);\n";
+	cpp << "}\n\n";
+	cpp << "const cconfig::atom& get_atom(const cconfig::element& e, const char* uri)\n";
+	cpp << "{\n";
+	cpp << "\tif(!e.is_atom())\n";
+	cpp << "\t\tfail(uri, \"Atom required\");\n";
+	cpp << "\treturn e.as_atom_unchecked();\n";
+	cpp << "}\n\n";
+	cpp << "long get_long(const cconfig::element& e, const char* uri)\n";
+	cpp << "{\n";
+	cpp << "\tconst cconfig::atom& a = get_atom(e, uri);\n";
+	cpp << "\tif(!a.is_long())\n";
+	cpp << "\t\tfail(uri, \"Type mismatch, integer required\");\n";
+	cpp << "\treturn a.get_long();\n";
+	cpp << "}\n\n";
+	cpp << "double get_double(const cconfig::element& e, const char* uri)\n";
+	cpp << "{\n";
+	cpp << "\tconst cconfig::atom& a = get_atom(e, uri);\n";
+	cpp << "\tif(!a.is_double())\n";
+	cpp << "\t\tfail(uri, \"Type mismatch, float required\");\n";
+	cpp << "\treturn a.get_double();\n";
+	cpp << "}\n\n";
+	cpp << "bool get_bool(const cconfig::element& e, const char* uri)\n";
+	cpp << "{\n";
+	cpp << "\tconst cconfig::atom& a = get_atom(e, uri);\n";
+	cpp << "\tif(!a.is_bool())\n";
+	cpp << "\t\tfail(uri, \"Type mismatch, bool required\");\n";
+	cpp << "\treturn a.get_bool();\n";
+	cpp << "}\n\n";
+	cpp << "void get_string(const cconfig::element& e, const char* uri, std::string& r)\n";
+	cpp << "{\n";
+	cpp << "\tconst cconfig::atom& a = get_atom(e, uri);\n";
+	cpp << "\tif(!a.is_string())\n";
+	cpp << "\t\tfail(uri, \"Type mismatch, string required\");\n";
+	cpp << "\tconst boost::string_ref s = a.get_string_ref();\n";
+	cpp << "\tr.assign(s.data(), s.size());\n";
+	cpp << "}\n\n";
+	cpp << "template<typename T>\n";
+	cpp << "void get_array(const cconfig::list& l, const char* uri, cconfig::list::storage_type storage,\n";
+	cpp << "\tT (*get)(const cconfig::element&, const char*), std::vector<T>& r)\n";
+	cpp << "{\n";
+	cpp << "\t// typed arrays hold values of their storage type only\n";
+	cpp << "\tif(storage != cconfig::list::generic_storage && l.storage() == storage)\n";
+	cpp << "\t{\n";
+	cpp << "\t\tstd::vector<T> values = l.as_vector<T>();\n";
+	cpp << "\t\tr.swap(values);\n";
+	cpp << "\t\treturn;\n";
+	cpp << "\t}\n\n";
+	cpp << "\tr.reserve(l.size());\n";
+	cpp << "\tfor(cconfig::list::iterator it = l.begin(); it != l.end(); ++it)\n";
+	cpp << "\t\tr.push_back(get(*it, uri));\n";
+	cpp << "}\n\n";
+	root_->generate_function(cpp);
+	cpp << "\n}\n\n";
+	cpp << "\nvoid cconfig::wrapper::load_config(const std::string& config_filename, Config& config)\n";
+	cpp << "{\n";
+	cpp << "\tboost::shared_ptr<cconfig::file> f(new cconfig::file);\n";
+	cpp << "\tf->load(config_filename);\n\n";
+	cpp << "\t// the config is validated while it is copied into the struct\n";
+	cpp << "\tgenerate_Config(f->root(), config);\n";
+	cpp << "\tconfig.file_ = f;\n";
+	cpp << "}\n\n";
+	cpp << "cconfig::wrapper::Config cconfig::wrapper::load_config(const std::string& config_filename)\n";
+	cpp << "{\n";
+	cpp << "\tConfig c;\n";
+	cpp << "\tload_config(config_filename, c);\n";
+	cpp << "\treturn c;\n";
+	cpp << "}\n\n";
+	cpp << "const cconfig::schema::schema& cconfig::wrapper::get_schema()\n";
+	cpp << "{\n";
+	cpp << "\tstatic const boost::scoped_ptr<cconfig::schema::schema> s(generate_schema());\n";
+	cpp << "\treturn *s;\n";
+	cpp << "}\n\n";
+	// the schema is embedded in compiled form and rebuilt by a single
+	// load_binary() call instead of code constructing every node
+	std::ostringstream compiled;
+	save_binary(compiled);
+	cpp << "namespace {\n\n";
+	cpp << "// compiled schema, see cconfig::schema::schema::save_binary()\n";
+	cpp << "const char schema_data[] =\n";
+	generate_string_literal(cpp, compiled.str());
+	cpp << ";\n\n";
+	cpp << "}\n\n";
+	cpp << "cconfig::schema::schema* cconfig::wrapper::generate_schema()\n";
+	cpp << "{\n";
+	cpp << "\tcconfig::schema::schema* s = new cconfig::schema::schema;\n";
+	cpp << "\ttry {\n";
+	cpp << "\t\ts->load_binary(schema_data, sizeof(schema_data) - 1, \"" << basename << "\");\n";
+	cpp << "\t} catch(...) {\n";
+	cpp << "\t\tdelete s;\n";
+	cpp << "\t\tthrow;\n";
+	cpp << "\t}\n";
+	cpp << "\treturn s;\n";
+	cpp << "}\n\n";
+
+	// unchanged files are left alone, so that their timestamps don't
+	// trigger rebuilds of everything that includes them
+	const bool header_written = write_if_changed(targetdir + "/" + basename + ".hpp", header.str());
+	const bool cpp_written = write_if_changed(targetdir + "/" + basename + ".cpp", cpp.str());
+	return header_written || cpp_written;
+}
+
+bool
+cconfig::schema::schema::generate_embedded(
+	const std::string& basename,
+	const std::string& name,
+	const std::string& targetdir,
+	const std::string& includepath,
+	const cconfig::file& config) const
+{
+	bool identifier = !name.empty() && !std::isdigit(static_cast<unsigned char>(name[0]));
+	for(size_t i = 0; i < name.size(); ++i)
+		identifier = identifier && (std::isalnum(static_cast<unsigned char>(name[i])) || name[i] == '_');
+	if(!identifier)
+		throw cconfig::schema::exception("Invalid name for an embedded config: '" + name + "'");
+
+	// the generated code relies on the config matching the schema, so
+	// errors show up when the code is generated and not at runtime
+	validation_options options;
+	options.strict = true;
+	const validation_result r = validate(config, options);
+	if(!r.valid)
+		throw cconfig::schema::exception("Validation failed at " +
+			(r.error_uri == "/" ? std::string("root level") : r.error_uri) + ": " + r.error_message);
+
+	const std::string filename = basename + "_" + name;
+	const std::string guard = boost::to_upper_copy(filename);
+
+	std::ostringstream header;
+	header << "// THIS FILE HAS BEEN GENERATED FROM THE SCHEMA AND A CONFIG FILE\n";
+	header << "// DO NOT CHANGE THIS FILE IN ANY CASE!!\n\n";
+	header << "#ifndef " << guard << "_H_\n";
+	header << "#define " << guard << "_H_\n\n";
+	header << "#include \"" << includepath << basename << ".hpp\"\n\n";
+	header << "namespace cconfig { namespace wrapper {\n\n";
+	header << "// embedded config, built on first use without a backing file\n";
+	header << "const Config& " << name << "();\n\n";
+	header << "}}\n\n";
+	header << "#endif\n";
+
+	std::ostringstream cpp;
+	cpp << "// THIS FILE HAS BEEN GENERATED FROM THE SCHEMA AND A CONFIG FILE\n";
+	cpp << "// DO NOT CHANGE THIS FILE IN ANY CASE!!\n\n";
+	cpp << "#include \"" << filename << ".hpp\"\n\n";
+	cpp << "namespace {\n\n";
+	cpp << "cconfig::wrapper::Config generate()\n";
+	cpp << "{\n";
+	cpp << "\tcconfig::wrapper::Config c;\n";
+	root_->generate_embedded(cpp, config.root(), "c", 1);
+	cpp << "\treturn c;\n";
+	cpp << "}\n\n";
+	cpp << "}\n\n";
+	cpp << "const cconfig::wrapper::Config& cconfig::wrapper::" << name << "()\n";
+	cpp << "{\n";
+	cpp << "\tstatic const Config c = generate();\n";
+	cpp << "\treturn c;\n";
+	cpp << "}\n";
+
+	const bool header_written = write_if_changed(targetdir + "/" + filename + ".hpp", header.str());
+	const bool cpp_written = write_if_changed(targetdir + "/" + filename + ".cpp", cpp.str());
+	return header_written || cpp_written;
+}
+
+bool
+cconfig::schema::schema::generate_parser(
+	const std::string& basename,
+	const std::string& targetdir,
+	const std::string& includepath) const
+{
+	if(root_ == NULL)
+		throw cconfig::schema::exception("No schema loaded");
+
+	const std::string filename = basename + "_parser";
+	const std::string guard = boost::to_upper_copy(filename);
+
+	std::ostringstream header;
+	header << "// THIS FILE HAS BEEN GENERATED FROM THE SCHEMA FILE\n";
+	header << "// DO NOT CHANGE THIS FILE IN ANY CASE!!\n\n";
+	header << "#ifndef " << guard << "_H_\n";
+	header << "#define " << guard << "_H_\n\n";
+	header << "#include \"" << includepath << basename << ".hpp\"\n\n";
+	header << "namespace cconfig { namespace wrapper {\n\n";
+	header << "// like load_config(), but the config is parsed directly into the\n";
+	header << "// struct without building a tree, so Config::file() is not available\n";
+	header << "Config parse_config(const std::string& config_filename);\n";
+	header << "void parse_config(const std::string& config_filename, Config& config);\n";
+	header << "void parse_config(const char* data, size_t size, Config& config,\n";
+	header << "\tconst std::string& name = \"<buffer>\");\n\n";
+	header << "}}\n\n";
+	header << "#endif\n";
+
+	std::ostringstream cpp;
+	cpp << "// THIS FILE HAS BEEN GENERATED FROM THE SCHEMA FILE\n";
+	cpp << "// DO NOT CHANGE THIS FILE IN ANY CASE!!\n\n";
+	cpp << "#include \"" << filename << ".hpp\"\n\n";
+	cpp << "#include \"" << includepath << "config_input.hpp\"\n";
+	cpp << "#include \"" << includepath << "config_parser.hpp\"\n\n";
+	cpp << "#include <boost/cstdint.hpp>\n\n";
+	cpp << "#include <algorithm>\n\n";
+	cpp << "namespace {\n\n";
+	cpp << "using namespace cconfig::wrapper;\n\n";
+	cpp << "void fail(const char* uri, const std::string& message)\n";
+	cpp << "{\n";
+	cpp << "\tconst bool root = uri[0] == '/' && uri[1] == '\\0';\n";
+	cpp << "\tthrow validation_error(std::string(\"Validation failed at \") + (root ? \"root level\" : uri) + \": \" + message);\n";
+	cpp << "}\n\n";
+	cpp << "struct node_info\n";
+	cpp << "{\n";
+	cpp << "\tconst char* uri;\n";
+	cpp << "\t/** Error for values of another kind */\n";
+	cpp << "\tconst char* kind_error;\n";
+	cpp << "\t/** Error for atoms of another type, NULL for groups and lists */\n";
+	cpp << "\tconst char* type_error;\n";
+	cpp << "};\n\n";
+	cpp << "extern const node_info nodes[];\n\n";
+	cpp << "void wrong_kind(int n)\n";
+	cpp << "{\n";
+	cpp << "\tfail(nodes[n].uri, nodes[n].kind_error);\n";
+	cpp << "}\n\n";
+	cpp << "void wrong_type(int n)\n";
+	cpp << "{\n";
+	cpp << "\tfail(nodes[n].uri, nodes[n].type_error != NULL ? nodes[n].type_error : nodes[n].kind_error);\n";
+	cpp << "}\n\n";
+	cpp << "template<typename T>\n";
+	cpp << "typename T::reference append(T& v)\n";
+	cpp << "{\n";
+	cpp << "\tv.resize(v.size() + 1);\n";
+	cpp << "\treturn v.back();\n";
+	cpp << "}\n\n";
+	cpp << "// appends a default row to a struct-of-arrays list\n";
+	cpp << "template<typename T>\n";
+	cpp << "void append_row(T& l)\n";
+	cpp << "{\n";
+	cpp << "\tl.resize(l.size() + 1);\n";
+	cpp << "}\n\n";
+	cpp << "void assign(std::string& r, boost::string_ref text)\n";
+	cpp << "{\n";
+	cpp << "\tconst boost::string_ref s = text.substr(1, text.size() - 2);\n";
+	cpp << "\tif(s.find('\\\\') == boost::string_ref::npos)\n";
+	cpp << "\t{\n";
+	cpp << "\t\tr.assign(s.data(), s.size());\n";
+	cpp << "\t\treturn;\n";
+	cpp << "\t}\n";
+	cpp << "\tr.resize(s.size());\n";
+	cpp << "\tr.resize(cconfig::util::unescape(s, &r[0]));\n";
+	cpp << "}\n\n";
+	parser_generator(*root_).generate(cpp);
+	cpp << "}\n\n";
+	cpp << "void cconfig::wrapper::parse_config(const char* data, size_t size, Config& config,\n";
+	cpp << "\tconst std::string& name)\n";
+	cpp << "{\n";
+	cpp << "\tcconfig::lexer l(data, data + size, name);\n";
+	cpp << "\tconfig_handler h(config);\n";
+	cpp << "\tcconfig::parser<config_handler> p(l, h);\n";
+	cpp << "\tp.parse();\n";
+	cpp << "\th.finish();\n";
+	cpp << "}\n\n";
+	cpp << "void cconfig::wrapper::parse_config(const std::string& config_filename, Config& config)\n";
+	cpp << "{\n";
+	cpp << "\tconst cconfig::mapped_file input(config_filename);\n";
+	cpp << "\tparse_config(input.data(), input.size(), config, config_filename);\n";
+	cpp << "}\n\n";
+	cpp << "cconfig::wrapper::Config cconfig::wrapper::parse_config(const std::string& config_filename)\n";
+	cpp << "{\n";
+	cpp << "\tConfig c;\n";
+	cpp << "\tparse_config(config_filename, c);\n";
+	cpp << "\treturn c;\n";
+	cpp << "}\n";
+
+	const bool header_written = write_if_changed(targetdir + "/" + filename + ".hpp", header.str());
+	const bool cpp_written = write_if_changed(targetdir + "/" + filename + ".cpp", cpp.str());
+	return header_written || cpp_written;
+}
+
+void
+cconfig::schema::schema::generate_config_stub(const std::string& outputfile) const
+{
+	std::ofstream stub_file(outputfile.c_str());
+	if(!stub_file)
+		throw cconfig::schema::exception("Unable to open file (" + outputfile + ")");
+
+	cconfig::writer w(stub_file);
+	for(cconfig::schema::group::node_map_type::const_iterator it = root_->children_.begin();
+		it != root_->children_.end(); ++it)
+		it->second->generate_config_stub(w, it->first);
+	w.finish();
 }
 
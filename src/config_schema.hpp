@@ -32,6 +32,7 @@
 #include <boost/variant.hpp>
 #include <boost/optional.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/cstdint.hpp>
 
 #include <string>
 #include <vector>
@@ -44,6 +45,9 @@ namespace cconfig {
 
 class file;
 class element;
+class list;
+class atom;
+class writer;
 
 namespace schema {
 
@@ -81,6 +85,35 @@ struct validation_result
 	{}	
 };
 
+typedef std::vector<validation_result> error_list;
+
+/**
+ * @brief Options for validating a config
+ */
+struct validation_options
+{
+	/**
+	 * @brief Flag for enabling strict validation, see node::validate()
+	 */
+	bool strict;
+
+	/**
+	 * @brief Number of threads used for validating large lists
+	 *
+	 * 1 validates sequentially, 0 uses one thread per core. The
+	 * elements of a list are split into chunks, and the result
+	 * is the same as that of sequential validation.
+	 */
+	unsigned int threads;
+
+	/**
+	 * @brief Lists with fewer elements are validated sequentially
+	 */
+	size_t parallel_threshold;
+
+	validation_options() : strict(false), threads(1), parallel_threshold(4096) {}
+};
+
 /**
  * @brief Abstract node class for the schema tree
  *
@@ -89,15 +122,57 @@ struct validation_result
  * validation classes are used only internally by the validator
  * and the code generator, so this should be no problem.
  */
+class group;
+class list;
+class atom;
+
 class node
 {
 public:
-	node() : required_(false), parent_(NULL) {}
+	/**
+	 * @brief Kind of a schema node, stored in every node
+	 */
+	enum kind_type { group_kind, list_kind, atom_kind };
+
+	explicit node(kind_type kind) : kind_(kind), required_(false), parent_(NULL) {}
 	virtual ~node() {}
 
+	kind_type kind() const { return kind_; }
+	bool is_group() const { return kind_ == group_kind; }
+	bool is_list() const { return kind_ == list_kind; }
+	bool is_atom() const { return kind_ == atom_kind; }
+
+	/**
+	 * @brief Unchecked conversions to the concrete node type
+	 *
+	 * These must only be used after checking kind() or one
+	 * of the is_* functions.
+	 */
+	group& as_group_unchecked();
+	const group& as_group_unchecked() const;
+	list& as_list_unchecked();
+	const list& as_list_unchecked() const;
+	atom& as_atom_unchecked();
+	const atom& as_atom_unchecked() const;
+
+	/**
+	 * @brief Location of the node in the schema tree
+	 *
+	 * Both are computed for the whole tree by finalize(), on a
+	 * tree that has not been finalized they are built by walking
+	 * the parent chain.
+	 */
 	std::string uri() const;
+	/** uri() usable as part of an identifier */
 	std::string uri_safe() const;
 
+	/**
+	 * @brief Computes the URIs of this node and its descendants
+	 *
+	 * This is done by schema::set() once the tree is complete.
+	 */
+	void finalize();
+
 	/**
 	 * @brief Virtual function for validating the tree
 	 *
@@ -120,56 +195,64 @@ public:
 
 	/**
 	 * @brief Virtual function for generating declaration code (header file)
+	 *
+	 * All generators write to the given stream, so that the cost of
+	 * generating code is linear in its size.
 	 */
-	virtual std::string generate_declaration() const = 0;
+	virtual void generate_declaration(std::ostream& out) const = 0;
 
 	/**
 	 * @brief Virtual function for generating definition code (cpp file)
 	 */
-	virtual std::string generate_definition() const = 0;
+	virtual void generate_definition(std::ostream& out) const = 0;
 
 	/**
 	 * @brief Virtual function for generating initialization code (cpp file)
+	 *
+	 * @param target Expression naming the struct member or vector element
+	 * that is populated in place from @c child_element
 	 */
-	virtual std::string generate_initialization() const = 0;
+	virtual void generate_initialization(std::ostream& out, const std::string& target) const = 0;
 
 	/**
 	 * @brief Virtual function for generating initialization function (cpp file)
 	 */
-	virtual std::string generate_function() const = 0;
+	virtual void generate_function(std::ostream& out) const = 0;
 
 	/**
-	 * @brief Virtual function for generating the schema tree builder (cpp file)
+	 * @brief Virtual function for writing a config file stub
 	 *
-	 * @param unique_id Reference to an (arbitrary) integer that is incremented
-	 * internally for generating variable names for the tree builder
-	 * @param indent Indentation width
+	 * @param key Setting name, empty for elements of lists and arrays
 	 */
-	virtual std::string generate_tree_builder(int& unique_id, int indent) const = 0;
+	virtual void generate_config_stub(cconfig::writer& w, const std::string& key) const = 0;
 
 	/**
-	 * @brief Virtual function for generating a config file stub
+	 * @brief Virtual function for generating code that assigns a config value (cpp file)
 	 *
-	 * @param variant Module to generate the stub for
+	 * @param e Config element, already validated against this node
+	 * @param target Expression naming the struct member or vector element
 	 * @param indent Indentation width
 	 */
-	virtual std::string generate_config_stub(int indent) const = 0;
+	virtual void generate_embedded(std::ostream& out, const cconfig::element& e,
+		const std::string& target, int indent) const = 0;
 
 	/**
-	 * @brief Generates schema tree initialization common to all node types
-	 *
-	 * @param unique_id Integer for generating variable names for the tree builder
-	 * @param indent Indentation width
+	 * @brief Returns the C++ type generated for values of this node
 	 */
-	std::string generate_common_tree_initialization(int unique_id, int indent) const;
+	std::string generate_type_name() const;
 	
 	/**
-	 * @brief Utility function for indenting a string
+	 * @brief Utility function for writing an atom value as C++ literal
 	 */
-	static void indent_string(std::string& s, int indent)
+	static void generate_literal(std::ostream& out, const cconfig::atom& a);
+
+	/**
+	 * @brief Utility function for indenting the output
+	 */
+	static void indent_string(std::ostream& out, int indent)
 	{
 		for(int i=0; i<indent; i++)
-			s += "\t";
+			out << '\t';
 	}
 
 	/**
@@ -188,8 +271,17 @@ public:
 				attribute_value_type(value)
 			)
 		);
+		resolve_attribute(name);
 	}
 
+	/**
+	 * @brief Hook for storing known attributes in typed members
+	 *
+	 * Called by add_attribute(), throws if the attribute has an
+	 * unsuitable type.
+	 */
+	virtual void resolve_attribute(const std::string&) {}
+
 	/**
 	 * @brief Function for checking if a specific attribute is set on the node
 	 *
@@ -222,32 +314,15 @@ public:
 		}
 	}
 
+	kind_type kind_;
 	std::string name_;
 	bool required_;
 
 	node* parent_;
 
-	/**
-	 * @brief Visitor for the variants in attribute map
-	 *
-	 * Generates an initialization string for all allowed
-	 * types in the attribute variant.
-	 */
-	struct attribute_visitor :
-		boost::static_visitor<std::string>
-	{
-		std::string operator()(long x) const
-		{ return "(long)" + boost::lexical_cast<std::string>(x); }
-		
-		std::string operator()(bool x) const
-		{ return std::string("(bool)") + (x?"true":"false"); }
-		
-		std::string operator()(double x) const
-		{ return "(double)" + boost::lexical_cast<std::string>(x); }
-		
-		std::string operator()(const std::string& x) const
-		{ return "\"" + x + "\""; }
-	};
+	/** Set by finalize() */
+	std::string uri_;
+	std::string uri_safe_;
 
 	typedef boost::variant<long, bool, double, std::string> attribute_value_type;
 	typedef std::map<std::string, attribute_value_type> attribute_map_type;
@@ -257,6 +332,7 @@ public:
 class group : public node
 {
 public:
+	group() : node(group_kind) {}
 	~group();
 
 	void add_child(
@@ -268,13 +344,14 @@ public:
 			const cconfig::element& e,
 			bool strict=false) const;
 	
-	std::string generate_declaration() const;
-	std::string generate_definition() const;
-	std::string generate_initialization() const;
-	std::string generate_function() const;
+	void generate_declaration(std::ostream& out) const;
+	void generate_definition(std::ostream& out) const;
+	void generate_initialization(std::ostream& out, const std::string& target) const;
+	void generate_function(std::ostream& out) const;
 
-	std::string generate_tree_builder(int& unique_id, int indent) const;
-	std::string generate_config_stub(int indent) const;
+	void generate_config_stub(cconfig::writer& w, const std::string& key) const;
+	void generate_embedded(std::ostream& out, const cconfig::element& e,
+		const std::string& target, int indent) const;
 
 	typedef std::map<std::string, node*> node_map_type;
 	node_map_type children_;
@@ -283,60 +360,240 @@ public:
 class list : public node
 {
 public:
+	list() : node(list_kind), has_min_(false), min_(0), soa_(false) {}
 	~list();
 
 	void add_child(node* n);
+	void resolve_attribute(const std::string& name);
 	
 	validation_result validate(
 			const cconfig::element& e,
 			bool strict=false) const;
 	
-	std::string generate_declaration() const;
-	std::string generate_definition() const;
-	std::string generate_initialization() const;
-	std::string generate_function() const;
+	void generate_declaration(std::ostream& out) const;
+	void generate_definition(std::ostream& out) const;
+	void generate_initialization(std::ostream& out, const std::string& target) const;
+	void generate_function(std::ostream& out) const;
 	
-	std::string generate_tree_builder(int& unique_id, int indent) const;
-	std::string generate_config_stub(int indent) const;
+	void generate_config_stub(cconfig::writer& w, const std::string& key) const;
+	void generate_embedded(std::ostream& out, const cconfig::element& e,
+		const std::string& target, int indent) const;
 
 	typedef std::vector<node*> node_list_type;
 	node_list_type children_;
+
+	/** 'min' attribute */
+	bool has_min_;
+	unsigned long min_;
+
+	/**
+	 * 'layout' attribute, true for "soa"
+	 *
+	 * A list of groups with layout="soa" is generated as one vector per
+	 * group member instead of a vector of group structs. Elements are
+	 * accessed through row proxies holding references into the vectors.
+	 */
+	bool soa_;
 };
 
 class atom : public node
 {
 public:
 	atom(const std::type_info& type) :
-		type_(type) {}
+		node(atom_kind), type_(type),
+		has_default_(false), default_long_(0), default_double_(0), default_bool_(false)
+	{}
+
+	void resolve_attribute(const std::string& name);
 
 	validation_result validate(
 			const cconfig::element& e,
 			bool strict=false) const;
 	
-	std::string generate_declaration() const;
-	std::string generate_definition() const;
-	std::string generate_initialization() const;
-	std::string generate_function() const;
+	void generate_declaration(std::ostream& out) const;
+	void generate_definition(std::ostream& out) const;
+	void generate_initialization(std::ostream& out, const std::string& target) const;
+	void generate_function(std::ostream& out) const;
 
-	std::string generate_tree_builder(int& unique_id, int indent) const;
-	std::string generate_config_stub(int indent) const;
+	void generate_config_stub(cconfig::writer& w, const std::string& key) const;
+	void generate_embedded(std::ostream& out, const cconfig::element& e,
+		const std::string& target, int indent) const;
 
 	/**
 	 * @brief Generates type string from the variant type
 	 */
 	std::string c_type_string() const;
 
+	/**
+	 * @brief Generates the name of the checked conversion for the type
+	 */
+	void generate_getter(std::ostream& out) const;
+
 	const std::type_info& type_;
+
+	/** 'default' attribute, stored in the member matching type_ */
+	bool has_default_;
+	long default_long_;
+	double default_double_;
+	bool default_bool_;
+	std::string default_string_;
+};
+
+inline group& node::as_group_unchecked() { return static_cast<group&>(*this); }
+inline const group& node::as_group_unchecked() const { return static_cast<const group&>(*this); }
+inline list& node::as_list_unchecked() { return static_cast<list&>(*this); }
+inline const list& node::as_list_unchecked() const { return static_cast<const list&>(*this); }
+inline atom& node::as_atom_unchecked() { return static_cast<atom&>(*this); }
+inline const atom& node::as_atom_unchecked() const { return static_cast<const atom&>(*this); }
+
+/**
+ * @brief Validation program compiled from a schema tree
+ *
+ * The schema tree is flattened into an array of instructions
+ * with the kind and type checks, required flags, key hashes
+ * and error locations resolved in advance. The children of
+ * a group are stored next to each other in key order and are
+ * merged with the settings of a config group in a single walk,
+ * falling back to the hash index of the group for settings
+ * that are out of order. Strict validation then only needs to
+ * compare the number of matched settings with the group size.
+ *
+ * Validation does not throw, all errors are reported in the
+ * returned validation_result.
+ */
+class validator
+{
+public:
+	validator() {}
+	explicit validator(const group& root) { compile(root); }
+
+	/**
+	 * @brief Compiles the program, replacing a previous one
+	 *
+	 * @param root Root node of the schema tree, which is not
+	 * referenced afterwards
+	 */
+	void compile(const group& root);
+
+	bool empty() const { return program_.empty(); }
+
+	/**
+	 * @brief Validates a config tree
+	 *
+	 * @param e Root element of the config tree
+	 * @param strict Flag for enabling strict validation, see
+	 * node::validate()
+	 *
+	 * @return validation_result object
+	 */
+	validation_result validate(
+			const cconfig::element& e,
+			bool strict=false) const;
+
+	/**
+	 * @brief Validates a config tree and collects all errors
+	 *
+	 * Validation continues after an error with the next setting,
+	 * the children of a mismatching setting are skipped.
+	 *
+	 * @param errors List the errors are appended to, in the
+	 * order validate() would encounter them
+	 *
+	 * @return The first error or a valid result
+	 */
+	validation_result validate(
+			const cconfig::element& e,
+			bool strict,
+			error_list& errors) const;
+
+	/**
+	 * @brief Validates a config tree with the given options
+	 */
+	validation_result validate(
+			const cconfig::element& e,
+			const validation_options& options) const;
+
+	/**
+	 * @brief Validates a config tree with the given options and
+	 * collects all errors
+	 */
+	validation_result validate(
+			const cconfig::element& e,
+			const validation_options& options,
+			error_list& errors) const;
+
+private:
+	enum value_type { no_value, long_value, double_value, bool_value, string_value };
+
+	struct instruction
+	{
+		node::kind_type kind;
+		value_type type;
+		bool required;
+		bool has_min;
+		unsigned long min;
+		/** Key in the parent group and its util::hash_key() */
+		std::string name;
+		boost::uint32_t hash;
+		std::string uri;
+		/** Range of the child instructions */
+		size_t first;
+		size_t count;
+	};
+
+	void compile_node(const node& n, size_t index);
+
+	struct context
+	{
+		bool strict;
+		/** Threads for large lists, 1 within a parallel section */
+		unsigned int threads;
+		size_t parallel_threshold;
+		/** First error */
+		validation_result result;
+		/** All errors, NULL to stop at the first one */
+		error_list* errors;
+
+		context(const validation_options& options, unsigned int _threads, error_list* _errors) :
+			strict(options.strict),
+			threads(_threads),
+			parallel_threshold(options.parallel_threshold),
+			result(true),
+			errors(_errors)
+		{}
+	};
+
+	/** State shared by the threads validating a list */
+	struct list_job;
+
+	validation_result execute(
+			const cconfig::element& e,
+			const validation_options& options,
+			error_list* errors) const;
+
+	/** These return false if validation has to stop */
+	bool run(size_t index, const cconfig::element& e, context& c) const;
+	bool run_group(const instruction& ins, const cconfig::element& e, context& c) const;
+	bool run_list(const instruction& ins, const cconfig::element& e, context& c) const;
+	bool run_parallel(size_t index, const cconfig::list& l, context& c) const;
+	void run_chunks(list_job& job) const;
+	bool check_value(const instruction& ins, value_type type, context& c) const;
+	static bool fail(context& c, const std::string& uri, const std::string& message);
+
+	std::vector<instruction> program_;
 };
 
 /**
  * @brief Class encapsulating a config schema
+ *
+ * A loaded schema is not modified by validation, any number of
+ * threads may validate against it concurrently.
  */
 class schema
 {
 public:
-	schema() {}
-	explicit schema(const std::string& filename) { load(filename); }
+	schema() : root_(NULL) {}
+	explicit schema(const std::string& filename) : root_(NULL) { load(filename); }
 
 	~schema() { delete root_; }
 
@@ -347,14 +604,60 @@ public:
 	 */
 	void load(const std::string& filename);
 
+	/**
+	 * @brief Loads the schema from a memory buffer
+	 *
+	 * The buffer is parsed in place and not referenced afterwards
+	 *
+	 * @param data Pointer to the schema text
+	 * @param size Size of the schema text in bytes
+	 */
+	void load_from_buffer(const char* data, size_t size);
+
+	/**
+	 * @brief Loads the schema from a stream
+	 *
+	 * @param in Stream that is read until end of file
+	 */
+	void load_from_stream(std::istream& in);
+
+	/**
+	 * @brief Loads a schema compiled by save_binary()
+	 *
+	 * The tree is rebuilt from the data without running the schema
+	 * parser, the data is not referenced afterwards. load() detects
+	 * compiled schemas by their signature, so a compiled schema can
+	 * be used in place of the schema file. The generated wrapper
+	 * embeds its schema in this form.
+	 *
+	 * @param name Name of the data used in error messages
+	 *
+	 * @throws cconfig::schema::exception if the data is not a valid
+	 * compiled schema
+	 */
+	void load_binary(const char* data, size_t size, const std::string& name = "<buffer>");
+
+	/**
+	 * @brief Writes the schema tree in compiled form (see load_binary())
+	 */
+	void save_binary(std::ostream& out) const;
+
 	/**
 	 * @brief Allows to set the root node manually
 	 *
-	 * This is used internally by the generated tree builder
+	 * This is used by the schema parser and load_binary()
 	 *
 	 * @param root Pointer to the root node (transfers ownership)
 	 */
-	void set(group* root) { root_ = root; }
+	void set(group* root) { delete root_; root_ = root; compile(); }
+
+	/**
+	 * @brief Finalizes the tree and recompiles the validator
+	 *
+	 * This is done by set() and needs to be repeated only if
+	 * the tree has been modified through root() afterwards.
+	 */
+	void compile();
 
 	/**
 	 * @brief Validates a config file
@@ -372,8 +675,38 @@ public:
 	 * @return validation_result object
 	 */
 	validation_result validate(
-			cconfig::file& config,
-			bool strict=false);
+			const cconfig::file& config,
+			bool strict=false) const;
+
+	/**
+	 * @brief Validates a config file and collects all errors
+	 *
+	 * See validator::validate(). Like the other validation
+	 * functions this may be called concurrently.
+	 *
+	 * @param errors List the errors are appended to
+	 *
+	 * @return The first error or a valid result
+	 */
+	validation_result validate(
+			const cconfig::file& config,
+			bool strict,
+			error_list& errors) const;
+
+	/**
+	 * @brief Validates a config file with the given options
+	 *
+	 * See validation_options, large lists may be validated on
+	 * multiple threads.
+	 */
+	validation_result validate(
+			const cconfig::file& config,
+			const validation_options& options) const;
+
+	validation_result validate(
+			const cconfig::file& config,
+			const validation_options& options,
+			error_list& errors) const;
 
 	/**
 	 * @brief Generates wrapper code
@@ -388,16 +721,57 @@ public:
 	 * @param includepath Relative path to the includes that will
 	 * be written into the generated files so that the compiler
 	 * can find the config file and schema headers
+	 *
+	 * @return False if both files existed with the same content
+	 * and have not been touched
 	 */
-	void generate_wrapper(const std::string& basename, const std::string& targetdir,
+	bool generate_wrapper(const std::string& basename, const std::string& targetdir,
 		const std::string& includepath) const;
+
+	/**
+	 * @brief Generates code for a config embedded into the binary
+	 *
+	 * The config is validated strictly and written as assignments to
+	 * a Config of the wrapper generated with the same basename, arrays
+	 * become static constant tables. The files basename_name.hpp and
+	 * basename_name.cpp declare and define a function @p name returning
+	 * the Config, which is built on first use and has no backing file.
+	 *
+	 * @param name Name of the generated function, a C++ identifier
+	 * @param config Config file to embed
+	 *
+	 * @return False if both files existed with the same content
+	 * and have not been touched
+	 */
+	bool generate_embedded(const std::string& basename, const std::string& name,
+		const std::string& targetdir, const std::string& includepath,
+		const cconfig::file& config) const;
 	
+	/**
+	 * @brief Generates a parser reading configs directly into the wrapper structs
+	 *
+	 * The files basename_parser.hpp and basename_parser.cpp declare and
+	 * define parse_config(), a replacement for load_config() of the
+	 * wrapper generated with the same basename. The config text is
+	 * tokenized by the parser of config files, keys are dispatched on
+	 * their hash and values are type checked and stored as they are
+	 * read, so no tree is built. Configs are checked like by the
+	 * wrapper, but errors are reported in the order of the input and
+	 * include directives are not supported.
+	 *
+	 * @return False if both files existed with the same content
+	 * and have not been touched
+	 */
+	bool generate_parser(const std::string& basename, const std::string& targetdir,
+		const std::string& includepath) const;
+
 	void generate_config_stub(const std::string& outputfile) const;
 	
 	node* root() { return root_; }
 
 private:
 	group* root_;
+	validator validator_;
 };
 
 }}
@@ -0,0 +1,166 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_STATS_HPP_
+#define CONFIG_STATS_HPP_
+
+#include <cstddef>
+#include <string>
+
+#include <boost/chrono/duration.hpp>
+#include <boost/function.hpp>
+
+#ifdef CCONFIG_STATS
+#  include <boost/chrono/system_clocks.hpp>
+#endif
+
+#include "config_tree.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Measurements of loading and validating a config, see file::stats().
+///
+/// The measurements are only taken if the library and all code using it
+/// is compiled with CCONFIG_STATS defined, otherwise all members stay
+/// zero and the instrumentation is compiled out. The builtin parser
+/// lexes, parses and builds the tree in a single pass, so these phases
+/// are measured together as parse_time.
+///
+struct load_stats
+{
+#ifdef CCONFIG_STATS
+   static const bool enabled = true;
+#else
+   static const bool enabled = false;
+#endif
+
+   load_stats() :
+      read_time(0), parse_time(0), validate_time(0), validations(0), bytes_read(0), tokens(0), groups(0), lists(0), atoms(0),
+      allocations(0), allocated_bytes(0), reserved_bytes(0), max_depth(0)
+   {}
+
+   /// Name of the loaded file, "<buffer>" or "<stream>"
+   std::string name;
+
+   /// Reading or mapping the input, streams are read while parsing
+   boost::chrono::nanoseconds read_time;
+   /// Parsing the input and building the tree, only indexing the
+   /// top-level definitions for lazily parsed configs
+   boost::chrono::nanoseconds parse_time;
+   /// Total time spent in schema::validate for this config
+   boost::chrono::nanoseconds validate_time;
+   size_t validations;
+
+   /// Size of the input, included files not counted
+   size_t bytes_read;
+   /// Tokens of the input read by the builtin or ANTLR lexer
+   size_t tokens;
+
+   /// Elements of the tree by kind, values of typed arrays are counted
+   /// as atoms. Not counted for lazily parsed configs.
+   size_t groups;
+   size_t lists;
+   size_t atoms;
+
+   /// Allocations from the arenas of the tree
+   size_t allocations;
+   size_t allocated_bytes;
+   /// Memory the arenas allocated from the system
+   size_t reserved_bytes;
+
+   /// Deepest nesting of groups and lists, the root group has depth 1
+   size_t max_depth;
+};
+
+///
+/// \brief Receives the stats of a file after it was loaded and after each validation.
+///
+/// Set in load_options, e.g. for exporting the stats to a metrics system.
+/// Called on the thread that loaded or validated the config.
+///
+typedef boost::function<void (const load_stats&)> stats_callback;
+
+namespace stats_detail {
+
+///
+/// \brief Measures the wall time since construction, always zero without CCONFIG_STATS.
+///
+class stopwatch
+{
+public:
+#ifdef CCONFIG_STATS
+   stopwatch() : start_(boost::chrono::steady_clock::now()) {}
+
+   boost::chrono::nanoseconds elapsed() const { return boost::chrono::steady_clock::now() - start_; }
+
+private:
+   boost::chrono::steady_clock::time_point start_;
+#else
+   boost::chrono::nanoseconds elapsed() const { return boost::chrono::nanoseconds(0); }
+#endif
+};
+
+///
+/// \brief Adds the elements below e to the counters of stats.
+///
+inline void count_elements(const element& e, load_stats& stats, size_t depth)
+{
+   if(e.is_atom())
+   {
+      stats.atoms++;
+      return;
+   }
+
+   if(depth > stats.max_depth)
+      stats.max_depth = depth;
+   if(e.is_group())
+   {
+      stats.groups++;
+      const group& g = e.as_group_unchecked();
+      for(group::iterator it = g.begin(); it != g.end(); ++it)
+         count_elements(*it->value, stats, depth + 1);
+      return;
+   }
+
+   stats.lists++;
+   const list& l = e.as_list_unchecked();
+   if(l.storage() != list::generic_storage)
+   {
+      stats.atoms += l.size();
+      return;
+   }
+   for(list::iterator it = l.begin(); it != l.end(); ++it)
+      count_elements(*it, stats, depth + 1);
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,280 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef CONFIG_STREAM_HPP_
+#define CONFIG_STREAM_HPP_
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#ifdef __unix__
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#include "config_tree.hpp"
+#include "config_builder.hpp"
+#include "config_parser.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Source of config input that is read in chunks.
+///
+class input_source
+{
+public:
+   virtual ~input_source() {}
+
+   ///
+   /// \brief Reads up to size bytes, returns as soon as some data is available.
+   ///
+   /// \returns The number of bytes read, 0 at the end of the input.
+   /// \throws cconfig::exception on read errors.
+   ///
+   virtual size_t read(char* buffer, size_t size) = 0;
+};
+
+///
+/// \brief Chunked input from a std::istream.
+///
+class stream_source : public input_source
+{
+public:
+   explicit stream_source(std::istream& in) : in_(in) {}
+
+   size_t read(char* buffer, size_t size)
+   {
+      in_.read(buffer, static_cast<std::streamsize>(size));
+      if(in_.bad())
+         throw cconfig::exception("Unable to read input stream");
+      return static_cast<size_t>(in_.gcount());
+   }
+
+private:
+   std::istream& in_;
+};
+
+#ifdef __unix__
+///
+/// \brief Chunked input from a file, pipe or device.
+///
+/// Reads return whatever a pipe holds instead of waiting for a chunk to
+/// fill up, so parsing keeps pace with the writer.
+///
+class file_source : public input_source, boost::noncopyable
+{
+public:
+   ///
+   /// \throws cconfig::exception if the file cannot be opened.
+   ///
+   explicit file_source(const std::string& filename) : filename_(filename), fd_(::open(filename.c_str(), O_RDONLY))
+   {
+      if(fd_ < 0)
+         throw cconfig::exception("Unable to open file (" + filename + ")");
+   }
+
+   ~file_source() { ::close(fd_); }
+
+   size_t read(char* buffer, size_t size)
+   {
+      for(;;)
+      {
+         const ssize_t n = ::read(fd_, buffer, size);
+         if(n >= 0)
+            return static_cast<size_t>(n);
+         if(errno != EINTR)
+            throw cconfig::exception("Unable to read file (" + filename_ + ")");
+      }
+   }
+
+private:
+   const std::string filename_;
+   const int fd_;
+};
+
+///
+/// \brief Returns true for files whose size is known up front.
+///
+/// Pipes, character devices and most files in /proc are read in chunks,
+/// their size is unknown or reported as 0.
+///
+inline bool is_regular_file(const std::string& filename)
+{
+   struct stat st;
+   return ::stat(filename.c_str(), &st) != 0 || (S_ISREG(st.st_mode) && st.st_size != 0);
+}
+#endif
+
+namespace stream_detail {
+
+///
+/// \brief Finds the complete top-level definitions at the start of the input read so far.
+///
+/// Definitions that may continue in the rest of the input, including
+/// ones that look malformed because they are cut off, are left for the
+/// next call.
+///
+/// \returns The end of the last complete definition, begin if there is none.
+///
+inline const char* complete_definitions(const char* begin, const char* end, const std::string& name)
+{
+   const char* last = begin;
+   try
+   {
+      for(;;)
+      {
+         cconfig::lexer l(begin, last, end, name);
+         token t;
+         l.next(t);
+         // tokens at the end may continue, like "tr" of "true"
+         if(t.type == token::end_of_input || t.text.end() == end)
+            return last;
+
+         const char* next;
+         if(t.type == token::include)
+         {
+            token file;
+            l.next(file);
+            if(file.type == token::end_of_input)
+               return last;
+            next = file.text.end();
+         }
+         else if(t.type == token::identifier)
+         {
+            next = parser_detail::skip_definition(l, t.text.end(), end);
+            if(next == NULL)
+               return last;
+         }
+         else
+         {
+            // the parser reports the error
+            return end;
+         }
+         last = next;
+      }
+   }
+   catch(const cconfig::parse_error&)
+   {
+      return last;
+   }
+}
+
+/// Moves a location behind the text in [begin, end)
+inline void advance(size_t& line, size_t& column, const char* begin, const char* end)
+{
+   for(const char* p = begin; p != end; ++p)
+   {
+      if(*p == '\n')
+      {
+         line++;
+         column = 1;
+      }
+      else
+         column++;
+   }
+}
+
+}
+
+///
+/// \brief Parses a config while it is being read.
+///
+/// Complete top-level definitions are parsed as soon as they have been
+/// read and are then dropped from the buffer, which only holds the
+/// definition in progress. Parsing keeps up with a producer writing into
+/// a pipe this way, and memory does not grow with the input beyond the
+/// tree. A single definition spanning everything is parsed at the end.
+///
+/// \param builder Builder that does not reference the input
+/// \param chunk_size Number of bytes requested per read
+/// \throws cconfig::parse_error on syntax errors, cconfig::exception on
+///         read errors.
+///
+inline group* parse_stream(cconfig::input_source& in, const std::string& name,
+   cconfig::tree_builder& builder, size_t chunk_size = 64 * 1024)
+{
+   if(builder.reference_input())
+      throw cconfig::exception("Streamed input cannot be referenced by the tree");
+
+   group* root = builder.make_group();
+   tree_handler h(builder, root);
+
+   std::vector<char> buffer(chunk_size);
+   size_t size = 0;
+   // location of the start of the buffer in the input
+   size_t line = 1;
+   size_t column = 1;
+   // incomplete definitions are scanned again once the buffer has doubled,
+   // so that a large definition is not scanned once per chunk
+   size_t rescan_size = 0;
+
+   for(bool eof = false; !eof; )
+   {
+      if(buffer.size() - size < chunk_size)
+         buffer.resize(std::max(buffer.size() * 2, size + chunk_size));
+      const size_t n = in.read(&buffer[size], chunk_size);
+      eof = n == 0;
+      size += n;
+      if(!eof && size < rescan_size)
+         continue;
+
+      const char* begin = &buffer[0];
+      const char* end = begin + size;
+      const char* stop = eof ? end : stream_detail::complete_definitions(begin, end, name);
+      if(stop == begin && !eof)
+      {
+         rescan_size = 2 * size;
+         continue;
+      }
+
+      cconfig::lexer l(begin, stop, name);
+      l.set_location(line, column);
+      parser<tree_handler> p(l, h);
+      p.parse();
+      builder.record_input(stop - begin, l.token_count());
+
+      stream_detail::advance(line, column, begin, stop);
+      std::memmove(&buffer[0], stop, end - stop);
+      size = end - stop;
+      rescan_size = 0;
+   }
+   return root;
+}
+
+}
+
+#endif
@@ -31,21 +31,36 @@
 
 #include <string>
 #include <deque>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstring>
 
 #include <boost/variant.hpp>
-#include <boost/ptr_container/ptr_map.hpp>
-#include <boost/ptr_container/ptr_vector.hpp>
-
-#include <boost/algorithm/string/split.hpp>
-#include <boost/algorithm/string/erase.hpp>
-#include <boost/algorithm/string/classification.hpp>
+#include <boost/optional.hpp>
+#include <boost/atomic.hpp>
+#include <boost/iterator/iterator_facade.hpp>
 
 #include <boost/lexical_cast.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/integral_constant.hpp>
 #include <boost/type_traits/is_arithmetic.hpp>
+#include <boost/type_traits/is_const.hpp>
+#include <boost/type_traits/is_floating_point.hpp>
+#include <boost/type_traits/is_integral.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <boost/type_traits/remove_const.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 #include <boost/foreach.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <boost/cstdint.hpp>
+
+#include "config_arena.hpp"
 
-#include <boost/xpressive/xpressive.hpp>
+// path literals need relaxed constexpr functions
+#if __cplusplus >= 201402L
+#  define CCONFIG_HAS_PATH_LITERALS 1
+#endif
 
 namespace cconfig {
 
@@ -61,8 +76,26 @@ class parse_error : public cconfig::exception
 {
 public:
    parse_error(const std::string& what) :
-      cconfig::exception(what)
+      cconfig::exception(what),
+      line_(0),
+      column_(0)
    {}
+
+   parse_error(const std::string& what, size_t line, size_t column) :
+      cconfig::exception(what + " at line " + boost::lexical_cast<std::string>(line)
+         + ", column " + boost::lexical_cast<std::string>(column)),
+      line_(line),
+      column_(column)
+   {}
+
+   /// Line of the error (starting at 1), 0 if unknown
+   size_t line() const { return line_; }
+   /// Column of the error (starting at 1), 0 if unknown
+   size_t column() const { return column_; }
+
+private:
+   size_t line_;
+   size_t column_;
 };
 
 class lookup_error : public cconfig::exception
@@ -80,300 +113,2000 @@ typedef std::deque<boost::variant<std::string, unsigned int> > token_list;
 
 namespace util {
    ///
-   /// \brief Function for splitting lookup paths.
-   /// 
+   /// \brief Single token of a lookup path as produced by path_tokenizer.
+   ///
+   /// The token text is a non-owning view into the tokenized path and
+   /// is only valid as long as the path string is alive.
+   ///
+   struct path_token
+   {
+      /// any_index and any_key are wildcards, see path_tokenizer
+      enum token_type { name, index, any_index, any_key };
+
+      token_type type;
+      boost::string_ref text;
+      unsigned int value;  ///< Index value, only valid for index tokens
+      size_t offset;       ///< Offset of the token within the path
+   };
+
+   ///
+   /// \brief Single pass tokenizer for lookup paths.
+   ///
    /// Lookup paths consist of group names separated by dots. Each group
    /// name may be followed by one or more index numbers enclosed in
-   /// square brackets.
+   /// square brackets. For compatibility, a purely numeric component
+   /// following a dot is treated as an index as well.
+   ///
+   /// The tokenizer scans the path in place and neither allocates nor
+   /// copies any part of it.
+   ///
+   /// If wildcards are enabled, "[*]" matches every element of a list
+   /// and a "*" in place of a group name every child of a group.
+   ///
+   class path_tokenizer
+   {
+   public:
+      path_tokenizer(const char* begin, const char* end, bool wildcards = false) :
+         begin_(begin), pos_(begin), end_(end), wildcards_(wildcards)
+      {}
+
+      explicit path_tokenizer(const std::string& s, bool wildcards = false) :
+         begin_(s.data()), pos_(s.data()), end_(s.data() + s.size()), wildcards_(wildcards)
+      {}
+
+      ///
+      /// \brief Extracts the next token from the path.
+      ///
+      /// \param t Token that receives the result.
+      /// \returns false if the end of the path has been reached.
+      /// \throws cconfig::lookup_error with the offset of the malformed
+      /// token if the path cannot be parsed.
+      ///
+      bool next(path_token& t)
+      {
+         if(pos_ == end_)
+         {
+            if(pos_ == begin_)
+               fail(pos_, "Empty config path");
+            return false;
+         }
+
+         if(*pos_ == '[')
+         {
+            if(pos_ == begin_)
+               fail(pos_, "Index without group name in config path");
+
+            const char* start = ++pos_;
+            if(!scan_wildcard(t, path_token::any_index))
+               scan_number(t, start);
+            if(pos_ == end_ || *pos_ != ']')
+               fail(pos_, "Unterminated index in config path");
+            ++pos_;
+         }
+         else
+         {
+            if(pos_ != begin_)
+            {
+               if(*pos_ != '.')
+                  fail(pos_, "Unexpected character in config path");
+               ++pos_;
+            }
+
+            if(scan_wildcard(t, path_token::any_key))
+               return true;
+
+            const char* start = pos_;
+            while(pos_ != end_ && is_word_char(*pos_))
+               ++pos_;
+
+            if(pos_ == start)
+               fail(start, (start == end_ || *start == '.' || *start == '[')
+                  ? "Subsequent path separators found in config path"
+                  : "Unexpected character in config path");
+
+            if(is_number(start, pos_))
+            {
+               pos_ = start;
+               scan_number(t, start);
+            }
+            else
+            {
+               t.type = path_token::name;
+               t.text = boost::string_ref(start, pos_ - start);
+               t.value = 0;
+               t.offset = start - begin_;
+            }
+         }
+
+         return true;
+      }
+
+   private:
+      static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+      static bool is_word_char(char c)
+      {
+         return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+      }
+
+      static bool is_number(const char* begin, const char* end)
+      {
+         for(; begin != end; ++begin)
+            if(!is_digit(*begin))
+               return false;
+         return true;
+      }
+
+      void scan_number(path_token& t, const char* start)
+      {
+         unsigned int value = 0;
+         while(pos_ != end_ && is_digit(*pos_))
+         {
+            unsigned int digit = *pos_ - '0';
+            if(value > (std::numeric_limits<unsigned int>::max() - digit) / 10)
+               fail(start, "Index out of range in config path");
+            value = value * 10 + digit;
+            ++pos_;
+         }
+
+         if(pos_ == start)
+            fail(start, "Invalid index in config path");
+
+         t.type = path_token::index;
+         t.text = boost::string_ref(start, pos_ - start);
+         t.value = value;
+         t.offset = start - begin_;
+      }
+
+      bool scan_wildcard(path_token& t, path_token::token_type type)
+      {
+         if(!wildcards_ || pos_ == end_ || *pos_ != '*')
+            return false;
+
+         t.type = type;
+         t.text = boost::string_ref(pos_, 1);
+         t.value = 0;
+         t.offset = pos_ - begin_;
+         ++pos_;
+         return true;
+      }
+
+      void fail(const char* where, const char* message) const
+      {
+         throw cconfig::lookup_error(std::string(message) + " ("
+            + std::string(begin_, end_) + ") at offset "
+            + boost::lexical_cast<std::string>(where - begin_));
+      }
+
+      const char* begin_;
+      const char* pos_;
+      const char* end_;
+      bool wildcards_;
+   };
+
+   ///
+   /// \brief Hash function for group keys (32 bit FNV-1a).
+   ///
+   inline boost::uint32_t hash_key(boost::string_ref key)
+   {
+      boost::uint32_t h = 2166136261u;
+      for(boost::string_ref::const_iterator it = key.begin(); it != key.end(); ++it)
+      {
+         h ^= static_cast<unsigned char>(*it);
+         h *= 16777619u;
+      }
+      return h;
+   }
+
+   ///
+   /// \brief Function for splitting lookup paths.
+   /// 
+   /// This is kept for compatibility, lookups use path_tokenizer
+   /// directly instead of building a token list.
    ///
    /// \param s Lookup path that is to be splitted.
    /// \returns A deque containing strings or integers resembling group names
    /// and index numbers.
    ///
-   static token_list split(const std::string& s)
+   inline token_list split(const std::string& s)
    {
-      using namespace boost::xpressive;
-   
       token_list result;
-      std::deque<std::string> tokens;
-      std::string stripped = boost::algorithm::erase_all_copy(s, "]");
-      boost::algorithm::split(tokens, stripped, boost::algorithm::is_any_of(".["));
-   
-      sregex rexName = +_w;
-      sregex rexNumber = +_d;
-      smatch what;
+      path_tokenizer tokenizer(s);
+      path_token t;
    
-      BOOST_FOREACH(const std::string& t, tokens)
+      while(tokenizer.next(t))
       {
-         if(t.empty())
-            throw cconfig::lookup_error("Subsequent path separators found in config path (" + s + ")");
-   
-         if(regex_match(t, what, rexNumber)) {
-            result.push_back(boost::lexical_cast<unsigned int>(t));
-         }
-         else if(regex_match(t, what, rexName)) {
-            result.push_back(t);
-         }
-         else {
-            throw cconfig::lookup_error("Failed to parse config path (" + s + ") at token " + t);
-         }
+         if(t.type == path_token::index)
+            result.push_back(t.value);
+         else
+            result.push_back(std::string(t.text.data(), t.text.size()));
       }
    
       return result;
    }
 }
 
-namespace atom_detail {
-
 ///
-/// \brief Visitor for the variant in cconfig::atom
+/// \brief Interned group key.
 ///
-/// This visitor enables numeric and lexical casting from the allowed types in atom
-/// to arbitrary types by specializing for std::string.
+/// Every distinct key of a config tree is stored exactly once in the
+/// tree's symbol_table. Groups refer to their keys through symbol
+/// pointers, so key comparisons are pointer comparisons.
 ///
-template<typename T>
-struct visitor : public boost::static_visitor<T>
-{
-   // note: this class is specialized for std::string below
-   template <typename U>
-   typename boost::enable_if<boost::is_arithmetic<U>, const T>::type
-   operator()(const U& value) const { return boost::numeric_cast<T>(value); }
-
-   template <typename U>
-   typename boost::enable_if<boost::is_same<U, std::string>, const T>::type
-   operator()(const U& value) const { return boost::lexical_cast<T>(value); }
-};
-
-template<>
-struct visitor<std::string> : public boost::static_visitor<std::string>
+struct symbol
 {
-   template <typename U>
-   typename boost::enable_if<boost::is_arithmetic<U>, const std::string>::type
-   operator()(const U& value) const { return boost::lexical_cast<std::string>(value); }
-
-   template <typename U>
-   typename boost::enable_if<boost::is_same<U, std::string>, const std::string>::type
-   operator()(const U& value) const { return value; }
+   /// Key string, owned by the arena of the symbol table
+   boost::string_ref name;
+   /// util::hash_key() of name
+   boost::uint32_t hash;
+   /// Dense id, symbols are numbered in the order they were interned
+   boost::uint32_t id;
 };
 
-}
-
-class group;
-class list;
-class atom;
-
 ///
-/// \brief Abstract class resembling a single configuration setting.
+/// \brief Set of interned keys of a config tree.
 ///
-/// This is the base class for all config element types (group, list
-/// and atom). Their instances form a tree in memory which resembles
-/// the configuration setting hierarchy.
+/// Symbols and the hash table are allocated from the arena the table was
+/// created with. The table itself may live in the same arena.
 ///
-class element
+class symbol_table
 {
 public:
-   virtual ~element() {}
+   explicit symbol_table(cconfig::arena& a) :
+      arena_(&a),
+      table_(NULL),
+      size_(0),
+      capacity_(0)
+   {}
 
-   const group& as_group() const;
-   const list& as_list() const;
-   const atom& as_atom() const;
+   ///
+   /// \brief Returns the symbol for name, creating it if necessary.
+   ///
+   const symbol* intern(boost::string_ref name);
 
-   const element& operator[](const std::string& key) const;
-   const element& operator[](size_t index) const;
+   ///
+   /// \brief Returns the symbol for name or NULL if it was never interned.
+   ///
+   const symbol* find(boost::string_ref name) const { return find(name, util::hash_key(name)); }
+   const symbol* find(boost::string_ref name, boost::uint32_t hash) const;
 
-   template<typename T>
-   const T lookup(const std::string& path) const;
+   size_t size() const { return size_; }
 
-   template<typename T>
-   const T lookup(const std::string& path, const T& default_value) const;
+   /// Makes room for n symbols without growing the hash table
+   void reserve(size_t n);
 
-   template<typename T>
-   const T as() const;
+   cconfig::arena& get_arena() const { return *arena_; }
 
-   template<typename T>
-   operator T() const
+   /// Capacity of the hash table for n symbols
+   static size_t table_capacity(size_t n)
    {
-      return as<T>();
+      size_t capacity = 64;
+      while(capacity < n * 2)
+         capacity *= 2;
+      return capacity;
    }
 
-protected:
-   element() {}
-   element(const element&) {}
-
 private:
-   const element& recursive_lookup(const element& e, token_list tokens) const;
+   symbol_table(const symbol_table&);
+   symbol_table& operator=(const symbol_table&);
 
-   class visitor : public boost::static_visitor<const element&>
-   {
-   public:
-      visitor(const element& current) : current_(current) {}
-
-      const element& operator()(const std::string& s) const { return current_[s]; }
-      const element& operator()(unsigned int i) const { return current_[i]; }
-   
-   private:
-      const element& current_;
-   };
+   void grow() { rehash(capacity_ ? capacity_ * 2 : 64); }
+   void rehash(boost::uint32_t capacity);
 
+   cconfig::arena* arena_;
+   const symbol** table_;
+   boost::uint32_t size_;
+   boost::uint32_t capacity_;
 };
 
-class group : public element
+///
+/// \brief Precompiled lookup path.
+///
+/// A path is split and validated once upon construction and can then be
+/// used for any number of lookups. Lookups through a precompiled path
+/// walk the config tree directly without parsing the path string again.
+///
+/// Paths are meant to be created once (e.g. as static objects) for
+/// settings that are looked up frequently.
+///
+class path
 {
 public:
-   group() {}
+   ///
+   /// \brief A single path component (either a group key or a list index).
+   ///
+   struct component
+   {
+      explicit component(const std::string& k) : key(k), hash(util::hash_key(k)), index(0), is_index(false) {}
+      explicit component(unsigned int i) : key(), hash(0), index(i), is_index(true) {}
 
-   void insert(const std::string& key, element* value) { std::string key_(key); settings_.insert(key_, value); }
-   const element& get(const std::string& key) const;
+      std::string key;
+      /// Precomputed util::hash_key() of key
+      boost::uint32_t hash;
+      unsigned int index;
+      bool is_index;
+   };
 
-private:
-   typedef boost::ptr_map<std::string, element> setting_map_t;
-   setting_map_t settings_;
-   
-public:
-   typedef setting_map_t::const_iterator iterator;
-   iterator begin() const { return settings_.begin(); }
-   iterator end() const { return settings_.end(); }
-};
+   typedef std::vector<component> component_list;
+   typedef component_list::const_iterator iterator;
 
-class list : public element
-{
-public:
-   list() {}
+   ///
+   /// \brief Constructs a path from its string representation.
+   ///
+   /// \param s Lookup path, see util::path_tokenizer for the syntax.
+   /// \throws cconfig::lookup_error if the path is malformed.
+   ///
+   explicit path(const std::string& s) : str_(s) { compile(); }
+   explicit path(const char* s) : str_(s) { compile(); }
+
+   const std::string& str() const { return str_; }
 
-   void append(element* value) { settings_.push_back(value); }
-   const element& get(size_t index) const { return settings_[index]; }
+   size_t size() const { return components_.size(); }
+   bool empty() const { return components_.empty(); }
 
-   size_t size() const { return settings_.size(); }
-   bool empty() const { return settings_.empty(); }
+   iterator begin() const { return components_.begin(); }
+   iterator end() const { return components_.end(); }
 
 private:
-   typedef boost::ptr_vector<element> setting_list_t;
-   setting_list_t settings_;
+   void compile()
+   {
+      util::path_tokenizer tokenizer(str_);
+      util::path_token t;
+      while(tokenizer.next(t))
+      {
+         if(t.type == util::path_token::index)
+            components_.push_back(component(t.value));
+         else
+            components_.push_back(component(std::string(t.text.data(), t.text.size())));
+      }
+   }
 
-public:
-   typedef setting_list_t::const_iterator iterator;
-   iterator begin() const { return settings_.begin(); }
-   iterator end() const { return settings_.end(); }
+   std::string str_;
+   component_list components_;
 };
 
-class atom : public element
-{
-public:
-   explicit atom(const long& value) : value_(value) {}
-   explicit atom(const double& value) : value_(value) {}
-   explicit atom(const std::string& value) : value_(value) {}
-   explicit atom(const bool& value) : value_(value) {}
+#ifdef CCONFIG_HAS_PATH_LITERALS
 
-   const std::type_info& type() const { return value_.type(); }
+class element;
 
-   template<typename T>
-   const T as() const
-   {
-      return boost::apply_visitor(atom_detail::visitor<T>(), value_);
-   }
+namespace path_literal_detail {
 
-private:
-   boost::variant<bool, long, double, std::string> value_;
+///
+/// \brief Result of scanning a path literal, see util::path_tokenizer
+///
+enum status
+{
+   ok,
+   empty_path,
+   index_without_name,
+   unterminated_index,
+   unexpected_character,
+   subsequent_separators,
+   invalid_index,
+   index_out_of_range
 };
 
-inline const group& element::as_group() const
+///
+/// \brief Path component of a static_path with its key hash precomputed
+///
+struct hop
 {
-   try {
-      return dynamic_cast<const group&>(*this);
-   } catch(std::bad_cast&) {
-      // TODO: put location of element in hierarchy into error message
-      throw cconfig::lookup_error("Config setting is not a group");
-   }
-}
+   constexpr hop() : is_index(false), index(0), key(""), length(0), hash(0) {}
 
-inline const list& element::as_list() const
+   bool is_index;
+   unsigned int index;
+   const char* key;
+   size_t length;
+   boost::uint32_t hash;
+};
+
+constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+constexpr bool is_word_char(char c)
 {
-   try {
-      return dynamic_cast<const list&>(*this);
-   } catch(std::bad_cast&) {
-      // TODO: put location of element in hierarchy into error message
-      throw cconfig::lookup_error("Config setting is not a group");
-   }
+   return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
 }
 
-inline const atom& element::as_atom() const
+///
+/// \brief Scans a number at s[pos], the index in brackets or after a dot
+///
+constexpr status scan_index(const char* s, size_t n, size_t& pos, unsigned int& value)
 {
-   try {
-      return dynamic_cast<const atom&>(*this);
-   } catch(std::bad_cast&) {
-      // TODO: put location of element in hierarchy into error message
-      throw cconfig::lookup_error("Config setting is not a group");
+   const size_t start = pos;
+   value = 0;
+   while(pos != n && is_digit(s[pos]))
+   {
+      const unsigned int digit = s[pos] - '0';
+      if(value > (std::numeric_limits<unsigned int>::max() - digit) / 10)
+         return index_out_of_range;
+      value = value * 10 + digit;
+      ++pos;
    }
+   return pos == start ? invalid_index : ok;
 }
 
-inline const element& element::operator[](const std::string& key) const
+///
+/// \brief Tokenizes a path with the rules of util::path_tokenizer
+///
+/// \param hops Receives the components unless it is NULL
+/// \param count Receives the number of components
+///
+constexpr status scan(const char* s, size_t n, hop* hops, size_t& count)
 {
-   if(key.find_first_of(".[") != std::string::npos)
+   count = 0;
+   if(n == 0)
+      return empty_path;
+
+   size_t pos = 0;
+   while(pos != n)
    {
-      token_list tokens = util::split(key);
-      try {
-         return recursive_lookup(*this, tokens);
-      } catch(cconfig::lookup_error&) {
-         throw cconfig::lookup_error("Config setting not found (" + key + ")");
+      hop h;
+      if(s[pos] == '[')
+      {
+         if(pos == 0)
+            return index_without_name;
+         ++pos;
+         const status st = scan_index(s, n, pos, h.index);
+         if(st != ok)
+            return st;
+         if(pos == n || s[pos] != ']')
+            return unterminated_index;
+         ++pos;
+         h.is_index = true;
+      }
+      else
+      {
+         if(pos != 0)
+         {
+            if(s[pos] != '.')
+               return unexpected_character;
+            ++pos;
+         }
+
+         const size_t start = pos;
+         bool number = true;
+         for(; pos != n && is_word_char(s[pos]); ++pos)
+            number = number && is_digit(s[pos]);
+
+         if(pos == start)
+            return (start == n || s[start] == '.' || s[start] == '[')
+               ? subsequent_separators : unexpected_character;
+
+         if(number)
+         {
+            pos = start;
+            const status st = scan_index(s, n, pos, h.index);
+            if(st != ok)
+               return st;
+            h.is_index = true;
+         }
+         else
+         {
+            // util::hash_key() unrolled into a constant expression
+            h.key = s + start;
+            h.length = pos - start;
+            h.hash = 2166136261u;
+            for(size_t i = start; i != pos; ++i)
+            {
+               h.hash ^= static_cast<unsigned char>(s[i]);
+               h.hash *= 16777619u;
+            }
+         }
       }
+
+      if(hops != NULL)
+         hops[count] = h;
+      ++count;
    }
-   else
-      return this->as_group().get(key);
+   return ok;
 }
 
-inline const element& element::operator[](size_t index) const
+constexpr status check(const char* s, size_t n)
 {
-   return this->as_list().get(index);
+   size_t count = 0;
+   return scan(s, n, NULL, count);
 }
 
-template<typename T>
-inline const T element::lookup(const std::string& path) const
+constexpr size_t count(const char* s, size_t n)
 {
-   token_list tokens = util::split(path);
-   try {
-      return recursive_lookup(*this, tokens).as<T>();
-   } catch(cconfig::lookup_error&) {
-      throw cconfig::lookup_error("Config setting not found (" + path + ")");
-   }
+   size_t count = 0;
+   return scan(s, n, NULL, count) == ok ? count : 0;
 }
 
-template<typename T>
-inline const T element::lookup(const std::string& path, const T& default_value) const
-{
-   try {
-      return lookup<T>(path);
-   }
-   catch(cconfig::lookup_error&) {
-      return default_value;
-   }
+template<size_t I, size_t N>
+struct walker;
+
 }
 
-inline const element& element::recursive_lookup(const element& e, token_list tokens) const
+///
+/// \brief Lookup path tokenized and hashed at compile time.
+///
+/// Instances are created with the CCONFIG_PATH() macro from string
+/// literals. Lookups through a static_path are unrolled into one hop per
+/// component, with the key hashes and indices as constants.
+///
+template<size_t N>
+class static_path
 {
-   if(tokens.empty())
-      return e;
+public:
+   constexpr static_path(const char* s, size_t length) : str_(s), length_(length), hops_()
+   {
+      size_t count = 0;
+      path_literal_detail::scan(s, length, hops_, count);
+   }
 
-   boost::variant<std::string, unsigned int> t = tokens.front();
-   tokens.pop_front();
-   
-   const element& next(boost::apply_visitor(visitor(e), t));
-   return recursive_lookup(next, tokens);
-}
+   std::string str() const { return std::string(str_, length_); }
+
+   constexpr size_t size() const { return N; }
+
+   ///
+   /// \brief Walks from e along the path.
+   ///
+   /// \returns Pointer to the element or NULL if there is no such setting.
+   ///
+   const element* find(const element& e) const;
+
+private:
+   const char* str_;
+   size_t length_;
+   path_literal_detail::hop hops_[N > 0 ? N : 1];
+};
+
+#endif
+
+namespace atom_detail {
 
+///
+/// \brief Conversion of the value held by cconfig::atom
+///
+/// This visitor enables numeric and lexical casting from the allowed types in atom
+/// to arbitrary types by specializing for std::string.
+///
 template<typename T>
-inline const T element::as() const
+struct visitor : public boost::static_visitor<T>
 {
-   return this->as_atom().as<T>();
-}
+   // note: this class is specialized for std::string below
+   template <typename U>
+   typename boost::enable_if<boost::is_arithmetic<U>, const T>::type
+   operator()(const U& value) const { return boost::numeric_cast<T>(value); }
 
-inline const element& group::get(const std::string& key) const
+   template <typename U>
+   typename boost::enable_if<boost::is_same<U, boost::string_ref>, const T>::type
+   operator()(const U& value) const { return boost::lexical_cast<T>(value.data(), value.size()); }
+};
+
+template<>
+struct visitor<std::string> : public boost::static_visitor<std::string>
+{
+   template <typename U>
+   typename boost::enable_if<boost::is_arithmetic<U>, const std::string>::type
+   operator()(const U& value) const { return boost::lexical_cast<std::string>(value); }
+
+   template <typename U>
+   typename boost::enable_if<boost::is_same<U, boost::string_ref>, const std::string>::type
+   operator()(const U& value) const { return std::string(value.data(), value.size()); }
+};
+
+}
+
+class group;
+class list;
+class atom;
+
+namespace compact_detail { class copier; }
+
+///
+/// \brief Memory held by a config subtree, see element::memory_usage().
+///
+/// Arena memory that is not assigned to any element (e.g. the hash table
+/// of the symbol table and unused space at the end of arena blocks) is
+/// not included.
+///
+struct memory_stats
+{
+   memory_stats() : keys(0), strings(0), containers(0), nodes(0) {}
+
+   /// Interned keys of the groups, each distinct key counted once
+   size_t keys;
+   /// Strings that are not stored inline in their atom, including
+   /// strings referring to a mapped file
+   size_t strings;
+   /// Child arrays, hash indexes and the values of typed arrays,
+   /// including capacity that is not used
+   size_t containers;
+   /// The group, list and atom objects themselves
+   size_t nodes;
+
+   size_t total() const { return keys + strings + containers + nodes; }
+};
+
+///
+/// \brief View of a contiguous range of values.
+///
+template<typename T>
+class span
+{
+public:
+   typedef T value_type;
+   typedef T* iterator;
+
+   span() : data_(NULL), size_(0) {}
+   span(T* data, size_t size) : data_(data), size_(size) {}
+
+   T* data() const { return data_; }
+   size_t size() const { return size_; }
+   bool empty() const { return size_ == 0; }
+   T& operator[](size_t index) const { return data_[index]; }
+
+   iterator begin() const { return data_; }
+   iterator end() const { return data_ + size_; }
+
+private:
+   T* data_;
+   size_t size_;
+};
+
+///
+/// \brief Abstract class resembling a single configuration setting.
+///
+/// This is the base class for all config element types (group, list
+/// and atom). Their instances form a tree in memory which resembles
+/// the configuration setting hierarchy.
+///
+class element
+{
+public:
+   ///
+   /// \brief Kind of a config element, stored in every element.
+   ///
+   enum kind_type { group_kind, list_kind, atom_kind };
+
+   kind_type kind() const { return static_cast<kind_type>(kind_); }
+   bool is_group() const { return kind_ == group_kind; }
+   bool is_list() const { return kind_ == list_kind; }
+   bool is_atom() const { return kind_ == atom_kind; }
+
+   ///
+   /// \brief Checked conversions to the concrete element type.
+   ///
+   /// \throws cconfig::lookup_error if the element is of another kind.
+   ///
+   const group& as_group() const;
+   const list& as_list() const;
+   const atom& as_atom() const;
+
+   ///
+   /// \brief Unchecked conversions to the concrete element type.
+   ///
+   /// These must only be used after checking kind() or one of the
+   /// is_* functions.
+   ///
+   const group& as_group_unchecked() const;
+   const list& as_list_unchecked() const;
+   const atom& as_atom_unchecked() const;
+
+   const element& operator[](const std::string& key) const;
+   const element& operator[](const cconfig::path& p) const;
+   const element& operator[](size_t index) const;
+
+   template<typename T>
+   const T lookup(const std::string& path) const;
+
+   template<typename T>
+   const T lookup(const std::string& path, const T& default_value) const;
+
+   template<typename T>
+   const T lookup(const cconfig::path& p) const;
+
+   template<typename T>
+   const T lookup(const cconfig::path& p, const T& default_value) const;
+
+   ///
+   /// \brief Non-throwing variant of operator[] for lookup paths.
+   ///
+   /// \returns Pointer to the element or NULL if there is no such setting.
+   /// \throws cconfig::lookup_error only if the path itself is malformed.
+   ///
+   const element* find(const std::string& path) const;
+   const element* find(const cconfig::path& p) const;
+
+   ///
+   /// \brief Checks if a setting exists.
+   ///
+   bool contains(const std::string& path) const;
+   bool contains(const cconfig::path& p) const;
+
+   ///
+   /// \brief Non-throwing variant of lookup.
+   ///
+   /// \returns The converted value or an empty optional if the setting
+   /// does not exist or is not an atom.
+   ///
+   template<typename T>
+   boost::optional<T> try_lookup(const std::string& path) const;
+
+   template<typename T>
+   boost::optional<T> try_lookup(const cconfig::path& p) const;
+
+#ifdef CCONFIG_HAS_PATH_LITERALS
+   ///
+   /// \brief Lookups through paths created with CCONFIG_PATH().
+   ///
+   template<size_t N>
+   const element& operator[](const static_path<N>& p) const;
+
+   template<typename T, size_t N>
+   const T lookup(const static_path<N>& p) const;
+
+   template<typename T, size_t N>
+   const T lookup(const static_path<N>& p, const T& default_value) const;
+
+   template<size_t N>
+   const element* find(const static_path<N>& p) const { return p.find(*this); }
+
+   template<size_t N>
+   bool contains(const static_path<N>& p) const { return p.find(*this) != NULL; }
+
+   template<typename T, size_t N>
+   boost::optional<T> try_lookup(const static_path<N>& p) const { return try_as<T>(p.find(*this)); }
+#endif
+
+   template<typename T>
+   const T as() const;
+
+   /// Converts all elements of a list, see list::as_vector()
+   template<typename T>
+   std::vector<T> as_vector() const;
+
+   /// Values of an array without copying, see list::as_span()
+   template<typename T>
+   span<T> as_span() const;
+
+   ///
+   /// \brief Returns the memory held by this element and all elements below it.
+   ///
+   /// Elements shared by several parents are counted once per parent.
+   ///
+   memory_stats memory_usage() const;
+
+   template<typename T>
+   operator T() const
+   {
+      return as<T>();
+   }
+
+protected:
+   explicit element(kind_type kind) : kind_(static_cast<unsigned char>(kind)) {}
+   element(const element& e) : kind_(e.kind_) {}
+
+   // elements live in an arena and are never destroyed individually
+   ~element() {}
+
+private:
+   const element& walk(const std::string& path) const;
+   const element& walk(const cconfig::path& p) const;
+
+   const element* find_child(boost::string_ref key) const;
+   const element* find_child(boost::string_ref key, boost::uint32_t hash) const;
+   const element* find_child(size_t index) const;
+
+   template<typename T>
+   static boost::optional<T> try_as(const element* e);
+
+   static void count_memory(const element& e, memory_stats& stats, std::vector<const symbol*>& keys);
+
+   // stored as a single byte so that derived classes can use the padding
+   unsigned char kind_;
+};
+
+///
+/// \brief Config group, maps keys to child elements.
+///
+/// Children are kept in a contiguous array in insertion order. Small
+/// groups (which are by far the most common ones) store their children
+/// inline and are searched linearly. Larger groups additionally maintain
+/// an open addressing hash index with precomputed key hashes.
+///
+/// Groups are allocated from an arena like all other elements, keys are
+/// interned in a symbol table shared by the whole tree.
+///
+class group : public element
+{
+public:
+   struct value_type
+   {
+      const symbol* key;
+      element* value;
+   };
+
+   explicit group(symbol_table& symbols) :
+      element(group_kind),
+      symbols_(&symbols),
+      settings_(inline_),
+      size_(0),
+      capacity_(inline_capacity),
+      index_(NULL),
+      index_capacity_(0)
+   {}
+
+   ///
+   /// \brief Inserts a child element.
+   ///
+   /// The key is interned in the symbol table of the group, the element
+   /// must have been allocated from the arena of that table. If the key
+   /// already exists the new element is ignored.
+   ///
+   void insert(boost::string_ref key, element* value) { insert(symbols_->intern(key), value); }
+   void insert(const symbol* key, element* value);
+
+   ///
+   /// \brief Replaces the element of the child at position in insertion order.
+   ///
+   /// The new element may belong to another tree, whose memory must then
+   /// outlive this group.
+   ///
+   void replace(size_t position, element* value) { settings_[position].value = value; }
+
+   const element& get(boost::string_ref key) const;
+   const element* get_if(boost::string_ref key) const { return get_if(key, util::hash_key(key)); }
+   const element* get_if(boost::string_ref key, boost::uint32_t hash) const;
+   const element* get_if(const symbol* key) const;
+
+   size_t size() const { return size_; }
+   bool empty() const { return size_ == 0; }
+
+   /// Symbol table holding the keys of this group
+   const symbol_table& symbols() const { return *symbols_; }
+
+private:
+   friend class element;
+   friend class compact_detail::copier;
+
+   group(const group&);
+   group& operator=(const group&);
+
+   /// Groups up to this size are searched linearly without an index
+   static const size_t linear_search_limit = 8;
+   /// Number of children stored inline
+   static const size_t inline_capacity = 4;
+
+   ///
+   /// \brief Slot of the hash index.
+   ///
+   /// position is the index into settings_ plus one, so that a zero
+   /// marks an empty slot.
+   ///
+   struct slot
+   {
+      boost::uint32_t hash;
+      boost::uint32_t position;
+   };
+
+   void index_insert(boost::uint32_t hash, size_t position);
+   void rebuild_index();
+
+   symbol_table* symbols_;
+   value_type* settings_;
+   boost::uint32_t size_;
+   boost::uint32_t capacity_;
+   slot* index_;
+   boost::uint32_t index_capacity_;
+   value_type inline_[inline_capacity];
+   
+public:
+   typedef const value_type* iterator;
+   iterator begin() const { return settings_; }
+   iterator end() const { return settings_ + size_; }
+};
+
+///
+/// \brief Config list, holds elements by index.
+///
+/// Arrays of integers, floating point numbers and booleans store their
+/// values contiguously (booleans as packed bits) instead of as separate
+/// atoms. They can still be accessed like any other list: the first
+/// access to one of their elements creates atoms for all values, which
+/// is safe to happen concurrently in readers of a finished tree.
+///
+class list : public element
+{
+public:
+   /// Storage of the elements
+   enum storage_type { generic_storage, long_storage, double_storage, bool_storage };
+
+   explicit list(cconfig::arena& a) :
+      element(list_kind),
+      arena_(&a),
+      settings_(NULL),
+      values_(NULL),
+      views_(NULL),
+      size_(0),
+      capacity_(0),
+      storage_(generic_storage)
+   {}
+
+   ///
+   /// \brief Appends a child element.
+   ///
+   /// The element must have been allocated from the same arena as the
+   /// list. Lists with typed storage are converted to generic storage.
+   ///
+   void append(element* value);
+
+   ///
+   /// \brief Appends a value.
+   ///
+   /// The first value appended to an empty list selects the typed storage
+   /// for its type. Values that don't match the storage are appended as
+   /// atoms, which converts the list to generic storage.
+   ///
+   void append_long(long value);
+   void append_double(double value);
+   void append_bool(bool value);
+
+   /// Appends the elements of another list, typed values are copied
+   void append(const list& other);
+
+   /// Makes room for at least n elements
+   void reserve(size_t n);
+   /// Replaces an element, see group::replace()
+   void replace(size_t index, element* value);
+   const element& get(size_t index) const;
+   const element* get_if(size_t index) const;
+
+   size_t size() const { return size_; }
+   bool empty() const { return size_ == 0; }
+
+   storage_type storage() const { return static_cast<storage_type>(storage_); }
+   /// The values of lists with long storage, NULL otherwise
+   const long* long_values() const { return storage_ == long_storage ? static_cast<const long*>(values_) : NULL; }
+   /// The values of lists with double storage, NULL otherwise
+   const double* double_values() const { return storage_ == double_storage ? static_cast<const double*>(values_) : NULL; }
+   /// Value at index of a list with bool storage (unchecked)
+   bool bool_value(size_t index) const { return (static_cast<const unsigned char*>(values_)[index >> 3] >> (index & 7)) & 1; }
+
+   ///
+   /// \brief Converts all elements to T.
+   ///
+   /// Arrays with typed storage are converted in a single pass without
+   /// creating elements. Conversions to narrower types check the range
+   /// once for the whole array with its minimum and maximum.
+   ///
+   /// \throws The exceptions of atom::as<T>() for elements that cannot be
+   ///         converted, cconfig::lookup_error for elements that are no atoms.
+   ///
+   template<typename T>
+   std::vector<T> as_vector() const;
+
+   ///
+   /// \brief Returns the values of an array with typed storage without copying.
+   ///
+   /// T is const long or const double. The values stay valid as long as
+   /// the tree.
+   ///
+   /// \throws cconfig::lookup_error if the list doesn't have the matching storage.
+   ///
+   template<typename T>
+   span<T> as_span() const;
+
+private:
+   friend class element;
+   friend class compact_detail::copier;
+
+   list(const list&);
+   list& operator=(const list&);
+
+   const element& at(size_t index) const;
+   /// Atoms for the values of typed storage
+   const atom* views() const;
+   const atom* create_views() const;
+   void construct_atoms(atom* atoms) const;
+   bool select_storage(storage_type t);
+   size_t value_bytes(size_t n) const;
+   void reserve_values(size_t n);
+   void make_generic();
+
+   cconfig::arena* arena_;
+   element** settings_;
+   void* values_;
+   mutable boost::atomic<atom*> views_;
+   boost::uint32_t size_;
+   boost::uint32_t capacity_;
+   unsigned char storage_;
+
+public:
+   class iterator;
+   friend class iterator;
+
+   class iterator : public boost::iterator_facade<iterator, const element, boost::random_access_traversal_tag>
+   {
+   public:
+      iterator() : list_(NULL), index_(0) {}
+      iterator(const list* l, size_t index) : list_(l), index_(index) {}
+
+   private:
+      friend class boost::iterator_core_access;
+
+      const element& dereference() const { return list_->at(index_); }
+      bool equal(const iterator& other) const { return index_ == other.index_; }
+      void increment() { ++index_; }
+      void decrement() { --index_; }
+      void advance(std::ptrdiff_t n) { index_ += n; }
+      std::ptrdiff_t distance_to(const iterator& other) const
+      {
+         return static_cast<std::ptrdiff_t>(other.index_) - static_cast<std::ptrdiff_t>(index_);
+      }
+
+      const list* list_;
+      size_t index_;
+   };
+
+   iterator begin() const { return iterator(this, 0); }
+   iterator end() const { return iterator(this, size_); }
+};
+
+///
+/// \brief Config value (bool, long, double or string).
+///
+/// Atoms are stored as compact tagged cells of 16 bytes on common 64 bit
+/// platforms. Numbers and booleans are held inline, strings are held as
+/// length and pointer into the arena or inline if they are short enough.
+///
+class atom : public element
+{
+public:
+   explicit atom(const long& value) : element(atom_kind), tag_(long_tag), size_(0) { payload_.l = value; }
+   explicit atom(const double& value) : element(atom_kind), tag_(double_tag), size_(0) { payload_.d = value; }
+   explicit atom(const bool& value) : element(atom_kind), tag_(bool_tag), size_(0) { payload_.b = value; }
+
+   ///
+   /// \brief Constructs a string atom.
+   ///
+   /// Short strings are stored inline, longer ones are copied into the arena.
+   ///
+   atom(cconfig::arena& a, boost::string_ref value) : element(atom_kind)
+   {
+      assign_string(value.size() <= sizeof(payload_.small) ? value : a.copy_string(value));
+   }
+
+   ///
+   /// \brief Constructs a string atom referring to external memory.
+   ///
+   /// Longer strings are not copied, the referenced bytes must stay valid
+   /// for the lifetime of the atom (e.g. arena memory or a mapped file).
+   ///
+   explicit atom(boost::string_ref value) : element(atom_kind) { assign_string(value); }
+
+   ///
+   /// \brief Returns the type of the stored value.
+   ///
+   /// Strings are reported as std::string, which is also the type
+   /// returned by as<std::string>().
+   ///
+   const std::type_info& type() const
+   {
+      switch(tag_)
+      {
+      case bool_tag:   return typeid(bool);
+      case long_tag:   return typeid(long);
+      case double_tag: return typeid(double);
+      default:         return typeid(std::string);
+      }
+   }
+
+   ///
+   /// \brief Converts the value to T.
+   ///
+   /// Reading the stored type (long, double, bool, std::string or
+   /// boost::string_ref for strings) does not convert anything, other
+   /// types are converted with numeric_cast or lexical_cast.
+   ///
+   template<typename T>
+   T as() const { return convert<T>(); }
+
+   ///
+   /// \brief Exact type accessors.
+   ///
+   /// \throws cconfig::lookup_error if the value has another type.
+   ///
+   long get_long() const { return tag_ == long_tag ? payload_.l : mismatch<long>("an integer"); }
+   double get_double() const { return tag_ == double_tag ? payload_.d : mismatch<double>("a floating point value"); }
+   bool get_bool() const { return tag_ == bool_tag ? payload_.b : mismatch<bool>("a boolean"); }
+   /// The string without copying, valid as long as the tree
+   boost::string_ref get_string_ref() const { return is_string() ? str() : mismatch<boost::string_ref>("a string"); }
+
+   bool is_long() const { return tag_ == long_tag; }
+   bool is_double() const { return tag_ == double_tag; }
+   bool is_bool() const { return tag_ == bool_tag; }
+   bool is_string() const { return tag_ == string_tag || tag_ == small_string_tag; }
+
+   /// Atoms are equal if they hold the same type and value
+   friend bool operator==(const atom& a, const atom& b)
+   {
+      if(a.tag_ != b.tag_)
+         return a.is_string() && b.is_string() && a.str() == b.str();
+      switch(a.tag_)
+      {
+      case bool_tag:   return a.payload_.b == b.payload_.b;
+      case long_tag:   return a.payload_.l == b.payload_.l;
+      case double_tag: return a.payload_.d == b.payload_.d;
+      default:         return a.str() == b.str();
+      }
+   }
+
+   friend bool operator!=(const atom& a, const atom& b) { return !(a == b); }
+
+private:
+   friend class element;
+   friend class compact_detail::copier;
+
+   enum tag_type { bool_tag, long_tag, double_tag, string_tag, small_string_tag };
+
+   void assign_string(boost::string_ref value)
+   {
+      size_ = static_cast<boost::uint32_t>(value.size());
+      if(value.size() <= sizeof(payload_.small))
+      {
+         tag_ = small_string_tag;
+         if(!value.empty())
+            std::memcpy(payload_.small, value.data(), value.size());
+      }
+      else
+      {
+         tag_ = string_tag;
+         payload_.s = value.data();
+      }
+   }
+
+   template<typename T>
+   const T convert() const
+   {
+      atom_detail::visitor<T> v;
+      switch(tag_)
+      {
+      case bool_tag:   return v(payload_.b);
+      case long_tag:   return v(payload_.l);
+      case double_tag: return v(payload_.d);
+      default:         return v(str());
+      }
+   }
+
+   template<typename T>
+   static T mismatch(const char* expected)
+   {
+      throw cconfig::lookup_error(std::string("Config setting is not ") + expected);
+   }
+
+   boost::string_ref str() const
+   {
+      return boost::string_ref(tag_ == small_string_tag ? payload_.small : payload_.s, size_);
+   }
+
+   unsigned char tag_;
+   /// Length of string values
+   boost::uint32_t size_;
+   union
+   {
+      bool b;
+      long l;
+      double d;
+      const char* s;
+      char small[8];
+   } payload_;
+};
+
+template<>
+inline long atom::as<long>() const { return tag_ == long_tag ? payload_.l : convert<long>(); }
+
+template<>
+inline double atom::as<double>() const { return tag_ == double_tag ? payload_.d : convert<double>(); }
+
+template<>
+inline bool atom::as<bool>() const { return tag_ == bool_tag ? payload_.b : convert<bool>(); }
+
+template<>
+inline std::string atom::as<std::string>() const
+{
+   if(!is_string())
+      return convert<std::string>();
+   const boost::string_ref s = str();
+   return std::string(s.data(), s.size());
+}
+
+template<>
+inline boost::string_ref atom::as<boost::string_ref>() const { return get_string_ref(); }
+
+inline const group& element::as_group() const
+{
+   if(!is_group())
+      // TODO: put location of element in hierarchy into error message
+      throw cconfig::lookup_error("Config setting is not a group");
+   return as_group_unchecked();
+}
+
+inline const list& element::as_list() const
+{
+   if(!is_list())
+      // TODO: put location of element in hierarchy into error message
+      throw cconfig::lookup_error("Config setting is not a list");
+   return as_list_unchecked();
+}
+
+inline const atom& element::as_atom() const
+{
+   if(!is_atom())
+      // TODO: put location of element in hierarchy into error message
+      throw cconfig::lookup_error("Config setting is not an atom");
+   return as_atom_unchecked();
+}
+
+inline const group& element::as_group_unchecked() const
+{
+   return static_cast<const group&>(*this);
+}
+
+inline const list& element::as_list_unchecked() const
+{
+   return static_cast<const list&>(*this);
+}
+
+inline const atom& element::as_atom_unchecked() const
+{
+   return static_cast<const atom&>(*this);
+}
+
+inline const element& element::operator[](const std::string& key) const
+{
+   if(key.find_first_of(".[") != std::string::npos)
+      return walk(key);
+   else
+      return this->as_group().get(key);
+}
+
+inline const element& element::operator[](const cconfig::path& p) const
+{
+   return walk(p);
+}
+
+inline const element& element::operator[](size_t index) const
+{
+   return this->as_list().get(index);
+}
+
+inline const element* element::find(const std::string& path) const
+{
+   util::path_tokenizer tokenizer(path);
+   util::path_token t;
+
+   const element* e = this;
+   while(tokenizer.next(t))
+   {
+      // keep tokenizing after a miss so that malformed paths are
+      // always reported, regardless of the config contents
+      if(e == NULL)
+         continue;
+
+      if(t.type == util::path_token::index)
+         e = e->find_child(t.value);
+      else
+         e = e->find_child(t.text);
+   }
+   return e;
+}
+
+inline const element* element::find(const cconfig::path& p) const
+{
+   const element* e = this;
+   for(cconfig::path::iterator it = p.begin(); it != p.end() && e != NULL; ++it)
+   {
+      if(it->is_index)
+         e = e->find_child(it->index);
+      else
+         e = e->find_child(it->key, it->hash);
+   }
+   return e;
+}
+
+inline bool element::contains(const std::string& path) const
+{
+   return find(path) != NULL;
+}
+
+inline bool element::contains(const cconfig::path& p) const
+{
+   return find(p) != NULL;
+}
+
+template<typename T>
+inline boost::optional<T> element::try_lookup(const std::string& path) const
+{
+   return try_as<T>(find(path));
+}
+
+template<typename T>
+inline boost::optional<T> element::try_lookup(const cconfig::path& p) const
+{
+   return try_as<T>(find(p));
+}
+
+template<typename T>
+inline const T element::lookup(const std::string& path) const
+{
+   return walk(path).as<T>();
+}
+
+template<typename T>
+inline const T element::lookup(const std::string& path, const T& default_value) const
+{
+   boost::optional<T> value = try_lookup<T>(path);
+   return value ? *value : default_value;
+}
+
+template<typename T>
+inline const T element::lookup(const cconfig::path& p) const
+{
+   return walk(p).as<T>();
+}
+
+template<typename T>
+inline const T element::lookup(const cconfig::path& p, const T& default_value) const
+{
+   boost::optional<T> value = try_lookup<T>(p);
+   return value ? *value : default_value;
+}
+
+inline const element& element::walk(const std::string& path) const
+{
+   const element* e = find(path);
+   if(e == NULL)
+      throw cconfig::lookup_error("Config setting not found (" + path + ")");
+   return *e;
+}
+
+inline const element& element::walk(const cconfig::path& p) const
+{
+   const element* e = find(p);
+   if(e == NULL)
+      throw cconfig::lookup_error("Config setting not found (" + p.str() + ")");
+   return *e;
+}
+
+#ifdef CCONFIG_HAS_PATH_LITERALS
+template<size_t N>
+inline const element& element::operator[](const static_path<N>& p) const
+{
+   const element* e = p.find(*this);
+   if(e == NULL)
+      throw cconfig::lookup_error("Config setting not found (" + p.str() + ")");
+   return *e;
+}
+
+template<typename T, size_t N>
+inline const T element::lookup(const static_path<N>& p) const
+{
+   return operator[](p).template as<T>();
+}
+
+template<typename T, size_t N>
+inline const T element::lookup(const static_path<N>& p, const T& default_value) const
+{
+   boost::optional<T> value = try_lookup<T>(p);
+   return value ? *value : default_value;
+}
+#endif
+
+inline const element* element::find_child(boost::string_ref key) const
+{
+   return is_group() ? as_group_unchecked().get_if(key) : NULL;
+}
+
+inline const element* element::find_child(boost::string_ref key, boost::uint32_t hash) const
+{
+   return is_group() ? as_group_unchecked().get_if(key, hash) : NULL;
+}
+
+inline const element* element::find_child(size_t index) const
+{
+   return is_list() ? as_list_unchecked().get_if(index) : NULL;
+}
+
+template<typename T>
+inline boost::optional<T> element::try_as(const element* e)
+{
+   if(e == NULL || !e->is_atom())
+      return boost::none;
+   return e->as_atom_unchecked().as<T>();
+}
+
+template<typename T>
+inline const T element::as() const
+{
+   return this->as_atom().as<T>();
+}
+
+template<typename T>
+inline std::vector<T> element::as_vector() const
+{
+   return this->as_list().as_vector<T>();
+}
+
+template<typename T>
+inline span<T> element::as_span() const
+{
+   return this->as_list().as_span<T>();
+}
+
+inline const symbol* symbol_table::intern(boost::string_ref name)
+{
+   const boost::uint32_t hash = util::hash_key(name);
+   const symbol* existing = find(name, hash);
+   if(existing != NULL)
+      return existing;
+
+   if((size_ + 1) * 2 > capacity_)
+      grow();
+
+   symbol* s = new(*arena_) symbol;
+   s->name = arena_->copy_string(name);
+   s->hash = hash;
+   s->id = size_++;
+
+   const size_t mask = capacity_ - 1;
+   size_t i = hash & mask;
+   while(table_[i] != NULL)
+      i = (i + 1) & mask;
+   table_[i] = s;
+   return s;
+}
+
+inline const symbol* symbol_table::find(boost::string_ref name, boost::uint32_t hash) const
+{
+   if(table_ == NULL)
+      return NULL;
+
+   const size_t mask = capacity_ - 1;
+   for(size_t i = hash & mask; table_[i] != NULL; i = (i + 1) & mask)
+   {
+      if(table_[i]->hash == hash && table_[i]->name == name)
+         return table_[i];
+   }
+   return NULL;
+}
+
+inline void symbol_table::reserve(size_t n)
+{
+   if(n * 2 > capacity_)
+      rehash(static_cast<boost::uint32_t>(table_capacity(n)));
+}
+
+inline void symbol_table::rehash(boost::uint32_t capacity)
+{
+   // the old table stays in the arena, growing geometrically keeps the
+   // waste below the size of the final table
+   const symbol** table = arena_->allocate_array<const symbol*>(capacity);
+   std::fill(table, table + capacity, static_cast<const symbol*>(NULL));
+
+   const size_t mask = capacity - 1;
+   for(size_t j = 0; j < capacity_; j++)
+   {
+      if(table_[j] == NULL)
+         continue;
+      size_t i = table_[j]->hash & mask;
+      while(table[i] != NULL)
+         i = (i + 1) & mask;
+      table[i] = table_[j];
+   }
+
+   table_ = table;
+   capacity_ = capacity;
+}
+
+inline const element& group::get(boost::string_ref key) const
+{
+   const element* e = get_if(key);
+   if(e == NULL)
+      throw cconfig::lookup_error("Element not found (" + key.to_string() + ")");
+   return *e;
+}
+
+inline void group::insert(const symbol* key, element* value)
+{
+   if(get_if(key) != NULL)
+      return;
+
+   if(size_ == capacity_)
+   {
+      value_type* settings = symbols_->get_arena().allocate_array<value_type>(capacity_ * 2);
+      std::copy(settings_, settings_ + size_, settings);
+      settings_ = settings;
+      capacity_ *= 2;
+   }
+
+   value_type& v = settings_[size_++];
+   v.key = key;
+   v.value = value;
+
+   if(index_ == NULL)
+   {
+      if(size_ > linear_search_limit)
+         rebuild_index();
+   }
+   else if(size_ * 2 > index_capacity_)
+      rebuild_index();
+   else
+      index_insert(key->hash, size_ - 1);
+}
+
+inline const element* group::get_if(boost::string_ref key, boost::uint32_t hash) const
+{
+   const symbol* s = symbols_->find(key, hash);
+   return s != NULL ? get_if(s) : NULL;
+}
+
+inline const element* group::get_if(const symbol* key) const
+{
+   if(index_ == NULL)
+   {
+      for(iterator it = begin(); it != end(); ++it)
+         if(it->key == key)
+            return it->value;
+      return NULL;
+   }
+
+   const size_t mask = index_capacity_ - 1;
+   for(size_t i = key->hash & mask; ; i = (i + 1) & mask)
+   {
+      const slot& s = index_[i];
+      if(s.position == 0)
+         return NULL;
+      if(s.hash == key->hash && settings_[s.position - 1].key == key)
+         return settings_[s.position - 1].value;
+   }
+}
+
+inline void group::index_insert(boost::uint32_t hash, size_t position)
+{
+   const size_t mask = index_capacity_ - 1;
+   size_t i = hash & mask;
+   while(index_[i].position != 0)
+      i = (i + 1) & mask;
+   index_[i].hash = hash;
+   index_[i].position = static_cast<boost::uint32_t>(position + 1);
+}
+
+inline void group::rebuild_index()
+{
+   // keep the load factor at or below one half
+   boost::uint32_t capacity = 16;
+   while(capacity < size_ * 2)
+      capacity *= 2;
+
+   index_ = symbols_->get_arena().allocate_array<slot>(capacity);
+   index_capacity_ = capacity;
+   std::memset(index_, 0, capacity * sizeof(slot));
+   for(size_t i = 0; i < size_; i++)
+      index_insert(settings_[i].key->hash, i);
+}
+
+inline void list::append(element* value)
+{
+   if(storage_ != generic_storage)
+      make_generic();
+
+   if(size_ == capacity_)
+   {
+      boost::uint32_t capacity = capacity_ ? capacity_ * 2 : 4;
+      element** settings = arena_->allocate_array<element*>(capacity);
+      if(size_ != 0)
+         std::memcpy(settings, settings_, size_ * sizeof(element*));
+      settings_ = settings;
+      capacity_ = capacity;
+   }
+   settings_[size_++] = value;
+}
+
+inline void list::append_long(long value)
+{
+   if(!select_storage(long_storage))
+      return append(new(*arena_) atom(value));
+   static_cast<long*>(values_)[size_++] = value;
+}
+
+inline void list::append_double(double value)
+{
+   if(!select_storage(double_storage))
+      return append(new(*arena_) atom(value));
+   static_cast<double*>(values_)[size_++] = value;
+}
+
+inline void list::append_bool(bool value)
+{
+   if(!select_storage(bool_storage))
+      return append(new(*arena_) atom(value));
+   unsigned char& bits = static_cast<unsigned char*>(values_)[size_ >> 3];
+   if((size_ & 7) == 0)
+      bits = 0;
+   bits |= static_cast<unsigned char>(value) << (size_ & 7);
+   ++size_;
+}
+
+inline void list::append(const list& other)
+{
+   if(other.storage_ == generic_storage || (storage_ != other.storage_ && size_ != 0))
+   {
+      reserve(size_ + other.size_);
+      for(iterator it = other.begin(); it != other.end(); ++it)
+         append(const_cast<element*>(&*it));
+      return;
+   }
+
+   if(other.size_ == 0)
+      return;
+   select_storage(static_cast<storage_type>(other.storage_));
+   reserve(size_ + other.size_);
+   if(storage_ == bool_storage)
+   {
+      for(size_t i = 0; i < other.size_; i++)
+         append_bool(other.bool_value(i));
+   }
+   else
+   {
+      std::memcpy(static_cast<char*>(values_) + value_bytes(size_), other.values_, value_bytes(other.size_));
+      size_ += other.size_;
+   }
+}
+
+inline void list::reserve(size_t n)
+{
+   if(n <= capacity_)
+      return;
+   if(storage_ != generic_storage)
+      return reserve_values(n);
+
+   element** settings = arena_->allocate_array<element*>(n);
+   if(size_ != 0)
+      std::memcpy(settings, settings_, size_ * sizeof(element*));
+   settings_ = settings;
+   capacity_ = static_cast<boost::uint32_t>(n);
+}
+
+inline void list::replace(size_t index, element* value)
+{
+   if(storage_ != generic_storage)
+      make_generic();
+   settings_[index] = value;
+}
+
+namespace list_detail {
+
+///
+/// \brief True if numeric_cast<T> never fails for values of type S.
+///
+template<typename T, typename S>
+struct always_fits : boost::integral_constant<bool, boost::is_same<T, S>::value
+   || (boost::is_floating_point<T>::value && (boost::is_integral<S>::value || sizeof(T) >= sizeof(S)))>
+{};
+
+template<typename T, typename S>
+inline void convert_values(const S* values, size_t n, std::vector<T>& result, boost::false_type)
+{
+   result.reserve(n);
+   for(size_t i = 0; i < n; i++)
+      result.push_back(atom(values[i]).as<T>());
+}
+
+template<typename T, typename S>
+inline void convert_values(const S* values, size_t n, std::vector<T>& result, boost::true_type)
+{
+   if(n == 0)
+      return;
+
+   if(!always_fits<T, S>::value)
+   {
+      S lowest = values[0];
+      S highest = values[0];
+      for(size_t i = 1; i < n; i++)
+      {
+         lowest = values[i] < lowest ? values[i] : lowest;
+         highest = values[i] > highest ? values[i] : highest;
+      }
+      boost::numeric_cast<T>(lowest);
+      boost::numeric_cast<T>(highest);
+   }
+
+   // converts implicitly, the range has been checked
+   result.assign(values, values + n);
+}
+
+/// Converts values of typed storage like atom::as<T>() would
+template<typename T, typename S>
+inline void convert_values(const S* values, size_t n, std::vector<T>& result)
+{
+   convert_values(values, n, result, boost::is_arithmetic<T>());
+}
+
+template<typename T>
+inline const T* typed_values(const list& l);
+
+template<>
+inline const long* typed_values<long>(const list& l)
+{
+   if(l.storage() != list::long_storage)
+      throw cconfig::lookup_error("Config setting is not an integer array");
+   return l.long_values();
+}
+
+template<>
+inline const double* typed_values<double>(const list& l)
+{
+   if(l.storage() != list::double_storage)
+      throw cconfig::lookup_error("Config setting is not a floating point array");
+   return l.double_values();
+}
+
+}
+
+template<typename T>
+inline std::vector<T> list::as_vector() const
+{
+   std::vector<T> result;
+   switch(storage_)
+   {
+   case long_storage:
+      list_detail::convert_values(long_values(), size_, result);
+      break;
+   case double_storage:
+      list_detail::convert_values(double_values(), size_, result);
+      break;
+   case bool_storage:
+      result.reserve(size_);
+      for(size_t i = 0; i < size_; i++)
+         result.push_back(atom(bool_value(i)).as<T>());
+      break;
+   default:
+      result.reserve(size_);
+      for(size_t i = 0; i < size_; i++)
+         result.push_back(settings_[i]->as<T>());
+      break;
+   }
+   return result;
+}
+
+template<typename T>
+inline span<T> list::as_span() const
+{
+   BOOST_STATIC_ASSERT(boost::is_const<T>::value);
+   return span<T>(list_detail::typed_values<typename boost::remove_const<T>::type>(*this), size_);
+}
+
+inline const element& list::at(size_t index) const
+{
+   if(storage_ == generic_storage)
+      return *settings_[index];
+   return views()[index];
+}
+
+inline const atom* list::views() const
+{
+   const atom* v = views_.load(boost::memory_order_acquire);
+   return v != NULL ? v : create_views();
+}
+
+inline const atom* list::create_views() const
+{
+   atom* views = static_cast<atom*>(arena::allocate_detached(size_ * sizeof(atom)));
+   construct_atoms(views);
+
+   atom* expected = NULL;
+   if(views_.compare_exchange_strong(expected, views, boost::memory_order_acq_rel, boost::memory_order_acquire))
+   {
+      arena_->attach(views);
+      return views;
+   }
+   // another thread was faster
+   arena::free_detached(views);
+   return expected;
+}
+
+/// Constructs atoms of the values of typed storage in uninitialized memory
+inline void list::construct_atoms(atom* atoms) const
+{
+   for(size_t i = 0; i < size_; i++)
+   {
+      switch(storage_)
+      {
+      case long_storage: new(atoms + i) atom(static_cast<const long*>(values_)[i]); break;
+      case double_storage: new(atoms + i) atom(static_cast<const double*>(values_)[i]); break;
+      default: new(atoms + i) atom(bool_value(i)); break;
+      }
+   }
+}
+
+/// Prepares appending a value of typed storage t, returns false if the storage doesn't match
+inline bool list::select_storage(storage_type t)
+{
+   if(storage_ != t)
+   {
+      if(storage_ != generic_storage || size_ != 0)
+         return false;
+      storage_ = static_cast<unsigned char>(t);
+      capacity_ = 0;
+   }
+
+   // views are created for finished trees, but must not miss values
+   if(views_.load(boost::memory_order_relaxed) != NULL)
+      views_.store(NULL, boost::memory_order_relaxed);
+   if(size_ == capacity_)
+      reserve_values(capacity_ ? capacity_ * 2 : 4);
+   return true;
+}
+
+inline size_t list::value_bytes(size_t n) const
+{
+   switch(storage_)
+   {
+   case long_storage: return n * sizeof(long);
+   case double_storage: return n * sizeof(double);
+   default: return (n + 7) / 8;
+   }
+}
+
+inline void list::reserve_values(size_t n)
+{
+   void* values = arena_->allocate(value_bytes(n));
+   if(size_ != 0)
+      std::memcpy(values, values_, value_bytes(size_));
+   values_ = values;
+   capacity_ = static_cast<boost::uint32_t>(n);
+}
+
+/// Turns typed storage into pointers to atoms of the values
+inline void list::make_generic()
+{
+   // the atoms are allocated from the arena rather than taken from the
+   // detached views, so that all nodes of the tree lie in arena blocks
+   atom* atoms = size_ != 0 ? arena_->allocate_array<atom>(size_) : NULL;
+   construct_atoms(atoms);
+   const boost::uint32_t capacity = size_ > 4 ? size_ : 4;
+   element** settings = arena_->allocate_array<element*>(capacity);
+   for(size_t i = 0; i < size_; i++)
+      settings[i] = atoms + i;
+
+   settings_ = settings;
+   capacity_ = capacity;
+   values_ = NULL;
+   views_.store(NULL, boost::memory_order_relaxed);
+   storage_ = generic_storage;
+}
+
+inline const element& list::get(size_t index) const
+{
+   const element* e = get_if(index);
+   if(e == NULL)
+      throw cconfig::lookup_error("Index out of range (" + boost::lexical_cast<std::string>(index) + ")");
+   return *e;
+}
+
+inline const element* list::get_if(size_t index) const
+{
+   if(index >= size_)
+      return NULL;
+   return &at(index);
+}
+
+inline memory_stats element::memory_usage() const
+{
+   memory_stats stats;
+   std::vector<const symbol*> keys;
+   count_memory(*this, stats, keys);
+
+   std::sort(keys.begin(), keys.end());
+   keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+   for(std::vector<const symbol*>::const_iterator it = keys.begin(); it != keys.end(); ++it)
+      stats.keys += sizeof(symbol) + (*it)->name.size();
+   return stats;
+}
+
+inline void element::count_memory(const element& e, memory_stats& stats, std::vector<const symbol*>& keys)
 {
-   setting_map_t::const_iterator it = settings_.find(key);
-   if(it == settings_.end())
-      throw cconfig::lookup_error("Element not found (" + key + ")");
-   return *it->second;
+   switch(e.kind())
+   {
+   case group_kind:
+      {
+         const group& g = e.as_group_unchecked();
+         stats.nodes += sizeof(group);
+         if(g.settings_ != g.inline_)
+            stats.containers += g.capacity_ * sizeof(group::value_type);
+         stats.containers += g.index_capacity_ * sizeof(group::slot);
+         for(group::iterator it = g.begin(); it != g.end(); ++it)
+         {
+            keys.push_back(it->key);
+            count_memory(*it->value, stats, keys);
+         }
+      }
+      break;
+   case list_kind:
+      {
+         const list& l = e.as_list_unchecked();
+         stats.nodes += sizeof(list);
+         if(l.storage_ == list::generic_storage)
+         {
+            stats.containers += l.capacity_ * sizeof(element*);
+            for(size_t i = 0; i < l.size_; i++)
+               count_memory(*l.settings_[i], stats, keys);
+         }
+         else
+         {
+            stats.containers += l.value_bytes(l.capacity_);
+            if(l.views_.load(boost::memory_order_acquire) != NULL)
+               stats.containers += l.size_ * sizeof(atom);
+         }
+      }
+      break;
+   case atom_kind:
+      {
+         const atom& a = e.as_atom_unchecked();
+         stats.nodes += sizeof(atom);
+         if(a.tag_ == atom::string_tag)
+            stats.strings += a.size_;
+      }
+      break;
+   }
+}
+
+#ifdef CCONFIG_HAS_PATH_LITERALS
+namespace path_literal_detail {
+
+template<size_t I, size_t N>
+struct walker
+{
+   static const element* find(const hop* hops, const element* e)
+   {
+      const hop& h = hops[I];
+      if(h.is_index)
+         e = e->is_list() ? e->as_list_unchecked().get_if(h.index) : NULL;
+      else
+         e = e->is_group() ? e->as_group_unchecked().get_if(boost::string_ref(h.key, h.length), h.hash) : NULL;
+      return e == NULL ? NULL : walker<I + 1, N>::find(hops, e);
+   }
+};
+
+template<size_t N>
+struct walker<N, N>
+{
+   static const element* find(const hop*, const element* e) { return e; }
+};
+
+}
+
+template<size_t N>
+inline const element* static_path<N>::find(const element& e) const
+{
+   return path_literal_detail::walker<0, N>::find(hops_, &e);
 }
+#endif
 
 }
 
+#ifdef CCONFIG_HAS_PATH_LITERALS
+///
+/// \brief Creates a cconfig::static_path from a string literal.
+///
+/// The path is checked when the code is compiled, malformed paths fail
+/// a static_assert instead of throwing cconfig::lookup_error.
+///
+/// \code
+/// const long a = f.lookup<long>(CCONFIG_PATH("settings.list[1].a"));
+/// \endcode
+///
+#define CCONFIG_PATH(literal) \
+   ([]() -> const auto& { \
+      static_assert(::cconfig::path_literal_detail::check(literal, sizeof(literal) - 1) == \
+         ::cconfig::path_literal_detail::ok, "Malformed config path literal " literal); \
+      static constexpr ::cconfig::static_path< \
+         ::cconfig::path_literal_detail::count(literal, sizeof(literal) - 1)> p(literal, sizeof(literal) - 1); \
+      return p; \
+   }())
+#endif
+
 #endif
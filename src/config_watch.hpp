@@ -0,0 +1,372 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_WATCH_HPP_
+#define CONFIG_WATCH_HPP_
+
+#include <string>
+#include <exception>
+
+#include <boost/atomic.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#ifdef __linux__
+#define CCONFIG_INOTIFY
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "config_input.hpp"
+#include "config_live.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Options of a cconfig::watcher.
+///
+struct watch_options
+{
+   watch_options() :
+      debounce(100),
+      max_delay(1000),
+      poll_interval(1000),
+      polling(false)
+   {}
+
+   /// Time in milliseconds without further writes before reloading
+   unsigned int debounce;
+   /// Maximum time in milliseconds from the first write to the reload,
+   /// even if the file keeps being written
+   unsigned int max_delay;
+   /// Interval in milliseconds of checking the file when polling
+   unsigned int poll_interval;
+   /// Poll even if the system can notify about changes (inotify on Linux)
+   bool polling;
+   /// Called on the watcher thread if reading or reloading the file fails,
+   /// the previous config stays current then
+   boost::function<void (const std::exception&)> error_handler;
+};
+
+///
+/// \brief Reloads a live_file on a background thread when its file changes.
+///
+/// On Linux the directory of the file is watched with inotify, so that
+/// editors replacing the file by renaming are noticed as well. Elsewhere,
+/// or if inotify is not available, the modification time, size and inode
+/// of the file are polled.
+///
+/// Bursts of writes are debounced. Before reloading, the content is
+/// hashed and compared with the loaded one, so touching or rewriting the
+/// file with the same content does not parse it again. Reloads go through
+/// live_file::reload(), which notifies subscribers of the changes.
+///
+class watcher : boost::noncopyable
+{
+public:
+   explicit watcher(live_file& f, const watch_options& options = watch_options()) :
+      file_(f),
+      filename_(f.filename()),
+      options_(options),
+      stopped_(false),
+      hash_(0),
+      inotify_(-1),
+      wake_(-1)
+   {
+      try
+      {
+         hash_ = content_hash();
+      }
+      catch(const cconfig::exception&)
+      {
+         // the first readable content is reloaded
+      }
+      stamp_ = current_stamp();
+
+#ifdef CCONFIG_INOTIFY
+      if(!options_.polling)
+         start_inotify();
+#endif
+      thread_ = boost::thread(boost::bind(&watcher::run, this));
+   }
+
+   ~watcher()
+   {
+      stop();
+#ifdef CCONFIG_INOTIFY
+      if(inotify_ >= 0)
+         ::close(inotify_);
+      if(wake_ >= 0)
+         ::close(wake_);
+#endif
+   }
+
+   /// Stops watching and waits for a running reload to finish
+   void stop()
+   {
+      {
+         boost::mutex::scoped_lock lock(mutex_);
+         stopped_ = true;
+      }
+      condition_.notify_all();
+#ifdef CCONFIG_INOTIFY
+      if(wake_ >= 0)
+      {
+         const boost::uint64_t one = 1;
+         ssize_t written = ::write(wake_, &one, sizeof(one));
+         (void)written;
+      }
+#endif
+      if(thread_.joinable())
+         thread_.join();
+   }
+
+   /// Returns true if changes are noticed by polling
+   bool polling() const { return inotify_ < 0; }
+
+private:
+   void run()
+   {
+      // waits with a negative timeout only return false when stopped,
+      // failures of inotify fall back to polling
+      while(wait_for_change(-1))
+      {
+         const boost::posix_time::ptime first = now();
+         for(;;)
+         {
+            const long remaining = static_cast<long>(options_.max_delay) - elapsed(first);
+            const long timeout = remaining < static_cast<long>(options_.debounce) ? remaining : options_.debounce;
+            if(timeout <= 0 || !wait_for_change(timeout))
+               break;
+         }
+         if(stopped_)
+            return;
+         reload();
+      }
+   }
+
+   void reload()
+   {
+      try
+      {
+         const boost::uint64_t h = content_hash();
+         if(h == hash_)
+            return;
+         file_.reload();
+         hash_ = h;
+      }
+      catch(const std::exception& e)
+      {
+         if(options_.error_handler)
+            options_.error_handler(e);
+      }
+   }
+
+   ///
+   /// \brief Waits for a change of the file.
+   ///
+   /// \returns false if the timeout in milliseconds (if not negative)
+   /// expired or the watcher was stopped.
+   ///
+   bool wait_for_change(long timeout)
+   {
+#ifdef CCONFIG_INOTIFY
+      if(inotify_ >= 0)
+         return wait_inotify(timeout);
+#endif
+      return wait_polling(timeout);
+   }
+
+   bool wait_polling(long timeout)
+   {
+      const boost::posix_time::ptime start = now();
+      for(;;)
+      {
+         long step = options_.poll_interval;
+         if(timeout >= 0 && timeout - elapsed(start) < step)
+            step = timeout - elapsed(start);
+         if(step > 0)
+         {
+            boost::mutex::scoped_lock lock(mutex_);
+            if(!stopped_)
+               condition_.timed_wait(lock, boost::posix_time::milliseconds(step));
+         }
+         if(stopped_)
+            return false;
+
+         const cconfig::file_stamp s = current_stamp();
+         if(s != stamp_)
+         {
+            stamp_ = s;
+            return true;
+         }
+         if(timeout >= 0 && elapsed(start) >= timeout)
+            return false;
+      }
+   }
+
+#ifdef CCONFIG_INOTIFY
+   void start_inotify()
+   {
+      const std::string::size_type slash = filename_.find_last_of('/');
+      const std::string directory = slash == std::string::npos ? "." : filename_.substr(0, slash + 1);
+      basename_ = slash == std::string::npos ? filename_ : filename_.substr(slash + 1);
+
+      inotify_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+      if(inotify_ < 0)
+         return;
+      wake_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if(wake_ < 0 || ::inotify_add_watch(inotify_, directory.c_str(),
+            IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO) < 0)
+      {
+         // fall back to polling
+         ::close(inotify_);
+         inotify_ = -1;
+      }
+   }
+
+   bool wait_inotify(long timeout)
+   {
+      const boost::posix_time::ptime start = now();
+      for(;;)
+      {
+         long remaining = -1;
+         if(timeout >= 0 && (remaining = timeout - elapsed(start)) < 0)
+            remaining = 0;
+
+         pollfd fds[2] = { { inotify_, POLLIN, 0 }, { wake_, POLLIN, 0 } };
+         const int result = ::poll(fds, 2, static_cast<int>(remaining));
+         if(stopped_)
+            return false;
+         if(result < 0 && errno != EINTR)
+         {
+            inotify_failed();
+            return wait_polling(timeout < 0 ? -1 : remaining);
+         }
+         if(result == 0)
+            return false;
+         if(result > 0 && read_events())
+            return true;
+      }
+   }
+
+   /// Reports that waiting for events failed and switches to polling
+   void inotify_failed()
+   {
+      ::close(inotify_);
+      inotify_ = -1;
+      if(options_.error_handler)
+         options_.error_handler(cconfig::exception("Unable to wait for changes, polling instead (" + filename_ + ")"));
+   }
+
+   /// Returns true if one of the pending events concerns the file
+   bool read_events()
+   {
+      char buffer[4096] __attribute__((aligned(__alignof__(inotify_event))));
+      bool found = false;
+      ssize_t size;
+      while((size = ::read(inotify_, buffer, sizeof(buffer))) > 0)
+      {
+         for(const char* p = buffer; p < buffer + size; )
+         {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            if(event->len != 0 && basename_ == event->name)
+               found = true;
+            p += sizeof(inotify_event) + event->len;
+         }
+      }
+      return found;
+   }
+#endif
+
+   /// Returns an empty stamp if the file does not exist
+   cconfig::file_stamp current_stamp() const
+   {
+      cconfig::file_stamp s;
+      cconfig::file_stamp::of(filename_, s);
+      return s;
+   }
+
+   /// 64 bit FNV-1a hash of the file contents
+   boost::uint64_t content_hash() const
+   {
+      std::string content;
+      cconfig::read_file(filename_, content);
+
+      boost::uint64_t h = 14695981039346656037ull;
+      for(std::string::const_iterator it = content.begin(); it != content.end(); ++it)
+      {
+         h ^= static_cast<unsigned char>(*it);
+         h *= 1099511628211ull;
+      }
+      return h;
+   }
+
+   static boost::posix_time::ptime now()
+   {
+      return boost::posix_time::microsec_clock::universal_time();
+   }
+
+   static long elapsed(const boost::posix_time::ptime& since)
+   {
+      return static_cast<long>((now() - since).total_milliseconds());
+   }
+
+   live_file& file_;
+   const std::string filename_;
+   const watch_options options_;
+
+   boost::atomic<bool> stopped_;
+   boost::mutex mutex_;
+   boost::condition_variable condition_;
+
+   /// Hash of the loaded content
+   boost::uint64_t hash_;
+   /// Last seen state of the file when polling
+   cconfig::file_stamp stamp_;
+
+   /// Read by polling(), reset by the watcher thread if inotify fails
+   boost::atomic<int> inotify_;
+   int wake_;
+   std::string basename_;
+
+   boost::thread thread_;
+};
+
+}
+
+#endif
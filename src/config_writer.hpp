@@ -0,0 +1,502 @@
+/**
+ * Copyright (c) 2010-2012, Johannes Asal
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES,  INCLUDING,  BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS  FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED AND ON ANY THEORY OF LIABILITY,  WHETHER  IN
+ * CONTRACT,  STRICT  LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFIG_WRITER_HPP_
+#define CONFIG_WRITER_HPP_
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#ifdef __unix__
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+#include "config_tree.hpp"
+#include "config_number.hpp"
+#include "config_events.hpp"
+
+namespace cconfig {
+
+///
+/// \brief Writes configs in the syntax of grammar/Config.g.
+///
+/// The writer receives the structure of a config as events, either from
+/// the calling code, from write() for existing trees or from
+/// parse_events() to reformat a config. Output is collected in a buffer
+/// of fixed size and passed on whenever it is full, so memory use only
+/// depends on the nesting depth.
+///
+/// Events that would not result in a valid config (e.g. values without
+/// a key inside groups or arrays with elements of different types) throw
+/// a cconfig::exception, the output written up to that point is kept.
+///
+/// \code
+/// cconfig::writer w(std::cout);
+/// w.on_group_begin("server");
+/// w.on_atom("port", cconfig::atom(8080L));
+/// w.on_group_end();
+/// w.finish();
+/// \endcode
+///
+class writer : public event_handler, boost::noncopyable
+{
+public:
+   enum style
+   {
+      /// One setting per line, indented with tabs
+      pretty,
+      /// No whitespace at all
+      compact
+   };
+
+   explicit writer(std::ostream& out, style s = pretty) :
+      out_(&out), fd_(-1), style_(s), size_(0)
+   {
+      stack_.push_back(frame(group_frame));
+   }
+
+#ifdef __unix__
+   ///
+   /// \brief Constructs a writer for a file descriptor, which is not closed.
+   ///
+   explicit writer(int fd, style s = pretty) :
+      out_(NULL), fd_(fd), style_(s), size_(0)
+   {
+      stack_.push_back(frame(group_frame));
+   }
+#endif
+
+   /// Flushes the remaining output, errors are ignored, see finish()
+   ~writer()
+   {
+      try
+      {
+         flush();
+      }
+      catch(...)
+      {}
+   }
+
+   void on_group_begin(boost::string_ref key)
+   {
+      begin_value(key, group_frame);
+      if(stack_.back().kind == group_frame)
+         put(style_ == pretty ? " {\n" : "{");
+      else
+         put(style_ == pretty ? "{\n" : "{");
+      stack_.push_back(frame(group_frame));
+   }
+
+   void on_group_end()
+   {
+      end_container(group_frame);
+      indent(stack_.size() - 1);
+      put('}');
+      if(stack_.back().kind == group_frame && style_ == pretty)
+         put('\n');
+   }
+
+   void on_list_begin(boost::string_ref key)
+   {
+      begin_value(key, list_frame);
+      put('(');
+      stack_.push_back(frame(list_frame));
+   }
+
+   void on_list_end()
+   {
+      const bool empty = stack_.back().count == 0;
+      end_container(list_frame);
+      if(!empty && style_ == pretty)
+      {
+         put('\n');
+         indent(stack_.size() - 1);
+      }
+      put(')');
+      end_definition();
+   }
+
+   void on_array_begin(boost::string_ref key)
+   {
+      begin_value(key, array_frame);
+      put('[');
+      stack_.push_back(frame(array_frame));
+   }
+
+   void on_array_end()
+   {
+      end_container(array_frame);
+      put(']');
+      end_definition();
+   }
+
+   void on_atom(boost::string_ref key, const cconfig::atom& value)
+   {
+      const tag t = value.is_long() ? long_tag : value.is_double() ? double_tag
+         : value.is_bool() ? bool_tag : string_tag;
+
+      // everything is checked before anything is written
+      char number[32];
+      size_t length = 0;
+      if(t == long_tag)
+         length = util::format_long(value.get_long(), number);
+      else if(t == double_tag)
+         length = format_double(value.get_double(), number);
+
+      frame& f = stack_.back();
+      if(f.kind == array_frame && f.count != 0 && f.element != t)
+         throw cconfig::exception("Array elements must have the same type");
+      begin_value(key, atom_frame);
+      f.element = t;
+
+      switch(t)
+      {
+      case long_tag: case double_tag: put(boost::string_ref(number, length)); break;
+      case bool_tag: put(value.get_bool() ? "true" : "false"); break;
+      default: put_string(value.get_string_ref()); break;
+      }
+      end_definition();
+   }
+
+   void on_include(boost::string_ref path)
+   {
+      if(stack_.back().kind != group_frame)
+         throw cconfig::exception("Include directives are only allowed inside groups");
+      indent(stack_.size() - 1);
+      put("@include ");
+      put_string(path);
+      if(style_ == pretty)
+         put('\n');
+      stack_.back().count++;
+   }
+
+   ///
+   /// \brief Writes an element with all of its children.
+   ///
+   /// Lists with typed storage are written as arrays, all other lists as
+   /// lists. Parsing the output yields an equal tree.
+   ///
+   void write(boost::string_ref key, const element& e)
+   {
+      if(e.is_atom())
+         on_atom(key, e.as_atom_unchecked());
+      else if(e.is_group())
+      {
+         on_group_begin(key);
+         write_settings(e.as_group_unchecked());
+         on_group_end();
+      }
+      else
+         write_list(key, e.as_list_unchecked());
+   }
+
+   ///
+   /// \brief Writes the settings of a group at the current position.
+   ///
+   /// For the root group of a tree this writes the whole config.
+   ///
+   void write_settings(const group& g)
+   {
+      for(group::iterator it = g.begin(); it != g.end(); ++it)
+         write(it->key->name, *it->value);
+   }
+
+   ///
+   /// \brief Writes the buffered output.
+   ///
+   /// \throws cconfig::exception if writing fails.
+   ///
+   void flush()
+   {
+      if(size_ == 0)
+         return;
+
+      const size_t n = size_;
+      size_ = 0;
+      if(out_ != NULL)
+      {
+         out_->write(buffer_, n);
+         if(!*out_)
+            throw cconfig::exception("Unable to write config");
+         return;
+      }
+
+#ifdef __unix__
+      for(size_t written = 0; written < n; )
+      {
+         const ssize_t r = ::write(fd_, buffer_ + written, n - written);
+         if(r < 0 && errno == EINTR)
+            continue;
+         if(r < 0)
+            throw cconfig::exception("Unable to write config");
+         written += r;
+      }
+#endif
+   }
+
+   ///
+   /// \brief Checks that all groups and lists have been closed and flushes the output.
+   ///
+   /// \throws cconfig::exception if writing fails or the config is incomplete.
+   ///
+   void finish()
+   {
+      if(stack_.size() != 1)
+         throw cconfig::exception("Config is incomplete, groups or lists are still open");
+      flush();
+      if(out_ != NULL)
+         out_->flush();
+   }
+
+private:
+   enum frame_kind { group_frame, list_frame, array_frame, atom_frame };
+   enum tag { long_tag, double_tag, bool_tag, string_tag };
+
+   struct frame
+   {
+      explicit frame(frame_kind k) : kind(k), count(0), element(long_tag) {}
+
+      frame_kind kind;
+      size_t count;
+      /// Type of the elements of arrays
+      tag element;
+   };
+
+   static const size_t buffer_size = 16 * 1024;
+
+   static bool is_key(boost::string_ref key)
+   {
+      if(key.empty() || !(std::isalpha(static_cast<unsigned char>(key[0])) || key[0] == '_'))
+         return false;
+      for(size_t i = 1; i < key.size(); i++)
+         if(!(std::isalnum(static_cast<unsigned char>(key[i])) || key[i] == '_'))
+            return false;
+      return key != "true" && key != "false";
+   }
+
+   ///
+   /// \brief Writes what precedes a value: its key or the separator from
+   /// the previous element.
+   ///
+   void begin_value(boost::string_ref key, frame_kind kind)
+   {
+      frame& f = stack_.back();
+      if(f.kind == group_frame)
+      {
+         if(!is_key(key))
+            throw cconfig::exception("Invalid setting name '" + key.to_string() + "'");
+         indent(stack_.size() - 1);
+         put(key);
+         if(kind != group_frame)
+            put(style_ == pretty ? " = " : "=");
+      }
+      else
+      {
+         if(!key.empty())
+            throw cconfig::exception("Elements of lists have no name ('" + key.to_string() + "')");
+         if(f.kind == array_frame && kind != atom_frame)
+            throw cconfig::exception("Arrays may only contain atoms");
+
+         if(f.count != 0)
+            put(',');
+         if(style_ == pretty)
+         {
+            if(f.kind == list_frame)
+            {
+               put('\n');
+               indent(stack_.size() - 1);
+            }
+            else if(f.count != 0)
+               put(' ');
+         }
+      }
+      f.count++;
+   }
+
+   /// Terminates a variable definition inside a group
+   void end_definition()
+   {
+      if(stack_.back().kind == group_frame)
+         put(style_ == pretty ? ";\n" : ";");
+   }
+
+   void end_container(frame_kind kind)
+   {
+      if(stack_.size() == 1 || stack_.back().kind != kind)
+         throw cconfig::exception("Unbalanced end of group, list or array");
+      stack_.pop_back();
+   }
+
+   void write_list(boost::string_ref key, const list& l)
+   {
+      switch(l.storage())
+      {
+      case list::long_storage:
+         on_array_begin(key);
+         for(size_t i = 0; i < l.size(); i++)
+         {
+            begin_value(boost::string_ref(), atom_frame);
+            put_long(l.long_values()[i]);
+         }
+         on_array_end();
+         break;
+      case list::double_storage:
+         on_array_begin(key);
+         for(size_t i = 0; i < l.size(); i++)
+         {
+            begin_value(boost::string_ref(), atom_frame);
+            put_double(l.double_values()[i]);
+         }
+         on_array_end();
+         break;
+      case list::bool_storage:
+         on_array_begin(key);
+         for(size_t i = 0; i < l.size(); i++)
+         {
+            begin_value(boost::string_ref(), atom_frame);
+            put(l.bool_value(i) ? "true" : "false");
+         }
+         on_array_end();
+         break;
+      default:
+         on_list_begin(key);
+         for(list::iterator it = l.begin(); it != l.end(); ++it)
+            write(boost::string_ref(), *it);
+         on_list_end();
+      }
+   }
+
+   void indent(size_t depth)
+   {
+      if(style_ == pretty)
+         for(size_t i = 0; i < depth; i++)
+            put('\t');
+   }
+
+   void put(char c)
+   {
+      if(size_ == buffer_size)
+         flush();
+      buffer_[size_++] = c;
+   }
+
+   void put(boost::string_ref s)
+   {
+      for(size_t i = 0; i < s.size(); )
+      {
+         if(size_ == buffer_size)
+            flush();
+         const size_t n = std::min(s.size() - i, buffer_size - size_);
+         std::memcpy(buffer_ + size_, s.data() + i, n);
+         size_ += n;
+         i += n;
+      }
+   }
+
+   void put_long(long value)
+   {
+      char digits[24];
+      put(boost::string_ref(digits, util::format_long(value, digits)));
+   }
+
+   static size_t format_double(double value, char* buffer)
+   {
+      const size_t n = util::format_double(value, buffer);
+      if(n == 0)
+         throw cconfig::exception("Infinity and NaN cannot be written to configs");
+      return n;
+   }
+
+   void put_double(double value)
+   {
+      char digits[32];
+      put(boost::string_ref(digits, format_double(value, digits)));
+   }
+
+   void put_string(boost::string_ref s)
+   {
+      static const char hex[] = "01234567";
+      put('"');
+      for(size_t i = 0; i < s.size(); i++)
+      {
+         const unsigned char c = s[i];
+         switch(c)
+         {
+         case '"': put("\\\""); break;
+         case '\\': put("\\\\"); break;
+         case '\b': put("\\b"); break;
+         case '\t': put("\\t"); break;
+         case '\n': put("\\n"); break;
+         case '\f': put("\\f"); break;
+         case '\r': put("\\r"); break;
+         default:
+            if(c < 0x20 || c == 0x7f)
+            {
+               // always three digits, so that a following digit isn't taken
+               // for a part of the escape sequence
+               const char octal[] = { '\\', hex[c >> 6], hex[(c >> 3) & 7], hex[c & 7] };
+               put(boost::string_ref(octal, sizeof(octal)));
+            }
+            else
+               put(static_cast<char>(c));
+         }
+      }
+      put('"');
+   }
+
+   std::ostream* out_;
+   int fd_;
+   style style_;
+   std::vector<frame> stack_;
+   char buffer_[buffer_size];
+   size_t size_;
+};
+
+///
+/// \brief Writes a whole config tree.
+///
+/// \throws cconfig::exception if writing fails or the tree contains values
+///         that cannot be written (see writer).
+///
+inline void write_config(const group& root, std::ostream& out, writer::style s = writer::pretty)
+{
+   writer w(out, s);
+   w.write_settings(root);
+   w.finish();
+}
+
+}
+
+#endif
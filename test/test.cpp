@@ -27,7 +27,29 @@
  */
 
 #include "config_file.hpp"
+#include "config_batch.hpp"
+#include "config_column.hpp"
+#include "config_events.hpp"
+#include "config_live.hpp"
+#include "config_overlay.hpp"
+#include "config_watch.hpp"
+#include "config_writer.hpp"
 #include <iostream>
+#include <fstream>
+#include <sstream>
+
+static void print_changes(const cconfig::live_file::snapshot_type&, const cconfig::change_list& changes)
+{
+	for(cconfig::change_list::const_iterator it = changes.begin(); it != changes.end(); ++it)
+		std::cout << it->path << " changed" << std::endl;
+}
+
+struct atom_counter : cconfig::event_handler
+{
+	atom_counter() : atoms(0) {}
+	void on_atom(boost::string_ref, const cconfig::atom&) { atoms++; }
+	int atoms;
+};
 
 int main()
 {
@@ -35,5 +57,219 @@ int main()
 	std::cout << f["settings.list[1].a"].as<std::string>() << std::endl;
 	std::cout << f["settings.subgroup.test"].as<std::string>() << std::endl;
 	std::cout << f["settings.array[2]"].as<int>() << std::endl;
+
+	const cconfig::path p("settings.list[1].a");
+	std::cout << f[p].as<std::string>() << std::endl;
+	std::cout << f.lookup<int>(cconfig::path("settings.array[2]")) << std::endl;
+	std::cout << f.lookup<int>(cconfig::path("settings.array[3]"), 4) << std::endl;
+#ifdef CCONFIG_HAS_PATH_LITERALS
+	std::cout << f[CCONFIG_PATH("settings.list[1].a")].as<std::string>() << std::endl;
+	std::cout << f.lookup<int>(CCONFIG_PATH("settings.array.2")) << f.contains(CCONFIG_PATH("settings.missing")) << std::endl;
+#endif
+
+	std::cout << f.contains("settings.subgroup") << f.contains("settings.missing") << std::endl;
+	std::cout << f.try_lookup<std::string>("b.test").get_value_or("none") << std::endl;
+	std::cout << f.try_lookup<std::string>("b.missing").get_value_or("none") << std::endl;
+
+	cconfig::load_options cached;
+	cached.lookup_cache = 16;
+	cconfig::file c("../../test/test.conf", cached);
+	std::cout << c.lookup<int>("settings.array[2]") << c.lookup<int>("settings.array[2]") << c.contains("settings.missing") << std::endl;
+	std::cout << c.cache_stats().hits << " " << c.cache_stats().misses << std::endl;
+
+	std::string subgroup_test;
+	int missing = 0;
+	cconfig::lookup_batch batch;
+	batch.add("settings.subgroup.test", subgroup_test).add("settings.missing", missing, 5);
+	cconfig::batch_result resolved = batch.resolve(f.root());
+	std::cout << subgroup_test << " " << missing << " " << resolved.defaulted.size() << resolved.ok() << std::endl;
+
+	const std::vector<std::string> column = cconfig::extract_column<std::string>(f.root(), cconfig::wildcard_path("settings.list[*].a"));
+	std::cout << column.size() << " " << column.back() << " " << cconfig::extract_column<int>(f.root(), cconfig::wildcard_path("settings.array[*]")).size() << std::endl;
+
+	atom_counter counter;
+	cconfig::parse_events("../../test/test.conf", counter);
+	std::cout << counter.atoms << std::endl;
+
+	std::ostringstream written;
+	cconfig::write_config(f.root(), written, cconfig::writer::compact);
+	const std::string rewritten = written.str();
+	cconfig::file reparsed;
+	reparsed.load_from_buffer(rewritten.data(), rewritten.size());
+	std::cout << rewritten.size() << " " << reparsed["settings.list[1].a"].as<std::string>() << std::endl;
+
+	cconfig::load_options indexed;
+	indexed.path_index = true;
+	cconfig::file i("../../test/test.conf", indexed);
+	std::cout << i["settings.list[1].a"].as<std::string>() << " " << i.index().size() << std::endl;
+	cconfig::path_index::range below = i.index().with_prefix("settings.array[");
+	std::cout << below.second - below.first << std::endl;
+
+	cconfig::load_options options;
+	options.input = cconfig::load_options::map_file;
+	cconfig::file mapped("../../test/test.conf", options);
+	std::cout << mapped["settings.list[0].a"].as<std::string>() << std::endl;
+
+	cconfig::load_options reference;
+	reference.parser = cconfig::load_options::antlr_parser;
+	cconfig::file antlr("../../test/test.conf", reference);
+	std::cout << antlr["settings.list[0].a"].as<std::string>() << std::endl;
+
+	const char buffer[] = "a = 1; b { test = \"from buffer\"; }";
+	cconfig::file from_buffer;
+	from_buffer.load_from_buffer(buffer, sizeof(buffer) - 1);
+	std::cout << from_buffer["b.test"].as<std::string>() << std::endl;
+
+	std::ifstream in("../../test/test.conf");
+	cconfig::file from_stream;
+	from_stream.load_from_stream(in);
+	std::cout << from_stream["settings.array[1]"].as<int>() << std::endl;
+
+	{
+		std::ofstream compiled("test.cconfb", std::ios::binary);
+		f.save_binary(compiled);
+	}
+	cconfig::file binary;
+	binary.load_binary("test.cconfb");
+	std::cout << binary["settings.list[0].a"].as<std::string>() << std::endl;
+
+	// both list elements refer to the same cell
+	const boost::uint32_t shared_cells[] = { cconfig::binary::group_cell, 1, 0, 4,
+		cconfig::binary::list_cell, 2, 8, 8, cconfig::binary::bool_cell, 1 };
+	std::string shared(cconfig::binary::detail::signature, sizeof(cconfig::binary::detail::signature));
+	cconfig::binary::detail::put_word(shared, cconfig::binary::format_version);
+	cconfig::binary::detail::put_word(shared, 1);
+	cconfig::binary::detail::put_word(shared, sizeof(shared_cells) / sizeof(shared_cells[0]));
+	cconfig::binary::detail::put_word(shared, 0);
+	cconfig::binary::detail::put_word(shared, 1);
+	for(size_t i = 0; i < sizeof(shared_cells) / sizeof(shared_cells[0]); i++)
+		cconfig::binary::detail::put_word(shared, shared_cells[i]);
+	shared += "x";
+	{
+		std::ofstream malformed("malformed.cconfb", std::ios::binary);
+		malformed << shared;
+	}
+	try
+	{
+		binary.load_binary("malformed.cconfb");
+	}
+	catch(const cconfig::exception& e)
+	{
+		std::cout << e.what() << std::endl;
+	}
+
+	cconfig::load_options lazy;
+	lazy.mode = cconfig::load_options::lazy;
+	cconfig::file lazy_file("../../test/test.conf", lazy);
+	std::cout << lazy_file["settings.list[0].a"].as<std::string>() << std::endl;
+	std::cout << lazy_file.root().size() << std::endl;
+
+	cconfig::load_options parallel;
+	parallel.mode = cconfig::load_options::parallel;
+	parallel.threads = 2;
+	cconfig::file parallel_file("../../test/test.conf", parallel);
+	std::cout << parallel_file.lookup<int>("settings.array[2]") << std::endl;
+
+	// large enough to be split into slices, arrays at their commas
+	std::ostringstream large;
+	large << "a = 1;\nnumbers = [";
+	for(int i = 0; i < 40000; i++)
+		large << (i != 0 ? ", " : "") << i;
+	large << "];\ngroups = (";
+	for(int i = 0; i < 20000; i++)
+		large << (i != 0 ? ", " : "") << "{ x = " << i << "; }";
+	large << ");\n";
+	const std::string large_config = large.str();
+	parallel.threads = 4;
+	cconfig::file large_parallel, large_sequential;
+	large_parallel.load_from_buffer(large_config.data(), large_config.size(), parallel);
+	large_sequential.load_from_buffer(large_config.data(), large_config.size());
+	std::ostringstream parallel_written, sequential_written;
+	cconfig::write_config(large_parallel.root(), parallel_written, cconfig::writer::compact);
+	cconfig::write_config(large_sequential.root(), sequential_written, cconfig::writer::compact);
+	std::cout << (parallel_written.str() == sequential_written.str()) << " "
+		<< large_parallel.lookup<int>("numbers[39999]") << std::endl;
+
+	// the first error in the input is reported, not the one of a split list
+	const std::string broken = "a = ;\n" + large_config.substr(6, large_config.size() - 9) + ", { x = ; });\n";
+	try
+	{
+		cconfig::file broken_parallel;
+		broken_parallel.load_from_buffer(broken.data(), broken.size(), parallel);
+	}
+	catch(const cconfig::parse_error& e)
+	{
+		std::cout << e.line() << ":" << e.column() << std::endl;
+	}
+
+	const char including[] = "extra {\n\t@include \"../../test/test.conf\"\n}\na = 4;";
+	cconfig::file included;
+	included.load_from_buffer(including, sizeof(including) - 1);
+	std::cout << included.lookup<int>("a") << " " << included.lookup<std::string>("extra.b.test") << std::endl;
+
+	cconfig::overlay layers;
+	layers.push(f);
+	layers.push(cconfig::file());
+	layers.push(included);
+	cconfig::file merged = layers.flatten();
+	std::cout << layers.lookup<int>("a") << " " << merged.lookup<int>("settings.array[1]") << " " << (&merged["settings"] == &f["settings"]) << std::endl;
+
+	boost::shared_ptr<const cconfig::element> handle = merged.shared_element("settings.subgroup");
+	merged = cconfig::file();
+	std::cout << handle->lookup<std::string>("test") << std::endl;
+
+	const char overflow[] = "a = 1;\nb = 99999999999999999999;";
+	try
+	{
+		cconfig::file out_of_range;
+		out_of_range.load_from_buffer(overflow, sizeof(overflow) - 1);
+	}
+	catch(const cconfig::parse_error& e)
+	{
+		std::cout << e.line() << ":" << e.column() << std::endl;
+	}
+
+	const cconfig::list& array = f["settings.array"].as_list();
+	std::cout << (array.storage() == cconfig::list::long_storage) << " " << array.long_values()[2] << std::endl;
+	std::vector<double> values = array.as_vector<double>();
+	std::cout << values.size() << " " << array.as_span<const long>()[1] << std::endl;
+	std::cout << f["settings.list[0].a"].as_atom().get_string_ref() << std::endl;
+
+	const cconfig::load_stats stats = f.stats();
+	if(cconfig::load_stats::enabled)
+		std::cout << stats.groups << " " << stats.lists << " " << stats.atoms << " " << stats.max_depth << std::endl;
+
+	cconfig::file compacted = f;
+	compacted.compact();
+	const cconfig::memory_stats loaded = f.root().memory_usage();
+	const cconfig::memory_stats fitted = compacted.root().memory_usage();
+	std::cout << (fitted.total() <= loaded.total()) << " " << compacted.lookup<std::string>("settings.list[1].a") << std::endl;
+
+	cconfig::live_file live(from_buffer);
+	cconfig::live_file::snapshot_type before = live.snapshot();
+	live.subscribe("b", print_changes);
+	live.publish(f);
+	std::cout << before->lookup<std::string>("b.test") << " " << live.contains("b.test") << std::endl;
+	cconfig::setting<long> answer(live, "a", 0L);
+	live.publish(included);
+	std::cout << *answer << " " << live.generation() << std::endl;
+
+	{
+		std::ofstream watched_file("watched.conf");
+		watched_file << "a = 1;";
+	}
+	cconfig::live_file watched("watched.conf");
+	cconfig::watch_options polled;
+	polled.polling = true;
+	polled.poll_interval = 10;
+	polled.debounce = 10;
+	cconfig::watcher w(watched, polled);
+	{
+		std::ofstream watched_file("watched.conf");
+		watched_file << "a = 22;";
+	}
+	for(int i = 0; i < 500 && watched.lookup<long>("a") == 1; i++)
+		boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+	std::cout << w.polling() << " " << watched.lookup<long>("a") << std::endl;
 	return 0;
 }
@@ -27,8 +27,11 @@
  */
 
 #include "config_file.hpp"
+#include "config_file_set.hpp"
 #include "config_schema.hpp"
 #include <iostream>
+#include <fstream>
+#include <sstream>
 
 int main()
 {
@@ -44,5 +47,32 @@ int main()
 	{
 		std::cout << "ERROR @ " << r.error_uri << ": " << r.error_message << std::endl;
 	}
+
+	// the compiled validator must agree with the recursive one
+	std::cout << (s.root()->validate(f.root(), true).valid == r.valid ? "SAME" : "DIFFERENT") << std::endl;
+
+	cconfig::schema::validation_options options;
+	options.strict = true;
+	options.threads = 2;
+	options.parallel_threshold = 1;
+	std::cout << (s.validate(f, options).valid == r.valid ? "SAME" : "DIFFERENT") << std::endl;
+
+	std::ifstream in("../../test/test.schema");
+	cconfig::schema::schema from_stream;
+	from_stream.load_from_stream(in);
+	std::cout << (from_stream.validate(f, true).valid ? "VALID" : "INVALID") << std::endl;
+
+	std::ostringstream compiled;
+	s.save_binary(compiled);
+	cconfig::schema::schema from_binary;
+	from_binary.load_binary(compiled.str().data(), compiled.str().size());
+	std::cout << (from_binary.validate(f, true).valid == r.valid ? "SAME" : "DIFFERENT") << std::endl;
+
+	cconfig::file_set set;
+	set.add("../../test/test.conf").add("../../test/missing.conf");
+	cconfig::file_set_options set_options;
+	set_options.schema = &s;
+	set_options.strict = true;
+	std::cout << set.load(set_options) << " " << set[0].valid() << " " << set[1].error << std::endl;
 	return 0;
 }